@@ -173,6 +173,7 @@ acl_add_list (u32 count, vl_api_acl_rule_t rules[],
   acl_list_t *a;
   acl_rule_t *r;
   acl_rule_t *acl_new_rules = 0;
+  int is_replace = 0;
   int i;
 
   if (*acl_list_index != ~0)
@@ -233,7 +234,7 @@ acl_add_list (u32 count, vl_api_acl_rule_t rules[],
   else
     {
       a = am->acls + *acl_list_index;
-      hash_acl_delete(am, *acl_list_index);
+      is_replace = 1;
       /* Get rid of the old rules */
       if (a->rules)
         vec_free (a->rules);
@@ -241,7 +242,10 @@ acl_add_list (u32 count, vl_api_acl_rule_t rules[],
   a->rules = acl_new_rules;
   a->count = count;
   memcpy (a->tag, tag, sizeof (a->tag));
-  hash_acl_add(am, *acl_list_index);
+  if (is_replace)
+    hash_acl_replace(am, *acl_list_index);
+  else
+    hash_acl_add(am, *acl_list_index);
   clib_mem_set_heap (oldheap);
   return 0;
 }
@@ -1360,17 +1364,21 @@ vl_api_acl_add_replace_t_handler (vl_api_acl_add_replace_t * mp)
   u32 acl_list_index = ntohl (mp->acl_index);
   u32 acl_count = ntohl (mp->count);
   u32 expected_len = sizeof(*mp) + acl_count*sizeof(mp->r[0]);
+  f64 update_start = vlib_time_now (am->vlib_main);
+  u32 update_usec;
 
   if (verify_message_len(mp, expected_len, "acl_add_replace")) {
       rv = acl_add_list (acl_count, mp->r, &acl_list_index, mp->tag);
   } else {
       rv = VNET_API_ERROR_INVALID_VALUE;
   }
+  update_usec = (vlib_time_now (am->vlib_main) - update_start) * 1e6;
 
   /* *INDENT-OFF* */
   REPLY_MACRO2(VL_API_ACL_ADD_REPLACE_REPLY,
   ({
     rmp->acl_index = htonl(acl_list_index);
+    rmp->update_usec = htonl(update_usec);
   }));
   /* *INDENT-ON* */
 }
@@ -2404,7 +2412,7 @@ acl_plugin_show_sessions(acl_main_t *am,
       vlib_cli_output(vm, "    tcp_flags_seen: %x", sess->tcp_flags_seen.as_u16);
       vlib_cli_output(vm, "    last active time: %lu", sess->last_active_time);
       vlib_cli_output(vm, "    thread index: %u", sess->thread_index);
-      vlib_cli_output(vm, "    link enqueue time: %lu", sess->link_enqueue_time);
+      vlib_cli_output(vm, "    timer handle: %u", sess->timer_handle);
       vlib_cli_output(vm, "    link next index: %u", sess->link_next_idx);
       vlib_cli_output(vm, "    link prev index: %u", sess->link_prev_idx);
       vlib_cli_output(vm, "    link list id: %u", sess->link_list_id);
@@ -2418,41 +2426,30 @@ acl_plugin_show_sessions(acl_main_t *am,
       vlib_cli_output(vm, "    sw_if_index %d: add %lu - del %lu = %lu", sw_if_index, n_adds, n_dels, n_adds - n_dels);
     }));
 
-    vlib_cli_output(vm, "  connection timeout type lists:", wk);
-    u8 tt = 0;
-    for(tt = 0; tt < ACL_N_TIMEOUTS; tt++) {
-      u32 head_session_index = pw->fa_conn_list_head[tt];
-      vlib_cli_output(vm, "  fa_conn_list_head[%d]: %d", tt, head_session_index);
-      if (~0 != head_session_index) {
-	fa_session_t *sess = pw->fa_sessions_pool + head_session_index;
-	vlib_cli_output(vm, "    last active time: %lu", sess->last_active_time);
-	vlib_cli_output(vm, "    link enqueue time: %lu", sess->link_enqueue_time);
-      }
+    vlib_cli_output(vm, "  TCP transient recycle list head: %d", pw->fa_recycle_list_head);
+    if (~0 != pw->fa_recycle_list_head) {
+      fa_session_t *sess = pw->fa_sessions_pool + pw->fa_recycle_list_head;
+      vlib_cli_output(vm, "    last active time: %lu", sess->last_active_time);
     }
 
-    vlib_cli_output(vm, "  Next expiry time: %lu", pw->next_expiry_time);
-    vlib_cli_output(vm, "  Requeue until time: %lu", pw->requeue_until_time);
-    vlib_cli_output(vm, "  Current time wait interval: %lu", pw->current_time_wait_interval);
+    vlib_cli_output(vm, "  Session timer wheel: %u timers, current tick %lu",
+                    pool_elts(pw->session_timer_wheel.timers), pw->session_timer_wheel.current_tick);
+    vlib_cli_output(vm, "  Expired sessions waiting to be checked: %u", vec_len(pw->expired));
+    vlib_cli_output(vm, "  Count of expired session timers: %lu", pw->cnt_session_timer_expired);
     vlib_cli_output(vm, "  Count of deleted sessions: %lu", pw->cnt_deleted_sessions);
     vlib_cli_output(vm, "  Delete already deleted: %lu", pw->cnt_already_deleted_sessions);
     vlib_cli_output(vm, "  Session timers restarted: %lu", pw->cnt_session_timer_restarted);
-    vlib_cli_output(vm, "  Swipe until this time: %lu", pw->swipe_end_time);
     vlib_cli_output(vm, "  sw_if_index serviced bitmap: %U", format_bitmap_hex, pw->serviced_sw_if_index_bitmap);
     vlib_cli_output(vm, "  pending clear intfc bitmap : %U", format_bitmap_hex, pw->pending_clear_sw_if_index_bitmap);
     vlib_cli_output(vm, "  clear in progress: %u", pw->clear_in_process);
     vlib_cli_output(vm, "  interrupt is pending: %d", pw->interrupt_is_pending);
-    vlib_cli_output(vm, "  interrupt is needed: %d", pw->interrupt_is_needed);
-    vlib_cli_output(vm, "  interrupt is unwanted: %d", pw->interrupt_is_unwanted);
-    vlib_cli_output(vm, "  interrupt generation: %d", pw->interrupt_generation);
   }
   vlib_cli_output(vm, "\n\nConn cleaner thread counters:");
 #define _(cnt, desc) vlib_cli_output(vm, "             %20lu: %s", am->cnt, desc);
   foreach_fa_cleaner_counter;
 #undef _
-  vlib_cli_output(vm, "Interrupt generation: %d", am->fa_interrupt_generation);
-  vlib_cli_output(vm, "Sessions per interval: min %lu max %lu increment: %f ms current: %f ms",
-	  am->fa_min_deleted_sessions_per_interval, am->fa_max_deleted_sessions_per_interval,
-	  am->fa_cleaner_wait_time_increment * 1000.0, ((f64)am->fa_current_cleaner_timer_wait_interval) * 1000.0/(f64)vm->clib_time.clocks_per_second);
+  vlib_cli_output(vm, "Sessions checked per cleaner run: max %lu",
+	  am->fa_max_deleted_sessions_per_interval);
 }
 
 static clib_error_t *
@@ -2527,6 +2524,17 @@ acl_plugin_print_pae(vlib_main_t *vm, int j, applied_hash_ace_entry_t *pae)
 				   pae->next_applied_entry_index, pae->prev_applied_entry_index, pae->tail_applied_entry_index, pae->hitcount);
 }
 
+static void
+acl_plugin_print_applied_mask_info(vlib_main_t *vm, char *dir, applied_hash_acl_info_t *pal)
+{
+  hash_applied_mask_info_t *minfo;
+  vlib_cli_output(vm, "  %s lookup mask type probe order:", dir);
+  vec_foreach(minfo, pal->applied_mask_info_vec) {
+    vlib_cli_output(vm, "    mask type index %d first applied entry %d",
+                    minfo->mask_type_index, minfo->first_applied_entry_index);
+  }
+}
+
 static void
 acl_plugin_show_tables_applied_info(acl_main_t *am, u32 sw_if_index)
 {
@@ -2546,6 +2554,7 @@ acl_plugin_show_tables_applied_info(acl_main_t *am, u32 sw_if_index)
 	applied_hash_acl_info_t *pal = &am->input_applied_hash_acl_info_by_sw_if_index[swi];
 	vlib_cli_output(vm, "  input lookup mask_type_index_bitmap: %U", format_bitmap_hex, pal->mask_type_index_bitmap);
 	vlib_cli_output(vm, "  input applied acls: %U", format_vec32, pal->applied_acls, "%d");
+	acl_plugin_print_applied_mask_info(vm, "input", pal);
       }
       if (swi < vec_len(am->input_hash_entry_vec_by_sw_if_index)) {
 	vlib_cli_output(vm, "  input lookup applied entries:");
@@ -2558,6 +2567,7 @@ acl_plugin_show_tables_applied_info(acl_main_t *am, u32 sw_if_index)
 	applied_hash_acl_info_t *pal = &am->output_applied_hash_acl_info_by_sw_if_index[swi];
 	vlib_cli_output(vm, "  output lookup mask_type_index_bitmap: %U", format_bitmap_hex, pal->mask_type_index_bitmap);
 	vlib_cli_output(vm, "  output applied acls: %U", format_vec32, pal->applied_acls, "%d");
+	acl_plugin_print_applied_mask_info(vm, "output", pal);
       }
       if (swi < vec_len(am->output_hash_entry_vec_by_sw_if_index)) {
 	vlib_cli_output(vm, "  output lookup applied entries:");
@@ -2776,27 +2786,19 @@ acl_init (vlib_main_t * vm)
   vec_validate(am->per_worker_data, tm->n_vlib_mains-1);
   {
     u16 wk;
-    u8 tt;
     for (wk = 0; wk < vec_len (am->per_worker_data); wk++) {
       acl_fa_per_worker_data_t *pw = &am->per_worker_data[wk];
-      vec_validate(pw->fa_conn_list_head, ACL_N_TIMEOUTS-1);
-      vec_validate(pw->fa_conn_list_tail, ACL_N_TIMEOUTS-1);
-      for(tt = 0; tt < ACL_N_TIMEOUTS; tt++) {
-        pw->fa_conn_list_head[tt] = ~0;
-        pw->fa_conn_list_tail[tt] = ~0;
-      }
+      pw->fa_recycle_list_head = ~0;
+      pw->fa_recycle_list_tail = ~0;
+      pw->cleaner_main_loop_count = ~0;
     }
   }
 
-  am->fa_min_deleted_sessions_per_interval = ACL_FA_DEFAULT_MIN_DELETED_SESSIONS_PER_INTERVAL;
   am->fa_max_deleted_sessions_per_interval = ACL_FA_DEFAULT_MAX_DELETED_SESSIONS_PER_INTERVAL;
-  am->fa_cleaner_wait_time_increment = ACL_FA_DEFAULT_CLEANER_WAIT_TIME_INCREMENT;
 
   am->fa_cleaner_cnt_delete_by_sw_index = 0;
   am->fa_cleaner_cnt_delete_by_sw_index_ok = 0;
   am->fa_cleaner_cnt_unknown_event = 0;
-  am->fa_cleaner_cnt_timer_restarted = 0;
-  am->fa_cleaner_cnt_wait_with_timeout = 0;
 
 
 #define _(N, v, s) am->fa_ipv6_known_eh_bitmap = clib_bitmap_set(am->fa_ipv6_known_eh_bitmap, v, 1);
@@ -190,6 +190,8 @@ typedef struct {
   clib_bihash_40_8_t fa_sessions_hash;
   /* The process node which orcherstrates the cleanup */
   u32 fa_cleaner_node_index;
+  /* set while the process wakes up the workers to age the sessions */
+  volatile u32 fa_cleaner_is_ticking;
   /* FA session timeouts, in seconds */
   u32 session_timeout_sec[ACL_N_TIMEOUTS];
   /* total session adds/dels */
@@ -221,28 +223,13 @@ typedef struct {
   u64 fa_conn_table_max_entries;
 
   /*
-   * If the cleaner has to delete more than this number
-   * of connections, it halves the sleep time.
+   * The maximum number of connections the per-worker cleaner
+   * checks for the idle timeout or deletes within a single run.
    */
 
 #define ACL_FA_DEFAULT_MAX_DELETED_SESSIONS_PER_INTERVAL 100
   u64 fa_max_deleted_sessions_per_interval;
 
-  /*
-   * If the cleaner deletes less than these connections,
-   * it increases the wait time by the "increment"
-   */
-
-#define ACL_FA_DEFAULT_MIN_DELETED_SESSIONS_PER_INTERVAL 1
-  u64 fa_min_deleted_sessions_per_interval;
-
-#define ACL_FA_DEFAULT_CLEANER_WAIT_TIME_INCREMENT 0.1
-  f64 fa_cleaner_wait_time_increment;
-
-  u64 fa_current_cleaner_timer_wait_interval;
-
-  int fa_interrupt_generation;
-
   /* per-worker data related t conn management */
   acl_fa_per_worker_data_t *per_worker_data;
 
@@ -256,7 +243,6 @@ typedef struct {
   _(fa_cleaner_cnt_delete_by_sw_index, "delete_by_sw_index events")        \
   _(fa_cleaner_cnt_delete_by_sw_index_ok, "delete_by_sw_index handled ok") \
   _(fa_cleaner_cnt_unknown_event, "unknown events received")               \
-  _(fa_cleaner_cnt_timer_restarted, "session idle timers restarted")       \
   _(fa_cleaner_cnt_wait_with_timeout, "event wait with timeout called")    \
   _(fa_cleaner_cnt_wait_without_timeout, "event wait w/o timeout called")  \
   _(fa_cleaner_cnt_event_cycles, "total event cycles")                     \
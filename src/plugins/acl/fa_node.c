@@ -28,6 +28,8 @@
 #include "fa_node.h"
 #include "hash_lookup.h"
 
+static vlib_node_registration_t acl_fa_worker_session_cleaner_process_node;
+
 typedef struct
 {
   u32 next_index;
@@ -572,7 +574,8 @@ fa_session_get_shortest_timeout(acl_main_t * am)
 }
 
 /*
- * Get the timeout of the session in a list since its enqueue time.
+ * Get the longest time a session can stay on the timer wheel
+ * before it is checked again.
  */
 
 static u64
@@ -580,8 +583,9 @@ fa_session_get_list_timeout (acl_main_t * am, fa_session_t * sess)
 {
   u64 timeout = am->vlib_main->clib_time.clocks_per_second;
   /*
-   * we have the shortest possible timeout type in all the lists
-   * (see README-multicore for the rationale)
+   * we always use the shortest possible timeout type, since another
+   * worker may change the timeout type of the session
+   * (see acl_multicore_doc.md for the rationale)
    */
   timeout *= fa_session_get_shortest_timeout(am);
   return timeout;
@@ -600,15 +604,52 @@ fa_session_get_timeout (acl_main_t * am, fa_session_t * sess)
   return timeout;
 }
 
+/*
+ * The timer wheels run off the TSC based time, which,
+ * unlike vlib_time_now(), is the same on all the threads.
+ */
+
+static inline f64
+acl_fa_tw_time_now (acl_main_t * am, u64 now)
+{
+  return ((f64) now) * am->vlib_main->clib_time.seconds_per_clock;
+}
+
+/*
+ * Get the number of timer wheel ticks until the session needs to be checked.
+ */
+
+static u64
+fa_session_get_timer_ticks (acl_main_t * am, fa_session_t * sess, u64 now)
+{
+  u64 timeout_time = sess->last_active_time + fa_session_get_timeout (am, sess);
+  u64 list_timeout_time = now + fa_session_get_list_timeout (am, sess);
+  u64 ticks = 0;
+
+  if (timeout_time > list_timeout_time)
+    timeout_time = list_timeout_time;
+  if (timeout_time > now)
+    ticks = acl_fa_tw_time_now (am, timeout_time - now) * ACL_FA_TW_TICKS_PER_SECOND;
+  /* round up, expiring a bit late is fine, expiring early is wasted work */
+  ticks++;
+  if (ticks > ACL_FA_TW_MAX_TIMER_TICKS)
+    ticks = ACL_FA_TW_MAX_TIMER_TICKS;
+  return ticks;
+}
+
 static void
 acl_fa_verify_init_sessions (acl_main_t * am)
 {
   if (!am->fa_sessions_hash_is_initialized) {
     u16 wk;
-    /* Allocate the per-worker sessions pools */
+    /* Allocate the per-worker sessions pools and the timer wheels */
     for (wk = 0; wk < vec_len (am->per_worker_data); wk++) {
       acl_fa_per_worker_data_t *pw = &am->per_worker_data[wk];
       pool_alloc_aligned(pw->fa_sessions_pool, am->fa_conn_table_max_entries, CLIB_CACHE_LINE_BYTES);
+      tw_timer_wheel_init_16t_2w_512sl (&pw->session_timer_wheel, 0 /* no callback */,
+                                        ACL_FA_TW_TIMER_INTERVAL,
+                                        am->fa_max_deleted_sessions_per_interval);
+      pw->session_timer_wheel.last_run_time = acl_fa_tw_time_now (am, clib_cpu_time_now ());
     }
 
     /* ... and the interface session hash table */
@@ -627,93 +668,136 @@ static inline fa_session_t *get_session_ptr(acl_main_t *am, u16 thread_index, u3
   return sess;
 }
 
-static inline int is_valid_session_ptr(acl_main_t *am, u16 thread_index, fa_session_t *sess)
+/*
+ * The worker cleaner node runs off interrupts. The cleaner process
+ * sends them once per timer wheel tick to the workers which have
+ * sessions, and the worker node only reposts one to itself while it
+ * has expired sessions left to check or a clearing to finish, so the
+ * idle sessions are aged on the worker that owns them without keeping
+ * it polling.
+ */
+
+static void
+send_one_worker_interrupt (acl_main_t *am, int thread_index)
 {
   acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
-  return ((sess != 0) && ((sess - pw->fa_sessions_pool) < pool_len(pw->fa_sessions_pool)));
+  if (!clib_smp_swap (&pw->interrupt_is_pending, 1)) {
+    vlib_node_set_interrupt_pending (vlib_mains[thread_index],
+                  acl_fa_worker_session_cleaner_process_node.index);
+  }
 }
 
 static void
-acl_fa_conn_list_add_session (acl_main_t * am, fa_full_session_id_t sess_id, u64 now)
+acl_fa_session_timer_start (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+			    fa_full_session_id_t sess_id, fa_session_t * sess, u64 now)
 {
-  fa_session_t *sess = get_session_ptr(am, sess_id.thread_index, sess_id.session_index);
-  u8 list_id = fa_session_get_timeout_type(am, sess);
-  uword thread_index = os_get_thread_index ();
-  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
-  /* the retrieved session thread index must be necessarily the same as the one in the key */
-  ASSERT (sess->thread_index == sess_id.thread_index);
-  /* the retrieved session thread index must be the same as current thread */
-  ASSERT (sess->thread_index == thread_index);
-  sess->link_enqueue_time = now;
-  sess->link_list_id = list_id;
+  ASSERT(sess->timer_handle == ACL_FA_TW_TIMER_HANDLE_INVALID);
+  sess->timer_handle =
+    tw_timer_start_16t_2w_512sl (&pw->session_timer_wheel, sess_id.session_index,
+                                 ACL_FA_TW_SESSION_TIMER_ID,
+                                 fa_session_get_timer_ticks (am, sess, now));
+}
+
+static void
+acl_fa_session_timer_stop (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+			   fa_session_t * sess)
+{
+  if (ACL_FA_TW_TIMER_HANDLE_INVALID != sess->timer_handle) {
+    tw_timer_stop_16t_2w_512sl (&pw->session_timer_wheel, sess->timer_handle);
+    sess->timer_handle = ACL_FA_TW_TIMER_HANDLE_INVALID;
+  }
+}
+
+/*
+ * The TCP transient sessions are kept on a FIFO list in the order
+ * they became transient, so we know which one to recycle
+ * when the session table is full.
+ */
+
+static void
+acl_fa_recycle_list_add_session (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+				 fa_full_session_id_t sess_id, fa_session_t * sess)
+{
+  sess->link_list_id = ACL_TIMEOUT_TCP_TRANSIENT;
   sess->link_next_idx = ~0;
-  sess->link_prev_idx = pw->fa_conn_list_tail[list_id];
-  if (~0 != pw->fa_conn_list_tail[list_id]) {
-    fa_session_t *prev_sess = get_session_ptr(am, thread_index, pw->fa_conn_list_tail[list_id]);
+  sess->link_prev_idx = pw->fa_recycle_list_tail;
+  if (~0 != pw->fa_recycle_list_tail) {
+    fa_session_t *prev_sess = get_session_ptr(am, sess_id.thread_index, pw->fa_recycle_list_tail);
     prev_sess->link_next_idx = sess_id.session_index;
-    /* We should never try to link with a session on another thread */
-    ASSERT(prev_sess->thread_index == sess->thread_index);
   }
-  pw->fa_conn_list_tail[list_id] = sess_id.session_index;
-  pw->serviced_sw_if_index_bitmap = clib_bitmap_set(pw->serviced_sw_if_index_bitmap, sess->sw_if_index, 1);
-
-  if (~0 == pw->fa_conn_list_head[list_id]) {
-    pw->fa_conn_list_head[list_id] = sess_id.session_index;
+  pw->fa_recycle_list_tail = sess_id.session_index;
+  if (~0 == pw->fa_recycle_list_head) {
+    pw->fa_recycle_list_head = sess_id.session_index;
   }
 }
 
-static int
-acl_fa_conn_list_delete_session (acl_main_t *am, fa_full_session_id_t sess_id)
+static void
+acl_fa_recycle_list_delete_session (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+				    fa_full_session_id_t sess_id, fa_session_t * sess)
 {
-  uword thread_index = os_get_thread_index ();
-  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
-  if (thread_index != sess_id.thread_index) {
-    /* If another thread attempts to delete the session, fail it. */
-#ifdef FA_NODE_VERBOSE_DEBUG
-    clib_warning("thread id in key %d != curr thread index, not deleting");
-#endif
-    return 0;
+  if (ACL_TIMEOUT_TCP_TRANSIENT != sess->link_list_id) {
+    return;
   }
-  fa_session_t *sess = get_session_ptr(am, sess_id.thread_index, sess_id.session_index);
-  /* we should never try to delete the session with another thread index */
-  ASSERT(sess->thread_index == thread_index);
   if (~0 != sess->link_prev_idx) {
-    fa_session_t *prev_sess = get_session_ptr(am, thread_index, sess->link_prev_idx);
-    /* the previous session must be in the same list as this one */
-    ASSERT(prev_sess->link_list_id == sess->link_list_id);
+    fa_session_t *prev_sess = get_session_ptr(am, sess_id.thread_index, sess->link_prev_idx);
     prev_sess->link_next_idx = sess->link_next_idx;
   }
   if (~0 != sess->link_next_idx) {
-    fa_session_t *next_sess = get_session_ptr(am, thread_index, sess->link_next_idx);
-    /* The next session must be in the same list as the one we are deleting */
-    ASSERT(next_sess->link_list_id == sess->link_list_id);
+    fa_session_t *next_sess = get_session_ptr(am, sess_id.thread_index, sess->link_next_idx);
     next_sess->link_prev_idx = sess->link_prev_idx;
   }
-  if (pw->fa_conn_list_head[sess->link_list_id] == sess_id.session_index) {
-    pw->fa_conn_list_head[sess->link_list_id] = sess->link_next_idx;
+  if (pw->fa_recycle_list_head == sess_id.session_index) {
+    pw->fa_recycle_list_head = sess->link_next_idx;
   }
-  if (pw->fa_conn_list_tail[sess->link_list_id] == sess_id.session_index) {
-    pw->fa_conn_list_tail[sess->link_list_id] = sess->link_prev_idx;
+  if (pw->fa_recycle_list_tail == sess_id.session_index) {
+    pw->fa_recycle_list_tail = sess->link_prev_idx;
+  }
+  sess->link_list_id = ~0;
+  sess->link_prev_idx = ~0;
+  sess->link_next_idx = ~0;
+}
+
+static void
+acl_fa_recycle_list_update_session (acl_main_t * am, acl_fa_per_worker_data_t * pw,
+				    fa_full_session_id_t sess_id, fa_session_t * sess)
+{
+  int is_transient = (ACL_TIMEOUT_TCP_TRANSIENT == fa_session_get_timeout_type(am, sess));
+  int is_linked = (ACL_TIMEOUT_TCP_TRANSIENT == sess->link_list_id);
+  if (is_transient && !is_linked) {
+    acl_fa_recycle_list_add_session(am, pw, sess_id, sess);
+  } else if (!is_transient && is_linked) {
+    acl_fa_recycle_list_delete_session(am, pw, sess_id, sess);
   }
-  return 1;
 }
 
 static int
 acl_fa_restart_timer_for_session (acl_main_t * am, u64 now, fa_full_session_id_t sess_id)
 {
-  if (acl_fa_conn_list_delete_session(am, sess_id)) {
-    acl_fa_conn_list_add_session(am, sess_id, now);
-    return 1;
-  } else {
+  uword thread_index = os_get_thread_index ();
+  if (thread_index != sess_id.thread_index) {
     /*
-     * Our thread does not own this connection, so we can not delete
-     * The session. To avoid the complicated signaling, we simply
-     * pick the list waiting time to be the shortest of the timeouts.
+     * Our thread does not own this connection, so we can not touch
+     * its timer. To avoid the complicated signaling, the timer of
+     * a session never exceeds the shortest of the timeouts.
      * This way we do not have to do anything special, and let
-     * the regular requeue check take care of everything.
+     * the regular timer expiry take care of everything.
      */
     return 0;
   }
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
+  fa_session_t *sess = get_session_ptr(am, sess_id.thread_index, sess_id.session_index);
+  void *oldheap = clib_mem_set_heap(am->acl_mheap);
+  acl_fa_recycle_list_update_session(am, pw, sess_id, sess);
+  /*
+   * If the timer has already expired, the session is waiting to be
+   * checked, which will restart the timer as needed.
+   */
+  if (ACL_FA_TW_TIMER_HANDLE_INVALID != sess->timer_handle) {
+    acl_fa_session_timer_stop(am, pw, sess);
+    acl_fa_session_timer_start(am, pw, sess_id, sess, now);
+  }
+  clib_mem_set_heap (oldheap);
+  return 1;
 }
 
 
@@ -739,9 +823,9 @@ acl_fa_delete_session (acl_main_t * am, u32 sw_if_index, fa_full_session_id_t se
   BV (clib_bihash_add_del) (&am->fa_sessions_hash,
 			    &sess->info.kv, 0);
   acl_fa_per_worker_data_t *pw = &am->per_worker_data[sess_id.thread_index];
+  acl_fa_session_timer_stop(am, pw, sess);
+  acl_fa_recycle_list_delete_session(am, pw, sess_id, sess);
   pool_put_index (pw->fa_sessions_pool, sess_id.session_index);
-  /* Deleting from timer structures not needed,
-     as the caller must have dealt with the timers. */
   vec_validate (pw->fa_session_dels_by_sw_if_index, sw_if_index);
   clib_mem_set_heap (oldheap);
   pw->fa_session_dels_by_sw_if_index[sw_if_index]++;
@@ -756,36 +840,12 @@ acl_fa_can_add_session (acl_main_t * am, int is_input, u32 sw_if_index)
   return (curr_sess_count < am->fa_conn_table_max_entries);
 }
 
-static u64
-acl_fa_get_list_head_expiry_time(acl_main_t *am, acl_fa_per_worker_data_t *pw, u64 now, u16 thread_index, int timeout_type)
-{
-  fa_session_t *sess = get_session_ptr(am, thread_index, pw->fa_conn_list_head[timeout_type]);
-  /*
-   * We can not check just the index here because inbetween the worker thread might
-   * dequeue the connection from the head just as we are about to check it.
-   */
-  if (!is_valid_session_ptr(am, thread_index, sess)) {
-    return ~0LL; // infinity.
-  } else {
-    u64 timeout_time =
-              sess->link_enqueue_time + fa_session_get_list_timeout (am, sess);
-    return timeout_time;
-  }
-}
-
-static int
-acl_fa_conn_time_to_check (acl_main_t *am, acl_fa_per_worker_data_t *pw, u64 now, u16 thread_index, u32 session_index)
-{
-  fa_session_t *sess = get_session_ptr(am, thread_index, session_index);
-  u64 timeout_time =
-              sess->link_enqueue_time + fa_session_get_list_timeout (am, sess);
-  return (timeout_time < now) || (sess->link_enqueue_time <= pw->swipe_end_time);
-}
-
 /*
- * see if there are sessions ready to be checked,
- * do the maintenance (requeue or delete), and
- * return the total number of sessions reclaimed.
+ * Advance the timer wheel if all the previously expired timers
+ * have been dealt with, then check up to fa_max_deleted_sessions_per_interval
+ * of the sessions with the expired timers: delete the ones which
+ * have been idle for longer than their timeout, and restart
+ * the timers for the rest. Return the number of the sessions checked.
  */
 static int
 acl_fa_check_idle_sessions(acl_main_t *am, u16 thread_index, u64 now)
@@ -793,69 +853,95 @@ acl_fa_check_idle_sessions(acl_main_t *am, u16 thread_index, u64 now)
   acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
   fa_full_session_id_t fsid;
   fsid.thread_index = thread_index;
-  int total_expired = 0;
+  int total_checked = 0;
+  void *oldheap = clib_mem_set_heap(am->acl_mheap);
 
-  {
-    u8 tt = 0;
-    for(tt = 0; tt < ACL_N_TIMEOUTS; tt++) {
-      while((vec_len(pw->expired) < am->fa_max_deleted_sessions_per_interval)
-	    && (~0 != pw->fa_conn_list_head[tt])
-	    && (acl_fa_conn_time_to_check(am, pw, now, thread_index,
-					  pw->fa_conn_list_head[tt]))) {
-	fsid.session_index = pw->fa_conn_list_head[tt];
-	vec_add1(pw->expired, fsid.session_index);
-	acl_fa_conn_list_delete_session(am, fsid);
-      }
+  if (0 == vec_len(pw->expired)) {
+    u32 *psid;
+    pw->expired = tw_timer_expire_timers_vec_16t_2w_512sl (&pw->session_timer_wheel,
+                                                           acl_fa_tw_time_now (am, now),
+                                                           pw->expired);
+    vec_foreach (psid, pw->expired)
+    {
+      /* strip the timer id, leaving the session index */
+      *psid &= 0x0FFFFFFF;
+      fa_session_t *sess = get_session_ptr(am, thread_index, *psid);
+      /* the timer is gone, the session is waiting to be checked */
+      if (sess)
+        sess->timer_handle = ACL_FA_TW_TIMER_HANDLE_INVALID;
     }
+    pw->cnt_session_timer_expired += vec_len(pw->expired);
   }
 
-  u32 *psid = NULL;
-  vec_foreach (psid, pw->expired)
-  {
-    fsid.session_index = *psid;
-    if (!pool_is_free_index (pw->fa_sessions_pool, fsid.session_index))
+  while ((total_checked < am->fa_max_deleted_sessions_per_interval)
+         && (vec_len(pw->expired) > 0)) {
+    fsid.session_index = vec_pop(pw->expired);
+    fa_session_t *sess = get_session_ptr(am, thread_index, fsid.session_index);
+    total_checked++;
+    /*
+     * The session might have been deleted while waiting to be checked,
+     * and the pool index may be reused by a new session with a running timer.
+     */
+    if ((0 == sess) || (ACL_FA_TW_TIMER_HANDLE_INVALID != sess->timer_handle))
+      {
+	pw->cnt_already_deleted_sessions++;
+	continue;
+      }
+    u64 sess_timeout_time =
+      sess->last_active_time + fa_session_get_timeout (am, sess);
+    if (now < sess_timeout_time)
       {
-	fa_session_t *sess = get_session_ptr(am, thread_index, fsid.session_index);
-	u32 sw_if_index = sess->sw_if_index;
-	u64 sess_timeout_time =
-	  sess->last_active_time + fa_session_get_timeout (am, sess);
-	if ((now < sess_timeout_time) && (0 == clib_bitmap_get(pw->pending_clear_sw_if_index_bitmap, sw_if_index)))
-	  {
-#ifdef FA_NODE_VERBOSE_DEBUG
-	    clib_warning ("ACL_FA_NODE_CLEAN: Restarting timer for session %d",
-	       (int) session_index);
-#endif
-	    /* There was activity on the session, so the idle timeout
-	       has not passed. Enqueue for another time period. */
-
-	    acl_fa_conn_list_add_session(am, fsid, now);
-	    pw->cnt_session_timer_restarted++;
-	  }
-	else
-	  {
 #ifdef FA_NODE_VERBOSE_DEBUG
-	    clib_warning ("ACL_FA_NODE_CLEAN: Deleting session %d",
-	       (int) session_index);
+	clib_warning ("ACL_FA_NODE_CLEAN: Restarting timer for session %d",
+	   (int) fsid.session_index);
 #endif
-	    acl_fa_delete_session (am, sw_if_index, fsid);
-	    pw->cnt_deleted_sessions++;
-	  }
+	/* There was activity on the session, so the idle timeout
+	   has not passed. Wait for the remainder of it. */
+	acl_fa_session_timer_start(am, pw, fsid, sess, now);
+	pw->cnt_session_timer_restarted++;
       }
     else
       {
-	pw->cnt_already_deleted_sessions++;
+#ifdef FA_NODE_VERBOSE_DEBUG
+	clib_warning ("ACL_FA_NODE_CLEAN: Deleting session %d",
+	   (int) fsid.session_index);
+#endif
+	acl_fa_delete_session (am, sess->sw_if_index, fsid);
+	pw->cnt_deleted_sessions++;
       }
   }
-  total_expired = vec_len(pw->expired);
-  /* zero out the vector which we have acted on */
-  if (pw->expired)
-    _vec_len (pw->expired) = 0;
-  /* if we were advancing and reached the end
-   * (no more sessions to recycle), reset the fast-forward timestamp */
-
-  if (pw->swipe_end_time && 0 == total_expired)
-    pw->swipe_end_time = 0;
-  return (total_expired);
+  clib_mem_set_heap (oldheap);
+  return (total_checked);
+}
+
+/*
+ * Delete a bounded number of the sessions on the interfaces
+ * requested to be cleared, continuing the walk over the session pool
+ * from where the previous call has stopped.
+ * Return 1 once the whole pool has been walked.
+ */
+static int
+acl_fa_clear_sessions_by_sw_if_index (acl_main_t *am, u16 thread_index)
+{
+  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
+  fa_full_session_id_t fsid;
+  fsid.thread_index = thread_index;
+  u32 n_visited = 0;
+  u32 n_deleted = 0;
+
+  while ((pw->clear_session_index < pool_len(pw->fa_sessions_pool))
+         && (n_visited < ACL_FA_CLEAR_MAX_VISITED_SESSIONS)
+         && (n_deleted < am->fa_max_deleted_sessions_per_interval)) {
+    fsid.session_index = pw->clear_session_index++;
+    n_visited++;
+    fa_session_t *sess = get_session_ptr(am, thread_index, fsid.session_index);
+    if (sess && clib_bitmap_get(pw->pending_clear_sw_if_index_bitmap, sess->sw_if_index)) {
+      acl_fa_delete_session (am, sess->sw_if_index, fsid);
+      pw->cnt_deleted_sessions++;
+      n_deleted++;
+    }
+  }
+  return (pw->clear_session_index >= pool_len(pw->fa_sessions_pool));
 }
 
 always_inline void
@@ -863,12 +949,10 @@ acl_fa_try_recycle_session (acl_main_t * am, int is_input, u16 thread_index, u32
 {
   /* try to recycle a TCP transient session */
   acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
-  u8 timeout_type = ACL_TIMEOUT_TCP_TRANSIENT;
   fa_full_session_id_t sess_id;
-  sess_id.session_index = pw->fa_conn_list_head[timeout_type];
+  sess_id.session_index = pw->fa_recycle_list_head;
   if (~0 != sess_id.session_index) {
     sess_id.thread_index = thread_index;
-    acl_fa_conn_list_delete_session(am, sess_id);
     acl_fa_delete_session(am, sw_if_index, sess_id);
   }
 }
@@ -902,6 +986,7 @@ acl_fa_add_session (acl_main_t * am, int is_input, u32 sw_if_index, u64 now,
   sess->sw_if_index = sw_if_index;
   sess->tcp_flags_seen.as_u16 = 0;
   sess->thread_index = thread_index;
+  sess->timer_handle = ACL_FA_TW_TIMER_HANDLE_INVALID;
   sess->link_list_id = ~0;
   sess->link_prev_idx = ~0;
   sess->link_next_idx = ~0;
@@ -911,24 +996,102 @@ acl_fa_add_session (acl_main_t * am, int is_input, u32 sw_if_index, u64 now,
   ASSERT(am->fa_sessions_hash_is_initialized == 1);
   BV (clib_bihash_add_del) (&am->fa_sessions_hash,
 			    &kv, 1);
-  acl_fa_conn_list_add_session(am, f_sess_id, now);
+  acl_fa_session_timer_start(am, pw, f_sess_id, sess, now);
+  acl_fa_recycle_list_update_session(am, pw, f_sess_id, sess);
+  pw->serviced_sw_if_index_bitmap = clib_bitmap_set(pw->serviced_sw_if_index_bitmap, sw_if_index, 1);
 
   vec_validate (pw->fa_session_adds_by_sw_if_index, sw_if_index);
   clib_mem_set_heap (oldheap);
   pw->fa_session_adds_by_sw_if_index[sw_if_index]++;
   clib_smp_atomic_add(&am->fa_session_total_adds, 1);
+  /*
+   * make sure the cleaner process ticks to age the session. The atomic add
+   * above orders the count before the flag, which is mostly set already:
+   * it is only written when the process has stopped ticking.
+   */
+  if (PREDICT_FALSE (!am->fa_cleaner_is_ticking)
+      && !clib_smp_swap (&am->fa_cleaner_is_ticking, 1))
+    vlib_process_signal_event_mt (am->vlib_main, am->fa_cleaner_node_index,
+                                  ACL_FA_CLEANER_RESCHEDULE, 0);
   return sess;
 }
 
 static int
-acl_fa_find_session (acl_main_t * am, u32 sw_if_index0, fa_5tuple_t * p5tuple,
-		     clib_bihash_kv_40_8_t * pvalue_sess)
+acl_fa_find_session_with_hash (acl_main_t * am, u32 sw_if_index0, u64 hash,
+			       fa_5tuple_t * p5tuple,
+			       clib_bihash_kv_40_8_t * pvalue_sess)
 {
-  return (BV (clib_bihash_search)
-	  (&am->fa_sessions_hash, &p5tuple->kv,
-	   pvalue_sess) == 0);
+  return (BV (clib_bihash_search_inline_2_with_hash)
+	  (&am->fa_sessions_hash, hash, &p5tuple->kv, pvalue_sess) == 0);
 }
 
+/* How far ahead of the current packet to prefetch the session hash data */
+#define ACL_FA_SESSION_PREFETCH_STRIDE 4
+
+/*
+ * First pass over the frame: extract the 5-tuples and the session keys
+ * of all the packets, compute the session hashes and prefetch the buckets,
+ * so the lookups in the second pass mostly hit the cache.
+ */
+always_inline void
+acl_fa_node_prepare_fn (vlib_main_t * vm, acl_main_t * am,
+			vlib_frame_t * frame, int is_ip6, int is_input,
+			int is_l2_path, u32 * sw_if_indices,
+			fa_5tuple_t * fa_5tuples, fa_5tuple_t * sess_keys,
+			u64 * hashes)
+{
+  u32 n_left = frame->n_vectors;
+  u32 *from = vlib_frame_vector_args (frame);
+  int with_sessions = acl_fa_ifc_has_sessions (am, 0);
+
+  while (n_left > 0)
+    {
+      vlib_buffer_t *b0;
+      u32 sw_if_index0;
+
+      if (n_left > 2)
+	{
+	  vlib_buffer_t *p2 = vlib_get_buffer (vm, from[2]);
+	  vlib_prefetch_buffer_header (p2, LOAD);
+	  CLIB_PREFETCH (p2->data, 2 * CLIB_CACHE_LINE_BYTES, LOAD);
+	}
+
+      b0 = vlib_get_buffer (vm, from[0]);
+
+      if (is_input)
+	sw_if_index0 = vnet_buffer (b0)->sw_if_index[VLIB_RX];
+      else
+	sw_if_index0 = vnet_buffer (b0)->sw_if_index[VLIB_TX];
+
+      /*
+       * Extract the L3/L4 matching info into a 5-tuple structure,
+       * then create a session key whose layout is independent on forward or reverse
+       * direction of the packet.
+       */
+
+      acl_fill_5tuple (am, b0, is_ip6, is_input, is_l2_path, fa_5tuples);
+      fa_5tuples->l4.lsb_of_sw_if_index = sw_if_index0 & 0xffff;
+      acl_make_5tuple_session_key (is_input, fa_5tuples, sess_keys);
+      fa_5tuples->pkt.sw_if_index = sw_if_index0;
+      fa_5tuples->pkt.is_ip6 = is_ip6;
+      fa_5tuples->pkt.is_input = is_input;
+      fa_5tuples->pkt.mask_type_index_lsb = ~0;
+
+      if (with_sessions)
+	{
+	  hashes[0] = BV (clib_bihash_hash) (&sess_keys->kv);
+	  BV (clib_bihash_prefetch_bucket) (&am->fa_sessions_hash, hashes[0]);
+	}
+
+      sw_if_indices[0] = sw_if_index0;
+      fa_5tuples++;
+      sess_keys++;
+      hashes++;
+      sw_if_indices++;
+      from++;
+      n_left--;
+    }
+}
 
 always_inline uword
 acl_fa_node_fn (vlib_main_t * vm,
@@ -945,11 +1108,15 @@ acl_fa_node_fn (vlib_main_t * vm,
   u32 pkts_restart_session_timer = 0;
   u32 trace_bitmap = 0;
   acl_main_t *am = &acl_main;
-  fa_5tuple_t fa_5tuple, kv_sess;
   clib_bihash_kv_40_8_t value_sess;
   vlib_node_runtime_t *error_node;
   u64 now = clib_cpu_time_now ();
   uword thread_index = os_get_thread_index ();
+  u32 sw_if_indices[VLIB_FRAME_SIZE], *sw_if_index;
+  fa_5tuple_t fa_5tuples[VLIB_FRAME_SIZE], *fa_5tuple;
+  fa_5tuple_t sess_keys[VLIB_FRAME_SIZE], *kv_sess;
+  u64 hashes[VLIB_FRAME_SIZE], *hash;
+  int with_sessions = acl_fa_ifc_has_sessions (am, 0);
 
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;
@@ -957,6 +1124,14 @@ acl_fa_node_fn (vlib_main_t * vm,
 
   error_node = vlib_node_get_runtime (vm, acl_fa_node->index);
 
+  acl_fa_node_prepare_fn (vm, am, frame, is_ip6, is_input, is_l2_path,
+			  sw_if_indices, fa_5tuples, sess_keys, hashes);
+
+  sw_if_index = sw_if_indices;
+  fa_5tuple = fa_5tuples;
+  kv_sess = sess_keys;
+  hash = hashes;
+
   while (n_left_from > 0)
     {
       u32 n_left_to_next;
@@ -975,6 +1150,10 @@ acl_fa_node_fn (vlib_main_t * vm,
 	  u32 match_rule_index = ~0;
 	  u8 error0 = 0;
 
+	  if (with_sessions && n_left_from > ACL_FA_SESSION_PREFETCH_STRIDE)
+	    BV (clib_bihash_prefetch_data) (&am->fa_sessions_hash,
+					     hash[ACL_FA_SESSION_PREFETCH_STRIDE]);
+
 	  /* speculatively enqueue b0 to the current next frame */
 	  bi0 = from[0];
 	  to_next[0] = bi0;
@@ -984,42 +1163,25 @@ acl_fa_node_fn (vlib_main_t * vm,
 	  n_left_to_next -= 1;
 
 	  b0 = vlib_get_buffer (vm, bi0);
+	  sw_if_index0 = sw_if_index[0];
 
-	  if (is_input)
-	    sw_if_index0 = vnet_buffer (b0)->sw_if_index[VLIB_RX];
-	  else
-	    sw_if_index0 = vnet_buffer (b0)->sw_if_index[VLIB_TX];
-
-	  /*
-	   * Extract the L3/L4 matching info into a 5-tuple structure,
-	   * then create a session key whose layout is independent on forward or reverse
-	   * direction of the packet.
-	   */
-
-	  acl_fill_5tuple (am, b0, is_ip6, is_input, is_l2_path, &fa_5tuple);
-          fa_5tuple.l4.lsb_of_sw_if_index = sw_if_index0 & 0xffff;
-	  acl_make_5tuple_session_key (is_input, &fa_5tuple, &kv_sess);
-	  fa_5tuple.pkt.sw_if_index = sw_if_index0;
-          fa_5tuple.pkt.is_ip6 = is_ip6;
-          fa_5tuple.pkt.is_input = is_input;
-          fa_5tuple.pkt.mask_type_index_lsb = ~0;
 #ifdef FA_NODE_VERBOSE_DEBUG
 	  clib_warning
 	    ("ACL_FA_NODE_DBG: session 5-tuple %016llx %016llx %016llx %016llx %016llx : %016llx",
-	     kv_sess.kv.key[0], kv_sess.kv.key[1], kv_sess.kv.key[2],
-	     kv_sess.kv.key[3], kv_sess.kv.key[4], kv_sess.kv.value);
+	     kv_sess->kv.key[0], kv_sess->kv.key[1], kv_sess->kv.key[2],
+	     kv_sess->kv.key[3], kv_sess->kv.key[4], kv_sess->kv.value);
 	  clib_warning
 	    ("ACL_FA_NODE_DBG: packet 5-tuple %016llx %016llx %016llx %016llx %016llx : %016llx",
-	     fa_5tuple.kv.key[0], fa_5tuple.kv.key[1], fa_5tuple.kv.key[2],
-	     fa_5tuple.kv.key[3], fa_5tuple.kv.key[4], fa_5tuple.kv.value);
+	     fa_5tuple->kv.key[0], fa_5tuple->kv.key[1], fa_5tuple->kv.key[2],
+	     fa_5tuple->kv.key[3], fa_5tuple->kv.key[4], fa_5tuple->kv.value);
 #endif
 
 	  /* Try to match an existing session first */
 
-	  if (acl_fa_ifc_has_sessions (am, sw_if_index0))
+	  if (with_sessions)
 	    {
-	      if (acl_fa_find_session
-		  (am, sw_if_index0, &kv_sess, &value_sess))
+	      if (acl_fa_find_session_with_hash
+		  (am, sw_if_index0, hash[0], kv_sess, &value_sess))
 		{
 		  trace_bitmap |= 0x80000000;
 		  error0 = ACL_FA_ERROR_ACL_EXIST_SESSION;
@@ -1033,7 +1195,7 @@ acl_fa_node_fn (vlib_main_t * vm,
 		    fa_session_get_timeout_type (am, sess);
 		  action =
 		    acl_fa_track_session (am, is_input, sw_if_index0, now,
-					  sess, &fa_5tuple);
+					  sess, fa_5tuple);
 		  /* expose the session id to the tracer */
 		  match_rule_index = f_sess_id.session_index;
 		  int new_timeout_type =
@@ -1069,7 +1231,7 @@ acl_fa_node_fn (vlib_main_t * vm,
 	  if (acl_check_needed)
 	    {
 	      action =
-		multi_acl_match_5tuple (sw_if_index0, &fa_5tuple, is_l2_path,
+		multi_acl_match_5tuple (sw_if_index0, fa_5tuple, is_l2_path,
 				       is_ip6, is_input, &match_acl_in_index,
 				       &match_rule_index, &trace_bitmap);
 	      error0 = action;
@@ -1083,9 +1245,9 @@ acl_fa_node_fn (vlib_main_t * vm,
 		  if (acl_fa_can_add_session (am, is_input, sw_if_index0))
 		    {
                       fa_session_t *sess = acl_fa_add_session (am, is_input, sw_if_index0, now,
-					                       &kv_sess);
+					                       kv_sess);
                       acl_fa_track_session (am, is_input, sw_if_index0, now,
-                                            sess, &fa_5tuple);
+                                            sess, fa_5tuple);
 		      pkts_new_session += 1;
 		    }
 		  else
@@ -1114,12 +1276,12 @@ acl_fa_node_fn (vlib_main_t * vm,
 	      t->next_index = next0;
 	      t->match_acl_in_index = match_acl_in_index;
 	      t->match_rule_index = match_rule_index;
-	      t->packet_info[0] = fa_5tuple.kv.key[0];
-	      t->packet_info[1] = fa_5tuple.kv.key[1];
-	      t->packet_info[2] = fa_5tuple.kv.key[2];
-	      t->packet_info[3] = fa_5tuple.kv.key[3];
-	      t->packet_info[4] = fa_5tuple.kv.key[4];
-	      t->packet_info[5] = fa_5tuple.kv.value;
+	      t->packet_info[0] = fa_5tuple->kv.key[0];
+	      t->packet_info[1] = fa_5tuple->kv.key[1];
+	      t->packet_info[2] = fa_5tuple->kv.key[2];
+	      t->packet_info[3] = fa_5tuple->kv.key[3];
+	      t->packet_info[4] = fa_5tuple->kv.key[4];
+	      t->packet_info[5] = fa_5tuple->kv.value;
 	      t->action = action;
 	      t->trace_bitmap = trace_bitmap;
 	    }
@@ -1134,6 +1296,11 @@ acl_fa_node_fn (vlib_main_t * vm,
 	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index,
 					   to_next, n_left_to_next, bi0,
 					   next0);
+
+	  sw_if_index++;
+	  fa_5tuple++;
+	  kv_sess++;
+	  hash++;
 	}
 
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
@@ -1237,8 +1404,8 @@ acl_out_ip4_fa_node_fn (vlib_main_t * vm,
 }
 
 /*
- * This process ensures the connection cleanup happens every so often
- * even in absence of traffic, as well as provides general orchestration
+ * The connection cleanup happens within the per-worker cleaner nodes,
+ * with the cleaner process providing the orchestration
  * for requests like connection deletion on a given sw_if_index.
  */
 
@@ -1265,11 +1432,12 @@ static char *acl_fa_cleaner_error_strings[] = {
 /* *INDENT-ON* */
 
 static vlib_node_registration_t acl_fa_session_cleaner_process_node;
-static vlib_node_registration_t acl_fa_worker_session_cleaner_process_node;
 
 /*
- * Per-worker thread interrupt-driven cleaner thread
- * to clean idle connections if there are no packets
+ * Per-worker interrupt-driven cleaner node, which ages the idle
+ * connections using the timer wheel of the worker, and
+ * deletes the connections on the interfaces being cleared.
+ * It keeps rescheduling itself while there is work to do.
  */
 static uword
 acl_fa_worker_conn_cleaner_process(vlib_main_t * vm,
@@ -1279,22 +1447,20 @@ acl_fa_worker_conn_cleaner_process(vlib_main_t * vm,
    u64 now = clib_cpu_time_now ();
    u16 thread_index = os_get_thread_index ();
    acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
-   int num_expired;
+
+   /* We might have been interrupted more than once within this main loop */
+   if (pw->cleaner_main_loop_count == vm->main_loop_count)
+     return 0;
+   pw->cleaner_main_loop_count = vm->main_loop_count;
 #ifdef FA_NODE_VERBOSE_DEBUG
    clib_warning("\nacl_fa_worker_conn_cleaner: thread index %d now %lu\n\n", thread_index, now);
 #endif
    /* allow another interrupt to be queued */
-   pw->interrupt_is_pending = 0;
+   clib_smp_swap (&pw->interrupt_is_pending, 0);
    if (pw->clear_in_process) {
-     if (0 == pw->swipe_end_time) {
+     if (0 == pw->clear_session_index) {
        /*
         * Someone has just set the flag to start clearing.
-        * we do this by combing through the connections up to a "time T"
-        * which is now, and requeueing everything except the expired
-        * connections and those matching the interface(s) being cleared.
-        */
-
-       /*
         * first filter the sw_if_index bitmap that they want from us, by
         * a bitmap of sw_if_index for which we actually have connections.
         */
@@ -1313,166 +1479,99 @@ acl_fa_worker_conn_cleaner_process(vlib_main_t * vm,
          pw->pending_clear_sw_if_index_bitmap = clib_bitmap_and(pw->pending_clear_sw_if_index_bitmap,
 							      pw->serviced_sw_if_index_bitmap);
        }
-
-       if (clib_bitmap_is_zero(pw->pending_clear_sw_if_index_bitmap)) {
-         /* if the cross-section is a zero vector, no need to do anything. */
+     }
+     /* if the cross-section is a zero vector, no need to do anything. */
+     if (clib_bitmap_is_zero(pw->pending_clear_sw_if_index_bitmap)
+         || acl_fa_clear_sessions_by_sw_if_index(am, thread_index)) {
 #ifdef FA_NODE_VERBOSE_DEBUG
-         clib_warning("WORKER: clearing done - nothing to do");
+       clib_warning("WORKER: clearing done");
 #endif
-         pw->clear_in_process = 0;
-       } else {
-#ifdef FA_NODE_VERBOSE_DEBUG
-         clib_warning("WORKER-CLEAR: swiping sw-if-index bitmap: %U, my serviced bitmap %U",
-                      format_bitmap_hex, pw->pending_clear_sw_if_index_bitmap,
-                      format_bitmap_hex, pw->serviced_sw_if_index_bitmap);
-#endif
-         /* swipe through the connection lists until enqueue timestamps become above "now" */
-         pw->swipe_end_time = now;
-       }
-     }
-   }
-   num_expired = acl_fa_check_idle_sessions(am, thread_index, now);
-   // clib_warning("WORKER-CLEAR: checked %d sessions (clear_in_progress: %d)", num_expired, pw->clear_in_process);
-   if (pw->clear_in_process) {
-     if (0 == num_expired) {
-       /* we were clearing but we could not process any more connections. time to stop. */
        clib_bitmap_zero(pw->pending_clear_sw_if_index_bitmap);
+       pw->clear_session_index = 0;
+       CLIB_MEMORY_BARRIER ();
        pw->clear_in_process = 0;
-#ifdef FA_NODE_VERBOSE_DEBUG
-       clib_warning("WORKER: clearing done, all done");
-#endif
-     } else {
-#ifdef FA_NODE_VERBOSE_DEBUG
-       clib_warning("WORKER-CLEAR: more work to do, raising interrupt");
-#endif
-       /* should continue clearing.. So could they please sent an interrupt again? */
-       pw->interrupt_is_needed = 1;
-     }
-   } else {
-     if (num_expired >= am->fa_max_deleted_sessions_per_interval) {
-       /* there was too much work, we should get an interrupt ASAP */
-       pw->interrupt_is_needed = 1;
-       pw->interrupt_is_unwanted = 0;
-     } else if (num_expired <= am->fa_min_deleted_sessions_per_interval) {
-       /* signal that they should trigger us less */
-       pw->interrupt_is_needed = 0;
-       pw->interrupt_is_unwanted = 1;
-     } else {
-       /* the current rate of interrupts is ok */
-       pw->interrupt_is_needed = 0;
-       pw->interrupt_is_unwanted = 0;
      }
    }
-   pw->interrupt_generation = am->fa_interrupt_generation;
+   if (am->fa_sessions_hash_is_initialized) {
+     acl_fa_check_idle_sessions(am, thread_index, now);
+   }
+   /*
+    * keep going while expired sessions are left to check or the clearing
+    * is not done, otherwise the cleaner process wakes us up on the next tick
+    */
+   if (vec_len(pw->expired) || pw->clear_in_process) {
+     send_one_worker_interrupt(am, thread_index);
+   }
    return 0;
 }
 
-static void
-send_one_worker_interrupt (vlib_main_t * vm, acl_main_t *am, int thread_index)
+/*
+ * The aging is done by the workers themselves, on their own data: while
+ * there are sessions, this process wakes up every ACL_FA_CLEANER_INTERVAL
+ * and interrupts the workers, which run their timer wheel. A worker has
+ * no other way to wake up in time when it gets no traffic. Without
+ * sessions the process sleeps until a worker adds one and signals it.
+ * It also orchestrates the requests like connection deletion on a given
+ * sw_if_index, which need to be carried out by all the workers before
+ * proceeding.
+ */
+
+/* are there sessions to age, stop ticking if not */
+static int
+acl_fa_cleaner_keep_ticking (acl_main_t * am)
 {
-  acl_fa_per_worker_data_t *pw = &am->per_worker_data[thread_index];
-  if (!pw->interrupt_is_pending) {
-    pw->interrupt_is_pending = 1;
-    vlib_node_set_interrupt_pending (vlib_mains[thread_index],
-                  acl_fa_worker_session_cleaner_process_node.index);
-    /* if the interrupt was requested, mark that done. */
-    /* pw->interrupt_is_needed = 0; */
+  am->fa_cleaner_is_ticking = 0;
+  /* see acl_fa_add_session () */
+  CLIB_MEMORY_BARRIER ();
+  if (am->fa_session_total_adds != am->fa_session_total_dels) {
+    am->fa_cleaner_is_ticking = 1;
+    return 1;
   }
+  return 0;
 }
 
 static void
-send_interrupts_to_workers (vlib_main_t * vm, acl_main_t *am)
+acl_fa_cleaner_tick (acl_main_t * am)
 {
-  int i;
-  /* Can't use vec_len(am->per_worker_data) since the threads might not have come up yet; */
-  int n_threads = vec_len(vlib_mains);
-  for (i = n_threads > 1 ? 1 : 0; i < n_threads; i++) {
-    send_one_worker_interrupt(vm, am, i);
-  }
+  int thread_index;
+
+  for (thread_index = 0;
+       thread_index < vec_len(am->per_worker_data) &&
+       thread_index < vec_len(vlib_mains); thread_index++)
+    send_one_worker_interrupt(am, thread_index);
 }
 
-/* centralized process to drive per-worker cleaners */
 static uword
 acl_fa_session_cleaner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 				vlib_frame_t * f)
 {
   acl_main_t *am = &acl_main;
-  u64 now;
-  f64 cpu_cps = vm->clib_time.clocks_per_second;
-  u64 next_expire;
-  /* We should check if there are connections to clean up - at least twice a second */
-  u64 max_timer_wait_interval = cpu_cps / 2;
   uword event_type, *event_data = 0;
   acl_fa_per_worker_data_t *pw0;
 
-  am->fa_current_cleaner_timer_wait_interval = max_timer_wait_interval;
   am->fa_cleaner_node_index = acl_fa_session_cleaner_process_node.index;
-  am->fa_interrupt_generation = 1;
   while (1)
     {
-      now = clib_cpu_time_now ();
-      next_expire = now + am->fa_current_cleaner_timer_wait_interval;
-      int has_pending_conns = 0;
-      u16 ti;
-      u8 tt;
-
-      /*
-       * walk over all per-thread list heads of different timeouts,
-       * and see if there are any connections pending.
-       * If there aren't - we do not need to wake up until the
-       * worker code signals that it has added a connection.
-       *
-       * Also, while we are at it, calculate the earliest we need to wake up.
-       */
-      for(ti = 0; ti < vec_len(vlib_mains); ti++) {
-        if (ti >= vec_len(am->per_worker_data)) {
-          continue;
-        }
-        acl_fa_per_worker_data_t *pw = &am->per_worker_data[ti];
-        for(tt = 0; tt < vec_len(pw->fa_conn_list_head); tt++) {
-          u64 head_expiry = acl_fa_get_list_head_expiry_time(am, pw, now, ti, tt);
-          if ((head_expiry < next_expire) && !pw->interrupt_is_pending) {
-#ifdef FA_NODE_VERBOSE_DEBUG
-            clib_warning("Head expiry: %lu, now: %lu, next_expire: %lu (worker: %d, tt: %d)", head_expiry, now, next_expire, ti, tt);
-#endif
-            next_expire = head_expiry;
-	  }
-          if (~0 != pw->fa_conn_list_head[tt]) {
-            has_pending_conns = 1;
-          }
+      if (am->fa_sessions_hash_is_initialized && acl_fa_cleaner_keep_ticking (am))
+        {
+          am->fa_cleaner_cnt_wait_with_timeout++;
+          (void) vlib_process_wait_for_event_or_clock (vm, ACL_FA_CLEANER_INTERVAL);
         }
-      }
-
-      /* If no pending connections and no ACL applied then no point in timing out */
-      if (!has_pending_conns && (0 == am->fa_total_enabled_count))
+      else
         {
           am->fa_cleaner_cnt_wait_without_timeout++;
           (void) vlib_process_wait_for_event (vm);
-          event_type = vlib_process_get_events (vm, &event_data);
         }
-      else
-	{
-	  f64 timeout = ((i64) next_expire - (i64) now) / cpu_cps;
-	  if (timeout <= 0)
-	    {
-	      /* skip waiting altogether */
-	      event_type = ~0;
-	    }
-	  else
-	    {
-              am->fa_cleaner_cnt_wait_with_timeout++;
-	      (void) vlib_process_wait_for_event_or_clock (vm, timeout);
-	      event_type = vlib_process_get_events (vm, &event_data);
-	    }
-	}
+      event_type = vlib_process_get_events (vm, &event_data);
 
       switch (event_type)
 	{
 	case ~0:
-	  /* nothing to do */
+	  /* timer expired */
+	  acl_fa_cleaner_tick (am);
 	  break;
 	case ACL_FA_CLEANER_RESCHEDULE:
-	  /* Nothing to do. */
+	  /* a worker got its first session, start ticking */
 	  break;
 	case ACL_FA_CLEANER_DELETE_BY_SW_IF_INDEX:
 	  {
@@ -1513,27 +1612,23 @@ acl_fa_session_cleaner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
                 clib_warning("ACL_FA_NODE_CLEAN: waiting previous cleaning cycle to finish on %d...", pw0 - am->per_worker_data);
 #endif
                 vlib_process_suspend(vm, 0.0001);
-                if (pw0->interrupt_is_needed) {
-                  send_one_worker_interrupt(vm, am, (pw0 - am->per_worker_data));
-                }
               }
-              if (pw0->clear_in_process) {
-                clib_warning("ERROR-BUG! Could not initiate cleaning on worker because another cleanup in progress");
-	      } else {
-                if (clear_all)
-                  {
-                    /* if we need to clear all, then just clear the interfaces that we are servicing */
-                    pw0->pending_clear_sw_if_index_bitmap = clib_bitmap_dup(pw0->serviced_sw_if_index_bitmap);
-                  }
-                else
-                  {
-                    pw0->pending_clear_sw_if_index_bitmap = clib_bitmap_dup(clear_sw_if_index_bitmap);
-                  }
-                pw0->clear_in_process = 1;
+              if (clear_all)
+                {
+                  /* if we need to clear all, then just clear the interfaces that we are servicing */
+                  pw0->pending_clear_sw_if_index_bitmap = clib_bitmap_dup(pw0->serviced_sw_if_index_bitmap);
+                }
+              else
+                {
+                  pw0->pending_clear_sw_if_index_bitmap = clib_bitmap_dup(clear_sw_if_index_bitmap);
+                }
+              CLIB_MEMORY_BARRIER ();
+              pw0->clear_in_process = 1;
+              /* kick the worker, it will keep itself running until done */
+              if ((pw0 - am->per_worker_data) < vec_len(vlib_mains)) {
+                send_one_worker_interrupt(am, pw0 - am->per_worker_data);
               }
             }
-            /* send some interrupts so they can start working */
-            send_interrupts_to_workers(vm, am);
 
             /* now wait till they all complete */
 #ifdef FA_NODE_VERBOSE_DEBUG
@@ -1547,9 +1642,6 @@ acl_fa_session_cleaner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
                 clib_warning("ACL_FA_NODE_CLEAN: waiting for my cleaning cycle to finish on %d...", pw0 - am->per_worker_data);
 #endif
                 vlib_process_suspend(vm, 0.0001);
-                if (pw0->interrupt_is_needed) {
-                  send_one_worker_interrupt(vm, am, (pw0 - am->per_worker_data));
-                }
               }
             }
 #ifdef FA_NODE_VERBOSE_DEBUG
@@ -1571,54 +1663,10 @@ acl_fa_session_cleaner_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 	  break;
 	}
 
-      send_interrupts_to_workers(vm, am);
-
       if (event_data)
 	_vec_len (event_data) = 0;
 
-      /*
-       * If the interrupts were not processed yet, ensure we wait a bit,
-       * but up to a point.
-       */
-      int need_more_wait = 0;
-      int max_wait_cycles = 100;
-      do {
-        need_more_wait = 0;
-        vec_foreach(pw0, am->per_worker_data) {
-          if (pw0->interrupt_generation != am->fa_interrupt_generation) {
-            need_more_wait = 1;
-          }
-        }
-        if (need_more_wait) {
-          vlib_process_suspend(vm, 0.0001);
-        }
-      } while (need_more_wait && (--max_wait_cycles > 0));
-
-      int interrupts_needed = 0;
-      int interrupts_unwanted = 0;
-
-      vec_foreach(pw0, am->per_worker_data) {
-        if (pw0->interrupt_is_needed) {
-          interrupts_needed++;
-          /* the per-worker value is reset when sending the interrupt */
-        }
-        if (pw0->interrupt_is_unwanted) {
-          interrupts_unwanted++;
-          pw0->interrupt_is_unwanted = 0;
-        }
-      }
-      if (interrupts_needed) {
-        /* they need more interrupts, do less waiting around next time */
-        am->fa_current_cleaner_timer_wait_interval /= 2;
-        /* never go into zero-wait either though - we need to give the space to others */
-        am->fa_current_cleaner_timer_wait_interval += 1; 
-      } else if (interrupts_unwanted) {
-        /* slowly increase the amount of sleep up to a limit */
-        if (am->fa_current_cleaner_timer_wait_interval < max_timer_wait_interval)
-          am->fa_current_cleaner_timer_wait_interval += cpu_cps * am->fa_cleaner_wait_time_increment;
-      }
       am->fa_cleaner_cnt_event_cycles++;
-      am->fa_interrupt_generation++;
     }
   /* NOT REACHED */
   return 0;
@@ -1632,10 +1680,6 @@ acl_fa_enable_disable (u32 sw_if_index, int is_input, int enable_disable)
   if (enable_disable) {
     acl_fa_verify_init_sessions(am);
     am->fa_total_enabled_count++;
-    void *oldheap = clib_mem_set_heap (am->vlib_main->heap_base);
-    vlib_process_signal_event (am->vlib_main, am->fa_cleaner_node_index,
-                                 ACL_FA_CLEANER_RESCHEDULE, 0);
-    clib_mem_set_heap (oldheap);
   } else {
     am->fa_total_enabled_count--;
   }
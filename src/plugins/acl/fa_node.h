@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <vppinfra/bihash_40_8.h>
+#include <vppinfra/tw_timer_16t_2w_512sl.h>
 
 #define TCP_FLAG_FIN    0x01
 #define TCP_FLAG_SYN    0x02
@@ -63,14 +64,34 @@ typedef struct {
     u16 as_u16;
   } tcp_flags_seen; ;     /* +2 bytes = 62 */
   u16 thread_index;          /* +2 bytes = 64 */
-  u64 link_enqueue_time;  /* 8 byte = 8 */
-  u32 link_prev_idx;      /* +4 bytes = 12 */
-  u32 link_next_idx;      /* +4 bytes = 16 */
-  u8 link_list_id;        /* +1 bytes = 17 */
-  u8 reserved1[7];        /* +7 bytes = 24 */
-  u64 reserved2[5];       /* +5*8 bytes = 64 */
+  u32 timer_handle;       /* 4 bytes = 4 */
+  u32 link_prev_idx;      /* +4 bytes = 8 */
+  u32 link_next_idx;      /* +4 bytes = 12 */
+  u8 link_list_id;        /* +1 bytes = 13 */
+  u8 reserved1[3];        /* +3 bytes = 16 */
+  u64 reserved2[6];       /* +6*8 bytes = 64 */
 } fa_session_t;
 
+/*
+ * The session idle timers are kept on a per-worker timer wheel,
+ * ticking every ACL_FA_TW_TIMER_INTERVAL seconds.
+ */
+#define ACL_FA_TW_TIMER_INTERVAL 0.1
+/*
+ * The workers are interrupted to run their wheel this often, catching up
+ * with all the ticks since the previous run: the sessions are deleted at
+ * most that late, the timeouts are in seconds.
+ */
+#define ACL_FA_CLEANER_INTERVAL 1.0
+#define ACL_FA_TW_TICKS_PER_SECOND 10
+/* the 16t_2w_512sl wheel can hold the timers up to 512*512 ticks */
+#define ACL_FA_TW_MAX_TIMER_TICKS ((512 * 512) - 1)
+#define ACL_FA_TW_SESSION_TIMER_ID 0
+#define ACL_FA_TW_TIMER_HANDLE_INVALID ((u32) ~0)
+
+/* How many session pool entries a worker looks at per run when clearing */
+#define ACL_FA_CLEAR_MAX_VISITED_SESSIONS 1024
+
 
 /* This structure is used to fill in the u64 value
    in the per-sw-if-index hash table */
@@ -106,51 +127,36 @@ CT_ASSERT_EQUAL(fa_full_session_id_size_is_64, sizeof(fa_full_session_id_t), siz
 typedef struct {
   /* The pool of sessions managed by this worker */
   fa_session_t *fa_sessions_pool;
-  /* per-worker ACL_N_TIMEOUTS of conn lists */
-  u32 *fa_conn_list_head;
-  u32 *fa_conn_list_tail;
+  /* timer wheel with the idle timers of the sessions owned by this worker */
+  tw_timer_wheel_16t_2w_512sl_t session_timer_wheel;
+  /* FIFO of TCP transient sessions, to pick a session to recycle */
+  u32 fa_recycle_list_head;
+  u32 fa_recycle_list_tail;
   /* adds and deletes per-worker-per-interface */
   u64 *fa_session_dels_by_sw_if_index;
   u64 *fa_session_adds_by_sw_if_index;
-  /* Vector of expired connections retrieved from lists */
+  /* Vector of sessions with expired timers, yet to be checked */
   u32 *expired;
-  /* the earliest next expiry time */
-  u64 next_expiry_time;
-  /* if not zero, look at all the elements until their enqueue timestamp is after below one */
-  u64 requeue_until_time;
-  /* Current time between the checks */
-  u64 current_time_wait_interval;
+  /* Counter of session timers which have expired */
+  u64 cnt_session_timer_expired;
   /* Counter of how many sessions we did delete */
   u64 cnt_deleted_sessions;
   /* Counter of already deleted sessions being deleted - should not increment unless a bug */
   u64 cnt_already_deleted_sessions;
-  /* Number of times we requeued a session to a head of the list */
+  /* Number of times we restarted the timer of a session which was still active */
   u64 cnt_session_timer_restarted;
-  /* swipe up to this enqueue time, rather than following the timeouts */
-  u64 swipe_end_time;
+  /* next session pool index to look at while clearing the sessions */
+  u32 clear_session_index;
   /* bitmap of sw_if_index serviced by this worker */
   uword *serviced_sw_if_index_bitmap;
   /* bitmap of sw_if_indices to clear. set by main thread, cleared by worker */
   uword *pending_clear_sw_if_index_bitmap;
-  /* atomic, indicates that the swipe-deletion of connections is in progress */
+  /* atomic, indicates that the deletion of connections by sw_if_index is in progress */
   u32 clear_in_process;
-  /* Interrupt is pending from main thread */
+  /* The cleaner node is scheduled to run on the next main loop of this worker */
   int interrupt_is_pending;
-  /*
-   * Interrupt node on the worker thread sets this if it knows there is
-   * more work to do, but it has to finish to avoid hogging the
-   * core for too long.
-   */
-  int interrupt_is_needed;
-  /*
-   * Set to indicate that the interrupt node wants to get less interrupts
-   * because there is not enough work for the current rate.
-   */
-  int interrupt_is_unwanted;
-  /*
-   * Set to copy of a "generation" counter in main thread so we can sync the interrupts.
-   */
-  int interrupt_generation;
+  /* main loop count of the last cleaner node run, to skip the duplicate interrupts */
+  u32 cleaner_main_loop_count;
 } acl_fa_per_worker_data_t;
 
 
@@ -162,8 +168,8 @@ typedef enum {
 
 enum
 {
-  ACL_FA_CLEANER_RESCHEDULE = 1,
-  ACL_FA_CLEANER_DELETE_BY_SW_IF_INDEX,
+  ACL_FA_CLEANER_DELETE_BY_SW_IF_INDEX = 1,
+  ACL_FA_CLEANER_RESCHEDULE,
 } acl_fa_cleaner_process_event_e;
 
 void acl_fa_enable_disable(u32 sw_if_index, int is_input, int enable_disable);
@@ -75,21 +75,30 @@ multi_acl_match_get_applied_ace_index(acl_main_t *am, fa_5tuple_t *match)
   u64 *pkey;
   int mask_type_index;
   u32 curr_match_index = ~0;
+  hash_applied_mask_info_t *minfo;
 
   u32 sw_if_index = match->pkt.sw_if_index;
   u8 is_input = match->pkt.is_input;
   applied_hash_ace_entry_t **applied_hash_aces = get_applied_hash_aces(am, is_input, sw_if_index);
   applied_hash_acl_info_t **applied_hash_acls = is_input ? &am->input_applied_hash_acl_info_by_sw_if_index :
                                                     &am->output_applied_hash_acl_info_by_sw_if_index;
+  applied_hash_acl_info_t *pal = vec_elt_at_index((*applied_hash_acls), sw_if_index);
 
   DBG("TRYING TO MATCH: %016llx %016llx %016llx %016llx %016llx %016llx",
 	       pmatch[0], pmatch[1], pmatch[2], pmatch[3], pmatch[4], pmatch[5]);
 
-  for(mask_type_index=0; mask_type_index < pool_len(am->ace_mask_type_pool); mask_type_index++) {
-    if (!clib_bitmap_get(vec_elt_at_index((*applied_hash_acls), sw_if_index)->mask_type_index_bitmap, mask_type_index)) {
-      /* This bit is not set. Avoid trying to match */
-      continue;
+  vec_foreach(minfo, pal->applied_mask_info_vec) {
+    if (minfo->first_applied_entry_index >= curr_match_index) {
+      /*
+       * The mask types are sorted by the first applied entry using them,
+       * so neither this nor any of the subsequent probes can yield
+       * a match earlier than the one we already have.
+       */
+      DBG("Early exit at mask type %d, first entry %d >= current match %d",
+          minfo->mask_type_index, minfo->first_applied_entry_index, curr_match_index);
+      break;
     }
+    mask_type_index = minfo->mask_type_index;
     ace_mask_type_entry_t *mte = vec_elt_at_index(am->ace_mask_type_pool, mask_type_index);
     pmatch = (u64 *)match;
     pmask = (u64 *)&mte->mask;
@@ -222,20 +231,50 @@ activate_applied_ace_hash_entry(acl_main_t *am,
   ASSERT(new_index != ~0);
   ASSERT(new_index < vec_len((*applied_hash_aces)));
   if (res == 0) {
-    /* There already exists an entry or more. Append at the end. */
+    /* There already exists an entry or more. */
     u32 first_index = result_val->applied_entry_index;
     ASSERT(first_index != ~0);
     DBG("A key already exists, with applied entry index: %d", first_index);
     applied_hash_ace_entry_t *first_pae = vec_elt_at_index((*applied_hash_aces), first_index);
     u32 last_index = first_pae->tail_applied_entry_index;
     ASSERT(last_index != ~0);
-    applied_hash_ace_entry_t *last_pae = vec_elt_at_index((*applied_hash_aces), last_index);
-    DBG("...advance to chained entry index: %d", last_index);
-    /* link ourseves in */
-    last_pae->next_applied_entry_index = new_index;
-    pae->prev_applied_entry_index = last_index;
-    /* adjust the pointer to the new tail */
-    first_pae->tail_applied_entry_index = new_index;
+    if (last_index < new_index) {
+      /* The usual case: append at the end. */
+      applied_hash_ace_entry_t *last_pae = vec_elt_at_index((*applied_hash_aces), last_index);
+      DBG("...advance to chained entry index: %d", last_index);
+      /* link ourseves in */
+      last_pae->next_applied_entry_index = new_index;
+      pae->prev_applied_entry_index = last_index;
+      /* adjust the pointer to the new tail */
+      first_pae->tail_applied_entry_index = new_index;
+    } else if (new_index < first_index) {
+      /*
+       * An incremental update reactivated an entry in front of the chain:
+       * it becomes the new head, so the hash needs to point to it.
+       */
+      DBG("...becoming the new head in front of index %d", first_index);
+      pae->next_applied_entry_index = first_index;
+      pae->tail_applied_entry_index = last_index;
+      first_pae->prev_applied_entry_index = new_index;
+      first_pae->tail_applied_entry_index = ~0;
+      hashtable_add_del(am, &kv, 1);
+    } else {
+      /* Somewhere in the middle - keep the chain sorted by the applied index */
+      u32 curr_index = first_index;
+      applied_hash_ace_entry_t *curr_pae = first_pae;
+      while (curr_pae->next_applied_entry_index < new_index) {
+        curr_index = curr_pae->next_applied_entry_index;
+        curr_pae = vec_elt_at_index((*applied_hash_aces), curr_index);
+      }
+      DBG("...inserting after chained entry index: %d", curr_index);
+      u32 next_index = curr_pae->next_applied_entry_index;
+      ASSERT(next_index != ~0);
+      applied_hash_ace_entry_t *next_pae = vec_elt_at_index((*applied_hash_aces), next_index);
+      pae->prev_applied_entry_index = curr_index;
+      pae->next_applied_entry_index = next_index;
+      curr_pae->next_applied_entry_index = new_index;
+      next_pae->prev_applied_entry_index = new_index;
+    }
   } else {
     /* It's the very first entry */
     hashtable_add_del(am, &kv, 1);
@@ -298,6 +337,44 @@ acl_plugin_hash_acl_set_trace_heap(acl_main_t *am, int on)
   }
 }
 
+/*
+ * Partition the applied entries by mask type, and order the partitions
+ * by the position of their first entry within the applied entries.
+ * The lookup probes the partitions in this order and stops as soon
+ * as the remaining ones can not contain an earlier match.
+ */
+static void
+hash_acl_build_applied_mask_info(acl_main_t *am, u32 sw_if_index, u8 is_input)
+{
+  u32 i;
+  u32 *seen_mask_types = 0;
+  hash_applied_mask_info_t *new_mask_info_vec = 0;
+  applied_hash_acl_info_t **applied_hash_acls = is_input ? &am->input_applied_hash_acl_info_by_sw_if_index
+                                                         : &am->output_applied_hash_acl_info_by_sw_if_index;
+  applied_hash_acl_info_t *pal = vec_elt_at_index((*applied_hash_acls), sw_if_index);
+  applied_hash_ace_entry_t **applied_hash_aces = get_applied_hash_aces(am, is_input, sw_if_index);
+
+  for(i=0; i < vec_len((*applied_hash_aces)); i++) {
+    applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), i);
+    hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, pae->acl_index);
+    u32 mask_type_index = vec_elt_at_index(ha->rules, pae->hash_ace_info_index)->mask_type_index;
+    vec_validate_init_empty(seen_mask_types, mask_type_index, ~0);
+    if (~0 == seen_mask_types[mask_type_index]) {
+      /* walking in ascending order, so the first entry seen is the lowest one */
+      hash_applied_mask_info_t minfo;
+      minfo.mask_type_index = mask_type_index;
+      minfo.first_applied_entry_index = i;
+      seen_mask_types[mask_type_index] = vec_len(new_mask_info_vec);
+      vec_add1(new_mask_info_vec, minfo);
+    }
+  }
+  vec_free(seen_mask_types);
+
+  hash_applied_mask_info_t *old_mask_info_vec = pal->applied_mask_info_vec;
+  pal->applied_mask_info_vec = new_mask_info_vec;
+  vec_free(old_mask_info_vec);
+}
+
 void
 hash_acl_apply(acl_main_t *am, u32 sw_if_index, u8 is_input, int acl_index)
 {
@@ -379,6 +456,7 @@ hash_acl_apply(acl_main_t *am, u32 sw_if_index, u8 is_input, int acl_index)
     activate_applied_ace_hash_entry(am, sw_if_index, is_input, applied_hash_aces, new_index);
   }
   applied_hash_entries_analyze(am, applied_hash_aces);
+  hash_acl_build_applied_mask_info(am, sw_if_index, is_input);
 done:
   clib_mem_set_heap (oldheap);
 }
@@ -435,6 +513,9 @@ move_applied_ace_hash_entry(acl_main_t *am,
      */
     u32 head_index = find_head_applied_ace_index(applied_hash_aces, old_index);
     ASSERT(head_index != ~0);
+    /* the only entry for this key: it is its own head, at its new place */
+    if (head_index == old_index)
+      head_index = new_index;
     applied_hash_ace_entry_t *head_pae = vec_elt_at_index((*applied_hash_aces), head_index);
 
     ASSERT(head_pae->tail_applied_entry_index == old_index);
@@ -587,6 +668,7 @@ hash_acl_unapply(acl_main_t *am, u32 sw_if_index, u8 is_input, int acl_index)
 
   /* After deletion we might not need some of the mask-types anymore... */
   hash_acl_build_applied_lookup_bitmap(am, sw_if_index, is_input);
+  hash_acl_build_applied_mask_info(am, sw_if_index, is_input);
   clib_mem_set_heap (oldheap);
 }
 
@@ -766,15 +848,15 @@ release_mask_type_index(acl_main_t *am, u32 mask_type_index)
   }
 }
 
-void hash_acl_add(acl_main_t *am, int acl_index)
+/*
+ * Build the bitmask-ready representation of the ACL rules
+ * into ha->rules and ha->mask_type_index_bitmap.
+ */
+static void
+hash_acl_build_rules(acl_main_t *am, int acl_index, hash_acl_info_t *ha)
 {
-  void *oldheap = hash_acl_set_heap(am);
-  DBG("HASH ACL add : %d", acl_index);
   int i;
   acl_list_t *a = &am->acls[acl_index];
-  vec_validate(am->hash_acl_infos, acl_index);
-  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, acl_index);
-  memset(ha, 0, sizeof(*ha));
 
   /* walk the newly added ACL entries and ensure that for each of them there
      is a mask type, increment a reference count for that mask type */
@@ -804,6 +886,17 @@ void hash_acl_add(acl_main_t *am, int acl_index)
       vec_add1(ha->rules, ace_info);
     }
   }
+}
+
+void hash_acl_add(acl_main_t *am, int acl_index)
+{
+  void *oldheap = hash_acl_set_heap(am);
+  DBG("HASH ACL add : %d", acl_index);
+  vec_validate(am->hash_acl_infos, acl_index);
+  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, acl_index);
+  memset(ha, 0, sizeof(*ha));
+
+  hash_acl_build_rules(am, acl_index, ha);
   /*
    * if an ACL is applied somewhere, fill the corresponding lookup data structures.
    * We need to take care if the ACL is not the last one in the vector of ACLs applied to the interface.
@@ -866,6 +959,279 @@ void hash_acl_delete(acl_main_t *am, int acl_index)
   clib_mem_set_heap (oldheap);
 }
 
+/*
+ * Find the offset of the first applied entry of a given ACL
+ * within the applied entries on an interface. The entries are laid out
+ * in the order of pal->applied_acls, so just sum up the ones in front.
+ */
+static u32
+hash_acl_applied_base_offset(acl_main_t *am, applied_hash_acl_info_t *pal, int acl_index)
+{
+  u32 base_offset = 0;
+  u32 *a_acl_index;
+  vec_foreach(a_acl_index, pal->applied_acls) {
+    if (*a_acl_index == acl_index)
+      return base_offset;
+    base_offset += vec_len(vec_elt_at_index(am->hash_acl_infos, *a_acl_index)->rules);
+  }
+  return ~0;
+}
+
+/*
+ * The content of a rule, which doesn't depend on its position:
+ * both are built by hash_acl_build_rules() from a zeroed structure.
+ */
+static void
+hash_ace_info_content(hash_ace_info_t *rule, hash_ace_info_t *content)
+{
+  /* copy the padding as well, the content is hashed and compared as bytes */
+  clib_memcpy(content, rule, sizeof(*content));
+  content->ace_index = 0;
+}
+
+/*
+ * Match the new rules of an ACL with the identical old ones, wherever
+ * they are. An identical rule found several times is matched in order.
+ * The matched rules have to keep their relative order, as the applied
+ * entries are sorted by priority: the longest increasing sequence of
+ * the old indices is kept, the other old rules are deleted and the
+ * other new rules added.
+ *
+ * Returns the new index of each old rule and the old index of each new
+ * one, ~0 if none.
+ */
+static void
+hash_acl_match_rules(hash_ace_info_t *old_rules, hash_ace_info_t *new_rules,
+                     u32 **old_to_new, u32 **new_to_old)
+{
+  int old_count = vec_len(old_rules);
+  int new_count = vec_len(new_rules);
+  hash_ace_info_t *old_contents = 0;
+  hash_ace_info_t content;
+  uword *old_by_content;
+  u32 *next_same = 0;
+  u32 *candidate = 0;
+  u32 *tails = 0;
+  u32 *prev = 0;
+  uword *p;
+  int i, lo, hi;
+
+  vec_validate_init_empty(*old_to_new, old_count, ~0);
+  vec_validate_init_empty(*new_to_old, new_count, ~0);
+  _vec_len(*old_to_new) = old_count;
+  _vec_len(*new_to_old) = new_count;
+  if (old_count == 0 || new_count == 0)
+    return;
+
+  /* the first old rule with a given content, chained to the next ones */
+  old_by_content = hash_create_mem(0, sizeof(hash_ace_info_t), sizeof(uword));
+  vec_validate(old_contents, old_count - 1);
+  vec_validate_init_empty(next_same, old_count - 1, ~0);
+  for(i = old_count - 1; i >= 0; i--) {
+    hash_ace_info_content(&old_rules[i], &old_contents[i]);
+    p = hash_get_mem(old_by_content, &old_contents[i]);
+    if (p)
+      next_same[i] = p[0];
+    hash_set_mem(old_by_content, &old_contents[i], i);
+  }
+
+  vec_validate_init_empty(candidate, new_count - 1, ~0);
+  for(i = 0; i < new_count; i++) {
+    hash_ace_info_content(&new_rules[i], &content);
+    p = hash_get_mem(old_by_content, &content);
+    if (!p)
+      continue;
+    candidate[i] = p[0];
+    if (next_same[p[0]] != ~0)
+      p[0] = next_same[p[0]];
+    else
+      hash_unset_mem(old_by_content, &content);
+  }
+
+  /*
+   * Longest increasing sequence of the candidates: tails[k] is the new
+   * index ending the best sequence of length k + 1 found so far.
+   */
+  vec_validate_init_empty(prev, new_count - 1, ~0);
+  for(i = 0; i < new_count; i++) {
+    if (candidate[i] == ~0)
+      continue;
+    lo = 0;
+    hi = vec_len(tails);
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (candidate[tails[mid]] < candidate[i])
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo > 0)
+      prev[i] = tails[lo - 1];
+    if (lo == vec_len(tails))
+      vec_add1(tails, i);
+    else
+      tails[lo] = i;
+  }
+  if (vec_len(tails)) {
+    u32 n;
+    for(n = vec_elt(tails, vec_len(tails) - 1); n != ~0; n = prev[n]) {
+      (*new_to_old)[n] = candidate[n];
+      (*old_to_new)[candidate[n]] = n;
+    }
+  }
+
+  hash_free(old_by_content);
+  vec_free(old_contents);
+  vec_free(next_same);
+  vec_free(candidate);
+  vec_free(tails);
+  vec_free(prev);
+}
+
+/*
+ * Apply the difference between the old and the new bitmask-ready rules
+ * of an ACL to the entries applied on a given interface, in place.
+ * The applied entries of the matched rules stay in the hash (retaining
+ * their hitcounts) and are moved to their new position, which is their
+ * priority, as are the entries of the subsequent ACLs. Only the entries
+ * of the deleted rules are deactivated, and those of the added ones
+ * activated.
+ *
+ * ha->rules must be holding the old rules on entry, and
+ * holds them again on return.
+ */
+static void
+hash_acl_update_applied(acl_main_t *am, u32 sw_if_index, u8 is_input, int acl_index,
+                        hash_ace_info_t *old_rules, hash_ace_info_t *new_rules,
+                        u32 *old_to_new, u32 *new_to_old)
+{
+  int i;
+  applied_hash_acl_info_t **applied_hash_acls = is_input ? &am->input_applied_hash_acl_info_by_sw_if_index
+                                                         : &am->output_applied_hash_acl_info_by_sw_if_index;
+  applied_hash_acl_info_t *pal = vec_elt_at_index((*applied_hash_acls), sw_if_index);
+  applied_hash_ace_entry_t **applied_hash_aces = get_applied_hash_aces(am, is_input, sw_if_index);
+  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, acl_index);
+
+  u32 base_offset = hash_acl_applied_base_offset(am, pal, acl_index);
+  if (~0 == base_offset) {
+    clib_warning("BUG: acl_index %d is not applied on sw_if_index %d is_input %d",
+                 acl_index, sw_if_index, is_input);
+    return;
+  }
+  int old_count = vec_len(old_rules);
+  int new_count = vec_len(new_rules);
+  int delta = new_count - old_count;
+  /* the old entries of the ACL, then those of the subsequent ACLs */
+  int n_entries = vec_len((*applied_hash_aces)) - base_offset;
+
+  DBG0("HASH ACL update applied: sw_if_index %d is_input %d acl %d base_offset %d old %d new %d",
+       sw_if_index, is_input, acl_index, base_offset, old_count, new_count);
+
+  /* deactivation computes the hash keys from the old rules */
+  ASSERT(ha->rules == old_rules);
+  for(i=0; i < old_count; i++) {
+    if (old_to_new[i] == ~0)
+      deactivate_applied_ace_hash_entry(am, sw_if_index, is_input,
+                                        applied_hash_aces, base_offset + i);
+  }
+
+  /*
+   * Move the kept entries and the subsequent ones. They keep their
+   * relative order, so the ones moving up are moved starting from the
+   * last one and the ones moving down starting from the first one,
+   * never overwriting an entry not moved yet.
+   */
+#define _new_pos(i) ((i) < old_count ? (int) old_to_new[i] : (i) + delta)
+  if (delta > 0)
+    vec_resize((*applied_hash_aces), delta);
+  for(i=n_entries-1; i >= 0; i--) {
+    if ((i >= old_count || old_to_new[i] != ~0) && _new_pos(i) > i)
+      move_applied_ace_hash_entry(am, sw_if_index, is_input, applied_hash_aces,
+                                  base_offset + i, base_offset + _new_pos(i));
+  }
+  for(i=0; i < n_entries; i++) {
+    if ((i >= old_count || old_to_new[i] != ~0) && _new_pos(i) < i)
+      move_applied_ace_hash_entry(am, sw_if_index, is_input, applied_hash_aces,
+                                  base_offset + i, base_offset + _new_pos(i));
+  }
+#undef _new_pos
+  if (delta < 0)
+    _vec_len((*applied_hash_aces)) += delta;
+
+  ha->rules = new_rules;
+
+  for(i=0; i < new_count; i++) {
+    u32 new_index = base_offset + i;
+    applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), new_index);
+    if (new_to_old[i] != ~0) {
+      /* a kept entry: same key, it now refers to the new rule */
+      pae->ace_index = new_rules[i].ace_index;
+      pae->hash_ace_info_index = i;
+      continue;
+    }
+    pae->acl_index = acl_index;
+    pae->ace_index = new_rules[i].ace_index;
+    pae->action = new_rules[i].action;
+    pae->hitcount = 0;
+    pae->hash_ace_info_index = i;
+    pae->next_applied_entry_index = ~0;
+    pae->prev_applied_entry_index = ~0;
+    pae->tail_applied_entry_index = ~0;
+    activate_applied_ace_hash_entry(am, sw_if_index, is_input, applied_hash_aces, new_index);
+  }
+
+  applied_hash_entries_analyze(am, applied_hash_aces);
+  hash_acl_build_applied_lookup_bitmap(am, sw_if_index, is_input);
+  hash_acl_build_applied_mask_info(am, sw_if_index, is_input);
+  /* let the next interface see the old rules again */
+  ha->rules = old_rules;
+}
+
+void hash_acl_replace(acl_main_t *am, int acl_index)
+{
+  void *oldheap = hash_acl_set_heap(am);
+  DBG0("HASH ACL replace : %d", acl_index);
+  vec_validate(am->hash_acl_infos, acl_index);
+  hash_acl_info_t *ha = vec_elt_at_index(am->hash_acl_infos, acl_index);
+  hash_ace_info_t *old_rules = ha->rules;
+  uword *old_mask_type_index_bitmap = ha->mask_type_index_bitmap;
+  u32 *sw_if_index;
+  int i;
+
+  /*
+   * Build the new rules first: the mask types common with the old rules
+   * get their refcount bumped, so they are not freed while releasing the old ones.
+   */
+  ha->rules = 0;
+  ha->mask_type_index_bitmap = 0;
+  hash_acl_build_rules(am, acl_index, ha);
+  hash_ace_info_t *new_rules = ha->rules;
+  ha->rules = old_rules;
+
+  u32 *old_to_new = 0;
+  u32 *new_to_old = 0;
+  hash_acl_match_rules(old_rules, new_rules, &old_to_new, &new_to_old);
+
+  vec_foreach(sw_if_index, ha->inbound_sw_if_index_list) {
+    hash_acl_update_applied(am, *sw_if_index, 1, acl_index, old_rules, new_rules,
+                            old_to_new, new_to_old);
+  }
+  vec_foreach(sw_if_index, ha->outbound_sw_if_index_list) {
+    hash_acl_update_applied(am, *sw_if_index, 0, acl_index, old_rules, new_rules,
+                            old_to_new, new_to_old);
+  }
+  ha->rules = new_rules;
+  vec_free(old_to_new);
+  vec_free(new_to_old);
+
+  for(i=0; i < vec_len(old_rules); i++) {
+    release_mask_type_index(am, old_rules[i].mask_type_index);
+  }
+  clib_bitmap_free(old_mask_type_index_bitmap);
+  vec_free(old_rules);
+  clib_mem_set_heap (oldheap);
+}
+
 u8
 hash_multi_acl_match_5tuple (u32 sw_if_index, fa_5tuple_t * pkt_5tuple, int is_l2,
                        int is_ip6, int is_input, u32 * acl_match_p,
@@ -40,6 +40,13 @@ void hash_acl_unapply(acl_main_t *am, u32 sw_if_index, u8 is_input, int acl_inde
 void hash_acl_add(acl_main_t *am, int acl_index);
 void hash_acl_delete(acl_main_t *am, int acl_index);
 
+/*
+ * Replace the rules of an existing ACL. Where the ACL is applied,
+ * only the lookup entries for the rules that changed are updated.
+ */
+
+void hash_acl_replace(acl_main_t *am, int acl_index);
+
 /*
  * Do the work required to match a given 5-tuple from the packet,
  * and return the action as well as populate the values pointed
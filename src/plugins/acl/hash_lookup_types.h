@@ -74,6 +74,16 @@ typedef struct {
   u8 action;
 } applied_hash_ace_entry_t;
 
+typedef struct {
+  /* mask type used for the hash probe */
+  u32 mask_type_index;
+  /*
+   * the lowest applied entry index having this mask type -
+   * no probe with this mask can yield a match earlier than that.
+   */
+  u32 first_applied_entry_index;
+} hash_applied_mask_info_t;
+
 typedef struct {
    /*
     * A logical OR of all the applied_ace_hash_entry_t=>
@@ -82,6 +92,11 @@ typedef struct {
    uword *mask_type_index_bitmap;
    /* applied ACLs so we can track them independently from main ACL module */
    u32 *applied_acls;
+   /*
+    * The mask types present in the applied entries, sorted by
+    * first_applied_entry_index, in the order they are probed during lookup.
+    */
+   hash_applied_mask_info_t *applied_mask_info_vec;
 } applied_hash_acl_info_t;
 
 
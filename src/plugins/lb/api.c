@@ -82,6 +82,7 @@ vl_api_lb_conf_t_handler
   rv = lb_conf((ip4_address_t *)&mp->ip4_src_address,
                (ip6_address_t *)mp->ip6_src_address,
                mp->sticky_buckets_per_core,
+               lbm->per_cpu_sticky_buckets_max,
                mp->flow_timeout);
 
  REPLY_MACRO (VL_API_LB_CONF_REPLY);
@@ -119,12 +120,19 @@ vl_api_lb_add_del_vip_t_handler
     lb_vip_type_t type;
     if (ip46_prefix_is_ip4(&prefix, mp->prefix_length)) {
       type = mp->is_gre4?LB_VIP_TYPE_IP4_GRE4:LB_VIP_TYPE_IP4_GRE6;
+      type = (mp->encap == 1)?LB_VIP_TYPE_IP4_L2DSR:type;
+      type = (mp->encap == 2)?LB_VIP_TYPE_IP4_L3DSR:type;
     } else {
       type = mp->is_gre4?LB_VIP_TYPE_IP6_GRE4:LB_VIP_TYPE_IP6_GRE6;
+      type = (mp->encap == 1)?LB_VIP_TYPE_IP6_L2DSR:type;
     }
 
-    rv = lb_vip_add(&prefix, mp->prefix_length, type,
-                    mp->new_flows_table_length, &vip_index);
+    if (mp->encap > 2 ||
+        (mp->encap == 2 && !ip46_prefix_is_ip4(&prefix, mp->prefix_length)))
+      rv = VNET_API_ERROR_INVALID_VALUE;
+    else
+      rv = lb_vip_add(&prefix, mp->prefix_length, type, mp->dscp,
+                      mp->new_flows_table_length, &vip_index);
   }
  REPLY_MACRO (VL_API_LB_CONF_REPLY);
 }
@@ -136,7 +144,12 @@ static void *vl_api_lb_add_del_vip_t_print
   s = format (0, "SCRIPT: lb_add_del_vip ");
   s = format (s, "%U ", format_ip46_prefix,
               (ip46_address_t *)mp->ip_prefix, mp->prefix_length, IP46_TYPE_ANY);
-  s = format (s, "%s ", mp->is_gre4?"gre4":"gre6");
+  if (mp->encap == 1)
+    s = format (s, "l2dsr ");
+  else if (mp->encap == 2)
+    s = format (s, "l3dsr dscp %u ", mp->dscp);
+  else
+    s = format (s, "%s ", mp->is_gre4?"gre4":"gre6");
   s = format (s, "%u ", mp->new_flows_table_length);
   s = format (s, "%s ", mp->is_del?"del":"add");
   FINISH;
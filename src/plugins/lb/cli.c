@@ -27,6 +27,8 @@ lb_vip_command_fn (vlib_main_t * vm,
   u8 del = 0;
   int ret;
   u32 gre4 = 0;
+  u32 l2dsr = 0, l3dsr = 0;
+  u32 dscp = 0;
   lb_vip_type_t type;
   clib_error_t *error = 0;
 
@@ -49,6 +51,12 @@ lb_vip_command_fn (vlib_main_t * vm,
       gre4 = 1;
     else if (unformat(line_input, "encap gre6"))
       gre4 = 0;
+    else if (unformat(line_input, "encap l2dsr"))
+      l2dsr = 1;
+    else if (unformat(line_input, "encap l3dsr"))
+      l3dsr = 1;
+    else if (unformat(line_input, "dscp %d", &dscp))
+      ;
     else {
       error = clib_error_return (0, "parse error: '%U'",
                                 format_unformat_error, line_input);
@@ -57,17 +65,30 @@ lb_vip_command_fn (vlib_main_t * vm,
   }
 
 
+  if (l3dsr && !ip46_prefix_is_ip4(&prefix, plen)) {
+    error = clib_error_return (0, "l3dsr is only supported for IPv4 VIPs");
+    goto done;
+  }
+
+  if (dscp >= 64) {
+    error = clib_error_return (0, "dscp value is too high");
+    goto done;
+  }
+
   if (ip46_prefix_is_ip4(&prefix, plen)) {
     type = (gre4)?LB_VIP_TYPE_IP4_GRE4:LB_VIP_TYPE_IP4_GRE6;
+    type = (l2dsr)?LB_VIP_TYPE_IP4_L2DSR:type;
+    type = (l3dsr)?LB_VIP_TYPE_IP4_L3DSR:type;
   } else {
     type = (gre4)?LB_VIP_TYPE_IP6_GRE4:LB_VIP_TYPE_IP6_GRE6;
+    type = (l2dsr)?LB_VIP_TYPE_IP6_L2DSR:type;
   }
 
   lb_garbage_collection();
 
   u32 index;
   if (!del) {
-    if ((ret = lb_vip_add(&prefix, plen, type, new_len, &index))) {
+    if ((ret = lb_vip_add(&prefix, plen, type, dscp, new_len, &index))) {
       error = clib_error_return (0, "lb_vip_add error %d", ret);
       goto done;
     } else {
@@ -92,7 +113,7 @@ done:
 VLIB_CLI_COMMAND (lb_vip_command, static) =
 {
   .path = "lb vip",
-  .short_help = "lb vip <prefix> [encap (gre6|gre4)] [new_len <n>] [del]",
+  .short_help = "lb vip <prefix> [encap (gre6|gre4|l2dsr|l3dsr)] [dscp <n>] [new_len <n>] [del]",
   .function = lb_vip_command_fn,
 };
 
@@ -180,6 +201,7 @@ lb_conf_command_fn (vlib_main_t * vm,
   ip6_address_t ip6 = lbm->ip6_src_address;
   u32 per_cpu_sticky_buckets = lbm->per_cpu_sticky_buckets;
   u32 per_cpu_sticky_buckets_log2 = 0;
+  u32 per_cpu_sticky_buckets_max = lbm->per_cpu_sticky_buckets_max;
   u32 flow_timeout = lbm->flow_timeout;
   int ret;
   clib_error_t *error = 0;
@@ -199,7 +221,9 @@ lb_conf_command_fn (vlib_main_t * vm,
       if (per_cpu_sticky_buckets_log2 >= 32)
         return clib_error_return (0, "buckets-log2 value is too high");
       per_cpu_sticky_buckets = 1 << per_cpu_sticky_buckets_log2;
-    } else if (unformat(line_input, "timeout %d", &flow_timeout))
+    } else if (unformat(line_input, "max-buckets %d", &per_cpu_sticky_buckets_max))
+      ;
+    else if (unformat(line_input, "timeout %d", &flow_timeout))
       ;
     else {
       error = clib_error_return (0, "parse error: '%U'",
@@ -210,7 +234,8 @@ lb_conf_command_fn (vlib_main_t * vm,
 
   lb_garbage_collection();
 
-  if ((ret = lb_conf(&ip4, &ip6, per_cpu_sticky_buckets, flow_timeout))) {
+  if ((ret = lb_conf(&ip4, &ip6, per_cpu_sticky_buckets,
+                     per_cpu_sticky_buckets_max, flow_timeout))) {
     error = clib_error_return (0, "lb_conf error %d", ret);
     goto done;
   }
@@ -224,7 +249,7 @@ done:
 VLIB_CLI_COMMAND (lb_conf_command, static) =
 {
   .path = "lb conf",
-  .short_help = "lb conf [ip4-src-address <addr>] [ip6-src-address <addr>] [buckets <n>] [timeout <s>]",
+  .short_help = "lb conf [ip4-src-address <addr>] [ip6-src-address <addr>] [buckets <n>] [max-buckets <n>] [timeout <s>]",
   .function = lb_conf_command_fn,
 };
 
@@ -282,9 +307,14 @@ lb_flowtable_flush_command_fn (vlib_main_t * vm,
   vlib_thread_main_t *tm = vlib_get_thread_main();
   lb_main_t *lbm = &lb_main;
 
+  //Runs with the workers stopped, the tables of the CPUs are not in use
   for(thread_index = 0; thread_index < tm->n_vlib_mains; thread_index++ ) {
-    lb_hash_t *h = lbm->per_cpu[thread_index].sticky_ht;
-    if (h != NULL) {
+    lb_per_cpu_t *pc = &lbm->per_cpu[thread_index];
+    lb_hash_t *tables[2] = { pc->sticky_ht, pc->old_sticky_ht };
+    u32 t;
+    for (t = 0; t < 2; t++) {
+      lb_hash_t *h = tables[t];
+      if (h != NULL) {
         u32 i;
         lb_hash_bucket_t *b;
 
@@ -292,10 +322,27 @@ lb_flowtable_flush_command_fn (vlib_main_t * vm,
             vlib_refcount_add(&lbm->as_refcount, thread_index, b->value[i], -1);
             vlib_refcount_add(&lbm->as_refcount, thread_index, 0, 1);
         }
-
-        lb_hash_free(h);
-        lbm->per_cpu[thread_index].sticky_ht = 0;
+      }
     }
+
+    //The current table is emptied in place, the workers keep using it
+    if (pc->sticky_ht)
+      memset(pc->sticky_ht->buckets, 0,
+             sizeof(lb_hash_bucket_t) * lb_hash_nbuckets(pc->sticky_ht));
+
+    //A resize in progress is abandoned, the workers request it again
+    if (pc->old_sticky_ht)
+      lb_hash_free(pc->old_sticky_ht);
+    if (pc->next_sticky_ht)
+      lb_hash_free(pc->next_sticky_ht);
+    if (pc->free_sticky_ht)
+      lb_hash_free(pc->free_sticky_ht);
+    pc->old_sticky_ht = NULL;
+    pc->next_sticky_ht = NULL;
+    pc->free_sticky_ht = NULL;
+    pc->sticky_alloc_pending = 0;
+    pc->migrate_bucket = 0;
+    pc->collisions_since_resize = 0;
   }
 
   return NULL;
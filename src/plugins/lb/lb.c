@@ -48,6 +48,30 @@ const static char* const * const lb_dpo_gre6_nodes[DPO_PROTO_NUM] =
 	[DPO_PROTO_IP6]  = lb_dpo_gre6_ip6,
     };
 
+const static char * const lb_dpo_l2dsr_ip4[] = { "lb4-l2dsr" , NULL };
+const static char * const lb_dpo_l2dsr_ip6[] = { "lb6-l2dsr" , NULL };
+const static char* const * const lb_dpo_l2dsr_nodes[DPO_PROTO_NUM] =
+    {
+	[DPO_PROTO_IP4]  = lb_dpo_l2dsr_ip4,
+	[DPO_PROTO_IP6]  = lb_dpo_l2dsr_ip6,
+    };
+
+const static char * const lb_dpo_l3dsr_ip4[] = { "lb4-l3dsr" , NULL };
+const static char* const * const lb_dpo_l3dsr_nodes[DPO_PROTO_NUM] =
+    {
+	[DPO_PROTO_IP4]  = lb_dpo_l3dsr_ip4,
+    };
+
+static dpo_type_t lb_vip_dpo_type(lb_vip_t *vip)
+{
+  lb_main_t *lbm = &lb_main;
+  if (lb_vip_is_l2dsr(vip))
+    return lbm->dpo_l2dsr_type;
+  if (lb_vip_is_l3dsr(vip))
+    return lbm->dpo_l3dsr_type;
+  return lb_vip_is_gre4(vip)?lbm->dpo_gre4_type:lbm->dpo_gre6_type;
+}
+
 u32 lb_hash_time_now(vlib_main_t * vm)
 {
   return (u32) (vlib_time_now(vm) + 10000);
@@ -63,13 +87,22 @@ u8 *format_lb_main (u8 * s, va_list * args)
   s = format(s, " #vips: %u\n", pool_elts(lbm->vips));
   s = format(s, " #ass: %u\n", pool_elts(lbm->ass) - 1);
 
+  s = format(s, " #sticky-buckets: %u (max %u)\n", lbm->per_cpu_sticky_buckets,
+             lbm->per_cpu_sticky_buckets_max);
+
   u32 thread_index;
   for(thread_index = 0; thread_index < tm->n_vlib_mains; thread_index++ ) {
-    lb_hash_t *h = lbm->per_cpu[thread_index].sticky_ht;
+    lb_per_cpu_t *pc = &lbm->per_cpu[thread_index];
+    lb_hash_t *h = pc->sticky_ht;
     if (h) {
       s = format(s, "core %d\n", thread_index);
       s = format(s, "  timeout: %ds\n", h->timeout);
       s = format(s, "  usage: %d / %d\n", lb_hash_elts(h, lb_hash_time_now(vlib_get_main())),  lb_hash_size(h));
+      s = format(s, "  resizes: %u%s\n", pc->sticky_resizes,
+                 pc->old_sticky_ht?" (in progress)":"");
+      s = format(s, "  timeouts: %lu collisions: %lu overwrites: %lu\n",
+                 pc->sticky_timeouts, pc->sticky_collisions,
+                 pc->sticky_overwrites);
     }
   }
 
@@ -81,6 +114,9 @@ static char *lb_vip_type_strings[] = {
     [LB_VIP_TYPE_IP6_GRE4] = "ip6-gre4",
     [LB_VIP_TYPE_IP4_GRE6] = "ip4-gre6",
     [LB_VIP_TYPE_IP4_GRE4] = "ip4-gre4",
+    [LB_VIP_TYPE_IP6_L2DSR] = "ip6-l2dsr",
+    [LB_VIP_TYPE_IP4_L2DSR] = "ip4-l2dsr",
+    [LB_VIP_TYPE_IP4_L3DSR] = "ip4-l3dsr",
 };
 
 u8 *format_lb_vip_type (u8 * s, va_list * args)
@@ -108,12 +144,15 @@ uword unformat_lb_vip_type (unformat_input_t * input, va_list * args)
 u8 *format_lb_vip (u8 * s, va_list * args)
 {
   lb_vip_t *vip = va_arg (*args, lb_vip_t *);
-  return format(s, "%U %U new_size:%u #as:%u%s",
+  s = format(s, "%U %U new_size:%u #as:%u%s",
              format_lb_vip_type, vip->type,
              format_ip46_prefix, &vip->prefix, vip->plen, IP46_TYPE_ANY,
              vip->new_flow_table_mask + 1,
              pool_elts(vip->as_indexes),
              (vip->flags & LB_VIP_FLAGS_USED)?"":" removed");
+  if (lb_vip_is_l3dsr(vip))
+    s = format(s, " dscp:%u", vip->dscp);
+  return s;
 }
 
 u8 *format_lb_as (u8 * s, va_list * args)
@@ -131,14 +170,15 @@ u8 *format_lb_vip_detailed (u8 * s, va_list * args)
   u32 indent = format_get_indent (s);
 
   s = format(s, "%U %U [%lu] %U%s\n"
-                   "%U  new_size:%u\n",
+                   "%U  new_size:%u last_rebuild_changed:%u\n",
                   format_white_space, indent,
                   format_lb_vip_type, vip->type,
                   vip - lbm->vips,
                   format_ip46_prefix, &vip->prefix, (u32) vip->plen, IP46_TYPE_ANY,
                   (vip->flags & LB_VIP_FLAGS_USED)?"":" removed",
                   format_white_space, indent,
-                  vip->new_flow_table_mask + 1);
+                  vip->new_flow_table_mask + 1,
+                  vip->new_flow_table_changed);
 
   //Print counters
   s = format(s, "%U  counters:\n",
@@ -150,6 +190,12 @@ u8 *format_lb_vip_detailed (u8 * s, va_list * args)
                lbm->vip_counters[i].name,
                vlib_get_simple_counter(&lbm->vip_counters[i], vip - lbm->vips));
 
+  vlib_counter_t tx;
+  vlib_get_combined_counter(&lbm->vip_tx_counters, vip - lbm->vips, &tx);
+  s = format(s, "%U    %s: %lu packets %lu bytes\n",
+             format_white_space, indent,
+             lbm->vip_tx_counters.name, tx.packets, tx.bytes);
+
 
   s = format(s, "%U  #as:%u\n",
              format_white_space, indent,
@@ -189,7 +235,7 @@ u8 *format_lb_vip_detailed (u8 * s, va_list * args)
 
 typedef struct {
   u32 as_index;
-  u32 last;
+  u32 next;
   u32 skip;
 } lb_pseudorand_t;
 
@@ -202,6 +248,41 @@ static int lb_pseudorand_compare(void *a, void *b)
   return memcmp(&asa->address, &asb->address, sizeof(asb->address));
 }
 
+/**
+ * Frees the new flow tables which can't be used by the workers anymore.
+ */
+static void lb_retired_flow_tables_free(u32 now)
+{
+  lb_main_t *lbm = &lb_main;
+  lb_retired_flow_table_t *rt;
+  u32 n = 0;
+  ASSERT (lbm->writer_lock[0]);
+
+  //Tables are retired in time order
+  vec_foreach(rt, lbm->retired_flow_tables) {
+    if (!clib_u32_loop_gt(now, rt->retired + LB_CONCURRENCY_TIMEOUT))
+      break;
+    vec_free(rt->table);
+    n++;
+  }
+
+  if (n)
+    vec_delete(lbm->retired_flow_tables, n, 0);
+}
+
+static void lb_retire_flow_table(lb_new_flow_entry_t *table, u32 now)
+{
+  lb_main_t *lbm = &lb_main;
+  lb_retired_flow_table_t *rt;
+
+  if (!table)
+    return;
+
+  vec_add2(lbm->retired_flow_tables, rt, 1);
+  rt->table = table;
+  rt->retired = now;
+}
+
 static void lb_vip_garbage_collection(lb_vip_t *vip)
 {
   lb_main_t *lbm = &lb_main;
@@ -235,6 +316,7 @@ static void lb_vip_garbage_collection(lb_vip_t *vip)
 void lb_garbage_collection()
 {
   lb_main_t *lbm = &lb_main;
+  u32 now = (u32) vlib_time_now(vlib_get_main());
   lb_get_writer_lock();
   lb_vip_t *vip;
   u32 *to_be_removed_vips = 0, *i;
@@ -249,48 +331,58 @@ void lb_garbage_collection()
 
   vec_foreach(i, to_be_removed_vips) {
     vip = &lbm->vips[*i];
+    lb_retire_flow_table(vip->new_flow_table, now);
+    vip->new_flow_table = 0;
     pool_put(lbm->vips, vip);
     pool_free(vip->as_indexes);
   }
 
   vec_free(to_be_removed_vips);
+  lb_retired_flow_tables_free(now);
   lb_put_writer_lock();
 }
 
+/**
+ * Sets the MagLev permutation of a new AS.
+ */
+static void lb_as_init_permutation(lb_vip_t *vip, lb_as_t *as)
+{
+  u64 seed = clib_xxhash(as->address.as_u64[0] ^
+                         as->address.as_u64[1]);
+  /* We have 2^n buckets.
+   * skip must be prime with 2^n.
+   * So skip must be odd.
+   * MagLev actually state that M should be prime,
+   * but this has a big computation cost (% operation).
+   * Using 2^n is more better (& operation).
+   */
+  as->maglev_skip = ((seed & 0xffffffff) | 1) & vip->new_flow_table_mask;
+  as->maglev_offset = (seed >> 32) & vip->new_flow_table_mask;
+}
+
+/**
+ * Rebuilds the new flow table of the VIP.
+ *
+ * The table is built aside, while the workers keep using the current one,
+ * and then published with a single pointer store. The replaced table is
+ * retired rather than freed as workers may still be reading it.
+ * As with MagLev, the table only depends on the set of used ASs, and
+ * changing one AS moves few entries between the others.
+ */
 static void lb_vip_update_new_flow_table(lb_vip_t *vip)
 {
   lb_main_t *lbm = &lb_main;
-  lb_new_flow_entry_t *old_table;
+  u32 now = (u32) vlib_time_now(vlib_get_main());
+  lb_new_flow_entry_t *old_table = vip->new_flow_table;
   u32 i, *as_index;
   lb_new_flow_entry_t *new_flow_table = 0;
   lb_as_t *as;
   lb_pseudorand_t *pr, *sort_arr = 0;
+  u32 mask = vip->new_flow_table_mask;
   u32 count;
 
   ASSERT (lbm->writer_lock[0]); //We must have the lock
 
-  //Check if some AS is configured or not
-  i = 0;
-  pool_foreach(as_index, vip->as_indexes, {
-      as = &lbm->ass[*as_index];
-      if (as->flags & LB_AS_FLAGS_USED) { //Not used anymore
-        i = 1;
-        goto out; //Not sure 'break' works in this macro-loop
-      }
-  });
-
-out:
-  if (i == 0) {
-    //Only the default. i.e. no AS
-    vec_validate(new_flow_table, vip->new_flow_table_mask);
-    for (i=0; i<vec_len(new_flow_table); i++)
-      new_flow_table[i].as_index = 0;
-
-    goto finished;
-  }
-
-  //First, let's sort the ASs
-  sort_arr = 0;
   vec_alloc(sort_arr, pool_elts(vip->as_indexes));
 
   i = 0;
@@ -300,42 +392,37 @@ out:
         continue;
 
       sort_arr[i].as_index = as - lbm->ass;
+      sort_arr[i].next = as->maglev_offset;
+      sort_arr[i].skip = as->maglev_skip;
       i++;
   });
   _vec_len(sort_arr) = i;
 
-  vec_sort_with_function(sort_arr, lb_pseudorand_compare);
+  vec_validate(new_flow_table, mask);
 
-  //Now let's pseudo-randomly generate permutations
-  vec_foreach(pr, sort_arr) {
-    lb_as_t *as = &lbm->ass[pr->as_index];
-
-    u64 seed = clib_xxhash(as->address.as_u64[0] ^
-                           as->address.as_u64[1]);
-    /* We have 2^n buckets.
-     * skip must be prime with 2^n.
-     * So skip must be odd.
-     * MagLev actually state that M should be prime,
-     * but this has a big computation cost (% operation).
-     * Using 2^n is more better (& operation).
-     */
-    pr->skip = ((seed & 0xffffffff) | 1) & vip->new_flow_table_mask;
-    pr->last = (seed >> 32) & vip->new_flow_table_mask;
+  if (vec_len(sort_arr) == 0) {
+    //Only the default. i.e. no AS
+    for (i=0; i<vec_len(new_flow_table); i++)
+      new_flow_table[i].as_index = 0;
+
+    goto finished;
   }
 
-  //Let's create a new flow table
-  vec_validate(new_flow_table, vip->new_flow_table_mask);
+  //Sorting makes the table independent of the order the ASs were added
+  vec_sort_with_function(sort_arr, lb_pseudorand_compare);
+
   for (i=0; i<vec_len(new_flow_table); i++)
     new_flow_table[i].as_index = ~0;
 
+  //Each AS in turn takes its next preferred entry which is still free
   u32 done = 0;
   while (1) {
     vec_foreach(pr, sort_arr) {
       while (1) {
-        u32 last = pr->last;
-        pr->last = (pr->last + pr->skip) & vip->new_flow_table_mask;
-        if (new_flow_table[last].as_index == ~0) {
-          new_flow_table[last].as_index = pr->as_index;
+        u32 next = pr->next;
+        pr->next = (pr->next + pr->skip) & mask;
+        if (new_flow_table[next].as_index == ~0) {
+          new_flow_table[next].as_index = pr->as_index;
           break;
         }
       }
@@ -345,34 +432,111 @@ out:
     }
   }
 
-  vec_free(sort_arr);
-
 finished:
+  vec_free(sort_arr);
 
-//Count number of changed entries
+  //Count number of changed entries
   count = 0;
   for (i=0; i<vec_len(new_flow_table); i++)
-    if (vip->new_flow_table == 0 ||
-        new_flow_table[i].as_index != vip->new_flow_table[i].as_index)
+    if (old_table == 0 ||
+        new_flow_table[i].as_index != old_table[i].as_index)
       count++;
+  vip->new_flow_table_changed = count;
 
-  old_table = vip->new_flow_table;
+  //Make sure the table content is visible before the table itself
+  CLIB_MEMORY_BARRIER ();
   vip->new_flow_table = new_flow_table;
-  vec_free(old_table);
+
+  lb_retire_flow_table(old_table, now);
+  lb_retired_flow_tables_free(now);
+}
+
+/**
+ * Allocates the sticky tables of the CPUs which have none yet,
+ * before a VIP sends them traffic.
+ */
+static void lb_sticky_tables_init(lb_main_t *lbm)
+{
+  lb_per_cpu_t *pc;
+
+  vec_foreach(pc, lbm->per_cpu) {
+    if (pc->sticky_ht)
+      continue;
+    pc->sticky_buckets_conf = lbm->per_cpu_sticky_buckets;
+    pc->sticky_buckets = lbm->per_cpu_sticky_buckets;
+    pc->sticky_ht = lb_hash_alloc(pc->sticky_buckets, lbm->flow_timeout);
+  }
 }
 
+/**
+ * Allocates the sticky tables the workers resize to, and frees the ones
+ * they are done with. The workers only swap and migrate tables.
+ * A worker leaves next_sticky_ht and free_sticky_ht to this process
+ * while its sticky_alloc_pending is set, so the tables are allocated and
+ * cleared without stopping the workers.
+ */
+static uword
+lb_sticky_alloc_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+                         vlib_frame_t * f)
+{
+  lb_main_t *lbm = &lb_main;
+  lb_per_cpu_t *pc;
+
+  while (1)
+    {
+      vlib_process_wait_for_event (vm);
+      vlib_process_get_events (vm, NULL);
+
+      vec_foreach(pc, lbm->per_cpu) {
+        if (!pc->sticky_alloc_pending)
+          continue;
+        if (pc->free_sticky_ht) {
+          lb_hash_free(pc->free_sticky_ht);
+          pc->free_sticky_ht = NULL;
+        }
+        //The wanted size may have changed again
+        if (pc->next_sticky_ht &&
+            lb_hash_nbuckets(pc->next_sticky_ht) != pc->sticky_buckets) {
+          lb_hash_free(pc->next_sticky_ht);
+          pc->next_sticky_ht = NULL;
+        }
+        if (!pc->next_sticky_ht && pc->sticky_ht &&
+            lb_hash_nbuckets(pc->sticky_ht) != pc->sticky_buckets)
+          pc->next_sticky_ht = lb_hash_alloc(pc->sticky_buckets,
+                                             lbm->flow_timeout);
+
+        //Make sure the new table is visible before giving it to the worker
+        CLIB_MEMORY_STORE_BARRIER ();
+        pc->sticky_alloc_pending = 0;
+      }
+    }
+  return 0;
+}
+
+VLIB_REGISTER_NODE (lb_sticky_alloc_node) =
+{
+  .function = lb_sticky_alloc_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "lb-sticky-alloc",
+};
+
 int lb_conf(ip4_address_t *ip4_address, ip6_address_t *ip6_address,
-           u32 per_cpu_sticky_buckets, u32 flow_timeout)
+           u32 per_cpu_sticky_buckets, u32 per_cpu_sticky_buckets_max,
+           u32 flow_timeout)
 {
   lb_main_t *lbm = &lb_main;
 
   if (!is_pow2(per_cpu_sticky_buckets))
     return VNET_API_ERROR_INVALID_MEMORY_SIZE;
 
+  if (per_cpu_sticky_buckets_max && !is_pow2(per_cpu_sticky_buckets_max))
+    return VNET_API_ERROR_INVALID_MEMORY_SIZE;
+
   lb_get_writer_lock(); //Not exactly necessary but just a reminder that it exists for my future self
   lbm->ip4_src_address = *ip4_address;
   lbm->ip6_src_address = *ip6_address;
   lbm->per_cpu_sticky_buckets = per_cpu_sticky_buckets;
+  lbm->per_cpu_sticky_buckets_max = per_cpu_sticky_buckets_max;
   lbm->flow_timeout = flow_timeout;
   lb_put_writer_lock();
   return 0;
@@ -434,7 +598,7 @@ int lb_vip_add_ass(u32 vip_index, ip46_address_t *addresses, u32 n)
     return VNET_API_ERROR_NO_SUCH_ENTRY;
   }
 
-  ip46_type_t type = lb_vip_is_gre4(vip)?IP46_TYPE_IP4:IP46_TYPE_IP6;
+  ip46_type_t type = lb_vip_as_is_ip4(vip)?IP46_TYPE_IP4:IP46_TYPE_IP6;
   u32 *to_be_added = 0;
   u32 *to_be_updated = 0;
   u32 i;
@@ -489,6 +653,7 @@ next:
     as->address = addresses[*ip];
     as->flags = LB_AS_FLAGS_USED;
     as->vip_index = vip_index;
+    lb_as_init_permutation(vip, as);
     pool_get(vip->as_indexes, as_index);
     *as_index = as - lbm->ass;
 
@@ -497,7 +662,7 @@ next:
      * so we are informed when its forwarding changes
      */
     fib_prefix_t nh = {};
-    if (lb_vip_is_gre4(vip)) {
+    if (lb_vip_as_is_ip4(vip)) {
 	nh.fp_addr.ip4 = as->address.ip4;
 	nh.fp_len = 32;
 	nh.fp_proto = FIB_PROTOCOL_IP4;
@@ -608,8 +773,7 @@ static void lb_vip_add_adjacency(lb_main_t *lbm, lb_vip_t *vip)
       pfx.fp_proto = FIB_PROTOCOL_IP6;
       proto = DPO_PROTO_IP6;
   }
-  dpo_set(&dpo, lb_vip_is_gre4(vip)?lbm->dpo_gre4_type:lbm->dpo_gre6_type,
-      proto, vip - lbm->vips);
+  dpo_set(&dpo, lb_vip_dpo_type(vip), proto, vip - lbm->vips);
   fib_table_entry_special_dpo_add(0,
 				  &pfx,
 				  FIB_SOURCE_PLUGIN_HI,
@@ -636,7 +800,8 @@ static void lb_vip_del_adjacency(lb_main_t *lbm, lb_vip_t *vip)
   fib_table_entry_special_remove(0, &pfx, FIB_SOURCE_PLUGIN_HI);
 }
 
-int lb_vip_add(ip46_address_t *prefix, u8 plen, lb_vip_type_t type, u32 new_length, u32 *vip_index)
+int lb_vip_add(ip46_address_t *prefix, u8 plen, lb_vip_type_t type, u8 dscp,
+               u32 new_length, u32 *vip_index)
 {
   lb_main_t *lbm = &lb_main;
   lb_vip_t *vip;
@@ -653,10 +818,17 @@ int lb_vip_add(ip46_address_t *prefix, u8 plen, lb_vip_type_t type, u32 new_leng
     return VNET_API_ERROR_INVALID_MEMORY_SIZE;
   }
 
-  if (ip46_prefix_is_ip4(prefix, plen) &&
-      (type != LB_VIP_TYPE_IP4_GRE4) &&
-      (type != LB_VIP_TYPE_IP4_GRE6))
+  if (ip46_prefix_is_ip4(prefix, plen) !=
+      (type == LB_VIP_TYPE_IP4_GRE4 || type == LB_VIP_TYPE_IP4_GRE6 ||
+       type == LB_VIP_TYPE_IP4_L2DSR || type == LB_VIP_TYPE_IP4_L3DSR)) {
+    lb_put_writer_lock();
     return VNET_API_ERROR_INVALID_ADDRESS_FAMILY;
+  }
+
+  if (type == LB_VIP_TYPE_IP4_L3DSR && dscp >= 64) {
+    lb_put_writer_lock();
+    return VNET_API_ERROR_INVALID_VALUE;
+  }
 
 
   //Allocate
@@ -667,6 +839,7 @@ int lb_vip_add(ip46_address_t *prefix, u8 plen, lb_vip_type_t type, u32 new_leng
   vip->plen = plen;
   vip->last_garbage_collection = (u32) vlib_time_now(vlib_get_main());
   vip->type = type;
+  vip->dscp = dscp;
   vip->flags = LB_VIP_FLAGS_USED;
   vip->as_indexes = 0;
 
@@ -676,14 +849,19 @@ int lb_vip_add(ip46_address_t *prefix, u8 plen, lb_vip_type_t type, u32 new_leng
     vlib_validate_simple_counter(&lbm->vip_counters[i], vip - lbm->vips);
     vlib_zero_simple_counter(&lbm->vip_counters[i], vip - lbm->vips);
   }
+  vlib_validate_combined_counter(&lbm->vip_tx_counters, vip - lbm->vips);
+  vlib_zero_combined_counter(&lbm->vip_tx_counters, vip - lbm->vips);
 
   //Configure new flow table
   vip->new_flow_table_mask = new_length - 1;
   vip->new_flow_table = 0;
+  vip->new_flow_table_changed = 0;
 
   //Create a new flow hash table full of the default entry
   lb_vip_update_new_flow_table(vip);
 
+  lb_sticky_tables_init(lbm);
+
   //Create adjacency to direct traffic
   lb_vip_add_adjacency(lbm, vip);
 
@@ -775,7 +953,7 @@ lb_as_stack (lb_as_t *as)
 {
   lb_main_t *lbm = &lb_main;
   lb_vip_t *vip = &lbm->vips[as->vip_index];
-  dpo_stack(lb_vip_is_gre4(vip)?lbm->dpo_gre4_type:lbm->dpo_gre6_type,
+  dpo_stack(lb_vip_dpo_type(vip),
 	    lb_vip_is_ip4(vip)?DPO_PROTO_IP4:DPO_PROTO_IP6,
 	    &as->dpo,
 	    fib_entry_contribute_ip_forwarding(
@@ -808,17 +986,22 @@ lb_init (vlib_main_t * vm)
   };
 
   lbm->vips = 0;
+  lbm->retired_flow_tables = 0;
   lbm->per_cpu = 0;
-  vec_validate(lbm->per_cpu, tm->n_vlib_mains - 1);
+  vec_validate_aligned(lbm->per_cpu, tm->n_vlib_mains - 1,
+                       CLIB_CACHE_LINE_BYTES);
   lbm->writer_lock = clib_mem_alloc_aligned (CLIB_CACHE_LINE_BYTES,  CLIB_CACHE_LINE_BYTES);
   lbm->writer_lock[0] = 0;
   lbm->per_cpu_sticky_buckets = LB_DEFAULT_PER_CPU_STICKY_BUCKETS;
+  lbm->per_cpu_sticky_buckets_max = 0;
   lbm->flow_timeout = LB_DEFAULT_FLOW_TIMEOUT;
   lbm->ip4_src_address.as_u32 = 0xffffffff;
   lbm->ip6_src_address.as_u64[0] = 0xffffffffffffffffL;
   lbm->ip6_src_address.as_u64[1] = 0xffffffffffffffffL;
   lbm->dpo_gre4_type = dpo_register_new_type(&lb_vft, lb_dpo_gre4_nodes);
   lbm->dpo_gre6_type = dpo_register_new_type(&lb_vft, lb_dpo_gre6_nodes);
+  lbm->dpo_l2dsr_type = dpo_register_new_type(&lb_vft, lb_dpo_l2dsr_nodes);
+  lbm->dpo_l3dsr_type = dpo_register_new_type(&lb_vft, lb_dpo_l3dsr_nodes);
   lbm->fib_node_type = fib_node_register_new_type(&lb_fib_node_vft);
 
   //Init AS reference counters
@@ -836,6 +1019,7 @@ lb_init (vlib_main_t * vm)
 #define _(a,b,c) lbm->vip_counters[c].name = b;
   lb_foreach_vip_counter
 #undef _
+  lbm->vip_tx_counters.name = "sent to application servers";
   return NULL;
 }
 
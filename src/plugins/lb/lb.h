@@ -43,6 +43,17 @@
 #define LB_DEFAULT_PER_CPU_STICKY_BUCKETS 1 << 10
 #define LB_DEFAULT_FLOW_TIMEOUT 40
 
+/**
+ * Buckets of a resized sticky table moved to the new table per frame.
+ */
+#define LB_STICKY_MIGRATE_BUCKETS_PER_FRAME 64
+
+/**
+ * A sticky table grows when this many flows per bucket could not be
+ * tracked since its last resize.
+ */
+#define LB_STICKY_GROW_COLLISIONS_PER_BUCKET 1
+
 typedef enum {
   LB_NEXT_DROP,
   LB_N_NEXT,
@@ -107,6 +118,14 @@ typedef struct {
    */
   dpo_id_t dpo;
 
+  /**
+   * MagLev permutation of the AS in the new flow table of its VIP.
+   * The AS prefers the entries offset, offset + skip, offset + 2*skip...
+   * Both are derived from the address when the AS is created.
+   */
+  u32 maglev_offset;
+  u32 maglev_skip;
+
 } lb_as_t;
 
 format_function_t format_lb_as;
@@ -115,6 +134,16 @@ typedef struct {
   u32 as_index;
 } lb_new_flow_entry_t;
 
+/**
+ * A new flow table replaced by a rebuild.
+ * Workers may still be reading it, so it is only freed
+ * after LB_CONCURRENCY_TIMEOUT seconds.
+ */
+typedef struct {
+  lb_new_flow_entry_t *table;
+  u32 retired;
+} lb_retired_flow_table_t;
+
 #define lb_foreach_vip_counter \
  _(NEXT_PACKET, "packet from existing sessions", 0) \
  _(FIRST_PACKET, "first session packet", 1) \
@@ -131,12 +160,22 @@ typedef enum {
 /**
  * The load balancer supports IPv4 and IPv6 traffic
  * and GRE4 and GRE6 encap.
+ * It also supports direct server return, where packets are not
+ * encapsulated and the ASs reply directly to the clients:
+ *  - L2DSR: packets are sent unchanged to the MAC address of the AS,
+ *    which must be directly connected and have the VIP configured.
+ *  - L3DSR: the destination address of IPv4 packets is replaced with
+ *    the AS address and the VIP DSCP is set, which the AS maps back
+ *    to the VIP.
  */
 typedef enum {
   LB_VIP_TYPE_IP6_GRE6,
   LB_VIP_TYPE_IP6_GRE4,
   LB_VIP_TYPE_IP4_GRE6,
   LB_VIP_TYPE_IP4_GRE4,
+  LB_VIP_TYPE_IP6_L2DSR,
+  LB_VIP_TYPE_IP4_L2DSR,
+  LB_VIP_TYPE_IP4_L3DSR,
   LB_VIP_N_TYPES,
 } lb_vip_type_t;
 
@@ -172,6 +211,12 @@ typedef struct {
    */
   u32 last_garbage_collection;
 
+  /**
+   * Number of new flow table entries which changed of AS
+   * during the last rebuild, i.e. the disruption it caused.
+   */
+  u32 new_flow_table_changed;
+
   //Not runtime
 
   /**
@@ -195,6 +240,11 @@ typedef struct {
    */
   lb_vip_type_t type;
 
+  /**
+   * DSCP set in the packets sent to the ASs, for L3DSR.
+   */
+  u8 dscp;
+
   /**
    * Flags related to this VIP.
    * LB_VIP_FLAGS_USED means the VIP is active.
@@ -212,17 +262,75 @@ typedef struct {
   u32 *as_indexes;
 } lb_vip_t;
 
-#define lb_vip_is_ip4(vip) ((vip)->type == LB_VIP_TYPE_IP4_GRE6 || (vip)->type == LB_VIP_TYPE_IP4_GRE4)
+#define lb_vip_is_ip4(vip) ((vip)->type == LB_VIP_TYPE_IP4_GRE6 || (vip)->type == LB_VIP_TYPE_IP4_GRE4 || \
+                            (vip)->type == LB_VIP_TYPE_IP4_L2DSR || (vip)->type == LB_VIP_TYPE_IP4_L3DSR)
 #define lb_vip_is_gre4(vip) ((vip)->type == LB_VIP_TYPE_IP6_GRE4 || (vip)->type == LB_VIP_TYPE_IP4_GRE4)
+#define lb_vip_is_l2dsr(vip) ((vip)->type == LB_VIP_TYPE_IP6_L2DSR || (vip)->type == LB_VIP_TYPE_IP4_L2DSR)
+#define lb_vip_is_l3dsr(vip) ((vip)->type == LB_VIP_TYPE_IP4_L3DSR)
+#define lb_vip_is_dsr(vip) (lb_vip_is_l2dsr(vip) || lb_vip_is_l3dsr(vip))
+/* ASs of DSR VIPs are of the VIP family */
+#define lb_vip_as_is_ip4(vip) (lb_vip_is_gre4(vip) || (lb_vip_is_dsr(vip) && lb_vip_is_ip4(vip)))
 format_function_t format_lb_vip;
 format_function_t format_lb_vip_detailed;
 
 typedef struct {
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+
   /**
    * Each CPU has its own sticky flow hash table.
    * One single table is used for all VIPs.
    */
   lb_hash_t *sticky_ht;
+
+  /**
+   * Previous sticky table, when it is being resized.
+   * Its entries are still looked up while they are moved
+   * to sticky_ht, a few buckets per frame.
+   */
+  lb_hash_t *old_sticky_ht;
+
+  /**
+   * Next bucket of old_sticky_ht to move.
+   */
+  u32 migrate_bucket;
+
+  /**
+   * Tables allocated and freed for this CPU by the lb-sticky-alloc
+   * process, so that the worker never calls the allocator.
+   * next_sticky_ht is the table of sticky_buckets buckets to resize to,
+   * free_sticky_ht a migrated table to free. While sticky_alloc_pending
+   * is set, both belong to the process and the worker leaves them alone.
+   */
+  lb_hash_t *next_sticky_ht;
+  lb_hash_t *free_sticky_ht;
+  volatile u32 sticky_alloc_pending;
+
+  /**
+   * Number of buckets this CPU sticky table should have.
+   * It is the configured number, unless the table has grown.
+   */
+  u32 sticky_buckets;
+
+  /**
+   * Configured number of buckets when sticky_buckets was set.
+   */
+  u32 sticky_buckets_conf;
+
+  /**
+   * New flows which could not be tracked since the last resize.
+   */
+  u32 collisions_since_resize;
+
+  /**
+   * Sticky table statistics.
+   * timeouts: timed out entries reused by new flows.
+   * collisions: new flows not tracked as their bucket was full.
+   * overwrites: entries lost as their bucket was full after a resize.
+   */
+  u64 sticky_timeouts;
+  u64 sticky_collisions;
+  u64 sticky_overwrites;
+  u32 sticky_resizes;
 } lb_per_cpu_t;
 
 typedef struct {
@@ -271,6 +379,12 @@ typedef struct {
    */
   u32 per_cpu_sticky_buckets;
 
+  /**
+   * Number of buckets up to which a per-cpu sticky hash table grows
+   * when flows can't be tracked. 0 if they don't grow.
+   */
+  u32 per_cpu_sticky_buckets_max;
+
   /**
    * Flow timeout in seconds.
    */
@@ -281,11 +395,18 @@ typedef struct {
    */
   vlib_simple_counter_main_t vip_counters[LB_N_VIP_COUNTERS];
 
+  /**
+   * Per VIP packets and bytes sent to the ASs
+   */
+  vlib_combined_counter_main_t vip_tx_counters;
+
   /**
    * DPO used to send packet from IP4/6 lookup to LB node.
    */
   dpo_type_t dpo_gre4_type;
   dpo_type_t dpo_gre6_type;
+  dpo_type_t dpo_l2dsr_type;
+  dpo_type_t dpo_l3dsr_type;
 
   /**
    * Node type for registering to fib changes.
@@ -297,24 +418,34 @@ typedef struct {
    */
   u16 msg_id_base;
 
+  /**
+   * New flow tables waiting to be freed.
+   */
+  lb_retired_flow_table_t *retired_flow_tables;
+
   volatile u32 *writer_lock;
 } lb_main_t;
 
 extern lb_main_t lb_main;
 extern vlib_node_registration_t lb6_node;
 extern vlib_node_registration_t lb4_node;
+extern vlib_node_registration_t lb_sticky_alloc_node;
 
 /**
  * Fix global load-balancer parameters.
  * @param ip4_address IPv4 source address used for encapsulated traffic
  * @param ip6_address IPv6 source address used for encapsulated traffic
+ * @param sticky_buckets Number of buckets of the per-cpu sticky tables
+ * @param sticky_buckets_max Number of buckets up to which they grow, or 0
  * @return 0 on success. VNET_LB_ERR_XXX on error
  */
 int lb_conf(ip4_address_t *ip4_address, ip6_address_t *ip6_address,
-            u32 sticky_buckets, u32 flow_timeout);
+            u32 sticky_buckets, u32 sticky_buckets_max, u32 flow_timeout);
+
+lb_hash_t *lb_get_sticky_table(u32 thread_index, u32 time_now);
 
 int lb_vip_add(ip46_address_t *prefix, u8 plen, lb_vip_type_t type,
-               u32 new_length, u32 *vip_index);
+               u8 dscp, u32 new_length, u32 *vip_index);
 int lb_vip_del(u32 vip_index);
 
 int lb_vip_find_index(ip46_address_t *prefix, u8 plen, u32 *vip_index);
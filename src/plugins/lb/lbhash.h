@@ -23,6 +23,8 @@
  * This hash table is the most dummy hash table you can do.
  * Fixed total size, fixed bucket size.
  * Advantage is that it could be very efficient (maybe).
+ * Growing is done by allocating a bigger table and moving the entries
+ * over, which is up to the user (see lb_get_sticky_table).
  *
  */
 
@@ -33,6 +35,8 @@
 
 #if defined (__SSE4_2__)
 #include <immintrin.h>
+#elif defined (__SSE2__)
+#include <emmintrin.h>
 #endif
 
 /*
@@ -61,7 +65,7 @@ typedef struct {
 } lb_hash_t;
 
 #define lb_hash_nbuckets(h) (((h)->buckets_mask) + 1)
-#define lb_hash_size(h) ((h)->buckets_mask + LBHASH_ENTRY_PER_BUCKET)
+#define lb_hash_size(h) (lb_hash_nbuckets(h) * LBHASH_ENTRY_PER_BUCKET)
 
 #define lb_hash_foreach_bucket(h, bucket) \
   for (bucket = (h)->buckets; \
@@ -83,11 +87,13 @@ lb_hash_t *lb_hash_alloc(u32 buckets, u32 timeout)
     return NULL;
 
   // Allocate 1 more bucket for prefetch
-  u32 size = ((u64)&((lb_hash_t *)(0))->buckets[0]) +
-      sizeof(lb_hash_bucket_t) * (buckets + 1);
+  uword size = ((uword)&((lb_hash_t *)(0))->buckets[0]) +
+      sizeof(lb_hash_bucket_t) * ((uword) buckets + 1);
   u8 *mem = 0;
   lb_hash_t *h;
   vec_alloc_aligned(mem, size, CLIB_CACHE_LINE_BYTES);
+  // All entries start timed out and pointing to the default AS
+  memset(mem, 0, size);
   h = (lb_hash_t *)mem;
   h->buckets_mask = (buckets - 1);
   h->timeout = timeout;
@@ -136,7 +142,7 @@ void lb_hash_get(lb_hash_t *ht, u32 hash, u32 vip, u32 time_now,
   lb_hash_bucket_t *bucket = &ht->buckets[hash & ht->buckets_mask];
   *found_value = ~0;
   *available_index = ~0;
-#if __SSE4_2__ && LB_HASH_DO_NOT_USE_SSE_BUCKETS == 0
+#if __SSE2__ && LB_HASH_DO_NOT_USE_SSE_BUCKETS == 0
   u32 bitmask, found_index;
   __m128i mask;
 
@@ -172,18 +178,35 @@ void lb_hash_get(lb_hash_t *ht, u32 hash, u32 vip, u32 time_now,
 #else
   u32 i;
   for (i = 0; i < LBHASH_ENTRY_PER_BUCKET; i++) {
-      u8 cmp = (bucket->hash[i] == hash && bucket->vip[i] == vip);
-      u8 timeouted = clib_u32_loop_gt(time_now, bucket->timeout[i]);
-      *found_value = (cmp || timeouted)?*found_value:bucket->value[i];
-      bucket->timeout[i] = (cmp || timeouted)?time_now + ht->timeout:bucket->timeout[i];
-      *available_index = (timeouted && (*available_index == ~0))?i:*available_index;
-
-      if (!cmp)
+      if (clib_u32_loop_gt(time_now, bucket->timeout[i])) {
+	*available_index = (*available_index == ~0)?i:*available_index;
+	continue;
+      }
+
+      if (bucket->hash[i] == hash && bucket->vip[i] == vip) {
+	*found_value = bucket->value[i];
+	bucket->timeout[i] = time_now + ht->timeout;
 	return;
+      }
   }
 #endif
 }
 
+/*
+ * @brief Returns the index of a timed out entry in the bucket of hash,
+ * or ~0 if the bucket is full.
+ */
+static_always_inline
+u32 lb_hash_available_index(lb_hash_t *h, u32 hash, u32 time_now)
+{
+  lb_hash_bucket_t *bucket = &h->buckets[hash & h->buckets_mask];
+  u32 i;
+  for (i = 0; i < LBHASH_ENTRY_PER_BUCKET; i++)
+    if (clib_u32_loop_gt(time_now, bucket->timeout[i]))
+      return i;
+  return ~0;
+}
+
 static_always_inline
 u32 lb_hash_available_value(lb_hash_t *h, u32 hash, u32 available_index)
 {
@@ -40,6 +40,16 @@ typedef struct {
   u32 as_index;
 } lb_trace_t;
 
+/**
+ * How packets are sent to the ASs, the node compile-time parameter.
+ */
+typedef enum {
+  LB_ENCAP_TYPE_GRE4,
+  LB_ENCAP_TYPE_GRE6,
+  LB_ENCAP_TYPE_L2DSR,
+  LB_ENCAP_TYPE_L3DSR,
+} lb_encap_type_t;
+
 u8 *
 format_lb_trace (u8 * s, va_list * args)
 {
@@ -60,34 +70,135 @@ format_lb_trace (u8 * s, va_list * args)
   return s;
 }
 
-lb_hash_t *lb_get_sticky_table(u32 thread_index)
+/**
+ * Empties an entry of a sticky table which is going to be freed.
+ */
+static_always_inline void
+lb_sticky_entry_release(u32 thread_index, lb_hash_bucket_t *b, u32 i)
+{
+  lb_main_t *lbm = &lb_main;
+  vlib_refcount_add(&lbm->as_refcount, thread_index, b->value[i], -1);
+  vlib_refcount_add(&lbm->as_refcount, thread_index, 0, 1);
+  b->value[i] = 0;
+  b->timeout[i] = 0;
+}
+
+/**
+ * Asks the lb-sticky-alloc process to allocate or free sticky tables.
+ */
+static void
+lb_sticky_table_request(lb_per_cpu_t *pc)
+{
+  if (!clib_smp_swap(&pc->sticky_alloc_pending, 1))
+    vlib_process_signal_event_mt(vlib_get_main(), lb_sticky_alloc_node.index,
+                                 0, 0);
+}
+
+/**
+ * Moves a few buckets of the old sticky table to the new one.
+ * The entries keep their timeout. Those which don't fit are lost.
+ */
+static void
+lb_sticky_table_migrate(u32 thread_index, lb_per_cpu_t *pc, u32 time_now)
 {
   lb_main_t *lbm = &lb_main;
-  lb_hash_t *sticky_ht = lbm->per_cpu[thread_index].sticky_ht;
-  //Check if size changed
-  if (PREDICT_FALSE(sticky_ht && (lbm->per_cpu_sticky_buckets != lb_hash_nbuckets(sticky_ht))))
+  lb_hash_t *old_ht = pc->old_sticky_ht;
+  lb_hash_t *ht = pc->sticky_ht;
+  u32 n = LB_STICKY_MIGRATE_BUCKETS_PER_FRAME;
+  lb_hash_bucket_t *b, *nb;
+  u32 i, j;
+
+  while (n-- && pc->migrate_bucket < lb_hash_nbuckets(old_ht))
     {
-      //Dereference everything in there
-      lb_hash_bucket_t *b;
-      u32 i;
-      lb_hash_foreach_entry(sticky_ht, b, i) {
-	vlib_refcount_add(&lbm->as_refcount, thread_index, b->value[i], -1);
-	vlib_refcount_add(&lbm->as_refcount, thread_index, 0, 1);
-      }
+      b = &old_ht->buckets[pc->migrate_bucket++];
+      for (i = 0; i < LBHASH_ENTRY_PER_BUCKET; i++)
+	{
+	  if (clib_u32_loop_gt(time_now, b->timeout[i]))
+	    {
+	      lb_sticky_entry_release(thread_index, b, i);
+	      continue;
+	    }
+
+	  j = lb_hash_available_index(ht, b->hash[i], time_now);
+	  if (PREDICT_FALSE(j == ~0))
+	    {
+	      pc->sticky_overwrites++;
+	      lb_sticky_entry_release(thread_index, b, i);
+	      continue;
+	    }
+
+	  //The new entry references the AS, the old one gets released
+	  nb = &ht->buckets[b->hash[i] & ht->buckets_mask];
+	  vlib_refcount_add(&lbm->as_refcount, thread_index, nb->value[j], -1);
+	  vlib_refcount_add(&lbm->as_refcount, thread_index, b->value[i], 1);
+	  nb->hash[j] = b->hash[i];
+	  nb->value[j] = b->value[i];
+	  nb->timeout[j] = b->timeout[i];
+	  nb->vip[j] = b->vip[i];
+	  lb_sticky_entry_release(thread_index, b, i);
+	}
+    }
 
-      lb_hash_free(sticky_ht);
-      sticky_ht = NULL;
+  //free_sticky_ht belongs to the process until it clears its last request
+  if (pc->migrate_bucket == lb_hash_nbuckets(old_ht) &&
+      !pc->sticky_alloc_pending)
+    {
+      //All entries were released, the process frees the table
+      ASSERT(pc->free_sticky_ht == NULL);
+      pc->free_sticky_ht = old_ht;
+      pc->old_sticky_ht = NULL;
+      lb_sticky_table_request(pc);
     }
+}
 
-  //Create if necessary
-  if (PREDICT_FALSE(sticky_ht == NULL)) {
-    lbm->per_cpu[thread_index].sticky_ht = lb_hash_alloc(lbm->per_cpu_sticky_buckets, lbm->flow_timeout);
-    sticky_ht = lbm->per_cpu[thread_index].sticky_ht;
-    clib_warning("Regenerated sticky table %p", sticky_ht);
-  }
+lb_hash_t *lb_get_sticky_table(u32 thread_index, u32 time_now)
+{
+  lb_main_t *lbm = &lb_main;
+  lb_per_cpu_t *pc = &lbm->per_cpu[thread_index];
+  lb_hash_t *sticky_ht = pc->sticky_ht;
 
+  //Allocated with the first VIP
   ASSERT(sticky_ht);
 
+  //Check if size changed, by configuration or by growing
+  if (PREDICT_FALSE(pc->sticky_buckets_conf != lbm->per_cpu_sticky_buckets))
+    {
+      pc->sticky_buckets_conf = lbm->per_cpu_sticky_buckets;
+      pc->sticky_buckets = lbm->per_cpu_sticky_buckets;
+    }
+  else if (PREDICT_FALSE(pc->sticky_buckets < lbm->per_cpu_sticky_buckets_max &&
+			 pc->collisions_since_resize >
+			 pc->sticky_buckets * LB_STICKY_GROW_COLLISIONS_PER_BUCKET))
+    {
+      //Counted again from the resize, not to grow several times before it
+      pc->sticky_buckets <<= 1;
+      pc->collisions_since_resize = 0;
+    }
+
+  if (PREDICT_FALSE(pc->old_sticky_ht != NULL))
+    {
+      lb_sticky_table_migrate(thread_index, pc, time_now);
+    }
+  else if (PREDICT_FALSE(pc->sticky_buckets != lb_hash_nbuckets(sticky_ht)))
+    {
+      //The next table belongs to the process until it clears the request
+      if (!pc->sticky_alloc_pending && pc->next_sticky_ht &&
+          lb_hash_nbuckets(pc->next_sticky_ht) == pc->sticky_buckets)
+        {
+          //Keep using the current entries while they are moved
+          pc->old_sticky_ht = sticky_ht;
+          pc->sticky_ht = sticky_ht = pc->next_sticky_ht;
+          pc->next_sticky_ht = NULL;
+          pc->migrate_bucket = 0;
+          pc->collisions_since_resize = 0;
+          pc->sticky_resizes++;
+        }
+      else
+        {
+          lb_sticky_table_request(pc);
+        }
+    }
+
   //Update timeout
   sticky_ht->timeout = lbm->flow_timeout;
   return sticky_ht;
@@ -149,14 +260,16 @@ static_always_inline uword
 lb_node_fn (vlib_main_t * vm,
          vlib_node_runtime_t * node, vlib_frame_t * frame,
          u8 is_input_v4, //Compile-time parameter stating that is input is v4 (or v6)
-         u8 is_encap_v4) //Compile-time parameter stating that is GRE encap is v4 (or v6)
+         lb_encap_type_t encap_type) //Compile-time parameter stating how packets are sent
 {
   lb_main_t *lbm = &lb_main;
   u32 n_left_from, *from, next_index, *to_next, n_left_to_next;
   u32 thread_index = vlib_get_thread_index();
   u32 lb_time = lb_hash_time_now(vm);
 
-  lb_hash_t *sticky_ht = lb_get_sticky_table(thread_index);
+  lb_per_cpu_t *pc = &lbm->per_cpu[thread_index];
+  lb_hash_t *sticky_ht = lb_get_sticky_table(thread_index, lb_time);
+  lb_hash_t *old_sticky_ht = pc->old_sticky_ht;
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;
   next_index = node->cached_next_index;
@@ -224,6 +337,15 @@ lb_node_fn (vlib_main_t * vm,
       lb_hash_get(sticky_ht, hash0, vnet_buffer (p0)->ip.adj_index[VLIB_TX],
 		  lb_time, &available_index0, &asindex0);
 
+      if (PREDICT_FALSE(asindex0 == ~0 && old_sticky_ht != NULL))
+	{
+	  //The flow may not have been moved yet
+	  u32 old_available_index0;
+	  lb_hash_get(old_sticky_ht, hash0,
+		      vnet_buffer (p0)->ip.adj_index[VLIB_TX],
+		      lb_time, &old_available_index0, &asindex0);
+	}
+
       if (PREDICT_TRUE(asindex0 != ~0))
 	{
 	  //Found an existing entry
@@ -240,8 +362,11 @@ lb_node_fn (vlib_main_t * vm,
 	  //Configuration may be changed, vectors resized, etc...
 
 	  //Dereference previously used
+	  u32 old_asindex0 = lb_hash_available_value(sticky_ht, hash0,
+						     available_index0);
+	  pc->sticky_timeouts += (old_asindex0 != 0);
 	  vlib_refcount_add(&lbm->as_refcount, thread_index,
-			    lb_hash_available_value(sticky_ht, hash0, available_index0), -1);
+			    old_asindex0, -1);
 	  vlib_refcount_add(&lbm->as_refcount, thread_index,
 			    asindex0, 1);
 
@@ -255,19 +380,45 @@ lb_node_fn (vlib_main_t * vm,
       else
 	{
 	  //Could not store new entry in the table
+	  //Established flows are kept rather than overwritten
 	  asindex0 = vip0->new_flow_table[hash0 & vip0->new_flow_table_mask].as_index;
 	  counter = LB_VIP_COUNTER_UNTRACKED_PACKET;
+	  pc->sticky_collisions++;
+	  pc->collisions_since_resize++;
 	}
 
       vlib_increment_simple_counter(&lbm->vip_counters[counter],
 				    thread_index,
 				    vnet_buffer (p0)->ip.adj_index[VLIB_TX],
 				    1);
+      vlib_increment_combined_counter(&lbm->vip_tx_counters,
+				      thread_index,
+				      vnet_buffer (p0)->ip.adj_index[VLIB_TX],
+				      1, len0);
 
-      //Now let's encap
+      if (encap_type == LB_ENCAP_TYPE_L2DSR)
+	{
+	  //The packet is sent as is, to the MAC of the AS adjacency
+	}
+      else if (encap_type == LB_ENCAP_TYPE_L3DSR)
+	{
+	  //The AS maps the DSCP back to the VIP
+	  ip4_header_t *ip40 = vlib_buffer_get_current(p0);
+	  ip_csum_t csum0 = ip40->checksum;
+	  u8 tos0 = (ip40->tos & 0x3) | (vip0->dscp << 2);
+	  csum0 = ip_csum_update (csum0, ip40->tos, tos0, ip4_header_t, tos);
+	  csum0 = ip_csum_update (csum0, ip40->dst_address.as_u32,
+				  lbm->ass[asindex0].address.ip4.as_u32,
+				  ip4_header_t, dst_address);
+	  ip40->tos = tos0;
+	  ip40->dst_address = lbm->ass[asindex0].address.ip4;
+	  ip40->checksum = ip_csum_fold (csum0);
+	}
+      else
       {
+	//Now let's encap
 	gre_header_t *gre0;
-	if (is_encap_v4)
+	if (encap_type == LB_ENCAP_TYPE_GRE4)
 	  {
 	    ip4_header_t *ip40;
 	    vlib_buffer_advance(p0, - sizeof(ip4_header_t) - sizeof(gre_header_t));
@@ -327,28 +478,49 @@ static uword
 lb6_gre6_node_fn (vlib_main_t * vm,
          vlib_node_runtime_t * node, vlib_frame_t * frame)
 {
-  return lb_node_fn(vm, node, frame, 0, 0);
+  return lb_node_fn(vm, node, frame, 0, LB_ENCAP_TYPE_GRE6);
 }
 
 static uword
 lb6_gre4_node_fn (vlib_main_t * vm,
          vlib_node_runtime_t * node, vlib_frame_t * frame)
 {
-  return lb_node_fn(vm, node, frame, 0, 1);
+  return lb_node_fn(vm, node, frame, 0, LB_ENCAP_TYPE_GRE4);
 }
 
 static uword
 lb4_gre6_node_fn (vlib_main_t * vm,
          vlib_node_runtime_t * node, vlib_frame_t * frame)
 {
-  return lb_node_fn(vm, node, frame, 1, 0);
+  return lb_node_fn(vm, node, frame, 1, LB_ENCAP_TYPE_GRE6);
 }
 
 static uword
 lb4_gre4_node_fn (vlib_main_t * vm,
          vlib_node_runtime_t * node, vlib_frame_t * frame)
 {
-  return lb_node_fn(vm, node, frame, 1, 1);
+  return lb_node_fn(vm, node, frame, 1, LB_ENCAP_TYPE_GRE4);
+}
+
+static uword
+lb6_l2dsr_node_fn (vlib_main_t * vm,
+         vlib_node_runtime_t * node, vlib_frame_t * frame)
+{
+  return lb_node_fn(vm, node, frame, 0, LB_ENCAP_TYPE_L2DSR);
+}
+
+static uword
+lb4_l2dsr_node_fn (vlib_main_t * vm,
+         vlib_node_runtime_t * node, vlib_frame_t * frame)
+{
+  return lb_node_fn(vm, node, frame, 1, LB_ENCAP_TYPE_L2DSR);
+}
+
+static uword
+lb4_l3dsr_node_fn (vlib_main_t * vm,
+         vlib_node_runtime_t * node, vlib_frame_t * frame)
+{
+  return lb_node_fn(vm, node, frame, 1, LB_ENCAP_TYPE_L3DSR);
 }
 
 VLIB_REGISTER_NODE (lb6_gre6_node) =
@@ -419,3 +591,53 @@ VLIB_REGISTER_NODE (lb4_gre4_node) =
   },
 };
 
+VLIB_REGISTER_NODE (lb6_l2dsr_node) =
+{
+  .function = lb6_l2dsr_node_fn,
+  .name = "lb6-l2dsr",
+  .vector_size = sizeof (u32),
+  .format_trace = format_lb_trace,
+
+  .n_errors = LB_N_ERROR,
+  .error_strings = lb_error_strings,
+
+  .n_next_nodes = LB_N_NEXT,
+  .next_nodes =
+  {
+      [LB_NEXT_DROP] = "error-drop"
+  },
+};
+
+VLIB_REGISTER_NODE (lb4_l2dsr_node) =
+{
+  .function = lb4_l2dsr_node_fn,
+  .name = "lb4-l2dsr",
+  .vector_size = sizeof (u32),
+  .format_trace = format_lb_trace,
+
+  .n_errors = LB_N_ERROR,
+  .error_strings = lb_error_strings,
+
+  .n_next_nodes = LB_N_NEXT,
+  .next_nodes =
+  {
+      [LB_NEXT_DROP] = "error-drop"
+  },
+};
+
+VLIB_REGISTER_NODE (lb4_l3dsr_node) =
+{
+  .function = lb4_l3dsr_node_fn,
+  .name = "lb4-l3dsr",
+  .vector_size = sizeof (u32),
+  .format_trace = format_lb_trace,
+
+  .n_errors = LB_N_ERROR,
+  .error_strings = lb_error_strings,
+
+  .n_next_nodes = LB_N_NEXT,
+  .next_nodes =
+  {
+      [LB_NEXT_DROP] = "error-drop"
+  },
+};
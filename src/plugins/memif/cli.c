@@ -64,6 +64,8 @@ memif_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
 	args.is_master = 0;
       else if (unformat (line_input, "mode ip"))
 	args.mode = MEMIF_INTERFACE_MODE_IP;
+      else if (unformat (line_input, "zero-copy"))
+	args.is_zero_copy = 1;
       else if (unformat (line_input, "hw-addr %U",
 			 unformat_ethernet_address, args.hw_addr))
 	args.hw_addr_set = 1;
@@ -78,6 +80,9 @@ memif_create_command_fn (vlib_main_t * vm, unformat_input_t * input,
 
   args.log2_ring_size = min_log2 (ring_size);
 
+  if (args.is_zero_copy && args.is_master)
+    return clib_error_return (0, "zero-copy is only supported on the slave");
+
   if (rx_queues > 255 || rx_queues < 1)
     return clib_error_return (0, "rx queue must be between 1 - 255");
   if (tx_queues > 255 || tx_queues < 1)
@@ -110,7 +115,7 @@ VLIB_CLI_COMMAND (memif_create_command, static) = {
   .short_help = "create memif [id <id>] [socket <path>] "
                 "[ring-size <size>] [buffer-size <size>] [hw-addr <mac-address>] "
 		"<master|slave> [rx-queues <number>] [tx-queues <number>] "
-		"[mode ip] [secret <string>]",
+		"[mode ip] [secret <string>] [zero-copy]",
   .function = memif_create_command_fn,
 };
 /* *INDENT-ON* */
@@ -329,8 +334,19 @@ memif_show_command_fn (vlib_main_t * vm, unformat_input_t * input,
       }
       vec_foreach_index (i, mif->rx_queues)
       {
+	vnet_hw_interface_rx_mode mode;
 	mq = vec_elt_at_index (mif->rx_queues, i);
 	vlib_cli_output (vm, "  %U", format_memif_queue, mif, mq, i);
+	if (vnet_hw_interface_get_rx_mode (vnm, mif->hw_if_index, i,
+					   &mode) == 0)
+	  vlib_cli_output (vm, "      thread %u rx-mode %U%s mode-switches %llu",
+			   vnet_get_device_input_thread_index (vnm,
+							       mif->hw_if_index,
+							       i),
+			   format_vnet_hw_interface_rx_mode, mode,
+			   mode != VNET_HW_INTERFACE_RX_MODE_ADAPTIVE ? "" :
+			   mq->adaptive_polling ? " (polling)" :
+			   " (interrupt)", mq->adaptive_switch_count);
 	if (show_descr)
 	  vlib_cli_output (vm, "  %U", format_memif_descriptor, mif, mq);
       }
@@ -348,6 +364,75 @@ VLIB_CLI_COMMAND (memif_show_command, static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+memif_adaptive_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			   vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  memif_main_t *mm = &memif_main;
+  u32 poll_threshold = mm->adaptive_poll_threshold;
+  u32 interrupt_threshold = mm->adaptive_interrupt_threshold;
+  u32 idle_dispatches = mm->adaptive_idle_dispatches;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    {
+      vlib_cli_output (vm, "poll-threshold %u interrupt-threshold %u "
+		       "idle-dispatches %u", poll_threshold,
+		       interrupt_threshold, idle_dispatches);
+      return 0;
+    }
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "poll-threshold %u", &poll_threshold))
+	;
+      else if (unformat (line_input, "interrupt-threshold %u",
+			 &interrupt_threshold))
+	;
+      else if (unformat (line_input, "idle-dispatches %u", &idle_dispatches))
+	;
+      else
+	{
+	  unformat_free (line_input);
+	  return clib_error_return (0, "unknown input `%U'",
+				    format_unformat_error, input);
+	}
+    }
+  unformat_free (line_input);
+
+  if (interrupt_threshold >= poll_threshold)
+    return clib_error_return (0, "interrupt-threshold must be lower than "
+			      "poll-threshold");
+  if (idle_dispatches == 0)
+    return clib_error_return (0, "idle-dispatches must be non-zero");
+
+  mm->adaptive_poll_threshold = poll_threshold;
+  mm->adaptive_interrupt_threshold = interrupt_threshold;
+  mm->adaptive_idle_dispatches = idle_dispatches;
+
+  return 0;
+}
+
+/*?
+ * Tune the rx queues in adaptive mode. A queue is polled once a dispatch
+ * brings in at least <em>poll-threshold</em> packets, and goes back to
+ * interrupts after <em>idle-dispatches</em> dispatches in a row bringing
+ * in no more than <em>interrupt-threshold</em> packets. Without
+ * arguments, the current values are shown.
+ *
+ * @cliexpar
+ * @cliexcmd{set memif adaptive poll-threshold 64 idle-dispatches 4096}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (memif_adaptive_command, static) = {
+  .path = "set memif adaptive",
+  .short_help = "set memif adaptive [poll-threshold <n>] "
+    "[interrupt-threshold <n>] [idle-dispatches <n>]",
+  .function = memif_adaptive_command_fn,
+};
+/* *INDENT-ON* */
+
 clib_error_t *
 memif_cli_init (vlib_main_t * vm)
 {
@@ -32,7 +32,8 @@
 _(NO_FREE_SLOTS, "no free tx slots")           \
 _(TRUNC_PACKET, "packet > buffer size -- truncated in tx ring") \
 _(PENDING_MSGS, "pending msgs in tx ring") \
-_(NO_TX_QUEUES, "no tx queues")
+_(NO_TX_QUEUES, "no tx queues") \
+_(NOT_SHARED, "buffer memory not shared with the peer (zero-copy)")
 
 typedef enum
 {
@@ -196,10 +197,8 @@ memif_interface_tx_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   head = ring->head;
   tail = ring->tail;
 
-  if (tail > head)
-    free_slots = tail - head;
-  else
-    free_slots = ring_size - head + tail;
+  /* keep a slot free, a full ring would look empty to the peer */
+  free_slots = ring_size - 1 - ((head - tail) & mask);
 
   while (n_left > 5 && free_slots > 1)
     {
@@ -270,6 +269,133 @@ error:
   return frame->n_vectors;
 }
 
+/*
+ * Zero-copy tx: the descriptors point at the vlib buffers, which stay
+ * ours until the peer moves the tail past them.
+ */
+static_always_inline uword
+memif_interface_tx_zc_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
+			      vlib_frame_t * frame, memif_if_t * mif)
+{
+  u8 qid;
+  memif_ring_t *ring;
+  u32 *buffers = vlib_frame_args (frame);
+  u32 n_left = frame->n_vectors;
+  u16 ring_size, mask;
+  u16 head, tail, slot;
+  u16 free_slots, n_free, n;
+  u32 thread_index = vlib_get_thread_index ();
+  u8 tx_queues = vec_len (mif->tx_queues);
+  memif_queue_t *mq;
+
+  if (PREDICT_FALSE (tx_queues == 0))
+    {
+      vlib_error_count (vm, node->node_index, MEMIF_TX_ERROR_NO_TX_QUEUES,
+			n_left);
+      vlib_buffer_free (vm, buffers, n_left);
+      return frame->n_vectors;
+    }
+
+  if (tx_queues < vec_len (vlib_mains))
+    {
+      qid = thread_index % tx_queues;
+      clib_spinlock_lock_if_init (&mif->lockp);
+    }
+  else
+    {
+      qid = thread_index;
+    }
+  mq = vec_elt_at_index (mif->tx_queues, qid);
+  ring = mq->ring;
+  ring_size = 1 << mq->log2_ring_size;
+  mask = ring_size - 1;
+
+  head = ring->head;
+  tail = ring->tail;
+
+  /* free the buffers the peer is done with, up to the end of the ring */
+  n_free = (tail - mq->last_tail) & mask;
+  while (n_free)
+    {
+      slot = mq->last_tail;
+      n = clib_min (n_free, ring_size - slot);
+      vlib_buffer_free_no_next (vm, &mq->buffers[slot], n);
+      mq->last_tail = (slot + n) & mask;
+      n_free -= n;
+    }
+
+  free_slots = ring_size - 1 - ((head - tail) & mask);
+
+  while (n_left)
+    {
+      vlib_buffer_t *b0 = vlib_get_buffer (vm, buffers[0]);
+      u32 bi0 = buffers[0];
+      u16 n_slots = 1;
+      int is_shared = memif_buffer_is_shared (mif, b0);
+
+      while (b0->flags & VLIB_BUFFER_NEXT_PRESENT)
+	{
+	  b0 = vlib_get_buffer (vm, b0->next_buffer);
+	  is_shared &= memif_buffer_is_shared (mif, b0);
+	  n_slots++;
+	}
+
+      /* the peer can't see buffer memory added after we connected */
+      if (PREDICT_FALSE (!is_shared))
+	{
+	  vlib_error_count (vm, node->node_index, MEMIF_TX_ERROR_NOT_SHARED,
+			    1);
+	  vlib_buffer_free (vm, buffers, 1);
+	  buffers++;
+	  n_left--;
+	  continue;
+	}
+
+      if (n_slots > free_slots)
+	break;
+
+      do
+	{
+	  memif_desc_t *d = &ring->desc[head];
+
+	  b0 = vlib_get_buffer (vm, bi0);
+	  memif_desc_set_buffer (vm, d, b0, b0->current_length);
+	  d->length = b0->current_length;
+	  d->flags = (b0->flags & VLIB_BUFFER_NEXT_PRESENT) ?
+	    MEMIF_DESC_FLAG_NEXT : 0;
+	  mq->buffers[head] = bi0;
+	  head = (head + 1) & mask;
+	}
+      while ((bi0 = (b0->flags & VLIB_BUFFER_NEXT_PRESENT) ?
+	      b0->next_buffer : 0));
+
+      buffers++;
+      n_left--;
+      free_slots -= n_slots;
+    }
+
+  CLIB_MEMORY_STORE_BARRIER ();
+  ring->head = head;
+
+  clib_spinlock_unlock_if_init (&mif->lockp);
+
+  if (n_left)
+    {
+      vlib_error_count (vm, node->node_index, MEMIF_TX_ERROR_NO_FREE_SLOTS,
+			n_left);
+      vlib_buffer_free (vm, buffers, n_left);
+    }
+
+  if ((ring->flags & MEMIF_RING_FLAG_MASK_INT) == 0 && mq->int_fd > -1)
+    {
+      u64 b = 1;
+      CLIB_UNUSED (int r) = write (mq->int_fd, &b, sizeof (b));
+      mq->int_count++;
+    }
+
+  return frame->n_vectors;
+}
+
 static uword
 memif_interface_tx (vlib_main_t * vm,
 		    vlib_node_runtime_t * node, vlib_frame_t * frame)
@@ -278,7 +404,9 @@ memif_interface_tx (vlib_main_t * vm,
   vnet_interface_output_runtime_t *rund = (void *) node->runtime_data;
   memif_if_t *mif = pool_elt_at_index (nm->interfaces, rund->dev_instance);
 
-  if (mif->flags & MEMIF_IF_FLAG_IS_SLAVE)
+  if (mif->flags & MEMIF_IF_FLAG_ZERO_COPY)
+    return memif_interface_tx_zc_inline (vm, node, frame, mif);
+  else if (mif->flags & MEMIF_IF_FLAG_IS_SLAVE)
     return memif_interface_tx_inline (vm, node, frame, mif, MEMIF_RING_S2M);
   else
     return memif_interface_tx_inline (vm, node, frame, mif, MEMIF_RING_M2S);
@@ -318,6 +446,10 @@ memif_interface_rx_mode_change (vnet_main_t * vnm, u32 hw_if_index, u32 qid,
   memif_if_t *mif = pool_elt_at_index (mm->interfaces, hw->dev_instance);
   memif_queue_t *mq = vec_elt_at_index (mif->rx_queues, qid);
 
+  /* adaptive mode starts with interrupts, see memif-input */
+  mq->adaptive_polling = 0;
+  mq->adaptive_idle_dispatches = 0;
+
   if (mode == VNET_HW_INTERFACE_RX_MODE_POLLING)
     mq->ring->flags |= MEMIF_RING_FLAG_MASK_INT;
   else
@@ -65,6 +65,42 @@ memif_queue_intfd_close (memif_queue_t * mq)
     }
 }
 
+/*
+ * Zero-copy: give back the vlib buffers still owned by the ring. On rx
+ * those are all but the slots handed to the graph and not refilled yet,
+ * on tx the slots between the last one the peer consumed and the head.
+ */
+static void
+memif_queue_free_buffers (memif_queue_t * mq, int is_tx)
+{
+  vlib_main_t *vm = vlib_get_main ();
+  u16 ring_size = 1 << mq->log2_ring_size;
+  u16 mask = ring_size - 1;
+  u16 slot, n_slots;
+
+  if (mq->buffers == 0)
+    return;
+
+  if (is_tx)
+    {
+      slot = mq->last_tail;
+      n_slots = mq->ring ? (mq->ring->head - mq->last_tail) & mask : 0;
+    }
+  else
+    {
+      slot = mq->last_head;
+      n_slots = ring_size - ((mq->last_head - mq->last_tail) & mask);
+    }
+
+  while (n_slots--)
+    {
+      vlib_buffer_free_no_next (vm, &mq->buffers[slot], 1);
+      slot = (slot + 1) & mask;
+    }
+
+  vec_free (mq->buffers);
+}
+
 void
 memif_disconnect (memif_if_t * mif, clib_error_t * err)
 {
@@ -121,16 +157,26 @@ memif_disconnect (memif_if_t * mif, clib_error_t * err)
   }
 
   /* free tx and rx queues */
-  vec_foreach (mq, mif->rx_queues) memif_queue_intfd_close (mq);
+  vec_foreach (mq, mif->rx_queues)
+  {
+    memif_queue_intfd_close (mq);
+    memif_queue_free_buffers (mq, 0);
+  }
   vec_free (mif->rx_queues);
 
-  vec_foreach (mq, mif->tx_queues) memif_queue_intfd_close (mq);
+  vec_foreach (mq, mif->tx_queues)
+  {
+    memif_queue_intfd_close (mq);
+    memif_queue_free_buffers (mq, 1);
+  }
   vec_free (mif->tx_queues);
 
   /* free memory regions */
   vec_foreach (mr, mif->regions)
   {
     int rv;
+    if (mr->is_external)
+      continue;
     if ((rv = munmap (mr->shm, mr->region_size)))
       clib_warning ("munmap failed, rv = %d", rv);
     if (mr->fd > -1)
@@ -169,6 +215,48 @@ memif_int_fd_read_ready (clib_file_t * uf)
 }
 
 
+/*
+ * Place a new rx queue on the worker polling the fewest rx queues, of
+ * any device, so that the queues of interfaces connecting and
+ * disconnecting over time stay spread across the workers.
+ */
+static uword
+memif_pick_rx_thread (vnet_main_t * vnm)
+{
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vnet_hw_interface_t *hw;
+  u32 *n_queues = 0, q;
+  uword thread_index, best = ~0;
+
+  if (vdm->first_worker_thread_index == 0)
+    return 0;
+
+  vec_validate (n_queues, vdm->last_worker_thread_index);
+
+  /* *INDENT-OFF* */
+  pool_foreach (hw, vnm->interface_main.hw_interfaces,
+  ({
+    /* unassigned queues keep their last thread index */
+    vec_foreach_index (q, hw->input_node_thread_index_by_queue)
+      {
+	thread_index = hw->input_node_thread_index_by_queue[q];
+	if (q < vec_len (hw->rx_mode_by_queue) &&
+	    hw->rx_mode_by_queue[q] != VNET_HW_INTERFACE_RX_MODE_UNKNOWN &&
+	    thread_index < vec_len (n_queues))
+	  n_queues[thread_index]++;
+      }
+  }));
+  /* *INDENT-ON* */
+
+  for (thread_index = vdm->first_worker_thread_index;
+       thread_index <= vdm->last_worker_thread_index; thread_index++)
+    if (best == ~0 || n_queues[thread_index] < n_queues[best])
+      best = thread_index;
+
+  vec_free (n_queues);
+  return best;
+}
+
 clib_error_t *
 memif_connect (memif_if_t * mif)
 {
@@ -221,7 +309,8 @@ memif_connect (memif_if_t * mif)
 	template.private_data = (mif->dev_instance << 16) | (i & 0xFFFF);
 	memif_file_add (&mq->int_clib_file_index, &template);
       }
-    vnet_hw_interface_assign_rx_thread (vnm, mif->hw_if_index, i, ~0);
+    vnet_hw_interface_assign_rx_thread (vnm, mif->hw_if_index, i,
+					memif_pick_rx_thread (vnm));
     rv = vnet_hw_interface_set_rx_mode (vnm, mif->hw_if_index, i,
 					VNET_HW_INTERFACE_RX_MODE_DEFAULT);
     if (rv)
@@ -263,6 +352,7 @@ memif_get_ring (memif_if_t * mif, memif_ring_type_t type, u16 ring_num)
 clib_error_t *
 memif_init_regions_and_queues (memif_if_t * mif)
 {
+  vlib_main_t *vm = vlib_get_main ();
   memif_ring_t *ring = NULL;
   int i, j;
   u64 buffer_offset;
@@ -277,9 +367,13 @@ memif_init_regions_and_queues (memif_if_t * mif)
     (sizeof (memif_ring_t) +
      sizeof (memif_desc_t) * (1 << mif->run.log2_ring_size));
 
-  r->region_size = buffer_offset +
-    mif->run.buffer_size * (1 << mif->run.log2_ring_size) *
-    (mif->run.num_s2m_rings + mif->run.num_m2s_rings);
+  /* zero-copy: the descriptors point at vlib buffers, see below */
+  if (mif->flags & MEMIF_IF_FLAG_ZERO_COPY)
+    r->region_size = buffer_offset;
+  else
+    r->region_size = buffer_offset +
+      mif->run.buffer_size * (1 << mif->run.log2_ring_size) *
+      (mif->run.num_s2m_rings + mif->run.num_m2s_rings);
 
   alloc.name = "memif region";
   alloc.size = r->region_size;
@@ -292,6 +386,27 @@ memif_init_regions_and_queues (memif_if_t * mif)
   r->fd = alloc.fd;
   r->shm = alloc.addr;
 
+  if (mif->flags & MEMIF_IF_FLAG_ZERO_COPY)
+    {
+      vlib_buffer_pool_t *bp;
+
+      vec_foreach (bp, vm->buffer_main->buffer_pools)
+      {
+	vlib_physmem_region_t *pr;
+
+	pr = vlib_physmem_get_region (vm, bp->physmem_region);
+	if (pr->fd < 0)
+	  return clib_error_return (0, "buffer memory %s can't be shared",
+				    pr->name);
+
+	vec_add2_aligned (mif->regions, r, 1, CLIB_CACHE_LINE_BYTES);
+	r->fd = pr->fd;
+	r->region_size = pr->size;
+	r->shm = pr->mem;
+	r->is_external = 1;
+      }
+    }
+
   for (i = 0; i < mif->run.num_s2m_rings; i++)
     {
       ring = memif_get_ring (mif, MEMIF_RING_S2M, i);
@@ -332,10 +447,16 @@ memif_init_regions_and_queues (memif_if_t * mif)
       return clib_error_return_unix (0, "eventfd[tx queue %u]", i);
     mq->int_clib_file_index = ~0;
     mq->ring = memif_get_ring (mif, MEMIF_RING_S2M, i);
-    mq->log2_ring_size = mif->cfg.log2_ring_size;
+    mq->log2_ring_size = mif->run.log2_ring_size;
     mq->region = 0;
     mq->offset = (void *) mq->ring - (void *) mif->regions[mq->region].shm;
     mq->last_head = 0;
+    mq->last_tail = 0;
+
+    /* filled by the tx path */
+    if (mif->flags & MEMIF_IF_FLAG_ZERO_COPY)
+      vec_validate_aligned (mq->buffers, (1 << mq->log2_ring_size) - 1,
+			    CLIB_CACHE_LINE_BYTES);
   }
 
   ASSERT (mif->rx_queues == 0);
@@ -348,10 +469,39 @@ memif_init_regions_and_queues (memif_if_t * mif)
       return clib_error_return_unix (0, "eventfd[rx queue %u]", i);
     mq->int_clib_file_index = ~0;
     mq->ring = memif_get_ring (mif, MEMIF_RING_M2S, i);
-    mq->log2_ring_size = mif->cfg.log2_ring_size;
+    mq->log2_ring_size = mif->run.log2_ring_size;
     mq->region = 0;
     mq->offset = (void *) mq->ring - (void *) mif->regions[mq->region].shm;
     mq->last_head = 0;
+    mq->last_tail = 0;
+
+    /* the peer writes straight into our buffers, give it a full ring */
+    if (mif->flags & MEMIF_IF_FLAG_ZERO_COPY)
+      {
+	u32 ring_size = 1 << mq->log2_ring_size;
+	u32 n_buffer_bytes =
+	  vlib_buffer_free_list_buffer_size (vm,
+					     VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
+	u32 n_alloc;
+
+	vec_validate_aligned (mq->buffers, ring_size - 1,
+			      CLIB_CACHE_LINE_BYTES);
+	n_alloc = vlib_buffer_alloc (vm, mq->buffers, ring_size);
+	if (n_alloc < ring_size)
+	  {
+	    vlib_buffer_free (vm, mq->buffers, n_alloc);
+	    vec_free (mq->buffers);
+	    return clib_error_return (0, "buffer alloc failed[rx queue %u]",
+				      i);
+	  }
+
+	for (j = 0; j < ring_size; j++)
+	  {
+	    vlib_buffer_t *b = vlib_get_buffer (vm, mq->buffers[j]);
+	    b->current_data = 0;
+	    memif_desc_set_buffer (vm, &mq->ring->desc[j], b, n_buffer_bytes);
+	  }
+      }
   }
 
   return 0;
@@ -750,6 +900,10 @@ memif_create_if (vlib_main_t * vm, memif_create_if_args_t * args)
   if (args->is_master == 0)
     mif->flags |= MEMIF_IF_FLAG_IS_SLAVE;
 
+  /* the slave owns the shared memory, so only it can do zero-copy */
+  if (args->is_master == 0 && args->is_zero_copy)
+    mif->flags |= MEMIF_IF_FLAG_ZERO_COPY;
+
   hw = vnet_get_hw_interface (vnm, mif->hw_if_index);
   hw->flags |= VNET_HW_INTERFACE_FLAG_SUPPORTS_INT_MODE;
   vnet_hw_interface_set_input_node (vnm, mif->hw_if_index,
@@ -798,6 +952,11 @@ memif_init (vlib_main_t * vm)
   vec_validate_aligned (mm->rx_buffers, tm->n_vlib_mains - 1,
 			CLIB_CACHE_LINE_BYTES);
 
+  mm->adaptive_poll_threshold = MEMIF_DEFAULT_ADAPTIVE_POLL_THRESHOLD;
+  mm->adaptive_interrupt_threshold =
+    MEMIF_DEFAULT_ADAPTIVE_INTERRUPT_THRESHOLD;
+  mm->adaptive_idle_dispatches = MEMIF_DEFAULT_ADAPTIVE_IDLE_DISPATCHES;
+
   return 0;
 }
 
@@ -27,6 +27,10 @@
 #define MEMIF_VERSION_MINOR	0
 #define MEMIF_VERSION		((MEMIF_VERSION_MAJOR << 8) | MEMIF_VERSION_MINOR)
 
+/* Minor version 1: a sender always leaves one ring slot free, so the
+   receiver may keep buffers in the free slots (zero-copy slave). */
+#define MEMIF_VERSION_ZERO_COPY	((MEMIF_VERSION_MAJOR << 8) | 1)
+
 /*
  *  Type definitions
  */
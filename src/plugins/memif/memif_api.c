@@ -136,6 +136,14 @@ vl_api_memif_create_t_handler (vl_api_memif_create_t * mp)
   /* mode */
   args.mode = mp->mode;
 
+  /* zero-copy */
+  args.is_zero_copy = mp->zero_copy;
+  if (args.is_zero_copy && args.is_master)
+    {
+      rv = VNET_API_ERROR_INVALID_ARGUMENT;
+      goto reply;
+    }
+
   /* rx/tx queues */
   if (args.is_master == 0)
     {
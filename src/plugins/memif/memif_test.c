@@ -130,6 +130,7 @@ api_memif_create (vat_main_t * vam)
   u32 tx_queues = MEMIF_DEFAULT_TX_QUEUES;
   int ret;
   u8 mode = MEMIF_INTERFACE_MODE_ETHERNET;
+  u8 zero_copy = 0;
 
   while (unformat_check_input (i) != UNFORMAT_END_OF_INPUT)
     {
@@ -150,6 +151,8 @@ api_memif_create (vat_main_t * vam)
 	role = 1;
       else if (unformat (i, "mode ip"))
 	mode = MEMIF_INTERFACE_MODE_IP;
+      else if (unformat (i, "zero-copy"))
+	zero_copy = 1;
       else if (unformat (i, "hw_addr %U", unformat_ethernet_address, hw_addr))
 	;
       else
@@ -197,6 +200,7 @@ api_memif_create (vat_main_t * vam)
   memcpy (mp->hw_addr, hw_addr, 6);
   mp->rx_queues = rx_queues;
   mp->tx_queues = tx_queues;
+  mp->zero_copy = zero_copy;
 
   S (mp);
   W (ret);
@@ -312,7 +316,8 @@ static void vl_api_memif_details_t_handler (vl_api_memif_details_t * mp)
 #define foreach_vpe_api_msg					  \
 _(memif_create, "[id <id>] [socket <path>] [ring_size <size>] " \
 		"[buffer_size <size>] [hw_addr <mac_address>] "   \
-		"[secret <string>] [mode ip] <master|slave>")	  \
+		"[secret <string>] [mode ip] [zero-copy] "	  \
+		"<master|slave>")				  \
 _(memif_delete, "<sw_if_index>")                                  \
 _(memif_dump, "")
 
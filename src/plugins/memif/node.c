@@ -464,47 +464,286 @@ memif_device_input_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   return n_rx_packets;
 }
 
+/* give the peer new buffers for the slots handed to the graph */
+static_always_inline void
+memif_refill_queue_zc (vlib_main_t * vm, memif_queue_t * mq,
+		       u32 n_buffer_bytes)
+{
+  memif_ring_t *ring = mq->ring;
+  u16 ring_size = 1 << mq->log2_ring_size;
+  u16 mask = ring_size - 1;
+  u16 n_slots, n, n_alloc, slot;
+  u32 i;
+
+  n_slots = (mq->last_head - mq->last_tail) & mask;
+
+  while (n_slots)
+    {
+      /* allocate straight into the ring, up to its end */
+      slot = mq->last_tail;
+      n = clib_min (n_slots, ring_size - slot);
+      n_alloc = vlib_buffer_alloc (vm, &mq->buffers[slot], n);
+      for (i = 0; i < n_alloc; i++)
+	{
+	  vlib_buffer_t *b = vlib_get_buffer (vm, mq->buffers[slot + i]);
+	  b->current_data = 0;
+	  memif_desc_set_buffer (vm, &ring->desc[slot + i], b,
+				 n_buffer_bytes);
+	}
+      mq->last_tail = (slot + n_alloc) & mask;
+      if (n_alloc < n)
+	break;
+      n_slots -= n;
+    }
+
+  CLIB_MEMORY_STORE_BARRIER ();
+  ring->tail = mq->last_tail;
+}
+
+/*
+ * Zero-copy rx: the peer wrote the packets straight into the vlib
+ * buffers behind the descriptors, hand them to the graph and refill the
+ * slots. A slot not refilled (buffer shortage) is not given back to the
+ * peer, the next call retries.
+ */
+static_always_inline uword
+memif_device_input_zc_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
+			      memif_if_t * mif, u16 qid,
+			      memif_interface_mode_t mode)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  memif_queue_t *mq = vec_elt_at_index (mif->rx_queues, qid);
+  memif_ring_t *ring = mq->ring;
+  u16 mask = (1 << mq->log2_ring_size) - 1;
+  uword n_trace = vlib_get_trace_count (vm, node);
+  u32 thread_index = vlib_get_thread_index ();
+  u32 n_rx_packets = 0, n_rx_bytes = 0;
+  u32 next_index, n_left_to_next, *to_next;
+  u16 num_slots;
+  u32 n_buffer_bytes = vlib_buffer_free_list_buffer_size (vm,
+							  VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
+
+  if (mode == MEMIF_INTERFACE_MODE_IP)
+    next_index = VNET_DEVICE_INPUT_NEXT_IP6_INPUT;
+  else
+    next_index = VNET_DEVICE_INPUT_NEXT_ETHERNET_INPUT;
+
+  num_slots = (ring->head - mq->last_head) & mask;
+
+  while (num_slots)
+    {
+      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+
+      while (num_slots && n_left_to_next)
+	{
+	  vlib_buffer_t *b0, *first_b0 = 0;
+	  u32 bi0, first_bi0 = 0, prev_bi0 = 0;
+	  u32 next0 = next_index;
+	  u16 slot;
+
+	  /* a packet spans the slots flagged with NEXT and one more */
+	  do
+	    {
+	      slot = mq->last_head;
+	      bi0 = mq->buffers[slot];
+	      b0 = vlib_get_buffer (vm, bi0);
+
+	      if (PREDICT_TRUE (num_slots > 2))
+		memif_prefetch (vm, mq->buffers[(slot + 2) & mask]);
+
+	      b0->current_data = 0;
+	      b0->current_length = clib_min (ring->desc[slot].length,
+					     n_buffer_bytes);
+	      if (first_b0 == 0)
+		{
+		  b0->total_length_not_including_first_buffer = 0;
+		  b0->flags = VLIB_BUFFER_TOTAL_LENGTH_VALID;
+		  vnet_buffer (b0)->sw_if_index[VLIB_RX] = mif->sw_if_index;
+		  vnet_buffer (b0)->sw_if_index[VLIB_TX] = (u32) ~ 0;
+		  first_bi0 = bi0;
+		  first_b0 = b0;
+		}
+	      else
+		memif_buffer_add_to_chain (vm, bi0, first_bi0, prev_bi0);
+
+	      n_rx_bytes += b0->current_length;
+	      prev_bi0 = bi0;
+	      mq->last_head = (slot + 1) & mask;
+	      num_slots--;
+	    }
+	  while (num_slots && (ring->desc[slot].flags & MEMIF_DESC_FLAG_NEXT));
+
+	  if (mode == MEMIF_INTERFACE_MODE_IP)
+	    next0 = memif_next_from_ip_hdr (node, first_b0);
+	  else if (mode == MEMIF_INTERFACE_MODE_ETHERNET)
+	    {
+	      if (PREDICT_FALSE (mif->per_interface_next_index != ~0))
+		next0 = mif->per_interface_next_index;
+	      else
+		/* redirect if feature path
+		 * enabled */
+		vnet_feature_start_device_input_x1 (mif->sw_if_index,
+						    &next0, first_b0);
+	    }
+
+	  /* trace */
+	  VLIB_BUFFER_TRACE_TRAJECTORY_INIT (first_b0);
+
+	  if (PREDICT_FALSE (n_trace > 0))
+	    {
+	      memif_input_trace_t *tr;
+	      vlib_trace_buffer (vm, node, next0, first_b0,
+				 /* follow_chain */ 0);
+	      vlib_set_trace_count (vm, node, --n_trace);
+	      tr = vlib_add_trace (vm, node, first_b0, sizeof (*tr));
+	      tr->next_index = next0;
+	      tr->hw_if_index = mif->hw_if_index;
+	      tr->ring = qid;
+	    }
+
+	  /* enqueue buffer */
+	  to_next[0] = first_bi0;
+	  to_next += 1;
+	  n_left_to_next--;
+
+	  /* enqueue */
+	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index, to_next,
+					   n_left_to_next, first_bi0, next0);
+
+	  /* next packet */
+	  n_rx_packets++;
+	}
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+    }
+
+  memif_refill_queue_zc (vm, mq, n_buffer_bytes);
+
+  vlib_increment_combined_counter (vnm->interface_main.combined_sw_if_counters
+				   + VNET_INTERFACE_COUNTER_RX, thread_index,
+				   mif->hw_if_index, n_rx_packets,
+				   n_rx_bytes);
+
+  return n_rx_packets;
+}
+
+/*
+ * Adaptive rx mode: a queue which brings in poll_threshold packets in a
+ * dispatch is polled, with the peer told not to send interrupts, until
+ * it brings in no more than interrupt_threshold packets for
+ * idle_dispatches dispatches in a row.
+ */
+static_always_inline void
+memif_adaptive_mode_update (vlib_main_t * vm, vlib_node_runtime_t * node,
+			    vnet_device_and_queue_t * dq, memif_queue_t * mq,
+			    u32 n_rx)
+{
+  memif_main_t *mm = &memif_main;
+
+  if (mq->adaptive_polling)
+    {
+      if (n_rx > mm->adaptive_interrupt_threshold)
+	{
+	  mq->adaptive_idle_dispatches = 0;
+	  return;
+	}
+      if (++mq->adaptive_idle_dispatches < mm->adaptive_idle_dispatches)
+	return;
+
+      mq->adaptive_polling = 0;
+      mq->adaptive_switch_count++;
+      mq->ring->flags &= ~MEMIF_RING_FLAG_MASK_INT;
+      CLIB_MEMORY_BARRIER ();
+
+      /* the peer may have missed the flag, look once more */
+      if (mq->ring->head != mq->last_head)
+	{
+	  dq->interrupt_pending = 1;
+	  vlib_node_set_interrupt_pending (vm, node->node_index);
+	}
+    }
+  else if (n_rx >= mm->adaptive_poll_threshold)
+    {
+      mq->adaptive_polling = 1;
+      mq->adaptive_idle_dispatches = 0;
+      mq->adaptive_switch_count++;
+      mq->ring->flags |= MEMIF_RING_FLAG_MASK_INT;
+    }
+}
+
 static uword
 memif_input_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
 		vlib_frame_t * frame)
 {
-  u32 n_rx = 0;
+  u32 n_rx = 0, n_adaptive_polling = 0;
   memif_main_t *nm = &memif_main;
   vnet_device_input_runtime_t *rt = (void *) node->runtime_data;
   vnet_device_and_queue_t *dq;
 
-  foreach_device_and_queue (dq, rt->devices_and_queues)
+  vec_foreach (dq, rt->devices_and_queues)
   {
     memif_if_t *mif;
+    memif_queue_t *mq;
+    u32 interrupt_pending, n = 0;
+
+    interrupt_pending = clib_smp_swap (&dq->interrupt_pending, 0);
     mif = vec_elt_at_index (nm->interfaces, dq->dev_instance);
-    if ((mif->flags & MEMIF_IF_FLAG_ADMIN_UP) &&
-	(mif->flags & MEMIF_IF_FLAG_CONNECTED))
+    if ((mif->flags & MEMIF_IF_FLAG_ADMIN_UP) == 0 ||
+	(mif->flags & MEMIF_IF_FLAG_CONNECTED) == 0)
+      continue;
+
+    mq = vec_elt_at_index (mif->rx_queues, dq->queue_id);
+    if (!interrupt_pending && dq->mode != VNET_HW_INTERFACE_RX_MODE_POLLING
+	&& !mq->adaptive_polling)
+      continue;
+
+    if (mif->flags & MEMIF_IF_FLAG_ZERO_COPY)
+      {
+	if (mif->mode == MEMIF_INTERFACE_MODE_IP)
+	  n = memif_device_input_zc_inline (vm, node, mif, dq->queue_id,
+					    MEMIF_INTERFACE_MODE_IP);
+	else
+	  n = memif_device_input_zc_inline (vm, node, mif, dq->queue_id,
+					    MEMIF_INTERFACE_MODE_ETHERNET);
+      }
+    else if (mif->flags & MEMIF_IF_FLAG_IS_SLAVE)
       {
-	if (mif->flags & MEMIF_IF_FLAG_IS_SLAVE)
-	  {
-	    if (mif->mode == MEMIF_INTERFACE_MODE_IP)
-	      n_rx += memif_device_input_inline (vm, node, frame, mif,
-						 MEMIF_RING_M2S, dq->queue_id,
-						 MEMIF_INTERFACE_MODE_IP);
-	    else
-	      n_rx += memif_device_input_inline (vm, node, frame, mif,
-						 MEMIF_RING_M2S, dq->queue_id,
-						 MEMIF_INTERFACE_MODE_ETHERNET);
-	  }
+	if (mif->mode == MEMIF_INTERFACE_MODE_IP)
+	  n = memif_device_input_inline (vm, node, frame, mif,
+					 MEMIF_RING_M2S, dq->queue_id,
+					 MEMIF_INTERFACE_MODE_IP);
 	else
-	  {
-	    if (mif->mode == MEMIF_INTERFACE_MODE_IP)
-	      n_rx += memif_device_input_inline (vm, node, frame, mif,
-						 MEMIF_RING_S2M, dq->queue_id,
-						 MEMIF_INTERFACE_MODE_IP);
-	    else
-	      n_rx += memif_device_input_inline (vm, node, frame, mif,
-						 MEMIF_RING_S2M, dq->queue_id,
-						 MEMIF_INTERFACE_MODE_ETHERNET);
-	  }
+	  n = memif_device_input_inline (vm, node, frame, mif,
+					 MEMIF_RING_M2S, dq->queue_id,
+					 MEMIF_INTERFACE_MODE_ETHERNET);
+      }
+    else
+      {
+	if (mif->mode == MEMIF_INTERFACE_MODE_IP)
+	  n = memif_device_input_inline (vm, node, frame, mif,
+					 MEMIF_RING_S2M, dq->queue_id,
+					 MEMIF_INTERFACE_MODE_IP);
+	else
+	  n = memif_device_input_inline (vm, node, frame, mif,
+					 MEMIF_RING_S2M, dq->queue_id,
+					 MEMIF_INTERFACE_MODE_ETHERNET);
+      }
+    n_rx += n;
+    dq->n_rx_vectors += n;
+
+    if (PREDICT_FALSE (dq->mode == VNET_HW_INTERFACE_RX_MODE_ADAPTIVE))
+      {
+	memif_adaptive_mode_update (vm, node, dq, mq, n);
+	n_adaptive_polling += mq->adaptive_polling;
       }
   }
 
+  /*
+   * No interrupt will come for the queues being polled, so keep the
+   * node scheduled if it runs in interrupt state.
+   */
+  if (n_adaptive_polling && node->state == VLIB_NODE_STATE_INTERRUPT)
+    vlib_node_set_interrupt_pending (vm, node->node_index);
+
   return n_rx;
 }
 
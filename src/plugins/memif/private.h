@@ -23,6 +23,12 @@
 #define MEMIF_DEFAULT_TX_QUEUES 1
 #define MEMIF_DEFAULT_BUFFER_SIZE 2048
 
+/* adaptive rx mode: packets per dispatch to start polling a queue, and
+   to go back to interrupts after that many dispatches in a row */
+#define MEMIF_DEFAULT_ADAPTIVE_POLL_THRESHOLD 32
+#define MEMIF_DEFAULT_ADAPTIVE_INTERRUPT_THRESHOLD 4
+#define MEMIF_DEFAULT_ADAPTIVE_IDLE_DISPATCHES 1024
+
 #define MEMIF_MAX_M2S_RING		(vec_len (vlib_mains) - 1)
 #define MEMIF_MAX_S2M_RING		(vec_len (vlib_mains) - 1)
 #define MEMIF_MAX_REGION		255
@@ -85,6 +91,7 @@ typedef struct
   void *shm;
   memif_region_size_t region_size;
   int fd;
+  u8 is_external;
 } memif_region_t;
 
 typedef struct
@@ -104,10 +111,18 @@ typedef struct
   u16 last_head;
   u16 last_tail;
 
+  /* zero-copy: vlib buffer behind each descriptor */
+  u32 *buffers;
+
   /* interrupts */
   int int_fd;
   uword int_clib_file_index;
   u64 int_count;
+
+  /* adaptive rx mode, polled with interrupts masked while busy */
+  u8 adaptive_polling;
+  u32 adaptive_idle_dispatches;
+  u64 adaptive_switch_count;
 } memif_queue_t;
 
 #define foreach_memif_if_flag \
@@ -115,7 +130,8 @@ typedef struct
   _(1, IS_SLAVE, "slave")		\
   _(2, CONNECTING, "connecting")	\
   _(3, CONNECTED, "connected")		\
-  _(4, DELETING, "deleting")
+  _(4, DELETING, "deleting")		\
+  _(5, ZERO_COPY, "zero-copy")
 
 typedef enum
 {
@@ -194,6 +210,11 @@ typedef struct
   /* rx buffer cache */
   u32 **rx_buffers;
 
+  /* adaptive rx mode hysteresis */
+  u32 adaptive_poll_threshold;
+  u32 adaptive_interrupt_threshold;
+  u32 adaptive_idle_dispatches;
+
 } memif_main_t;
 
 extern memif_main_t memif_main;
@@ -219,6 +240,7 @@ typedef struct
   u8 hw_addr[6];
   u8 rx_queues;
   u8 tx_queues;
+  u8 is_zero_copy;
 
   /* return */
   u32 sw_if_index;
@@ -235,6 +257,30 @@ memif_get_buffer (memif_if_t * mif, memif_ring_t * ring, u16 slot)
   return mif->regions[region].shm + ring->desc[slot].offset;
 }
 
+/*
+ * In zero-copy mode region 0 holds the rings only, and each vlib buffer
+ * pool is shared with the peer as region 1 + buffer_pool_index.
+ */
+static_always_inline int
+memif_buffer_is_shared (memif_if_t * mif, vlib_buffer_t * b)
+{
+  return (b->buffer_pool_index + 1 < vec_len (mif->regions));
+}
+
+/* point a descriptor at the current data of a vlib buffer */
+static_always_inline void
+memif_desc_set_buffer (vlib_main_t * vm, memif_desc_t * d,
+		       vlib_buffer_t * b, u32 buffer_length)
+{
+  vlib_buffer_pool_t *bp;
+
+  bp = vec_elt_at_index (vm->buffer_main->buffer_pools,
+			 b->buffer_pool_index);
+  d->region = 1 + b->buffer_pool_index;
+  d->offset = pointer_to_uword (vlib_buffer_get_current (b)) - bp->start;
+  d->buffer_length = buffer_length;
+}
+
 /* memif.c */
 clib_error_t *memif_init_regions_and_queues (memif_if_t * mif);
 clib_error_t *memif_connect (memif_if_t * mif);
@@ -109,7 +109,7 @@ memif_msg_enq_hello (int fd)
   memif_msg_hello_t *h = &msg.hello;
   msg.type = MEMIF_MSG_TYPE_HELLO;
   h->min_version = MEMIF_VERSION;
-  h->max_version = MEMIF_VERSION;
+  h->max_version = MEMIF_VERSION_ZERO_COPY;
   h->max_m2s_ring = MEMIF_MAX_M2S_RING;
   h->max_s2m_ring = MEMIF_MAX_M2S_RING;
   h->max_region = MEMIF_MAX_REGION;
@@ -130,7 +130,8 @@ memif_msg_enq_init (memif_if_t * mif)
 
   e->msg.type = MEMIF_MSG_TYPE_INIT;
   e->fd = -1;
-  i->version = MEMIF_VERSION;
+  i->version = (mif->flags & MEMIF_IF_FLAG_ZERO_COPY) ?
+    MEMIF_VERSION_ZERO_COPY : MEMIF_VERSION;
   i->id = mif->id;
   i->mode = mif->mode;
   s = format (0, "VPP %s%c", VPP_BUILD_VER, 0);
@@ -231,6 +232,17 @@ memif_msg_receive_hello (memif_if_t * mif, memif_msg_t * msg)
       msg->hello.max_version < MEMIF_VERSION)
     return clib_error_return (0, "incompatible protocol version");
 
+  /* an older master fills the whole ring, overwriting our buffers */
+  if (mif->flags & MEMIF_IF_FLAG_ZERO_COPY)
+    {
+      if (h->max_version < MEMIF_VERSION_ZERO_COPY)
+	return clib_error_return (0, "peer does not support zero-copy");
+      if (vec_len (vlib_get_main ()->buffer_main->buffer_pools) >
+	  h->max_region)
+	return clib_error_return (0, "peer accepts too few regions for "
+				  "zero-copy");
+    }
+
   mif->run.num_s2m_rings = clib_min (h->max_s2m_ring + 1,
 				     mif->cfg.num_s2m_rings);
   mif->run.num_m2s_rings = clib_min (h->max_m2s_ring + 1,
@@ -256,7 +268,7 @@ memif_msg_receive_init (memif_if_t ** mifp, memif_msg_t * msg,
   clib_error_t *err;
   uword *p;
 
-  if (i->version != MEMIF_VERSION)
+  if (i->version < MEMIF_VERSION || i->version > MEMIF_VERSION_ZERO_COPY)
     {
       memif_file_del_by_index (uf - file_main.file_pool);
       return clib_error_return (0, "unsupported version");
@@ -493,7 +505,8 @@ memif_msg_receive (memif_if_t ** mifp, clib_file_t * uf)
       if ((err = memif_init_regions_and_queues (mif)))
 	return err;
       memif_msg_enq_init (mif);
-      memif_msg_enq_add_region (mif, 0);
+      vec_foreach_index (i, mif->regions)
+	memif_msg_enq_add_region (mif, i);
       vec_foreach_index (i, mif->tx_queues)
 	memif_msg_enq_add_ring (mif, i, MEMIF_RING_S2M);
       vec_foreach_index (i, mif->rx_queues)
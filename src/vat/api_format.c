@@ -12948,6 +12948,7 @@ api_create_vhost_user_if (vat_main_t * vam)
   u32 custom_dev_instance = ~0;
   u8 hwaddr[6];
   u8 use_custom_mac = 0;
+  u8 enable_packed = 0;
   u8 *tag = 0;
   int ret;
 
@@ -12966,6 +12967,8 @@ api_create_vhost_user_if (vat_main_t * vam)
 	use_custom_mac = 1;
       else if (unformat (i, "server"))
 	is_server = 1;
+      else if (unformat (i, "packed"))
+	enable_packed = 1;
       else if (unformat (i, "tag %s", &tag))
 	;
       else
@@ -12988,6 +12991,7 @@ api_create_vhost_user_if (vat_main_t * vam)
   M (CREATE_VHOST_USER_IF, mp);
 
   mp->is_server = is_server;
+  mp->enable_packed = enable_packed;
   clib_memcpy (mp->sock_filename, file_name, vec_len (file_name));
   vec_free (file_name);
   if (custom_dev_instance != ~0)
@@ -13017,6 +13021,7 @@ api_modify_vhost_user_if (vat_main_t * vam)
   u32 custom_dev_instance = ~0;
   u8 sw_if_index_set = 0;
   u32 sw_if_index = (u32) ~ 0;
+  u8 enable_packed = 0;
   int ret;
 
   while (unformat_check_input (i) != UNFORMAT_END_OF_INPUT)
@@ -13033,6 +13038,8 @@ api_modify_vhost_user_if (vat_main_t * vam)
 	;
       else if (unformat (i, "server"))
 	is_server = 1;
+      else if (unformat (i, "packed"))
+	enable_packed = 1;
       else
 	break;
     }
@@ -13060,6 +13067,7 @@ api_modify_vhost_user_if (vat_main_t * vam)
 
   mp->sw_if_index = ntohl (sw_if_index);
   mp->is_server = is_server;
+  mp->enable_packed = enable_packed;
   clib_memcpy (mp->sock_filename, file_name, vec_len (file_name));
   vec_free (file_name);
   if (custom_dev_instance != ~0)
@@ -14405,7 +14413,8 @@ vl_api_ipsec_sa_details_t_handler (vl_api_ipsec_sa_details_t * mp)
 	 "use_anti_replay %u is_tunnel %u is_tunnel_ip6 %u "
 	 "tunnel_src_addr %U tunnel_dst_addr %U "
 	 "salt %u seq_outbound %lu last_seq_inbound %lu "
-	 "replay_window %lu total_data_size %lu\n",
+	 "replay_window %lu replay_window_size %u replay_dups %lu "
+	 "replay_too_old %lu total_data_size %lu\n",
 	 ntohl (mp->sa_id), ntohl (mp->sw_if_index), ntohl (mp->spi),
 	 mp->protocol,
 	 mp->crypto_alg, format_hex_bytes, mp->crypto_key, mp->crypto_key_len,
@@ -14419,6 +14428,9 @@ vl_api_ipsec_sa_details_t_handler (vl_api_ipsec_sa_details_t * mp)
 	 clib_net_to_host_u64 (mp->seq_outbound),
 	 clib_net_to_host_u64 (mp->last_seq_inbound),
 	 clib_net_to_host_u64 (mp->replay_window),
+	 ntohl (mp->replay_window_size),
+	 clib_net_to_host_u64 (mp->replay_dups),
+	 clib_net_to_host_u64 (mp->replay_too_old),
 	 clib_net_to_host_u64 (mp->total_data_size));
 }
 
@@ -14471,6 +14483,12 @@ static void vl_api_ipsec_sa_details_t_handler_json
     }
   vat_json_object_add_uint (node, "replay_window",
 			    clib_net_to_host_u64 (mp->replay_window));
+  vat_json_object_add_uint (node, "replay_window_size",
+			    ntohl (mp->replay_window_size));
+  vat_json_object_add_uint (node, "replay_dups",
+			    clib_net_to_host_u64 (mp->replay_dups));
+  vat_json_object_add_uint (node, "replay_too_old",
+			    clib_net_to_host_u64 (mp->replay_too_old));
   vat_json_object_add_uint (node, "total_data_size",
 			    clib_net_to_host_u64 (mp->total_data_size));
 
@@ -22171,10 +22189,10 @@ _(l2_interface_vlan_tag_rewrite,                                        \
   "[translate-2-[1|2]] [push_dot1q 0] tag1 <nn> tag2 <nn>")             \
 _(create_vhost_user_if,                                                 \
         "socket <filename> [server] [renumber <dev_instance>] "         \
-        "[mac <mac_address>]")                                          \
+        "[mac <mac_address>] [packed]")                                 \
 _(modify_vhost_user_if,                                                 \
         "<intfc> | sw_if_index <nn> socket <filename>\n"                \
-        "[server] [renumber <dev_instance>]")                           \
+        "[server] [renumber <dev_instance>] [packed]")                  \
 _(delete_vhost_user_if, "<intfc> | sw_if_index <nn>")                   \
 _(sw_interface_vhost_user_dump, "")                                     \
 _(show_version, "")                                                     \
@@ -74,26 +74,86 @@ vlib_clear_combined_counters (vlib_combined_counter_main_t * cm)
     }
 }
 
+void *vlib_stats_push_heap (uword) __attribute__ ((weak));
+void *
+vlib_stats_push_heap (uword n_bytes)
+{
+  return 0;
+}
+
+void vlib_stats_pop_heap (void *, void *, vlib_stats_counter_type_t)
+  __attribute__ ((weak));
+void
+vlib_stats_pop_heap (void *cm, void *oldheap, vlib_stats_counter_type_t type)
+{
+}
+
+void vlib_stats_pop_heap_error (u64 *, u32, void *) __attribute__ ((weak));
+void
+vlib_stats_pop_heap_error (u64 * counters, u32 thread_index, void *oldheap)
+{
+}
+
+void vlib_stats_unpublish (void *, vlib_stats_counter_type_t)
+  __attribute__ ((weak));
+void
+vlib_stats_unpublish (void *cm, vlib_stats_counter_type_t type)
+{
+}
+
+u64 *vlib_stats_unpublish_error (u64 *, u32) __attribute__ ((weak));
+u64 *
+vlib_stats_unpublish_error (u64 * counters, u32 thread_index)
+{
+  return counters;
+}
+
+void vlib_stats_register_error_index (u8 *, u32) __attribute__ ((weak));
+void
+vlib_stats_register_error_index (u8 * name, u32 index)
+{
+}
+
 void
 vlib_validate_simple_counter (vlib_simple_counter_main_t * cm, u32 index)
 {
   vlib_thread_main_t *tm = vlib_get_thread_main ();
+  void *oldheap = 0;
   int i;
 
+  /* published counters live on the stats segment heap, twice the size
+     of the counters is enough for them to grow there */
+  if (cm->stat_segment_name &&
+      !(oldheap = vlib_stats_push_heap (2 * sizeof (counter_t) *
+					tm->n_vlib_mains * (index + 1))))
+    vlib_stats_unpublish (cm, VLIB_STATS_SIMPLE_COUNTER);
+
   vec_validate (cm->counters, tm->n_vlib_mains - 1);
   for (i = 0; i < tm->n_vlib_mains; i++)
     vec_validate_aligned (cm->counters[i], index, CLIB_CACHE_LINE_BYTES);
+
+  if (oldheap)
+    vlib_stats_pop_heap (cm, oldheap, VLIB_STATS_SIMPLE_COUNTER);
 }
 
 void
 vlib_validate_combined_counter (vlib_combined_counter_main_t * cm, u32 index)
 {
   vlib_thread_main_t *tm = vlib_get_thread_main ();
+  void *oldheap = 0;
   int i;
 
+  if (cm->stat_segment_name &&
+      !(oldheap = vlib_stats_push_heap (2 * sizeof (vlib_counter_t) *
+					tm->n_vlib_mains * (index + 1))))
+    vlib_stats_unpublish (cm, VLIB_STATS_COMBINED_COUNTER);
+
   vec_validate (cm->counters, tm->n_vlib_mains - 1);
   for (i = 0; i < tm->n_vlib_mains; i++)
     vec_validate_aligned (cm->counters[i], index, CLIB_CACHE_LINE_BYTES);
+
+  if (oldheap)
+    vlib_stats_pop_heap (cm, oldheap, VLIB_STATS_COMBINED_COUNTER);
 }
 
 u32
@@ -63,6 +63,7 @@ typedef struct
                                            serialized incrementally. */
 
   char *name;			/**< The counter collection's name. */
+  char *stat_segment_name;	/**< Name in the stats segment, if published */
 } vlib_simple_counter_main_t;
 
 /** The number of counters (not the number of per-thread counters) */
@@ -183,6 +184,7 @@ typedef struct
   vlib_counter_t *value_at_last_serialize; /**< Counter values as of last serialize. */
   u32 last_incremental_serialize_index;	/**< Last counter index serialized incrementally. */
   char *name; /**< The counter collection's name. */
+  char *stat_segment_name; /**< Name in the stats segment, if published */
 } vlib_combined_counter_main_t;
 
 /** The number of counters (not the number of per-thread counters) */
@@ -319,6 +321,34 @@ serialize_function_t serialize_vlib_simple_counter_main,
 serialize_function_t serialize_vlib_combined_counter_main,
   unserialize_vlib_combined_counter_main;
 
+/** Stats segment hooks, provided by the application if it publishes
+    counters in a shared memory segment (see vpp/stats/stat_segment.c).
+
+    vlib_stats_push_heap() switches to the heap of the segment and returns
+    the previous heap, or 0 if there is no segment or it can't take the
+    given number of bytes more. The counters are (re)allocated on that
+    heap, then the vlib_stats_pop_heap functions switch back to the
+    previous heap and (re)publish the counters.
+
+    Once the segment is full, counters are no longer published: the
+    vlib_stats_unpublish functions move them from the segment to the
+    current heap before they grow there.
+*/
+typedef enum
+{
+  VLIB_STATS_SIMPLE_COUNTER,
+  VLIB_STATS_COMBINED_COUNTER,
+} vlib_stats_counter_type_t;
+
+void *vlib_stats_push_heap (uword n_bytes);
+void vlib_stats_pop_heap (void *cm, void *oldheap,
+			  vlib_stats_counter_type_t type);
+void vlib_stats_pop_heap_error (u64 * counters, u32 thread_index,
+				void *oldheap);
+void vlib_stats_unpublish (void *cm, vlib_stats_counter_type_t type);
+u64 *vlib_stats_unpublish_error (u64 * counters, u32 thread_index);
+void vlib_stats_register_error_index (u8 * name, u32 index);
+
 #endif /* included_vlib_counter_h */
 
 /*
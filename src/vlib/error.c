@@ -148,6 +148,7 @@ vlib_register_errors (vlib_main_t * vm,
   vlib_error_main_t *em = &vm->error_main;
   vlib_node_t *n = vlib_get_node (vm, node_index);
   uword l;
+  void *oldheap;
 
   ASSERT (vlib_get_thread_index () == 0);
 
@@ -170,7 +171,21 @@ vlib_register_errors (vlib_main_t * vm,
 	       error_strings, n_errors * sizeof (error_strings[0]));
 
   /* Allocate a counter/elog type for each error. */
+  if (!(oldheap = vlib_stats_push_heap (2 * l * sizeof (em->counters[0]))))
+    em->counters = vlib_stats_unpublish_error (em->counters, vm->thread_index);
   vec_validate (em->counters, l - 1);
+  if (oldheap)
+    {
+      uword i;
+
+      vlib_stats_pop_heap_error (em->counters, vm->thread_index, oldheap);
+      for (i = 0; i < n_errors; i++)
+	{
+	  u8 *name = format (0, "/err/%v/%s%c", n->name, error_strings[i], 0);
+	  vlib_stats_register_error_index (name, n->error_heap_index + i);
+	  vec_free (name);
+	}
+    }
   vec_validate (vm->error_elog_event_types, l - 1);
 
   /* Zero counters for re-registrations of errors. */
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <vlib/vlib.h>
+#include <vlib/threads.h>
+#include <vlib/linux/pmc.h>
+
+static void
+vlib_pmc_close (vlib_node_main_t * nm)
+{
+  int i;
+
+  for (i = 0; i < VLIB_NODE_N_PMC; i++)
+    {
+      if (nm->pmc_pages[i])
+	munmap (nm->pmc_pages[i], clib_mem_get_page_size ());
+      if (nm->pmc_fds[i] > 0)
+	close (nm->pmc_fds[i]);
+      nm->pmc_pages[i] = 0;
+      nm->pmc_fds[i] = -1;
+    }
+}
+
+/* open the counters of a thread, as one group scheduled together */
+static clib_error_t *
+vlib_pmc_open (vlib_node_main_t * nm, pid_t pid)
+{
+  static const u64 configs[] = {
+#define _(e,s) PERF_COUNT_HW_##e,
+    foreach_vlib_node_pmc_event
+#undef _
+  };
+  struct perf_event_attr attr;
+  int i, fd;
+  void *p;
+
+  for (i = 0; i < VLIB_NODE_N_PMC; i++)
+    {
+      memset (&attr, 0, sizeof (attr));
+      attr.size = sizeof (attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[i];
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.pinned = i == 0;
+
+      fd = syscall (__NR_perf_event_open, &attr, pid, -1,
+		    i ? nm->pmc_fds[0] : -1, 0);
+      if (fd < 0)
+	{
+	  vlib_pmc_close (nm);
+	  return clib_error_return_unix (0, "perf_event_open");
+	}
+      nm->pmc_fds[i] = fd;
+
+      /* the first page tells whether rdpmc may be used */
+      p = mmap (0, clib_mem_get_page_size (), PROT_READ, MAP_SHARED, fd, 0);
+      nm->pmc_pages[i] = p == MAP_FAILED ? 0 : p;
+    }
+
+  return 0;
+}
+
+clib_error_t *
+vlib_node_pmc_enable_disable (vlib_main_t * vm, int enable)
+{
+  clib_error_t *error = 0;
+  vlib_main_t *this_vm;
+  vlib_node_main_t *nm;
+  int i, j;
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    {
+      this_vm = vlib_mains[i];
+      if (!this_vm)
+	continue;
+      nm = &this_vm->node_main;
+
+      if (!enable)
+	{
+	  nm->pmc_enabled = 0;
+	  vlib_pmc_close (nm);
+	  continue;
+	}
+      if (nm->pmc_enabled)
+	continue;
+
+      for (j = 0; j < VLIB_NODE_N_PMC; j++)
+	nm->pmc_fds[j] = -1;
+
+      /* the counters follow the thread, whatever cpu it runs on */
+      error = vlib_pmc_open (nm, i == 0 ? 0 : vlib_worker_threads[i].lwp);
+      if (error)
+	break;
+
+      /* all allocations from the main thread, workers only count */
+      if (vec_len (nm->nodes))
+	vec_validate (nm->node_pmcs, vec_len (nm->nodes) - 1);
+      nm->pmc_enabled = 1;
+    }
+
+  /* all threads or none */
+  if (error)
+    for (i = 0; i < vec_len (vlib_mains); i++)
+      if (vlib_mains[i] && vlib_mains[i]->node_main.pmc_enabled)
+	{
+	  vlib_mains[i]->node_main.pmc_enabled = 0;
+	  vlib_pmc_close (&vlib_mains[i]->node_main);
+	}
+
+  vlib_worker_thread_barrier_release (vm);
+
+  return error;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef included_vlib_linux_pmc_h
+#define included_vlib_linux_pmc_h
+
+#include <unistd.h>
+#include <linux/perf_event.h>
+
+/*
+ * Hardware counters of a thread, opened with perf_event_open and read
+ * around each node call by dispatch_node.  The counters are read from
+ * user space with rdpmc when the kernel allows it, with a read() of the
+ * counter fd otherwise.
+ */
+
+always_inline u64
+vlib_pmc_read (vlib_node_main_t * nm, int i)
+{
+  u64 count = 0;
+
+#if defined(__x86_64__)
+  struct perf_event_mmap_page *p = nm->pmc_pages[i];
+
+  if (PREDICT_TRUE (p && p->cap_user_rdpmc))
+    {
+      u32 seq, idx, lo, hi;
+      i64 pmc;
+
+      do
+	{
+	  seq = p->lock;
+	  asm volatile ("":::"memory");
+	  idx = p->index;
+	  count = p->offset;
+	  if (idx)
+	    {
+	      asm volatile ("rdpmc":"=a" (lo), "=d" (hi):"c" (idx - 1));
+	      pmc = ((u64) hi << 32) | lo;
+	      pmc <<= 64 - p->pmc_width;
+	      pmc >>= 64 - p->pmc_width;
+	      count += pmc;
+	    }
+	  asm volatile ("":::"memory");
+	}
+      while (p->lock != seq);
+      return count;
+    }
+#endif
+
+  if (read (nm->pmc_fds[i], &count, sizeof (count)) != sizeof (count))
+    count = 0;
+  return count;
+}
+
+#endif /* included_vlib_linux_pmc_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
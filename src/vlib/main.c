@@ -37,7 +37,11 @@
  *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#define _GNU_SOURCE
+
 #include <math.h>
+#include <poll.h>
+#include <sys/eventfd.h>
 #include <vppinfra/format.h>
 #include <vlib/vlib.h>
 #include <vlib/threads.h>
@@ -45,6 +49,7 @@
 
 #include <vlib/unix/unix.h>
 #include <vlib/unix/cj.h>
+#include <vlib/linux/pmc.h>
 
 CJ_GLOBAL_LOG_PROTOTYPE;
 
@@ -204,6 +209,7 @@ vlib_put_frame_to_node (vlib_main_t * vm, u32 to_node_index, vlib_frame_t * f)
   p->frame_index = vlib_frame_index (vm, f);
   p->node_runtime_index = to_node->runtime_index;
   p->next_frame_index = VLIB_PENDING_FRAME_NO_NEXT_FRAME;
+  p->cpu_time_pending = vm->cpu_time_last_node_dispatch;
 }
 
 /* Free given frame. */
@@ -503,6 +509,7 @@ vlib_put_next_frame (vlib_main_t * vm,
 	  p->frame_index = nf->frame_index;
 	  p->node_runtime_index = nf->node_runtime_index;
 	  p->next_frame_index = nf - nm->next_frames;
+	  p->cpu_time_pending = vm->cpu_time_last_node_dispatch;
 	  nf->flags |= VLIB_FRAME_PENDING;
 	  f->flags |= VLIB_FRAME_PENDING;
 
@@ -910,6 +917,59 @@ add_trajectory_trace (vlib_buffer_t * b, u32 node_index)
 #endif
 }
 
+/* Kept out of line, the dispatch path only tests histograms_enabled. */
+static never_inline void
+vlib_node_histogram_update (vlib_node_main_t * nm, u32 node_index,
+			    uword n_vectors, u64 n_clocks)
+{
+  vlib_node_histogram_t *h;
+
+  /* allocated by the main thread, nodes added since are skipped */
+  if (node_index >= vec_len (nm->node_histograms))
+    return;
+
+  h = vec_elt_at_index (nm->node_histograms, node_index);
+  h->clocks_per_call[vlib_node_histogram_bucket (n_clocks)]++;
+  h->vectors_per_call[vlib_node_histogram_bucket (n_vectors)]++;
+}
+
+static never_inline void
+vlib_node_histogram_add_residency (vlib_node_main_t * nm, u32 node_index,
+				   u32 n_clocks)
+{
+  vlib_node_histogram_t *h;
+
+  if (node_index >= vec_len (nm->node_histograms))
+    return;
+
+  h = vec_elt_at_index (nm->node_histograms, node_index);
+  h->frame_residency[vlib_node_histogram_bucket (n_clocks)]++;
+}
+
+static never_inline void
+vlib_node_pmc_start (vlib_node_main_t * nm)
+{
+  int i;
+
+  for (i = 0; i < VLIB_NODE_N_PMC; i++)
+    nm->pmc_start[i] = vlib_pmc_read (nm, i);
+}
+
+static never_inline void
+vlib_node_pmc_end (vlib_node_main_t * nm, u32 node_index)
+{
+  vlib_node_pmc_t *np;
+  int i;
+
+  if (node_index >= vec_len (nm->node_pmcs))
+    return;
+
+  np = vec_elt_at_index (nm->node_pmcs, node_index);
+  np->calls++;
+  for (i = 0; i < VLIB_NODE_N_PMC; i++)
+    np->counts[i] += vlib_pmc_read (nm, i) - nm->pmc_start[i];
+}
+
 static_always_inline u64
 dispatch_node (vlib_main_t * vm,
 	       vlib_node_runtime_t * node,
@@ -967,6 +1027,9 @@ dispatch_node (vlib_main_t * vm,
 				 frame ? frame->n_vectors : 0,
 				 /* is_after */ 0);
 
+      if (PREDICT_FALSE (nm->pmc_enabled))
+	vlib_node_pmc_start (nm);
+
       /*
        * Turn this on if you run into
        * "bad monkey" contexts, and you want to know exactly
@@ -989,6 +1052,9 @@ dispatch_node (vlib_main_t * vm,
 
       t = clib_cpu_time_now ();
 
+      if (PREDICT_FALSE (nm->pmc_enabled))
+	vlib_node_pmc_end (nm, node->node_index);
+
       vlib_elog_main_loop_event (vm, node->node_index, t, n,	/* is_after */
 				 1);
 
@@ -1000,6 +1066,10 @@ dispatch_node (vlib_main_t * vm,
 					  /* n_vectors */ n,
 					  /* n_clocks */ t - last_time_stamp);
 
+      if (PREDICT_FALSE (nm->histograms_enabled))
+	vlib_node_histogram_update (nm, node->node_index, n,
+				    t - last_time_stamp);
+
       /* When in interrupt mode and vector rate crosses threshold switch to
          polling mode. */
       if ((dispatch_state == VLIB_NODE_STATE_INTERRUPT)
@@ -1083,6 +1153,176 @@ dispatch_node (vlib_main_t * vm,
   return t;
 }
 
+/*
+ * Move into frame f the vectors of the frames pending later in this
+ * main loop to the same node, until f holds the node's preferred batch
+ * size.  Merging stops at the first of those frames that does not fit,
+ * so the vectors stay in the order they were made pending.  The frames
+ * emptied are released without a dispatch.
+ */
+static never_inline void
+vlib_coalesce_pending_frames (vlib_main_t * vm, vlib_node_runtime_t * n,
+			      vlib_frame_t * f, uword pending_frame_index)
+{
+  vlib_node_main_t *nm = &vm->node_main;
+  vlib_node_t *node = vlib_get_node (vm, n->node_index);
+  u32 runtime_index = n - nm->nodes_by_type[VLIB_NODE_TYPE_INTERNAL];
+  u32 batch_size = node->preferred_batch_size;
+  vlib_pending_frame_t *p;
+  vlib_next_frame_t *nf;
+  vlib_frame_t *g;
+  uword i;
+
+  /* scalar arguments are per frame */
+  if (f->scalar_size)
+    return;
+  if (batch_size == 0 || batch_size > VLIB_FRAME_SIZE)
+    batch_size = VLIB_FRAME_SIZE;
+
+  for (i = pending_frame_index + 1;
+       i < vec_len (nm->pending_frames) && f->n_vectors < batch_size; i++)
+    {
+      p = nm->pending_frames + i;
+      if (p->node_runtime_index != runtime_index)
+	continue;
+
+      g = vlib_get_frame (vm, p->frame_index);
+      if (g->n_vectors == 0)
+	continue;
+      /* merging a later frame ahead of this one would reorder flows */
+      if (f->n_vectors + g->n_vectors > VLIB_FRAME_SIZE)
+	break;
+
+      /* the frame traced, if one was */
+      if (p->next_frame_index == VLIB_PENDING_FRAME_NO_NEXT_FRAME)
+	n->flags |= g->flags & VLIB_NODE_FLAG_TRACE;
+      else
+	{
+	  nf = vec_elt_at_index (nm->next_frames, p->next_frame_index);
+	  if (nf->flags & VLIB_FRAME_TRACE)
+	    n->flags |= VLIB_NODE_FLAG_TRACE;
+	  nf->flags &= ~VLIB_FRAME_TRACE;
+	}
+
+      clib_memcpy ((u8 *) vlib_frame_vector_args (f) +
+		   f->n_vectors * f->vector_size,
+		   vlib_frame_vector_args (g), g->n_vectors * g->vector_size);
+      f->n_vectors += g->n_vectors;
+      nm->frames_coalesced++;
+      nm->vectors_coalesced += g->n_vectors;
+      g->n_vectors = 0;
+    }
+}
+
+/* least loaded worker below the idle threshold, ~0 if none */
+static u32
+vlib_steal_pick_thread (vlib_main_t * vm)
+{
+  vlib_node_main_t *nm = &vm->node_main;
+  u32 i, thread_index = ~0;
+  f64 load, min_load = nm->steal_idle_vectors;
+
+  /* workers only, the main thread has the control plane to run */
+  for (i = 1; i < vec_len (vlib_mains); i++)
+    {
+      if (i == vm->thread_index || !vlib_mains[i])
+	continue;
+      load = vlib_last_vector_length_per_node (vlib_mains[i]);
+      if (load < min_load)
+	{
+	  min_load = load;
+	  thread_index = i;
+	}
+    }
+  return thread_index;
+}
+
+/*
+ * Hand frame f of a stealable node to an idle worker when this one is
+ * busy.  All the frames of the node made pending here go to the same
+ * thread, and that thread only changes once it has dispatched every
+ * frame given to it, so that packets of a flow stay in order.
+ */
+static never_inline void
+vlib_steal_pending_frame (vlib_main_t * vm, vlib_node_runtime_t * n,
+			  vlib_frame_t * f)
+{
+  vlib_node_main_t *nm = &vm->node_main;
+  vlib_frame_queue_elt_t *hf;
+  vlib_node_steal_t *s;
+  vlib_main_t *thread_vm;
+  f64 load;
+
+  /* allocated by the enable function */
+  if (n->node_index >= vec_len (nm->node_steals))
+    return;
+  s = nm->node_steals + n->node_index;
+  if (s->frame_queue_index == ~0 || f->scalar_size)
+    return;
+  /* traces are per thread, a traced frame is dispatched here */
+  if (n->flags & VLIB_NODE_FLAG_TRACE)
+    return;
+  /* a thread running stolen frames keeps its own, so a frame moves once */
+  if (vec_len (nm->steals_received))
+    return;
+
+  load = vlib_last_vector_length_per_node (vm);
+
+  if (s->thread_index != ~0)
+    {
+      thread_vm = vlib_mains[s->thread_index];
+      if (s->n_in_flight == 0
+	  && (load < nm->steal_idle_vectors
+	      || vlib_last_vector_length_per_node (thread_vm) >=
+	      nm->steal_busy_vectors))
+	s->thread_index = ~0;
+    }
+
+  if (s->thread_index == ~0)
+    {
+      if (load < nm->steal_busy_vectors)
+	return;
+      s->thread_index = vlib_steal_pick_thread (vm);
+      if (s->thread_index == ~0)
+	return;
+      s->n_thread_changes++;
+    }
+
+  hf = vlib_get_frame_queue_elt (s->frame_queue_index, s->thread_index);
+  clib_memcpy (hf->buffer_index, vlib_frame_vector_args (f),
+	       f->n_vectors * sizeof (u32));
+  hf->n_vectors = f->n_vectors;
+  hf->from_thread_index = vm->thread_index;
+  __sync_fetch_and_add (&s->n_in_flight, 1);
+  vlib_put_frame_queue_elt (hf);
+
+  thread_vm = vlib_mains[s->thread_index];
+  if (thread_vm->sleeping)
+    vlib_main_loop_wakeup (thread_vm);
+
+  s->frames_stolen++;
+  s->vectors_stolen += f->n_vectors;
+  f->n_vectors = 0;
+}
+
+/* The frames taken from other threads have now run through the graph
+   here: their threads may dispatch the nodes themselves again. */
+static never_inline void
+vlib_steal_ack_received (vlib_main_t * vm)
+{
+  vlib_node_main_t *nm = &vm->node_main;
+  vlib_node_steal_received_t *r;
+  vlib_node_steal_t *s;
+
+  vec_foreach (r, nm->steals_received)
+  {
+    s = vec_elt_at_index (vlib_mains[r->thread_index]->node_main.node_steals,
+			  r->node_index);
+    __sync_fetch_and_sub (&s->n_in_flight, 1);
+  }
+  _vec_len (nm->steals_received) = 0;
+}
+
 static u64
 dispatch_pending_node (vlib_main_t * vm, uword pending_frame_index,
 		       u64 last_time_stamp)
@@ -1126,7 +1366,7 @@ dispatch_pending_node (vlib_main_t * vm, uword pending_frame_index,
 
   /* Frame must be pending. */
   ASSERT (f->flags & VLIB_FRAME_PENDING);
-  ASSERT (f->n_vectors > 0);
+  ASSERT (f->n_vectors > 0 || nm->frame_coalescing);
 
   /* Copy trace flag from next frame to node.
      Trace flag indicates that at least one vector in the dispatched
@@ -1135,10 +1375,28 @@ dispatch_pending_node (vlib_main_t * vm, uword pending_frame_index,
   n->flags |= (nf->flags & VLIB_FRAME_TRACE) ? VLIB_NODE_FLAG_TRACE : 0;
   nf->flags &= ~VLIB_FRAME_TRACE;
 
-  last_time_stamp = dispatch_node (vm, n,
-				   VLIB_NODE_TYPE_INTERNAL,
-				   VLIB_NODE_STATE_POLLING,
-				   f, last_time_stamp);
+  if (PREDICT_FALSE (nm->frame_coalescing) && f->n_vectors > 0
+      && f->n_vectors < VLIB_FRAME_SIZE)
+    vlib_coalesce_pending_frames (vm, n, f, pending_frame_index);
+
+  if (PREDICT_FALSE (nm->work_stealing) && f->n_vectors > 0
+      && (n->flags & VLIB_NODE_FLAG_STEALABLE))
+    vlib_steal_pending_frame (vm, n, f);
+
+  /* Vectors of a frame coalesced into an earlier one, or taken by
+     another thread, are gone. */
+  if (PREDICT_TRUE (f->n_vectors > 0))
+    {
+      if (PREDICT_FALSE (nm->histograms_enabled))
+	vlib_node_histogram_add_residency (nm, n->node_index,
+					   (u32) last_time_stamp -
+					   p->cpu_time_pending);
+
+      last_time_stamp = dispatch_node (vm, n,
+				       VLIB_NODE_TYPE_INTERNAL,
+				       VLIB_NODE_STATE_POLLING,
+				       f, last_time_stamp);
+    }
 
   f->flags &= ~VLIB_FRAME_PENDING;
 
@@ -1423,6 +1681,94 @@ dispatch_suspended_process (vlib_main_t * vm,
   return t;
 }
 
+void
+vlib_main_loop_wakeup (vlib_main_t * vm)
+{
+  u64 one = 1;
+
+  if (write (vm->wakeup_fd, &one, sizeof (one)) < 0 && errno != EAGAIN)
+    clib_unix_warning ("write");
+}
+
+static void
+vlib_main_loop_sleep (vlib_main_t * vm, int is_main)
+{
+  vlib_node_main_t *nm = &vm->node_main;
+  struct pollfd pfd = {.fd = vm->wakeup_fd,.events = POLLIN };
+  struct timespec ts;
+  f64 t;
+  u64 n;
+
+  /* back off exponentially, up to the latency budget */
+  if (vm->idle_sleep_usec == 0)
+    vm->idle_sleep_usec = clib_min (vm->idle_sleep_min_usec,
+				    vm->idle_sleep_max_usec);
+  else
+    vm->idle_sleep_usec = clib_min (2 * vm->idle_sleep_usec,
+				    vm->idle_sleep_max_usec);
+
+  vm->sleeping = 1;
+  CLIB_MEMORY_BARRIER ();
+
+  /* an interrupt or a barrier may have come in meanwhile */
+  if (_vec_len (nm->pending_interrupt_node_runtime_indices) ||
+      (!is_main && *vlib_worker_threads->wait_at_barrier))
+    {
+      vm->sleeping = 0;
+      return;
+    }
+
+  ts.tv_sec = vm->idle_sleep_usec / 1000000;
+  ts.tv_nsec = (vm->idle_sleep_usec % 1000000) * 1000;
+
+  t = vlib_time_now (vm);
+  if (ppoll (&pfd, 1, &ts, 0) > 0)
+    {
+      if (read (vm->wakeup_fd, &n, sizeof (n)) > 0)
+	vm->n_sleep_wakeups++;
+      vm->idle_sleep_usec = 0;
+    }
+  vm->sleeping = 0;
+
+  vm->time_sleeping += vlib_time_now (vm) - t;
+  vm->n_sleeps++;
+}
+
+/*
+ * Sleep when the loop has found nothing to do for idle_sleep_after_loops
+ * iterations in a row, instead of spinning on idle input nodes.  The
+ * sleep starts at idle_sleep_min_usec and doubles on each idle iteration
+ * up to idle_sleep_max_usec, the latency budget: a packet arriving on a
+ * polled queue waits at most that long.  Interrupts and barrier syncs
+ * wake the thread up early.
+ */
+static_always_inline void
+vlib_main_loop_idle (vlib_main_t * vm, int is_main)
+{
+  vlib_node_main_t *nm = &vm->node_main;
+
+  if (PREDICT_TRUE (vm->idle_sleep_max_usec == 0))
+    return;
+
+  if (vm->main_loop_vectors_processed)
+    {
+      vm->n_idle_loops = 0;
+      vm->idle_sleep_usec = 0;
+      return;
+    }
+
+  if (++vm->n_idle_loops < vm->idle_sleep_after_loops)
+    return;
+
+  /* the main thread waits in epoll already when nothing is polled */
+  if (is_main && (vm->api_queue_nonempty ||
+		  nm->input_node_counts_by_state[VLIB_NODE_STATE_POLLING] ==
+		  0))
+    return;
+
+  vlib_main_loop_sleep (vm, is_main);
+}
+
 static_always_inline void
 vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
 {
@@ -1461,6 +1807,17 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
   if (!nm->interrupt_threshold_vector_length)
     nm->interrupt_threshold_vector_length = 5;
 
+  if (!vm->idle_sleep_min_usec)
+    vm->idle_sleep_min_usec = 10;
+  if (!vm->idle_sleep_after_loops)
+    vm->idle_sleep_after_loops = 1024;
+  vm->wakeup_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (vm->wakeup_fd < 0)
+    {
+      clib_unix_warning ("eventfd");
+      vm->idle_sleep_max_usec = 0;
+    }
+
   /* Start all processes. */
   if (is_main)
     {
@@ -1600,10 +1957,15 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
       /* Reset pending vector for next iteration. */
       _vec_len (nm->pending_frames) = 0;
 
+      if (PREDICT_FALSE (vec_len (nm->steals_received) > 0))
+	vlib_steal_ack_received (vm);
+
       /* Pending internal nodes may resume processes. */
       if (is_main && _vec_len (nm->data_from_advancing_timing_wheel) > 0)
 	goto processes_timing_wheel_data;
 
+      vlib_main_loop_idle (vm, is_main);
+
       vlib_increment_main_loop_counter (vm);
 
       /* Record time stamp in case there are no enabled nodes and above
@@ -1641,10 +2003,23 @@ vlib_main_configure (vlib_main_t * vm, unformat_input_t * input)
 	;
       else if (unformat (input, "elog-post-mortem-dump"))
 	vm->elog_post_mortem_dump = 1;
+      else if (unformat (input, "idle-sleep-max-usec %u",
+			 &vm->idle_sleep_max_usec))
+	;
+      else if (unformat (input, "idle-sleep-min-usec %u",
+			 &vm->idle_sleep_min_usec))
+	;
+      else if (unformat (input, "idle-sleep-after-loops %u",
+			 &vm->idle_sleep_after_loops))
+	;
       else
 	return unformat_parse_error (input);
     }
 
+  if (vm->idle_sleep_max_usec > 1000000)
+    return clib_error_return (0, "idle-sleep-max-usec must be at most "
+			      "1000000");
+
   unformat_free (input);
 
   /* Enable memory trace as early as possible. */
@@ -1656,6 +2031,84 @@ vlib_main_configure (vlib_main_t * vm, unformat_input_t * input)
 
 VLIB_EARLY_CONFIG_FUNCTION (vlib_main_configure, "vlib");
 
+static clib_error_t *
+set_idle_sleep (vlib_main_t * vm,
+		unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  u32 max_usec = ~0, min_usec = 0, after_loops = 0, thread_index = ~0;
+  u32 i;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "off"))
+	max_usec = 0;
+      else if (unformat (input, "max-usec %u", &max_usec))
+	;
+      else if (unformat (input, "min-usec %u", &min_usec))
+	;
+      else if (unformat (input, "after-loops %u", &after_loops))
+	;
+      else if (unformat (input, "thread %u", &thread_index))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (max_usec == ~0)
+    return clib_error_return (0, "please specify max-usec or off");
+  if (max_usec > 1000000)
+    return clib_error_return (0, "max-usec must be at most 1000000");
+  if (thread_index != ~0 && thread_index >= vec_len (vlib_mains))
+    return clib_error_return (0, "no thread %u", thread_index);
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    {
+      vlib_main_t *this_vm = vlib_mains[i];
+
+      if (!this_vm || (thread_index != ~0 && i != thread_index))
+	continue;
+      if (this_vm->wakeup_fd < 0)
+	continue;
+
+      this_vm->idle_sleep_max_usec = max_usec;
+      if (min_usec)
+	this_vm->idle_sleep_min_usec = min_usec;
+      if (after_loops)
+	this_vm->idle_sleep_after_loops = after_loops;
+      this_vm->n_idle_loops = 0;
+      this_vm->idle_sleep_usec = 0;
+    }
+
+  vlib_worker_thread_barrier_release (vm);
+
+  return 0;
+}
+
+/*?
+ * Let the main loop of a thread sleep when it finds nothing to do,
+ * instead of spinning on idle input nodes. After <em>after-loops</em>
+ * loops in a row without packets, the thread sleeps, starting with
+ * <em>min-usec</em> and doubling up to <em>max-usec</em>, its latency
+ * budget. Interrupts and barrier syncs wake it up early. The time spent
+ * asleep is reported by <em>show runtime</em>. The same can be set at
+ * startup with <em>idle-sleep-max-usec</em>, <em>idle-sleep-min-usec</em>
+ * and <em>idle-sleep-after-loops</em> in the vlib section.
+ *
+ * @cliexpar
+ * @cliexcmd{set main-loop idle-sleep max-usec 100 thread 1}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_idle_sleep_cli, static) = {
+  .path = "set main-loop idle-sleep",
+  .short_help = "set main-loop idle-sleep {max-usec <n> [min-usec <n>] "
+    "[after-loops <n>] | off} [thread <n>]",
+  .function = set_idle_sleep,
+};
+/* *INDENT-ON* */
+
 static void
 dummy_queue_signal_callback (vlib_main_t * vm)
 {
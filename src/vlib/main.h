@@ -210,6 +210,27 @@ typedef struct vlib_main_t
   /* Earliest barrier can be closed again */
   f64 barrier_no_close_before;
 
+  /*
+   * Sleep when the loop has nothing to do, see vlib_main_loop_idle.
+   * The maximum sleep is the latency budget, 0 to never sleep.
+   */
+  u32 idle_sleep_max_usec;
+  u32 idle_sleep_min_usec;
+  u32 idle_sleep_after_loops;
+
+  /* Idle loops in a row and current sleep */
+  u32 n_idle_loops;
+  u32 idle_sleep_usec;
+
+  /* Set while asleep, wakeup_fd wakes the thread up early */
+  volatile u32 sleeping;
+  int wakeup_fd;
+
+  /* Sleep statistics, since the last clear runtime */
+  f64 time_sleeping;
+  u64 n_sleeps;
+  u64 n_sleep_wakeups;
+
 } vlib_main_t;
 
 /* Global main structure. */
@@ -353,6 +374,9 @@ always_inline void vlib_set_queue_signal_callback
   vm->queue_signal_callback = fp;
 }
 
+/* Wake up a thread sleeping in its idle loop. */
+void vlib_main_loop_wakeup (vlib_main_t * vm);
+
 /* Main routine. */
 int vlib_main (vlib_main_t * vm, unformat_input_t * input);
 
@@ -369,6 +369,7 @@ register_node (vlib_main_t * vm, vlib_node_registration_t * r)
   _(state);
   _(scalar_size);
   _(vector_size);
+  _(preferred_batch_size);
   _(format_buffer);
   _(unformat_buffer);
   _(format_trace);
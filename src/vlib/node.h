@@ -129,6 +129,9 @@ typedef struct _vlib_node_registration
   /* Number of error codes used by this node. */
   u16 n_errors;
 
+  /* Vectors per call this node likes best, when coalescing frames. */
+  u16 preferred_batch_size;
+
   /* Number of next node names that follow. */
   u16 n_next_nodes;
 
@@ -261,6 +264,10 @@ typedef struct vlib_node_t
 #define VLIB_NODE_FLAG_SWITCH_FROM_INTERRUPT_TO_POLLING_MODE (1 << 6)
 #define VLIB_NODE_FLAG_SWITCH_FROM_POLLING_TO_INTERRUPT_MODE (1 << 7)
 
+  /* Node keeps no per-thread state: with work stealing enabled its
+     frames may be dispatched by another, idle, worker. */
+#define VLIB_NODE_FLAG_STEALABLE (1 << 8)
+
   /* State for input nodes. */
   u8 state;
 
@@ -273,6 +280,10 @@ typedef struct vlib_node_t
   /* Size of scalar and vector arguments in bytes. */
   u16 scalar_size, vector_size;
 
+  /* Vectors per call this node likes best, 0 for VLIB_FRAME_SIZE.
+     Frames to the node are coalesced up to that size. */
+  u16 preferred_batch_size;
+
   /* Handle/index in error heap for this node. */
   u32 error_heap_handle;
   u32 error_heap_index;
@@ -404,8 +415,88 @@ typedef struct
 
   /* Special value for next_frame_index when there is no next frame. */
 #define VLIB_PENDING_FRAME_NO_NEXT_FRAME ((u32) ~0)
+
+  /* Low bits of the CPU time the frame was made pending. */
+  u32 cpu_time_pending;
 } vlib_pending_frame_t;
 
+/* Number of log2 buckets in a node histogram. */
+#define VLIB_NODE_HISTOGRAM_N_BUCKETS 32
+
+/*
+ * Per-thread runtime histograms of a node, recorded when enabled with
+ * "set runtime histogram".  Bucket 0 counts zeroes and bucket i the
+ * values in [2^(i-1), 2^i), the last bucket also the larger values.
+ */
+typedef struct
+{
+  /* Clocks spent in the node function by one call. */
+  u64 clocks_per_call[VLIB_NODE_HISTOGRAM_N_BUCKETS];
+
+  /* Vectors handled by one call. */
+  u64 vectors_per_call[VLIB_NODE_HISTOGRAM_N_BUCKETS];
+
+  /* Clocks a frame to the node waited, from pending to dispatched. */
+  u64 frame_residency[VLIB_NODE_HISTOGRAM_N_BUCKETS];
+} vlib_node_histogram_t;
+
+/* Hardware counters read around each node call, see vlib/linux/pmc.h */
+#define foreach_vlib_node_pmc_event				\
+  _ (CPU_CYCLES, "cycles")					\
+  _ (INSTRUCTIONS, "instructions")				\
+  _ (CACHE_MISSES, "cache-misses")				\
+  _ (BRANCH_MISSES, "branch-misses")
+
+typedef enum
+{
+#define _(e,s) VLIB_NODE_PMC_##e,
+  foreach_vlib_node_pmc_event
+#undef _
+    VLIB_NODE_N_PMC,
+} vlib_node_pmc_event_t;
+
+/* Per-thread hardware counter totals of a node. */
+typedef struct
+{
+  u64 calls;
+  u64 counts[VLIB_NODE_N_PMC];
+} vlib_node_pmc_t;
+
+/* Per-thread work stealing state of a node. */
+typedef struct
+{
+  /* Frame queue to the node on the other threads, ~0 if not stealable. */
+  u32 frame_queue_index;
+
+  /* Thread taking the frames made pending here, ~0 while they are
+     dispatched here. */
+  u32 thread_index;
+
+  /* Frames given to thread_index it has not dispatched yet, decremented
+     by that thread. */
+  volatile u32 n_in_flight;
+
+  /* Frames and vectors taken by other threads, and their changes. */
+  u64 frames_stolen;
+  u64 vectors_stolen;
+  u64 n_thread_changes;
+} vlib_node_steal_t;
+
+/* Frame of a node taken from another thread, dispatched here. */
+typedef struct
+{
+  u32 node_index;
+  u32 thread_index;
+} vlib_node_steal_received_t;
+
+always_inline u32
+vlib_node_histogram_bucket (u64 v)
+{
+  if (v == 0)
+    return 0;
+  return clib_min (1 + min_log2 (v), VLIB_NODE_HISTOGRAM_N_BUCKETS - 1);
+}
+
 typedef struct vlib_node_runtime_t
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);	/**< cacheline mark */
@@ -645,6 +736,33 @@ typedef struct
   u32 flags;
 #define VLIB_NODE_MAIN_RUNTIME_STARTED (1 << 0)
 
+  /* Runtime histograms, indexed by node index, recorded when enabled. */
+  u32 histograms_enabled;
+  vlib_node_histogram_t *node_histograms;
+
+  /* Coalesce small frames pending to the same node, and statistics. */
+  u32 frame_coalescing;
+  u64 frames_coalesced;
+  u64 vectors_coalesced;
+
+  /* Work stealing, indexed by node index.  Frames go to an idle worker
+     when the average vector length here reaches steal_busy_vectors, to
+     a worker below steal_idle_vectors. */
+  u32 work_stealing;
+  u32 steal_busy_vectors;
+  u32 steal_idle_vectors;
+  vlib_node_steal_t *node_steals;
+
+  /* Frames taken from other threads in this main loop iteration. */
+  vlib_node_steal_received_t *steals_received;
+
+  /* Hardware counters, indexed by node index, read when enabled. */
+  u32 pmc_enabled;
+  vlib_node_pmc_t *node_pmcs;
+  int pmc_fds[VLIB_NODE_N_PMC];
+  void *pmc_pages[VLIB_NODE_N_PMC];
+  u64 pmc_start[VLIB_NODE_N_PMC];
+
   /* Nodes segregated by type for cache locality.
      Does not apply to nodes of type VLIB_NODE_TYPE_INTERNAL. */
   vlib_node_runtime_t *nodes_by_type[VLIB_N_NODE_TYPE];
@@ -207,6 +207,29 @@ format_vlib_node_stats (u8 * s, va_list * va)
   return s;
 }
 
+/* hardware counters of a node, or the header when n is 0 */
+static u8 *
+format_vlib_node_pmc (u8 * s, va_list * args)
+{
+  vlib_node_t *n = va_arg (*args, vlib_node_t *);
+  vlib_node_pmc_t *np = va_arg (*args, vlib_node_pmc_t *);
+  f64 calls, cycles;
+
+  if (!n)
+    return format (s, "%-30s%12s%8s%16s%16s%16s", "Hardware counters",
+		   "Calls", "IPC", "Instr/Call", "Cache-miss/Call",
+		   "Branch-miss/Call");
+
+  calls = np->calls;
+  cycles = np->counts[VLIB_NODE_PMC_CPU_CYCLES];
+  return format (s, "%-30v%12llu%8.2f%16.2f%16.2f%16.2f", n->name,
+		 np->calls,
+		 cycles ? np->counts[VLIB_NODE_PMC_INSTRUCTIONS] / cycles : 0,
+		 np->counts[VLIB_NODE_PMC_INSTRUCTIONS] / calls,
+		 np->counts[VLIB_NODE_PMC_CACHE_MISSES] / calls,
+		 np->counts[VLIB_NODE_PMC_BRANCH_MISSES] / calls);
+}
+
 static clib_error_t *
 show_node_runtime (vlib_main_t * vm,
 		   unformat_input_t * input, vlib_cli_command_t * cmd)
@@ -218,6 +241,7 @@ show_node_runtime (vlib_main_t * vm,
   vlib_node_t ***node_dups = 0;
   f64 *vectors_per_main_loop = 0;
   f64 *last_vector_length_per_node = 0;
+  vlib_node_pmc_t **node_pmcs = 0;
 
   time_now = vlib_time_now (vm);
 
@@ -279,6 +303,7 @@ show_node_runtime (vlib_main_t * vm,
 		    vlib_last_vectors_per_main_loop_as_f64 (stat_vm));
 	  vec_add1 (last_vector_length_per_node,
 		    vlib_last_vector_length_per_node (stat_vm));
+	  vec_add1 (node_pmcs, vec_dup (nm->node_pmcs));
 	}
       vlib_worker_thread_barrier_release (vm);
 
@@ -354,6 +379,32 @@ show_node_runtime (vlib_main_t * vm,
 	     (f64) n_input / dt,
 	     (f64) n_output / dt, (f64) n_drop / dt, (f64) n_punt / dt);
 
+	  if (stat_vm->node_main.frame_coalescing
+	      || stat_vm->node_main.frames_coalesced)
+	    vlib_cli_output (vm, "  frames coalesced %llu, vectors moved %llu",
+			     stat_vm->node_main.frames_coalesced,
+			     stat_vm->node_main.vectors_coalesced);
+
+	  for (i = 0; i < vec_len (stat_vm->node_main.node_steals); i++)
+	    {
+	      vlib_node_steal_t *st = stat_vm->node_main.node_steals + i;
+	      if (st->frames_stolen)
+		vlib_cli_output
+		  (vm, "  %U: %llu frames, %llu vectors stolen, "
+		   "%llu thread changes", format_vlib_node_name, vm, i,
+		   st->frames_stolen, st->vectors_stolen,
+		   st->n_thread_changes);
+	    }
+
+	  if (stat_vm->idle_sleep_max_usec || stat_vm->n_sleeps)
+	    vlib_cli_output
+	      (vm, "  idle sleep max %uus, asleep %.2f%% busy %.2f%%, "
+	       "%llu sleeps, %llu woken early",
+	       stat_vm->idle_sleep_max_usec,
+	       100.0 * stat_vm->time_sleeping / dt,
+	       100.0 * (1 - stat_vm->time_sleeping / dt),
+	       stat_vm->n_sleeps, stat_vm->n_sleep_wakeups);
+
 	  vlib_cli_output (vm, "%U", format_vlib_node_stats, stat_vm, 0, max);
 	  for (i = 0; i < vec_len (nodes); i++)
 	    {
@@ -369,10 +420,23 @@ show_node_runtime (vlib_main_t * vm,
 				   nodes[i], max);
 		}
 	    }
+
+	  if (vec_len (node_pmcs[j]))
+	    {
+	      vlib_cli_output (vm, "%U", format_vlib_node_pmc, 0, 0);
+	      for (i = 0; i < vec_len (nodes); i++)
+		if (nodes[i]->index < vec_len (node_pmcs[j]) &&
+		    node_pmcs[j][nodes[i]->index].calls)
+		  vlib_cli_output (vm, "%U", format_vlib_node_pmc, nodes[i],
+				   &node_pmcs[j][nodes[i]->index]);
+	    }
+
 	  vec_free (nodes);
+	  vec_free (node_pmcs[j]);
 	}
       vec_free (stat_vms);
       vec_free (node_dups);
+      vec_free (node_pmcs);
       vec_free (vectors_per_main_loop);
       vec_free (last_vector_length_per_node);
     }
@@ -424,6 +488,21 @@ clear_node_runtime (vlib_main_t * vm,
 	}
       /* Note: input/output rates computed using vlib_global_main */
       nm->time_last_runtime_stats_clear = vlib_time_now (vm);
+
+      stat_vm->time_sleeping = 0;
+      stat_vm->n_sleeps = 0;
+      stat_vm->n_sleep_wakeups = 0;
+
+      vec_zero (nm->node_histograms);
+      vec_zero (nm->node_pmcs);
+      nm->frames_coalesced = 0;
+      nm->vectors_coalesced = 0;
+      for (i = 0; i < vec_len (nm->node_steals); i++)
+	{
+	  nm->node_steals[i].frames_stolen = 0;
+	  nm->node_steals[i].vectors_stolen = 0;
+	  nm->node_steals[i].n_thread_changes = 0;
+	}
     }
 
   vlib_worker_thread_barrier_release (vm);
@@ -441,6 +520,475 @@ VLIB_CLI_COMMAND (clear_node_runtime_command, static) = {
 };
 /* *INDENT-ON* */
 
+void
+vlib_node_histograms_enable_disable (vlib_main_t * vm, int enable)
+{
+  vlib_main_t *stat_vm;
+  vlib_node_main_t *nm;
+  int i;
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    {
+      stat_vm = vlib_mains[i];
+      if (!stat_vm)
+	continue;
+      nm = &stat_vm->node_main;
+
+      /* all allocations from the main thread, workers only count */
+      if (enable && vec_len (nm->nodes))
+	vec_validate (nm->node_histograms, vec_len (nm->nodes) - 1);
+      nm->histograms_enabled = enable;
+    }
+
+  vlib_worker_thread_barrier_release (vm);
+}
+
+static clib_error_t *
+set_node_histogram (vlib_main_t * vm,
+		    unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  int enable = -1;
+
+  if (unformat (input, "enable") || unformat (input, "on"))
+    enable = 1;
+  else if (unformat (input, "disable") || unformat (input, "off"))
+    enable = 0;
+  else
+    return clib_error_return (0, "please specify enable or disable");
+
+  vlib_node_histograms_enable_disable (vm, enable);
+  return 0;
+}
+
+/*?
+ * Record per-node log2 histograms of clocks per call, vectors per call
+ * and frame residency, the clocks a frame waits between being made
+ * pending and being dispatched. Shown by <em>show runtime histogram</em>,
+ * reset by <em>clear runtime</em>. When disabled the dispatch path only
+ * tests a flag.
+ *
+ * @cliexpar
+ * @cliexcmd{set runtime histogram enable}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_node_histogram_command, static) = {
+  .path = "set runtime histogram",
+  .short_help = "set runtime histogram {enable | disable}",
+  .function = set_node_histogram,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+set_node_pmc (vlib_main_t * vm,
+	      unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  if (unformat (input, "enable") || unformat (input, "on"))
+    return vlib_node_pmc_enable_disable (vm, 1);
+  if (unformat (input, "disable") || unformat (input, "off"))
+    return vlib_node_pmc_enable_disable (vm, 0);
+  return clib_error_return (0, "please specify enable or disable");
+}
+
+/*?
+ * Read the cycles, instructions, cache misses and branch misses hardware
+ * counters of each thread around every node call, with perf_event_open
+ * and rdpmc. <em>show runtime</em> then lists the instructions per cycle
+ * and the counts per call of each node, since the last <em>clear
+ * runtime</em>. Reading the counters costs some tens of cycles per node
+ * call, so leave it disabled when not looking. Needs
+ * kernel.perf_event_paranoid at 2 or lower, or CAP_SYS_ADMIN.
+ *
+ * @cliexpar
+ * @cliexcmd{set runtime pmc enable}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_node_pmc_command, static) = {
+  .path = "set runtime pmc",
+  .short_help = "set runtime pmc {enable | disable}",
+  .function = set_node_pmc,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+set_frame_coalescing (vlib_main_t * vm,
+		      unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  int i, enable;
+
+  if (unformat (input, "enable") || unformat (input, "on"))
+    enable = 1;
+  else if (unformat (input, "disable") || unformat (input, "off"))
+    enable = 0;
+  else
+    return clib_error_return (0, "please specify enable or disable");
+
+  vlib_worker_thread_barrier_sync (vm);
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    if (vlib_mains[i])
+      vlib_mains[i]->node_main.frame_coalescing = enable;
+  vlib_worker_thread_barrier_release (vm);
+
+  return 0;
+}
+
+/*?
+ * Coalesce the small frames made pending to the same node within one
+ * main loop, e.g. from several input nodes each bringing in a few
+ * packets, so that the node is called once with a larger frame. Frames
+ * are coalesced up to the preferred batch size of the node, see
+ * <em>set node batch-size</em>. <em>show runtime</em> counts the frames
+ * coalesced.
+ *
+ * @cliexpar
+ * @cliexcmd{set runtime coalesce enable}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_frame_coalescing_command, static) = {
+  .path = "set runtime coalesce",
+  .short_help = "set runtime coalesce {enable | disable}",
+  .function = set_frame_coalescing,
+};
+/* *INDENT-ON* */
+
+void
+vlib_node_steal_enable_disable (vlib_main_t * vm, int enable,
+				u32 busy_vectors, u32 idle_vectors)
+{
+  vlib_node_main_t *nm = &vm->node_main, *stat_nm;
+  vlib_node_steal_t empty = {.frame_queue_index = ~0,.thread_index = ~0 };
+  vlib_node_t *n;
+  int i, j;
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  /* one frame queue per stealable node, kept when disabled */
+  if (enable && vec_len (nm->nodes))
+    {
+      vec_validate_init_empty (nm->node_steals, vec_len (nm->nodes) - 1,
+			       empty);
+      for (j = 0; j < vec_len (nm->nodes); j++)
+	{
+	  n = nm->nodes[j];
+	  if (nm->node_steals[j].frame_queue_index == ~0
+	      && (n->flags & VLIB_NODE_FLAG_STEALABLE)
+	      && n->type == VLIB_NODE_TYPE_INTERNAL
+	      && n->vector_size == sizeof (u32) && n->scalar_size == 0)
+	    nm->node_steals[j].frame_queue_index =
+	      vlib_frame_queue_main_init (j, 0);
+	}
+    }
+
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    {
+      if (!vlib_mains[i])
+	continue;
+      stat_nm = &vlib_mains[i]->node_main;
+
+      /* all allocations from the main thread, workers only count */
+      if (enable)
+	{
+	  vec_validate_init_empty (stat_nm->node_steals,
+				   vec_len (nm->node_steals) - 1, empty);
+	  for (j = 0; j < vec_len (nm->node_steals); j++)
+	    stat_nm->node_steals[j].frame_queue_index =
+	      nm->node_steals[j].frame_queue_index;
+	  stat_nm->steal_busy_vectors = busy_vectors;
+	  stat_nm->steal_idle_vectors = idle_vectors;
+	}
+      stat_nm->work_stealing = enable;
+    }
+
+  vlib_worker_thread_barrier_release (vm);
+}
+
+static clib_error_t *
+set_node_steal (vlib_main_t * vm,
+		unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  u32 busy_vectors = VLIB_FRAME_SIZE / 2, idle_vectors = 16;
+  int enable = -1;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "enable") || unformat (input, "on"))
+	enable = 1;
+      else if (unformat (input, "disable") || unformat (input, "off"))
+	enable = 0;
+      else if (unformat (input, "busy %u", &busy_vectors))
+	;
+      else if (unformat (input, "idle %u", &idle_vectors))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (enable == -1)
+    return clib_error_return (0, "please specify enable or disable");
+  if (enable && vlib_num_workers () < 2)
+    return clib_error_return (0, "work stealing needs two workers or more");
+  if (idle_vectors >= busy_vectors)
+    return clib_error_return (0, "idle must be below busy");
+
+  vlib_node_steal_enable_disable (vm, enable, busy_vectors, idle_vectors);
+  return 0;
+}
+
+/*?
+ * Let idle workers take the frames of stateless nodes, such as
+ * ip4-lookup and ip4-rewrite, from busy ones. A worker whose average
+ * vector length per node reaches <em>busy</em> (default 128) hands the
+ * frames pending to such a node to the least loaded worker below
+ * <em>idle</em> (default 16), through a frame queue. All the frames of
+ * a node go to one thread at a time, changed only once that thread has
+ * dispatched all it was given, so packets of a flow are not reordered by the
+ * node. Nodes opt in with VLIB_NODE_FLAG_STEALABLE. <em>show runtime</em>
+ * counts the frames stolen from each thread.
+ *
+ * @cliexpar
+ * @cliexcmd{set runtime steal enable busy 192 idle 32}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_node_steal_command, static) = {
+  .path = "set runtime steal",
+  .short_help = "set runtime steal {enable [busy <n>] [idle <n>] | disable}",
+  .function = set_node_steal,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+set_node_batch_size (vlib_main_t * vm,
+		     unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  u32 node_index, batch_size;
+  int i;
+
+  if (!unformat (input, "%U %u", unformat_vlib_node, vm, &node_index,
+		 &batch_size))
+    return clib_error_return (0, "please specify a node and a size");
+  if (batch_size > VLIB_FRAME_SIZE)
+    return clib_error_return (0, "size must be at most %u", VLIB_FRAME_SIZE);
+
+  vlib_worker_thread_barrier_sync (vm);
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    if (vlib_mains[i])
+      vlib_get_node (vlib_mains[i], node_index)->preferred_batch_size =
+	batch_size;
+  vlib_worker_thread_barrier_release (vm);
+
+  return 0;
+}
+
+/*?
+ * Set the number of vectors per call a node likes best, 0 for a full
+ * frame. When frame coalescing is enabled, frames pending to the node
+ * are merged until they hold that many vectors. The default comes from
+ * the node registration.
+ *
+ * @cliexpar
+ * @cliexcmd{set node batch-size ip4-lookup 64}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_node_batch_size_command, static) = {
+  .path = "set node batch-size",
+  .short_help = "set node batch-size <node> <n>",
+  .function = set_node_batch_size,
+};
+/* *INDENT-ON* */
+
+/* upper bound of the bucket reaching the given fraction of the samples */
+static u64
+node_histogram_percentile (u64 * buckets, f64 fraction)
+{
+  u64 total = 0, sum = 0;
+  int i;
+
+  for (i = 0; i < VLIB_NODE_HISTOGRAM_N_BUCKETS; i++)
+    total += buckets[i];
+  if (total == 0)
+    return 0;
+
+  for (i = 0; i < VLIB_NODE_HISTOGRAM_N_BUCKETS; i++)
+    {
+      sum += buckets[i];
+      if (sum >= fraction * total)
+	break;
+    }
+  return i ? 1ULL << clib_min (i, VLIB_NODE_HISTOGRAM_N_BUCKETS - 1) : 0;
+}
+
+static u8 *
+format_node_histogram_percentiles (u8 * s, va_list * args)
+{
+  u64 *buckets = va_arg (*args, u64 *);
+
+  return format (s, "%8llu %8llu %8llu",
+		 node_histogram_percentile (buckets, 0.5),
+		 node_histogram_percentile (buckets, 0.99),
+		 node_histogram_percentile (buckets, 0.999));
+}
+
+static u8 *
+format_node_histogram_buckets (u8 * s, va_list * args)
+{
+  vlib_node_histogram_t *h = va_arg (*args, vlib_node_histogram_t *);
+  u32 indent = format_get_indent (s);
+  int i;
+
+  s = format (s, "%12s %16s %16s %16s", "below",
+	      "clocks/call", "vectors/call", "frame residency");
+  for (i = 0; i < VLIB_NODE_HISTOGRAM_N_BUCKETS; i++)
+    {
+      if (!h->clocks_per_call[i] && !h->vectors_per_call[i] &&
+	  !h->frame_residency[i])
+	continue;
+      s = format (s, "\n%U", format_white_space, indent);
+      if (i == 0)
+	s = format (s, "%12s", "zero");
+      else if (i == VLIB_NODE_HISTOGRAM_N_BUCKETS - 1)
+	s = format (s, "%12s", "more");
+      else
+	s = format (s, "%12llu", 1ULL << i);
+      s = format (s, " %16llu %16llu %16llu", h->clocks_per_call[i],
+		  h->vectors_per_call[i], h->frame_residency[i]);
+    }
+  return s;
+}
+
+static clib_error_t *
+show_node_histogram (vlib_main_t * vm,
+		     unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  vlib_node_histogram_t **histograms = 0, *h, total;
+  vlib_node_t ***node_dups = 0, **nodes, *n;
+  vlib_main_t **stat_vms = 0, *stat_vm;
+  u32 node_index = ~0, thread_index = ~0;
+  u64 n_calls;
+  uword i, j, k;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "thread %u", &thread_index))
+	;
+      else if (unformat (input, "%U", unformat_vlib_node, vm, &node_index))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (!vm->node_main.histograms_enabled &&
+      !vec_len (vm->node_main.node_histograms))
+    return clib_error_return (0, "histograms are disabled, see "
+			      "set runtime histogram");
+
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    {
+      stat_vm = vlib_mains[i];
+      if (stat_vm && (thread_index == ~0 || i == thread_index))
+	vec_add1 (stat_vms, stat_vm);
+    }
+
+  /* snapshot under barrier, print without */
+  vlib_worker_thread_barrier_sync (vm);
+  for (j = 0; j < vec_len (stat_vms); j++)
+    {
+      vec_add1 (histograms, vec_dup (stat_vms[j]->node_main.node_histograms));
+      vec_add1 (node_dups, vec_dup (stat_vms[j]->node_main.nodes));
+    }
+  vlib_worker_thread_barrier_release (vm);
+
+  for (j = 0; j < vec_len (stat_vms); j++)
+    {
+      stat_vm = stat_vms[j];
+      nodes = node_dups[j];
+
+      if (vec_len (vlib_mains) > 1)
+	{
+	  if (j > 0)
+	    vlib_cli_output (vm, "---------------");
+	  vlib_cli_output (vm, "Thread %d %s", stat_vm->thread_index,
+			   vlib_worker_threads[stat_vm->thread_index].name);
+	}
+
+      if (node_index != ~0)
+	{
+	  if (node_index < vec_len (histograms[j]))
+	    vlib_cli_output (vm, "%v:\n  %U", nodes[node_index]->name,
+			     format_node_histogram_buckets,
+			     vec_elt_at_index (histograms[j], node_index));
+	  continue;
+	}
+
+      memset (&total, 0, sizeof (total));
+      vec_foreach (h, histograms[j])
+      {
+	for (k = 0; k < VLIB_NODE_HISTOGRAM_N_BUCKETS; k++)
+	  total.frame_residency[k] += h->frame_residency[k];
+      }
+      vlib_cli_output (vm, "frame residency clocks p50 p99 p99.9: %U",
+		       format_node_histogram_percentiles,
+		       total.frame_residency);
+
+      vlib_cli_output (vm, "%-30s %10s %26s %26s %26s", "Name", "Calls",
+		       "Clocks p50 p99 p99.9", "Vectors p50 p99 p99.9",
+		       "Residency p50 p99 p99.9");
+
+      vec_sort_with_function (nodes, node_cmp);
+      for (i = 0; i < vec_len (nodes); i++)
+	{
+	  n = nodes[i];
+	  if (n->index >= vec_len (histograms[j]))
+	    continue;
+	  h = vec_elt_at_index (histograms[j], n->index);
+	  n_calls = 0;
+	  for (k = 0; k < VLIB_NODE_HISTOGRAM_N_BUCKETS; k++)
+	    n_calls += h->clocks_per_call[k];
+	  if (n_calls == 0)
+	    continue;
+	  vlib_cli_output (vm, "%-30v %10llu %U %U %U", n->name, n_calls,
+			   format_node_histogram_percentiles,
+			   h->clocks_per_call,
+			   format_node_histogram_percentiles,
+			   h->vectors_per_call,
+			   format_node_histogram_percentiles,
+			   h->frame_residency);
+	}
+    }
+
+  for (j = 0; j < vec_len (stat_vms); j++)
+    {
+      vec_free (histograms[j]);
+      vec_free (node_dups[j]);
+    }
+  vec_free (histograms);
+  vec_free (node_dups);
+  vec_free (stat_vms);
+
+  return 0;
+}
+
+/*?
+ * Show the runtime histograms recorded since the last <em>clear
+ * runtime</em>: for each node the 50th, 99th and 99.9th percentiles of
+ * clocks per call, vectors per call and frame residency, as the upper
+ * bound of their log2 bucket. With a node name, the buckets of that
+ * node.
+ *
+ * @cliexpar
+ * @cliexcmd{show runtime histogram ip4-lookup thread 1}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_node_histogram_command, static) = {
+  .path = "show runtime histogram",
+  .short_help = "show runtime histogram [<node>] [thread <n>]",
+  .function = show_node_histogram,
+  .is_mp_safe = 1,
+};
+/* *INDENT-ON* */
+
 /* Dummy function to get us linked in. */
 void
 vlib_node_cli_reference (void)
@@ -201,6 +201,14 @@ vlib_node_set_interrupt_pending (vlib_main_t * vm, u32 node_index)
   clib_spinlock_lock_if_init (&nm->pending_interrupt_lock);
   vec_add1 (nm->pending_interrupt_node_runtime_indices, n->runtime_index);
   clib_spinlock_unlock_if_init (&nm->pending_interrupt_lock);
+
+  /* The thread may be asleep in its idle loop */
+  if (PREDICT_FALSE (vm->idle_sleep_max_usec != 0))
+    {
+      CLIB_MEMORY_BARRIER ();
+      if (vm->sleeping)
+	vlib_main_loop_wakeup (vm);
+    }
 }
 
 always_inline vlib_process_t *
@@ -1154,6 +1162,16 @@ format_function_t format_vlib_time;
 /* Parse node name -> node index. */
 unformat_function_t unformat_vlib_node;
 
+/* Start or stop recording the runtime histograms, on all threads. */
+void vlib_node_histograms_enable_disable (vlib_main_t * vm, int enable);
+
+/* Start or stop reading the hardware counters, on all threads. */
+clib_error_t *vlib_node_pmc_enable_disable (vlib_main_t * vm, int enable);
+
+/* Start or stop work stealing of the stealable nodes, on all threads. */
+void vlib_node_steal_enable_disable (vlib_main_t * vm, int enable,
+				     u32 busy_vectors, u32 idle_vectors);
+
 always_inline void
 vlib_node_increment_counter (vlib_main_t * vm, u32 node_index,
 			     u32 counter_index, u64 increment)
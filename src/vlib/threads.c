@@ -557,6 +557,7 @@ vlib_frame_queue_dequeue_internal (int thread_id,
 	  p->node_runtime_index = elt->node_runtime_index;
 	  p->frame_index = vlib_frame_index (vm, f);
 	  p->next_frame_index = VLIB_PENDING_FRAME_NO_NEXT_FRAME;
+	  p->cpu_time_pending = vm->cpu_time_last_node_dispatch;
 	  fq->dequeue_vectors += (u64) f->n_vectors;
 	  break;
 	case VLIB_FRAME_QUEUE_ELT_API_MSG:
@@ -910,8 +911,15 @@ start_workers (vlib_main_t * vm)
 	      clib_mem_set_heap (oldheap);
 	      vec_add1_aligned (vlib_mains, vm_clone, CLIB_CACHE_LINE_BYTES);
 
+	      oldheap =
+		vlib_stats_push_heap (2 *
+				      vec_bytes (vlib_mains[0]->
+						 error_main.counters));
 	      vm_clone->error_main.counters =
 		vec_dup (vlib_mains[0]->error_main.counters);
+	      if (oldheap)
+		vlib_stats_pop_heap_error (vm_clone->error_main.counters,
+					   vm_clone->thread_index, oldheap);
 	      vm_clone->error_main.counters_last_clear =
 		vec_dup (vlib_mains[0]->error_main.counters_last_clear);
 
@@ -1072,6 +1080,7 @@ vlib_worker_thread_node_refork (void)
   vlib_node_runtime_t *rt, *old_rt;
 
   vlib_node_t *new_n_clone;
+  void *oldheap;
 
   int j;
 
@@ -1087,7 +1096,14 @@ vlib_worker_thread_node_refork (void)
   clib_memcpy (&vm_clone->error_main, &vm->error_main,
 	       sizeof (vm->error_main));
   j = vec_len (vm->error_main.counters) - 1;
+  if (!(oldheap = vlib_stats_push_heap (2 * (j + 1) *
+					 sizeof (old_counters[0]))))
+    old_counters = vlib_stats_unpublish_error (old_counters,
+					       vm_clone->thread_index);
   vec_validate_aligned (old_counters, j, CLIB_CACHE_LINE_BYTES);
+  if (oldheap)
+    vlib_stats_pop_heap_error (old_counters, vm_clone->thread_index,
+			       oldheap);
   vec_validate_aligned (old_counters_all_clear, j, CLIB_CACHE_LINE_BYTES);
   vm_clone->error_main.counters = old_counters;
   vm_clone->error_main.counters_last_clear = old_counters_all_clear;
@@ -1435,7 +1451,7 @@ vlib_worker_thread_barrier_sync_int (vlib_main_t * vm)
   f64 t_entry;
   f64 t_open;
   f64 t_closed;
-  u32 count;
+  u32 count, i;
 
   if (vec_len (vlib_mains) < 2)
     return;
@@ -1469,6 +1485,13 @@ vlib_worker_thread_barrier_sync_int (vlib_main_t * vm)
   deadline = now + BARRIER_SYNC_TIMEOUT;
 
   *vlib_worker_threads->wait_at_barrier = 1;
+
+  /* idle workers may be asleep */
+  CLIB_MEMORY_BARRIER ();
+  for (i = 1; i < vec_len (vlib_mains); i++)
+    if (vlib_mains[i]->sleeping)
+      vlib_main_loop_wakeup (vlib_mains[i]);
+
   while (*vlib_worker_threads->workers_at_barrier != count)
     {
       if ((now = vlib_time_now (vm)) > deadline)
@@ -1687,6 +1710,15 @@ vlib_frame_queue_dequeue (vlib_main_t * vm, vlib_frame_queue_main_t * fqm)
       f->n_vectors = elt->n_vectors;
       vlib_put_frame_to_node (vm, fqm->node_index, f);
 
+      /* acknowledged to the stealing thread once dispatched */
+      if (elt->from_thread_index != ~0)
+	{
+	  vlib_node_steal_received_t *r;
+	  vec_add2 (vm->node_main.steals_received, r, 1);
+	  r->node_index = fqm->node_index;
+	  r->thread_index = elt->from_thread_index;
+	}
+
       elt->valid = 0;
       elt->n_vectors = 0;
       elt->msg_type = 0xfefefefe;
@@ -94,6 +94,9 @@ typedef struct
   u32 n_vectors;
   u32 last_n_vectors;
 
+  /* Thread the frame was stolen from, ~0 for a handoff. */
+  u32 from_thread_index;
+
   /* 256 * 4 = 1024 bytes, even mult of cache line size */
   u32 buffer_index[VLIB_FRAME_SIZE];
 }
@@ -462,6 +465,7 @@ vlib_get_frame_queue_elt (u32 frame_queue_index, u32 index)
 
   elt->msg_type = VLIB_FRAME_QUEUE_ELT_DISPATCH_FRAME;
   elt->last_n_vectors = elt->n_vectors = 0;
+  elt->from_thread_index = ~0;
 
   return elt;
 }
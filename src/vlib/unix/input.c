@@ -150,8 +150,9 @@ linux_epoll_input (vlib_main_t * vm,
       }
     else			/* busy */
       {
-	/* Don't come back for a respectable number of dispatch cycles */
-	node->input_main_loops_per_call = 1024;
+	/* Don't come back for a respectable number of dispatch cycles,
+	   unless the loop sleeps between them */
+	node->input_main_loops_per_call = vm->idle_sleep_usec ? 0 : 1024;
       }
 
     /* Allow any signal to wakeup our sleep. */
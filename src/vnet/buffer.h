@@ -324,6 +324,15 @@ typedef struct
       u16 *trajectory_trace;
     };
 #endif
+
+    /* async crypto offload, see vnet/crypto/async.h */
+    struct
+    {
+      u64 pad;			/* trajectory trace */
+      u32 thread_index;
+      u32 next_index;
+    } crypto_async;
+
     u32 unused[12];
   };
 } vnet_buffer_opaque2_t;
@@ -367,6 +367,11 @@ vnet_classify_find_entry_inline (vnet_classify_table_t * t,
     u32x4 as_u32x4;
     u64 as_u64[2];
   } result __attribute__((aligned(sizeof(u32x4))));
+  /* Packet data masked once per lookup, rather than once per entry */
+  union {
+    u32x4 as_u32x4[5];
+    u64 as_u64[10];
+  } masked __attribute__((aligned(sizeof(u32x4))));
   vnet_classify_bucket_t * b;
   u32 value_index;
   u32 bucket_index;
@@ -396,83 +401,136 @@ vnet_classify_find_entry_inline (vnet_classify_table_t * t,
 #ifdef CLASSIFY_USE_SSE
   if (U32X4_ALIGNED(h)) {
     u32x4 *data = (u32x4 *) h;
-    for (i = 0; i < limit; i++) {
-      key = v->key;
-      result.as_u32x4 = (data[0 + t->skip_n_vectors] & mask[0]) ^ key[0];
+    switch (t->match_n_vectors)
+      {
+      case 5:
+        masked.as_u32x4[4] = data[4 + t->skip_n_vectors] & mask[4];
+        /* FALLTHROUGH */
+      case 4:
+        masked.as_u32x4[3] = data[3 + t->skip_n_vectors] & mask[3];
+        /* FALLTHROUGH */
+      case 3:
+        masked.as_u32x4[2] = data[2 + t->skip_n_vectors] & mask[2];
+        /* FALLTHROUGH */
+      case 2:
+        masked.as_u32x4[1] = data[1 + t->skip_n_vectors] & mask[1];
+        /* FALLTHROUGH */
+      case 1:
+        masked.as_u32x4[0] = data[0 + t->skip_n_vectors] & mask[0];
+        break;
+      default:
+        abort();
+      }
+  } else
+#endif /* CLASSIFY_USE_SSE */
+    {
+      u32 skip_u64 = t->skip_n_vectors * 2;
+      u64 *data64 = (u64 *)h;
       switch (t->match_n_vectors)
         {
         case 5:
-          result.as_u32x4 |= (data[4 + t->skip_n_vectors] & mask[4]) ^ key[4];
+          masked.as_u64[8] = data64[8 + skip_u64] & ((u64 *)mask)[8];
+          masked.as_u64[9] = data64[9 + skip_u64] & ((u64 *)mask)[9];
           /* FALLTHROUGH */
         case 4:
-          result.as_u32x4 |= (data[3 + t->skip_n_vectors] & mask[3]) ^ key[3];
+          masked.as_u64[6] = data64[6 + skip_u64] & ((u64 *)mask)[6];
+          masked.as_u64[7] = data64[7 + skip_u64] & ((u64 *)mask)[7];
           /* FALLTHROUGH */
         case 3:
-          result.as_u32x4 |= (data[2 + t->skip_n_vectors] & mask[2]) ^ key[2];
+          masked.as_u64[4] = data64[4 + skip_u64] & ((u64 *)mask)[4];
+          masked.as_u64[5] = data64[5 + skip_u64] & ((u64 *)mask)[5];
           /* FALLTHROUGH */
         case 2:
-          result.as_u32x4 |= (data[1 + t->skip_n_vectors] & mask[1]) ^ key[1];
+          masked.as_u64[2] = data64[2 + skip_u64] & ((u64 *)mask)[2];
+          masked.as_u64[3] = data64[3 + skip_u64] & ((u64 *)mask)[3];
           /* FALLTHROUGH */
         case 1:
+          masked.as_u64[0] = data64[0 + skip_u64] & ((u64 *)mask)[0];
+          masked.as_u64[1] = data64[1 + skip_u64] & ((u64 *)mask)[1];
           break;
         default:
           abort();
         }
+    }
 
-      if (u32x4_zero_byte_mask (result.as_u32x4) == 0xffff) {
-        if (PREDICT_TRUE(now)) {
-          v->hits++;
-          v->last_heard = now;
-        }
-        return (v);
+  /*
+   * The masked data is aligned, so the vector compare can be used
+   * even if the packet data is not.
+   */
+#ifdef CLASSIFY_USE_SSE
+  for (i = 0; i < limit; i++) {
+    key = v->key;
+    result.as_u32x4 = masked.as_u32x4[0] ^ key[0];
+    switch (t->match_n_vectors)
+      {
+      case 5:
+        result.as_u32x4 |= masked.as_u32x4[4] ^ key[4];
+        /* FALLTHROUGH */
+      case 4:
+        result.as_u32x4 |= masked.as_u32x4[3] ^ key[3];
+        /* FALLTHROUGH */
+      case 3:
+        result.as_u32x4 |= masked.as_u32x4[2] ^ key[2];
+        /* FALLTHROUGH */
+      case 2:
+        result.as_u32x4 |= masked.as_u32x4[1] ^ key[1];
+        /* FALLTHROUGH */
+      case 1:
+        break;
+      default:
+        abort();
       }
-      v = vnet_classify_entry_at_index (t, v, 1);
+
+    if (u32x4_zero_byte_mask (result.as_u32x4) == 0xffff) {
+      if (PREDICT_TRUE(now)) {
+        v->hits++;
+        v->last_heard = now;
+      }
+      return (v);
     }
-  } else
-#endif /* CLASSIFY_USE_SSE */
-    {
-      u32 skip_u64 = t->skip_n_vectors * 2;
-      u64 *data64 = (u64 *)h;
-      for (i = 0; i < limit; i++) {
-        key = v->key;
-
-        result.as_u64[0] = (data64[0 + skip_u64] & ((u64 *)mask)[0]) ^ ((u64 *)key)[0];
-        result.as_u64[1] = (data64[1 + skip_u64] & ((u64 *)mask)[1]) ^ ((u64 *)key)[1];
-        switch (t->match_n_vectors)
-          {
-          case 5:
-            result.as_u64[0] |= (data64[8 + skip_u64] & ((u64 *)mask)[8]) ^ ((u64 *)key)[8];
-            result.as_u64[1] |= (data64[9 + skip_u64] & ((u64 *)mask)[9]) ^ ((u64 *)key)[9];
-            /* FALLTHROUGH */
-          case 4:
-            result.as_u64[0] |= (data64[6 + skip_u64] & ((u64 *)mask)[6]) ^ ((u64 *)key)[6];
-            result.as_u64[1] |= (data64[7 + skip_u64] & ((u64 *)mask)[7]) ^ ((u64 *)key)[7];
-            /* FALLTHROUGH */
-          case 3:
-            result.as_u64[0] |= (data64[4 + skip_u64] & ((u64 *)mask)[4]) ^ ((u64 *)key)[4];
-            result.as_u64[1] |= (data64[5 + skip_u64] & ((u64 *)mask)[5]) ^ ((u64 *)key)[5];
-            /* FALLTHROUGH */
-          case 2:
-            result.as_u64[0] |= (data64[2 + skip_u64] & ((u64 *)mask)[2]) ^ ((u64 *)key)[2];
-            result.as_u64[1] |= (data64[3 + skip_u64] & ((u64 *)mask)[3]) ^ ((u64 *)key)[3];
-            /* FALLTHROUGH */
-          case 1:
-            break;
-          default:
-            abort();
-          }
-
-        if (result.as_u64[0] == 0 && result.as_u64[1] == 0) {
-          if (PREDICT_TRUE(now)) {
-            v->hits++;
-            v->last_heard = now;
-          }
-          return (v);
-        }
+    v = vnet_classify_entry_at_index (t, v, 1);
+  }
+#else /* CLASSIFY_USE_SSE */
+  for (i = 0; i < limit; i++) {
+    key = v->key;
 
-        v = vnet_classify_entry_at_index (t, v, 1);
+    result.as_u64[0] = masked.as_u64[0] ^ ((u64 *)key)[0];
+    result.as_u64[1] = masked.as_u64[1] ^ ((u64 *)key)[1];
+    switch (t->match_n_vectors)
+      {
+      case 5:
+        result.as_u64[0] |= masked.as_u64[8] ^ ((u64 *)key)[8];
+        result.as_u64[1] |= masked.as_u64[9] ^ ((u64 *)key)[9];
+        /* FALLTHROUGH */
+      case 4:
+        result.as_u64[0] |= masked.as_u64[6] ^ ((u64 *)key)[6];
+        result.as_u64[1] |= masked.as_u64[7] ^ ((u64 *)key)[7];
+        /* FALLTHROUGH */
+      case 3:
+        result.as_u64[0] |= masked.as_u64[4] ^ ((u64 *)key)[4];
+        result.as_u64[1] |= masked.as_u64[5] ^ ((u64 *)key)[5];
+        /* FALLTHROUGH */
+      case 2:
+        result.as_u64[0] |= masked.as_u64[2] ^ ((u64 *)key)[2];
+        result.as_u64[1] |= masked.as_u64[3] ^ ((u64 *)key)[3];
+        /* FALLTHROUGH */
+      case 1:
+        break;
+      default:
+        abort();
+      }
+
+    if (result.as_u64[0] == 0 && result.as_u64[1] == 0) {
+      if (PREDICT_TRUE(now)) {
+        v->hits++;
+        v->last_heard = now;
       }
+      return (v);
     }
+
+    v = vnet_classify_entry_at_index (t, v, 1);
+  }
+#endif /* CLASSIFY_USE_SSE */
   return 0;
 }
 
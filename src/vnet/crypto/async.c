@@ -0,0 +1,480 @@
+/*
+ * async.c : asynchronous crypto offload to the crypto workers
+ *
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vnet/vnet.h>
+#include <vnet/api_errno.h>
+#include <vnet/crypto/async.h>
+
+vnet_crypto_async_main_t vnet_crypto_async_main;
+
+vlib_node_registration_t crypto_async_handoff_node;
+vlib_node_registration_t crypto_async_completion_node;
+
+u32
+vnet_crypto_async_register_handler (vlib_main_t * vm, u32 node_index)
+{
+  vnet_crypto_async_main_t *cam = &vnet_crypto_async_main;
+  vnet_crypto_async_handler_t *h;
+  vlib_node_t *n = vlib_get_node (vm, node_index);
+  u32 i;
+
+  vec_add2 (cam->handlers, h, 1);
+  h->node_index = node_index;
+
+  /* the completion node resumes the graph at the handler next nodes */
+  vec_validate_init_empty (h->completion_next_by_next,
+			   vec_len (n->next_nodes) - 1, 0);
+  for (i = 0; i < vec_len (n->next_nodes); i++)
+    if (n->next_nodes[i] != ~0)
+      h->completion_next_by_next[i] =
+	vlib_node_add_next (vm, crypto_async_completion_node.index,
+			    n->next_nodes[i]);
+
+  vec_add1 (cam->frame_queue_index_by_handler, ~0);
+
+  return h - cam->handlers;
+}
+
+int
+vnet_crypto_async_set_workers (vlib_main_t * vm, uword * bitmap)
+{
+  vnet_crypto_async_main_t *cam = &vnet_crypto_async_main;
+  u32 i;
+
+  if (clib_bitmap_last_set (bitmap) != ~0 &&
+      clib_bitmap_last_set (bitmap) >= cam->num_workers)
+    return VNET_API_ERROR_INVALID_WORKER;
+
+  /* every I/O worker being a crypto worker means there is no offload,
+     an empty bitmap disables it */
+  if (clib_bitmap_count_set_bits (bitmap) &&
+      clib_bitmap_count_set_bits (bitmap) == cam->num_workers)
+    return VNET_API_ERROR_INVALID_WORKER;
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  /* the frame queues are drained by the workers, create them once */
+  if (clib_bitmap_last_set (bitmap) != ~0)
+    {
+      for (i = 0; i < vec_len (cam->handlers); i++)
+	if (cam->frame_queue_index_by_handler[i] == ~0)
+	  cam->frame_queue_index_by_handler[i] =
+	    vlib_frame_queue_main_init (cam->handlers[i].node_index,
+					VNET_CRYPTO_ASYNC_FRAME_QUEUE_NELTS);
+      if (cam->completion_frame_queue_index == ~0)
+	cam->completion_frame_queue_index =
+	  vlib_frame_queue_main_init (crypto_async_completion_node.index,
+				      VNET_CRYPTO_ASYNC_FRAME_QUEUE_NELTS);
+    }
+
+  vec_reset_length (cam->workers);
+  clib_bitmap_zero (cam->workers_bitmap);
+
+  /* *INDENT-OFF* */
+  clib_bitmap_foreach (i, bitmap,
+    ({
+      vec_add1 (cam->workers, cam->first_worker_index + i);
+      cam->workers_bitmap =
+	clib_bitmap_set (cam->workers_bitmap, cam->first_worker_index + i, 1);
+    }));
+  /* *INDENT-ON* */
+
+  vlib_worker_thread_barrier_release (vm);
+
+  return 0;
+}
+
+void
+vnet_crypto_async_submit (vlib_main_t * vm, u32 handler_index,
+			  u32 * buffers, u32 * hashes, u32 n_buffers)
+{
+  vnet_crypto_async_main_t *cam = &vnet_crypto_async_main;
+  vnet_crypto_async_per_thread_data_t *ptd;
+  u32 fq_index = cam->frame_queue_index_by_handler[handler_index];
+  u32 n_workers = vec_len (cam->workers);
+  vlib_frame_queue_elt_t *hf;
+  vlib_frame_queue_t *fq0;
+  u32 *drop = 0;
+  u32 i;
+
+  ptd = vec_elt_at_index (cam->per_thread_data, vm->thread_index);
+
+  for (i = 0; i < n_buffers; i++)
+    {
+      vlib_buffer_t *b0 = vlib_get_buffer (vm, buffers[i]);
+      u32 thread0 = cam->workers[hashes[i] % n_workers];
+
+      /* drop rather than wait for a worker which can't keep up */
+      fq0 = is_vlib_frame_queue_congested (fq_index, thread0,
+					   VNET_CRYPTO_ASYNC_FRAME_QUEUE_NELTS
+					   - 2, ptd->congested_queue_by_thread);
+      if (PREDICT_FALSE (fq0 != 0))
+	{
+	  vec_add1 (drop, buffers[i]);
+	  continue;
+	}
+
+      vnet_buffer2 (b0)->crypto_async.thread_index = vm->thread_index;
+
+      hf = vlib_get_worker_handoff_queue_elt (fq_index, thread0,
+					      ptd->elt_by_thread);
+      hf->buffer_index[hf->n_vectors++] = buffers[i];
+
+      if (hf->n_vectors == VLIB_FRAME_SIZE)
+	{
+	  vlib_put_frame_queue_elt (hf);
+	  ptd->elt_by_thread[thread0] = 0;
+	}
+    }
+
+  /* ship the partially filled elements */
+  for (i = 0; i < vec_len (ptd->elt_by_thread); i++)
+    {
+      if (ptd->elt_by_thread[i])
+	{
+	  vlib_put_frame_queue_elt (ptd->elt_by_thread[i]);
+	  ptd->elt_by_thread[i] = 0;
+	}
+      ptd->congested_queue_by_thread[i] = (vlib_frame_queue_t *) (~0);
+    }
+
+  ptd->n_submitted += n_buffers - vec_len (drop);
+  if (PREDICT_FALSE (drop != 0))
+    {
+      ptd->n_dropped += vec_len (drop);
+      vlib_buffer_free (vm, drop, vec_len (drop));
+      vec_free (drop);
+    }
+}
+
+typedef struct
+{
+  u32 thread_index;
+  u32 next_index;
+} crypto_async_trace_t;
+
+static u8 *
+format_crypto_async_trace (u8 * s, va_list * args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  crypto_async_trace_t *t = va_arg (*args, crypto_async_trace_t *);
+
+  s = format (s, "crypto-async: thread %u next_index %u",
+	      t->thread_index, t->next_index);
+  return s;
+}
+
+/*
+ * Runs on the crypto workers: return the processed packets to the
+ * threads they were submitted from.
+ */
+static uword
+crypto_async_handoff_node_fn (vlib_main_t * vm,
+			      vlib_node_runtime_t * node,
+			      vlib_frame_t * frame)
+{
+  vnet_crypto_async_main_t *cam = &vnet_crypto_async_main;
+  vnet_crypto_async_per_thread_data_t *ptd;
+  u32 fq_index = cam->completion_frame_queue_index;
+  u32 n_left_from, *from;
+  vlib_frame_queue_elt_t *hf;
+  u32 i;
+
+  ptd = vec_elt_at_index (cam->per_thread_data, vm->thread_index);
+
+  from = vlib_frame_vector_args (frame);
+  n_left_from = frame->n_vectors;
+
+  while (n_left_from > 0)
+    {
+      u32 bi0 = from[0];
+      vlib_buffer_t *b0 = vlib_get_buffer (vm, bi0);
+      u32 thread0 = vnet_buffer2 (b0)->crypto_async.thread_index;
+
+      from += 1;
+      n_left_from -= 1;
+
+      /* the buffer belongs to the other thread once shipped */
+      if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE)
+			 && (b0->flags & VLIB_BUFFER_IS_TRACED)))
+	{
+	  crypto_async_trace_t *t = vlib_add_trace (vm, node, b0, sizeof (*t));
+	  t->thread_index = thread0;
+	  t->next_index = vnet_buffer2 (b0)->crypto_async.next_index;
+	}
+
+      hf = vlib_get_worker_handoff_queue_elt (fq_index, thread0,
+					      ptd->elt_by_thread);
+      hf->buffer_index[hf->n_vectors++] = bi0;
+
+      if (hf->n_vectors == VLIB_FRAME_SIZE)
+	{
+	  vlib_put_frame_queue_elt (hf);
+	  ptd->elt_by_thread[thread0] = 0;
+	}
+    }
+
+  for (i = 0; i < vec_len (ptd->elt_by_thread); i++)
+    if (ptd->elt_by_thread[i])
+      {
+	vlib_put_frame_queue_elt (ptd->elt_by_thread[i]);
+	ptd->elt_by_thread[i] = 0;
+      }
+
+  ptd->n_processed += frame->n_vectors;
+
+  return frame->n_vectors;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (crypto_async_handoff_node) = {
+  .function = crypto_async_handoff_node_fn,
+  .name = "crypto-async-handoff",
+  .vector_size = sizeof (u32),
+  .format_trace = format_crypto_async_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+
+  .n_next_nodes = 1,
+  .next_nodes = {
+    [0] = "error-drop",
+  },
+};
+/* *INDENT-ON* */
+
+/*
+ * Runs on the threads the packets were submitted from: enqueue the
+ * packets to the next nodes chosen by the handler.
+ */
+static uword
+crypto_async_completion_node_fn (vlib_main_t * vm,
+				 vlib_node_runtime_t * node,
+				 vlib_frame_t * frame)
+{
+  vnet_crypto_async_main_t *cam = &vnet_crypto_async_main;
+  u32 n_left_from, *from, *to_next, next_index;
+
+  from = vlib_frame_vector_args (frame);
+  n_left_from = frame->n_vectors;
+  next_index = node->cached_next_index;
+
+  while (n_left_from > 0)
+    {
+      u32 n_left_to_next;
+
+      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+
+      while (n_left_from > 0 && n_left_to_next > 0)
+	{
+	  u32 bi0, next0;
+	  vlib_buffer_t *b0;
+
+	  bi0 = from[0];
+	  to_next[0] = bi0;
+	  from += 1;
+	  to_next += 1;
+	  n_left_from -= 1;
+	  n_left_to_next -= 1;
+
+	  b0 = vlib_get_buffer (vm, bi0);
+	  next0 = vnet_buffer2 (b0)->crypto_async.next_index;
+
+	  if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE)
+			     && (b0->flags & VLIB_BUFFER_IS_TRACED)))
+	    {
+	      crypto_async_trace_t *t =
+		vlib_add_trace (vm, node, b0, sizeof (*t));
+	      t->thread_index = vm->thread_index;
+	      t->next_index = next0;
+	    }
+
+	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index,
+					   to_next, n_left_to_next,
+					   bi0, next0);
+	}
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+    }
+
+  cam->per_thread_data[vm->thread_index].n_completed += frame->n_vectors;
+
+  return frame->n_vectors;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (crypto_async_completion_node) = {
+  .function = crypto_async_completion_node_fn,
+  .name = "crypto-async-completion",
+  .vector_size = sizeof (u32),
+  .format_trace = format_crypto_async_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+
+  .n_next_nodes = 1,
+  .next_nodes = {
+    [0] = "error-drop",
+  },
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+set_crypto_async_command_fn (vlib_main_t * vm,
+			     unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  uword *bitmap = 0;
+  int is_disable = 0;
+  int rv;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "disable"))
+	is_disable = 1;
+      else if (unformat (input, "workers %U", unformat_bitmap_list, &bitmap))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (is_disable)
+    clib_bitmap_free (bitmap);
+  else if (bitmap == 0)
+    return clib_error_return (0, "Please specify list of workers...");
+
+  rv = vnet_crypto_async_set_workers (vm, bitmap);
+  clib_bitmap_free (bitmap);
+
+  switch (rv)
+    {
+    case 0:
+      break;
+
+    case VNET_API_ERROR_INVALID_WORKER:
+      return clib_error_return (0, "Invalid worker(s)");
+
+    default:
+      return clib_error_return (0, "unknown return value %d", rv);
+    }
+
+  return 0;
+}
+
+/*?
+ * Hand the crypto work of the other workers off to the given workers,
+ * e.g. to run ESP encryption and decryption on dedicated cores while
+ * the I/O workers keep forwarding. The packets of an SA are always
+ * processed by the same crypto worker.
+ *
+ * @cliexpar
+ * @cliexcmd{set crypto async workers 2-3}
+ * @cliexcmd{set crypto async disable}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_crypto_async_command, static) = {
+  .path = "set crypto async",
+  .short_help = "set crypto async [workers <workers-list>] [disable]",
+  .function = set_crypto_async_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_crypto_async_command_fn (vlib_main_t * vm,
+			      unformat_input_t * input,
+			      vlib_cli_command_t * cmd)
+{
+  vnet_crypto_async_main_t *cam = &vnet_crypto_async_main;
+  vnet_crypto_async_per_thread_data_t *ptd;
+  u8 *s = 0;
+  u32 i, *w;
+
+  vec_foreach (w, cam->workers) s = format (s, " %u", w[0]);
+
+  if (vec_len (cam->workers) == 0)
+    vlib_cli_output (vm, "crypto offload disabled");
+  else
+    vlib_cli_output (vm, "crypto worker threads:%v", s);
+  vec_free (s);
+
+  vlib_cli_output (vm, "%=8s%=16s%=16s%=16s%=16s", "thread",
+		   "submitted", "dropped", "processed", "completed");
+  vec_foreach_index (i, cam->per_thread_data)
+  {
+    ptd = &cam->per_thread_data[i];
+    vlib_cli_output (vm, "%=8u%=16lu%=16lu%=16lu%=16lu", i,
+		     ptd->n_submitted, ptd->n_dropped,
+		     ptd->n_processed, ptd->n_completed);
+  }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_crypto_async_command, static) = {
+  .path = "show crypto async",
+  .short_help = "show crypto async",
+  .function = show_crypto_async_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+crypto_async_init (vlib_main_t * vm)
+{
+  vnet_crypto_async_main_t *cam = &vnet_crypto_async_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vnet_crypto_async_per_thread_data_t *ptd;
+  vlib_thread_registration_t *tr;
+  clib_error_t *error;
+  uword *p;
+
+  if ((error = vlib_call_init_function (vm, threads_init)))
+    return error;
+
+  /* Only the standard vnet worker threads are supported */
+  p = hash_get_mem (tm->thread_registrations_by_name, "workers");
+  if (p)
+    {
+      tr = (vlib_thread_registration_t *) p[0];
+      if (tr)
+	{
+	  cam->num_workers = tr->count;
+	  cam->first_worker_index = tr->first_index;
+	}
+    }
+
+  cam->completion_frame_queue_index = ~0;
+
+  vec_validate_aligned (cam->per_thread_data, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+  vec_foreach (ptd, cam->per_thread_data)
+  {
+    vec_validate (ptd->elt_by_thread, tm->n_vlib_mains - 1);
+    vec_validate_init_empty (ptd->congested_queue_by_thread,
+			     tm->n_vlib_mains - 1,
+			     (vlib_frame_queue_t *) (~0));
+  }
+
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (crypto_async_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
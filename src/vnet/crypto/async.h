@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef included_vnet_crypto_async_h
+#define included_vnet_crypto_async_h
+
+#include <vlib/vlib.h>
+#include <vlib/threads.h>
+#include <vnet/buffer.h>
+
+/*
+ * Asynchronous crypto offload.
+ *
+ * A crypto node running on an I/O worker submits its packets to the
+ * crypto workers instead of processing them inline.  The packets reach
+ * the handler node, registered by the crypto node, on a crypto worker
+ * through a frame queue.  The handler does the crypto work, stores the
+ * next node of each packet with vnet_crypto_async_set_next() and sends
+ * it to the crypto-async-handoff node, which returns the packets to the
+ * thread they were submitted from.  There the crypto-async-completion
+ * node resumes the graph.
+ *
+ * The packets submitted with the same hash (e.g. of the same SA) are
+ * always processed by the same crypto worker, so they stay in order.
+ */
+
+#define VNET_CRYPTO_ASYNC_FRAME_QUEUE_NELTS 64
+
+typedef struct
+{
+  /* crypto node run on the crypto workers */
+  u32 node_index;
+
+  /* next index of the completion node by next index of the handler */
+  u32 *completion_next_by_next;
+} vnet_crypto_async_handler_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* frame queue elements being filled, by destination thread */
+  vlib_frame_queue_elt_t **elt_by_thread;
+  vlib_frame_queue_t **congested_queue_by_thread;
+
+  /* packets submitted and dropped on a full queue by the I/O worker */
+  u64 n_submitted;
+  u64 n_dropped;
+  /* packets processed by the crypto worker */
+  u64 n_processed;
+  /* packets returned to the I/O worker */
+  u64 n_completed;
+} vnet_crypto_async_per_thread_data_t;
+
+typedef struct
+{
+  vnet_crypto_async_handler_t *handlers;
+
+  /* frame queues to the handler nodes, by handler index */
+  u32 *frame_queue_index_by_handler;
+
+  /* frame queue to the completion node */
+  u32 completion_frame_queue_index;
+
+  /* thread indices of the crypto workers, no offload if empty */
+  u32 *workers;
+  uword *workers_bitmap;
+
+  vnet_crypto_async_per_thread_data_t *per_thread_data;
+
+  u32 first_worker_index;
+  u32 num_workers;
+} vnet_crypto_async_main_t;
+
+extern vnet_crypto_async_main_t vnet_crypto_async_main;
+
+u32 vnet_crypto_async_register_handler (vlib_main_t * vm, u32 node_index);
+int vnet_crypto_async_set_workers (vlib_main_t * vm, uword * bitmap);
+void vnet_crypto_async_submit (vlib_main_t * vm, u32 handler_index,
+			       u32 * buffers, u32 * hashes, u32 n_buffers);
+
+/* does this thread hand its crypto work off to the crypto workers */
+always_inline int
+vnet_crypto_async_is_offloaded (u32 thread_index)
+{
+  vnet_crypto_async_main_t *cam = &vnet_crypto_async_main;
+
+  /* only the workers drain the frame queues */
+  return (vec_len (cam->workers) && thread_index &&
+	  !clib_bitmap_get (cam->workers_bitmap, thread_index));
+}
+
+/*
+ * Called by the handler on the crypto worker: b0 is to be enqueued to
+ * the handler next next0 on the thread from0 was submitted from.
+ */
+always_inline void
+vnet_crypto_async_set_next (u32 handler_index, vlib_buffer_t * b0,
+			    vlib_buffer_t * from0, u32 next0)
+{
+  vnet_crypto_async_main_t *cam = &vnet_crypto_async_main;
+  vnet_crypto_async_handler_t *h = &cam->handlers[handler_index];
+
+  vnet_buffer2 (b0)->crypto_async.thread_index =
+    vnet_buffer2 (from0)->crypto_async.thread_index;
+  vnet_buffer2 (b0)->crypto_async.next_index =
+    h->completion_next_by_next[next0];
+}
+
+#endif /* included_vnet_crypto_async_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -345,9 +345,14 @@ af_packet_input_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
   foreach_device_and_queue (dq, rt->devices_and_queues)
   {
     af_packet_if_t *apif;
+    u32 n;
     apif = vec_elt_at_index (apm->interfaces, dq->dev_instance);
     if (apif->is_admin_up)
-      n_rx_packets += af_packet_device_input_fn (vm, node, frame, apif);
+      {
+	n = af_packet_device_input_fn (vm, node, frame, apif);
+	dq->n_rx_vectors += n;
+	n_rx_packets += n;
+      }
   }
 
   return n_rx_packets;
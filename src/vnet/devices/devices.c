@@ -332,6 +332,362 @@ vnet_hw_interface_get_rx_mode (vnet_main_t * vnm, u32 hw_if_index,
 
 
 
+static vnet_device_queue_load_t *
+vnet_device_queue_load_get (vnet_device_main_t * vdm, u32 hw_if_index,
+			    u16 queue_id)
+{
+  uword key = ((uword) hw_if_index << 16) | queue_id;
+  vnet_device_queue_load_t *ql;
+  uword *p;
+
+  p = hash_get (vdm->queue_load_by_key, key);
+  if (p)
+    return vec_elt_at_index (vdm->queue_loads, p[0]);
+
+  vec_add2 (vdm->queue_loads, ql, 1);
+  ql->hw_if_index = hw_if_index;
+  ql->queue_id = queue_id;
+  ql->thread_index = ~0;
+  hash_set (vdm->queue_load_by_key, key, ql - vdm->queue_loads);
+  return ql;
+}
+
+/*
+ * Sample the utilization of the workers, from the clocks spent in their
+ * internal nodes, and the rate of each rx queue, over the last dt
+ * seconds.  Input nodes are left out of the utilization since they are
+ * polled whether there is traffic or not.
+ */
+static void
+vnet_device_rx_placement_sample (vlib_main_t * vm, f64 now, f64 dt)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vnet_device_input_runtime_t *rt;
+  vnet_device_and_queue_t *dq;
+  vnet_device_queue_load_t *ql;
+  vnet_hw_interface_t *hw;
+  vlib_main_t *wvm;
+  vlib_node_t *n;
+  uword i, j, q, dq_index;
+  u64 clocks;
+
+  vec_validate (vdm->rx_placement_last_clocks, vec_len (vlib_mains) - 1);
+  vec_validate (vdm->rx_placement_utilization, vec_len (vlib_mains) - 1);
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  for (i = vdm->first_worker_thread_index;
+       i <= vdm->last_worker_thread_index; i++)
+    {
+      wvm = vlib_mains[i];
+      clocks = 0;
+      for (j = 0; j < vec_len (wvm->node_main.nodes); j++)
+	{
+	  n = wvm->node_main.nodes[j];
+	  if (n->type != VLIB_NODE_TYPE_INTERNAL)
+	    continue;
+	  vlib_node_sync_stats (wvm, n);
+	  clocks += n->stats_total.clocks;
+	}
+      vdm->rx_placement_utilization[i] =
+	(f64) (clocks - vdm->rx_placement_last_clocks[i]) /
+	(dt * wvm->clib_time.clocks_per_second);
+      vdm->rx_placement_last_clocks[i] = clocks;
+    }
+
+  /* *INDENT-OFF* */
+  pool_foreach (hw, vnm->interface_main.hw_interfaces,
+  ({
+    for (q = 0; q < vec_len (hw->input_node_thread_index_by_queue); q++)
+      {
+	if (q >= vec_len (hw->rx_mode_by_queue) ||
+	    hw->rx_mode_by_queue[q] == VNET_HW_INTERFACE_RX_MODE_UNKNOWN ||
+	    q >= vec_len (hw->dq_runtime_index_by_queue))
+	  continue;
+
+	i = hw->input_node_thread_index_by_queue[q];
+	rt = vlib_node_get_runtime_data (vlib_mains[i], hw->input_node_index);
+	dq_index = hw->dq_runtime_index_by_queue[q];
+	if (dq_index >= vec_len (rt->devices_and_queues))
+	  continue;
+	dq = rt->devices_and_queues + dq_index;
+	if (dq->hw_if_index != hw->hw_if_index || dq->queue_id != q)
+	  continue;
+
+	ql = vnet_device_queue_load_get (vdm, hw->hw_if_index, q);
+	/* the count restarts when the queue moves */
+	if (ql->thread_index != i || dq->n_rx_vectors < ql->last_n_rx_vectors)
+	  {
+	    ql->thread_index = i;
+	    ql->last_n_rx_vectors = 0;
+	  }
+	ql->rate = (dq->n_rx_vectors - ql->last_n_rx_vectors) / dt;
+	ql->last_n_rx_vectors = dq->n_rx_vectors;
+	ql->last_sample_time = now;
+      }
+  }));
+  /* *INDENT-ON* */
+
+  vlib_worker_thread_barrier_release (vm);
+}
+
+/*
+ * Move one queue from the busiest worker to the least busy one, if they
+ * are far enough apart.  The queue is the one whose share of the busy
+ * worker's load is closest to half the difference, so that the move
+ * narrows the gap without reversing it.
+ */
+static void
+vnet_device_rx_placement_balance (vlib_main_t * vm, f64 now)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vnet_device_queue_load_t *ql, *best = 0;
+  vnet_hw_interface_rx_mode mode;
+  f64 *u = vdm->rx_placement_utilization;
+  f64 gap, share, error, total_rate = 0, best_error = 0;
+  uword i, busiest, idlest;
+
+  if (now - vdm->rx_placement_last_move < vdm->rx_placement_hold_time)
+    return;
+
+  busiest = idlest = vdm->first_worker_thread_index;
+  for (i = vdm->first_worker_thread_index;
+       i <= vdm->last_worker_thread_index; i++)
+    {
+      if (u[i] > u[busiest])
+	busiest = i;
+      if (u[i] < u[idlest])
+	idlest = i;
+    }
+
+  gap = u[busiest] - u[idlest];
+  if (gap < vdm->rx_placement_threshold)
+    return;
+
+  vec_foreach (ql, vdm->queue_loads)
+    if (ql->last_sample_time == now && ql->thread_index == busiest)
+    total_rate += ql->rate;
+
+  if (total_rate == 0)
+    return;
+
+  vec_foreach (ql, vdm->queue_loads)
+  {
+    if (ql->last_sample_time != now || ql->thread_index != busiest ||
+	now - ql->last_move_time < vdm->rx_placement_hold_time)
+      continue;
+    share = u[busiest] * ql->rate / total_rate;
+    if (share == 0 || share >= gap)
+      continue;
+    error = share > gap / 2 ? share - gap / 2 : gap / 2 - share;
+    if (!best || error < best_error)
+      {
+	best = ql;
+	best_error = error;
+      }
+  }
+
+  if (!best)
+    return;
+
+  if (vnet_hw_interface_get_rx_mode (vnm, best->hw_if_index, best->queue_id,
+				     &mode))
+    return;
+  if (vnet_hw_interface_unassign_rx_thread (vnm, best->hw_if_index,
+					    best->queue_id))
+    return;
+  vnet_hw_interface_assign_rx_thread (vnm, best->hw_if_index,
+				      best->queue_id, idlest);
+  vnet_hw_interface_set_rx_mode (vnm, best->hw_if_index, best->queue_id,
+				 mode);
+
+  /* *INDENT-OFF* */
+  ELOG_TYPE_DECLARE (e) =
+  {
+    .format = "rx-placement: hw_if_index %d queue %d thread %d -> %d",
+    .format_args = "i4i4i4i4",
+  };
+  /* *INDENT-ON* */
+  struct
+  {
+    u32 hw_if_index, queue_id, from, to;
+  } *ed;
+  ed = ELOG_DATA (&vm->elog_main, e);
+  ed->hw_if_index = best->hw_if_index;
+  ed->queue_id = best->queue_id;
+  ed->from = busiest;
+  ed->to = idlest;
+
+  best->last_move_time = now;
+  vdm->rx_placement_last_move = now;
+  vdm->rx_placement_n_moves++;
+}
+
+static uword
+vnet_device_rx_placement_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+				  vlib_frame_t * f)
+{
+  vnet_device_main_t *vdm = &vnet_device_main;
+  uword event_type, *event_data = 0;
+  f64 now;
+
+  while (1)
+    {
+      if (vdm->rx_placement_auto)
+	vlib_process_wait_for_event_or_clock (vm, vdm->rx_placement_interval);
+      else
+	vlib_process_wait_for_event (vm);
+
+      event_type = vlib_process_get_events (vm, &event_data);
+      vec_reset_length (event_data);
+
+      if (!vdm->rx_placement_auto)
+	continue;
+
+      now = vlib_time_now (vm);
+      vnet_device_rx_placement_sample (vm, now,
+				       now - vdm->rx_placement_last_sample);
+
+      /* enabled or reconfigured: the first sample is the baseline */
+      if (event_type == ~0 && vdm->rx_placement_last_sample != 0)
+	vnet_device_rx_placement_balance (vm, now);
+      vdm->rx_placement_last_sample = now;
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (vnet_device_rx_placement_process_node, static) = {
+  .function = vnet_device_rx_placement_process,
+  .type = VLIB_NODE_TYPE_PROCESS,
+  .name = "rx-placement-process",
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+set_interface_rx_placement_auto (vlib_main_t * vm, unformat_input_t * input,
+				 vlib_cli_command_t * cmd)
+{
+  vnet_device_main_t *vdm = &vnet_device_main;
+  f64 interval = vdm->rx_placement_interval;
+  f64 hold_time = vdm->rx_placement_hold_time;
+  u32 threshold = vdm->rx_placement_threshold * 100;
+  int enable = -1;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "enable"))
+	enable = 1;
+      else if (unformat (input, "disable"))
+	enable = 0;
+      else if (unformat (input, "interval %f", &interval))
+	;
+      else if (unformat (input, "threshold %u", &threshold))
+	;
+      else if (unformat (input, "hold %f", &hold_time))
+	;
+      else
+	return clib_error_return (0, "parse error: '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (enable == -1)
+    return clib_error_return (0, "please specify enable or disable");
+  if (enable && (vdm->first_worker_thread_index == 0 ||
+		 vdm->last_worker_thread_index ==
+		 vdm->first_worker_thread_index))
+    return clib_error_return (0, "needs two workers or more");
+  if (interval <= 0 || hold_time < 0 || threshold > 100)
+    return clib_error_return (0, "invalid interval, threshold or hold");
+
+  vdm->rx_placement_interval = interval;
+  vdm->rx_placement_hold_time = hold_time;
+  vdm->rx_placement_threshold = threshold / 100.0;
+  vdm->rx_placement_auto = enable;
+  vdm->rx_placement_last_sample = 0;
+
+  vlib_process_signal_event (vm, vnet_device_rx_placement_process_node.index,
+			     /* type */ 1, /* data */ 0);
+  return 0;
+}
+
+/*?
+ * Move rx queues between workers to balance their load. Every
+ * '<em>interval</em>' seconds (default 5) the utilization of each worker
+ * is taken from the clocks its graph nodes spent, and the rate of each
+ * queue from the vectors its input node received. When the busiest and
+ * the least busy worker differ by more than '<em>threshold</em>' percent
+ * (default 20), one queue of the busiest worker moves to the least busy
+ * one. At most one queue moves per '<em>hold</em>' seconds (default 30),
+ * and a queue stays at least that long where it was moved. Moves are
+ * recorded in the event log.
+ *
+ * @cliexpar
+ * @cliexcmd{set interface rx-placement auto enable interval 2 threshold 30}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_interface_rx_placement_auto_command, static) = {
+  .path = "set interface rx-placement auto",
+  .short_help = "set interface rx-placement auto {enable | disable} "
+    "[interval <sec>] [threshold <percent>] [hold <sec>]",
+  .function = set_interface_rx_placement_auto,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_interface_rx_placement_auto (vlib_main_t * vm, unformat_input_t * input,
+				  vlib_cli_command_t * cmd)
+{
+  vnet_main_t *vnm = vnet_get_main ();
+  vnet_device_main_t *vdm = &vnet_device_main;
+  vnet_device_queue_load_t *ql;
+  uword i;
+
+  vlib_cli_output (vm, "auto rx placement %s, interval %.1fs, "
+		   "threshold %.0f%%, hold %.1fs, %llu moves",
+		   vdm->rx_placement_auto ? "enabled" : "disabled",
+		   vdm->rx_placement_interval,
+		   vdm->rx_placement_threshold * 100,
+		   vdm->rx_placement_hold_time, vdm->rx_placement_n_moves);
+
+  if (!vdm->rx_placement_auto || vdm->rx_placement_last_sample == 0)
+    return 0;
+
+  for (i = vdm->first_worker_thread_index;
+       i < vec_len (vdm->rx_placement_utilization) &&
+       i <= vdm->last_worker_thread_index; i++)
+    vlib_cli_output (vm, "Thread %wu (%s): utilization %.1f%%", i,
+		     vlib_worker_threads[i].name,
+		     vdm->rx_placement_utilization[i] * 100);
+
+  vec_foreach (ql, vdm->queue_loads)
+    if (ql->last_sample_time == vdm->rx_placement_last_sample)
+    vlib_cli_output (vm, "  %U queue %u thread %u: %.3e vectors/s",
+		     format_vnet_sw_if_index_name, vnm,
+		     vnet_get_hw_interface (vnm, ql->hw_if_index)->sw_if_index,
+		     ql->queue_id, ql->thread_index, ql->rate);
+
+  return 0;
+}
+
+/*?
+ * Show the state of the automatic rx placement, the worker utilization
+ * and the queue rates it last sampled.
+ *
+ * @cliexpar
+ * @cliexcmd{show interface rx-placement auto}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_interface_rx_placement_auto_command, static) = {
+  .path = "show interface rx-placement auto",
+  .short_help = "show interface rx-placement auto",
+  .function = show_interface_rx_placement_auto,
+};
+/* *INDENT-ON* */
+
 static clib_error_t *
 vnet_device_init (vlib_main_t * vm)
 {
@@ -343,6 +699,11 @@ vnet_device_init (vlib_main_t * vm)
   vec_validate_aligned (vdm->workers, tm->n_vlib_mains - 1,
 			CLIB_CACHE_LINE_BYTES);
 
+  vdm->rx_placement_interval = 5.0;
+  vdm->rx_placement_threshold = 0.2;
+  vdm->rx_placement_hold_time = 30.0;
+  vdm->queue_load_by_key = hash_create (0, sizeof (uword));
+
   p = hash_get_mem (tm->thread_registrations_by_name, "workers");
   tr = p ? (vlib_thread_registration_t *) p[0] : 0;
   if (tr && tr->count > 0)
@@ -47,12 +47,41 @@ typedef struct
   u64 aggregate_rx_packets;
 } vnet_device_per_worker_data_t;
 
+/* Load of an rx queue, sampled by the rx placement balancer */
+typedef struct
+{
+  u32 hw_if_index;
+  u16 queue_id;
+  u32 thread_index;
+  u64 last_n_rx_vectors;
+  /* vectors per second over the last interval */
+  f64 rate;
+  f64 last_sample_time;
+  f64 last_move_time;
+} vnet_device_queue_load_t;
+
 typedef struct
 {
   vnet_device_per_worker_data_t *workers;
   uword first_worker_thread_index;
   uword last_worker_thread_index;
   uword next_worker_thread_index;
+
+  /* Automatic rx placement: every interval, move a queue from the
+     busiest worker to the least busy one when their utilization
+     differs by more than the threshold, at most once per hold time. */
+  u8 rx_placement_auto;
+  f64 rx_placement_interval;
+  f64 rx_placement_threshold;
+  f64 rx_placement_hold_time;
+  f64 rx_placement_last_sample;
+  f64 rx_placement_last_move;
+  u64 rx_placement_n_moves;
+  /* by thread index */
+  u64 *rx_placement_last_clocks;
+  f64 *rx_placement_utilization;
+  vnet_device_queue_load_t *queue_loads;
+  uword *queue_load_by_key;
 } vnet_device_main_t;
 
 typedef struct
@@ -62,6 +91,8 @@ typedef struct
   u16 queue_id;
   vnet_hw_interface_rx_mode mode;
   u32 interrupt_pending;
+  /* vectors received, counted by the input node */
+  u64 n_rx_vectors;
 } vnet_device_and_queue_t;
 
 typedef struct
@@ -97,6 +97,12 @@
  */
 #define VHOST_USER_TX_COPY_THRESHOLD (VHOST_USER_COPY_ARRAY_N - 40)
 
+/*
+ * Default size from which the frames sent to the guest are copied with
+ * non-temporal stores, when enabled on the interface.
+ */
+#define VHOST_USER_LARGE_FRAME_SIZE 2048
+
 #define UNIX_GET_FD(unixfd_idx) \
     (unixfd_idx != ~0) ? \
 	pool_elt_at_index (file_main.file_pool, \
@@ -210,7 +216,8 @@ static_always_inline void *
 map_guest_mem (vhost_user_intf_t * vui, uword addr, u32 * hint)
 {
   int i = *hint;
-  if (PREDICT_TRUE ((vui->regions[i].guest_phys_addr <= addr) &&
+  if (PREDICT_TRUE (i < vui->nregions &&
+		    (vui->regions[i].guest_phys_addr <= addr) &&
 		    ((vui->regions[i].guest_phys_addr +
 		      vui->regions[i].memory_size) > addr)))
     {
@@ -292,6 +299,23 @@ map_user_mem (vhost_user_intf_t * vui, uword addr)
   return 0;
 }
 
+static inline u64
+map_user_mem_to_guest_addr (vhost_user_intf_t * vui, uword addr)
+{
+  int i;
+  for (i = 0; i < vui->nregions; i++)
+    {
+      if ((vui->regions[i].userspace_addr <= addr) &&
+	  ((vui->regions[i].userspace_addr + vui->regions[i].memory_size) >
+	   addr))
+	{
+	  return vui->regions[i].guest_phys_addr + addr -
+	    vui->regions[i].userspace_addr;
+	}
+    }
+  return 0;
+}
+
 static long
 get_huge_page_size (int fd)
 {
@@ -663,6 +687,132 @@ vhost_user_log_dirty_pages (vhost_user_intf_t * vui, u64 addr, u64 len)
                              sizeof(vq->used->member)); \
   }
 
+#define vhost_user_log_dirty_packed_desc(vui, vq, idx) \
+  if (PREDICT_FALSE(vq->log_used)) { \
+    vhost_user_log_dirty_pages(vui, vq->log_desc_guest_addr + \
+                               (idx) * sizeof(vring_packed_desc_t), \
+                               sizeof(vring_packed_desc_t)); \
+  }
+
+/** @brief Tells the driver whether it should kick us for new buffers */
+static_always_inline void
+vhost_user_vring_set_notify (vhost_user_intf_t * vui,
+			     vhost_user_vring_t * vq, u8 enable)
+{
+  if (vhost_user_is_packed_ring_supported (vui))
+    vq->used_event->flags = enable ?
+      VRING_EVENT_F_ENABLE : VRING_EVENT_F_DISABLE;
+  else
+    vq->used->flags = enable ? 0 : VRING_USED_F_NO_NOTIFY;
+}
+
+/** @brief Returns whether the driver wants a call for used buffers */
+static_always_inline int
+vhost_user_vring_want_interrupt (vhost_user_intf_t * vui,
+				 vhost_user_vring_t * vq)
+{
+  if (vhost_user_is_packed_ring_supported (vui))
+    return vq->avail_event->flags != VRING_EVENT_F_DISABLE;
+  return !(vq->avail->flags & VRING_AVAIL_F_NO_INTERRUPT);
+}
+
+/*
+ * Packed ring (virtio 1.1).
+ * The driver makes the descriptors available in ring order, setting their
+ * AVAIL flag to its wrap counter and their USED flag to the opposite.
+ * Chained descriptors follow each other in the ring, the buffer id being
+ * in the last one. The device returns a chain as one used descriptor,
+ * written in the slot of its first descriptor with both flags set to the
+ * device wrap counter. The driver consumes the used descriptors in order,
+ * so they are written once the copies are done, and their flags last.
+ */
+static_always_inline int
+vhost_user_packed_desc_available (vhost_user_vring_t * vq, u16 idx)
+{
+  u16 flags = __atomic_load_n (&vq->packed_desc[idx].flags,
+			       __ATOMIC_ACQUIRE);
+
+  return ((((flags & VIRTQ_DESC_F_AVAIL) != 0) == vq->avail_wrap_counter) &&
+	  (((flags & VIRTQ_DESC_F_USED) != 0) != vq->avail_wrap_counter));
+}
+
+static_always_inline void
+vhost_user_packed_advance_avail (vhost_user_vring_t * vq, u16 n_descs)
+{
+  vq->last_avail_idx += n_descs;
+  if (vq->last_avail_idx > vq->qsz_mask)
+    {
+      vq->last_avail_idx -= vq->qsz_mask + 1;
+      vq->avail_wrap_counter ^= 1;
+    }
+}
+
+/*
+ * Returns the chain at last_avail_idx as used, with len bytes written.
+ * desc_index is the last descriptor of the chain looked at, in the ring
+ * or in the indirect table if n_indirect is set.
+ */
+static_always_inline void
+vhost_user_packed_chain_used (vhost_user_vring_t * vq,
+			      vring_packed_desc_t * desc_table,
+			      u16 desc_index, u16 n_indirect, u16 n_descs,
+			      u32 len, vhost_packed_used_t * used)
+{
+  if (n_indirect)
+    {
+      used->id = vq->packed_desc[vq->last_avail_idx].id;
+      n_descs = 1;
+    }
+  else
+    {
+      /* skip the descriptors left at the end of the chain */
+      while ((desc_table[desc_index].flags & VIRTQ_DESC_F_NEXT) &&
+	     n_descs <= vq->qsz_mask)
+	{
+	  desc_index = (desc_index + 1) & vq->qsz_mask;
+	  n_descs++;
+	}
+      used->id = desc_table[desc_index].id;
+    }
+
+  used->idx = vq->last_used_idx;
+  used->len = len;
+  used->flags = vq->used_wrap_counter ?
+    (VIRTQ_DESC_F_AVAIL | VIRTQ_DESC_F_USED) : 0;
+
+  vq->last_used_idx += n_descs;
+  if (vq->last_used_idx > vq->qsz_mask)
+    {
+      vq->last_used_idx -= vq->qsz_mask + 1;
+      vq->used_wrap_counter ^= 1;
+    }
+  vhost_user_packed_advance_avail (vq, n_descs);
+}
+
+/** @brief Gives the used descriptors back to the driver */
+static_always_inline void
+vhost_user_packed_used_flush (vhost_user_intf_t * vui,
+			      vhost_user_vring_t * vq,
+			      vhost_packed_used_t * used, u32 n_used)
+{
+  u32 i;
+
+  for (i = 0; i < n_used; i++)
+    {
+      vq->packed_desc[used[i].idx].id = used[i].id;
+      vq->packed_desc[used[i].idx].len = used[i].len;
+    }
+
+  /* buffers, ids and lengths must be visible before the flags */
+  CLIB_MEMORY_BARRIER ();
+
+  for (i = 0; i < n_used; i++)
+    {
+      vq->packed_desc[used[i].idx].flags = used[i].flags;
+      vhost_user_log_dirty_packed_desc (vui, vq, used[i].idx);
+    }
+}
+
 static clib_error_t *
 vhost_user_socket_read (clib_file_t * uf)
 {
@@ -771,6 +921,8 @@ vhost_user_socket_read (clib_file_t * uf)
 	(1ULL << FEAT_VIRTIO_NET_F_MQ) |
 	(1ULL << FEAT_VHOST_USER_F_PROTOCOL_FEATURES) |
 	(1ULL << FEAT_VIRTIO_F_VERSION_1);
+      if (vui->enable_packed)
+	msg.u64 |= (1ULL << FEAT_VIRTIO_F_RING_PACKED);
       msg.u64 &= vui->feature_mask;
       msg.size = sizeof (msg.u64);
       DBG_SOCK ("if %d msg VHOST_USER_GET_FEATURES - reply 0x%016llx",
@@ -854,6 +1006,10 @@ vhost_user_socket_read (clib_file_t * uf)
 	  vui->region_mmap_fd[i] = fds[i];
 	}
       vui->nregions = msg.memory.nregions;
+
+      /* the region hints index the old table */
+      for (q = 0; q < VHOST_VRING_MAX_N; q++)
+	vui->vrings[q].map_hint = 0;
       break;
 
     case VHOST_USER_SET_VRING_NUM:
@@ -912,12 +1068,23 @@ vhost_user_socket_read (clib_file_t * uf)
 	  vui->vrings[msg.state.index].enabled = 1;
 	}
 
-      vui->vrings[msg.state.index].last_used_idx =
-	vui->vrings[msg.state.index].last_avail_idx =
-	vui->vrings[msg.state.index].used->idx;
+      if (vhost_user_is_packed_ring_supported (vui))
+	{
+	  vhost_user_vring_t *vq = &vui->vrings[msg.state.index];
+
+	  /* the position was given by VHOST_USER_SET_VRING_BASE */
+	  vq->last_used_idx = vq->last_avail_idx;
+	  vq->used_wrap_counter = vq->avail_wrap_counter;
+	  vq->log_desc_guest_addr =
+	    map_user_mem_to_guest_addr (vui, msg.addr.desc_user_addr);
+	}
+      else
+	vui->vrings[msg.state.index].last_used_idx =
+	  vui->vrings[msg.state.index].last_avail_idx =
+	  vui->vrings[msg.state.index].used->idx;
 
       /* tell driver that we don't want interrupts */
-      vui->vrings[msg.state.index].used->flags = VRING_USED_F_NO_NOTIFY;
+      vhost_user_vring_set_notify (vui, &vui->vrings[msg.state.index], 0);
       break;
 
     case VHOST_USER_SET_OWNER:
@@ -1024,7 +1191,16 @@ vhost_user_socket_read (clib_file_t * uf)
       DBG_SOCK ("if %d msg VHOST_USER_SET_VRING_BASE idx %d num %d",
 		vui->hw_if_index, msg.state.index, msg.state.num);
 
-      vui->vrings[msg.state.index].last_avail_idx = msg.state.num;
+      if (vhost_user_is_packed_ring_supported (vui))
+	{
+	  /* bit 15 is the avail wrap counter of packed rings */
+	  vui->vrings[msg.state.index].last_avail_idx =
+	    msg.state.num & 0x7fff;
+	  vui->vrings[msg.state.index].avail_wrap_counter =
+	    (msg.state.num >> 15) & 1;
+	}
+      else
+	vui->vrings[msg.state.index].last_avail_idx = msg.state.num;
       break;
 
     case VHOST_USER_GET_VRING_BASE:
@@ -1040,6 +1216,8 @@ vhost_user_socket_read (clib_file_t * uf)
        * closing the vring also initializes the vring last_avail_idx
        */
       msg.state.num = vui->vrings[msg.state.index].last_avail_idx;
+      if (vhost_user_is_packed_ring_supported (vui))
+	msg.state.num |= vui->vrings[msg.state.index].avail_wrap_counter << 15;
       msg.flags |= 4;
       msg.size = sizeof (msg.state);
 
@@ -1299,28 +1477,39 @@ vhost_user_rx_trace (vhost_trace_t * t,
 {
   vhost_user_main_t *vum = &vhost_user_main;
   u32 last_avail_idx = txvq->last_avail_idx;
-  u32 desc_current = txvq->avail->ring[last_avail_idx & txvq->qsz_mask];
   vring_desc_t *hdr_desc = 0;
   virtio_net_hdr_mrg_rxbuf_t *hdr;
   u32 hint = 0;
+  u16 flags;
 
   memset (t, 0, sizeof (*t));
   t->device_index = vui - vum->vhost_user_interfaces;
   t->qid = qid;
 
-  hdr_desc = &txvq->desc[desc_current];
-  if (txvq->desc[desc_current].flags & VIRTQ_DESC_F_INDIRECT)
+  /* addr and len are at the same offsets in packed descriptors */
+  if (vhost_user_is_packed_ring_supported (vui))
+    {
+      hdr_desc = (vring_desc_t *) & txvq->packed_desc[last_avail_idx];
+      flags = txvq->packed_desc[last_avail_idx].flags;
+    }
+  else
+    {
+      hdr_desc =
+	&txvq->desc[txvq->avail->ring[last_avail_idx & txvq->qsz_mask]];
+      flags = hdr_desc->flags;
+    }
+
+  if (flags & VIRTQ_DESC_F_INDIRECT)
     {
       t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_INDIRECT;
       /* Header is the first here */
-      hdr_desc = map_guest_mem (vui, txvq->desc[desc_current].addr, &hint);
+      hdr_desc = map_guest_mem (vui, hdr_desc->addr, &hint);
     }
-  if (txvq->desc[desc_current].flags & VIRTQ_DESC_F_NEXT)
+  if (flags & VIRTQ_DESC_F_NEXT)
     {
       t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_SIMPLE_CHAINED;
     }
-  if (!(txvq->desc[desc_current].flags & VIRTQ_DESC_F_NEXT) &&
-      !(txvq->desc[desc_current].flags & VIRTQ_DESC_F_INDIRECT))
+  if (!(flags & VIRTQ_DESC_F_NEXT) && !(flags & VIRTQ_DESC_F_INDIRECT))
     {
       t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_SINGLE_DESC;
     }
@@ -1478,9 +1667,10 @@ vhost_user_if_input (vlib_main_t * vm,
   u32 n_left_to_next, *to_next;
   u32 next_index = VNET_DEVICE_INPUT_NEXT_ETHERNET_INPUT;
   u32 n_trace = vlib_get_trace_count (vm, node);
-  u32 map_hint = 0;
+  u32 map_hint = txvq->map_hint;
   u16 thread_index = vlib_get_thread_index ();
   u16 copy_len = 0;
+  u16 i;
 
   {
     /* do we have pending interrupts ? */
@@ -1550,6 +1740,12 @@ vhost_user_if_input (vlib_main_t * vm,
   if (n_left > VLIB_FRAME_SIZE)
     n_left = VLIB_FRAME_SIZE;
 
+  /* The avail ring entries of the burst are read one after the other */
+  for (i = 0; i < n_left; i += CLIB_CACHE_LINE_BYTES / sizeof (u16))
+    CLIB_PREFETCH (&txvq->avail->ring[(txvq->last_avail_idx + i) &
+				      txvq->qsz_mask],
+		   CLIB_CACHE_LINE_BYTES, LOAD);
+
   /*
    * For small packets (<2kB), we will not need more than one vlib buffer
    * per packet. In case packets are bigger, we will just yeld at some point
@@ -1615,6 +1811,21 @@ vhost_user_if_input (vlib_main_t * vm,
 
 	  desc_current =
 	    txvq->avail->ring[txvq->last_avail_idx & txvq->qsz_mask];
+
+	  /*
+	   * Prefetch the head descriptor of the next packet, and the used
+	   * ring entries ahead once per cache line.
+	   */
+	  if (PREDICT_TRUE (n_left > 1))
+	    CLIB_PREFETCH (&txvq->desc[txvq->avail->ring
+				       [(txvq->last_avail_idx + 1) &
+					txvq->qsz_mask] & txvq->qsz_mask],
+			   sizeof (vring_desc_t), LOAD);
+	  if ((txvq->last_used_idx & 7) == 0)
+	    CLIB_PREFETCH (&txvq->used->ring[(txvq->last_used_idx + 8) &
+					     txvq->qsz_mask],
+			   CLIB_CACHE_LINE_BYTES, STORE);
+
 	  vum->cpus[thread_index].rx_buffers_len--;
 	  bi_current = (vum->cpus[thread_index].rx_buffers)
 	    [vum->cpus[thread_index].rx_buffers_len];
@@ -1836,6 +2047,8 @@ vhost_user_if_input (vlib_main_t * vm,
 	vhost_user_send_call (vm, txvq);
     }
 
+  txvq->map_hint = map_hint;
+
   /* increase rx counters */
   vlib_increment_combined_counter
     (vnet_main.interface_main.combined_sw_if_counters
@@ -1847,141 +2060,863 @@ vhost_user_if_input (vlib_main_t * vm,
   return n_rx_packets;
 }
 
-static uword
-vhost_user_input (vlib_main_t * vm,
-		  vlib_node_runtime_t * node, vlib_frame_t * f)
+/**
+ * Try to discard packets from the packed tx ring (VPP RX path).
+ * Returns the number of discarded packets.
+ */
+static u32
+vhost_user_rx_discard_packet_packed (vlib_main_t * vm,
+				     vhost_user_intf_t * vui,
+				     vhost_user_vring_t * txvq,
+				     u32 discard_max)
 {
-  vhost_user_main_t *vum = &vhost_user_main;
-  uword n_rx_packets = 0;
-  vhost_user_intf_t *vui;
-  vnet_device_input_runtime_t *rt =
-    (vnet_device_input_runtime_t *) node->runtime_data;
-  vnet_device_and_queue_t *dq;
-
-  vec_foreach (dq, rt->devices_and_queues)
-  {
-    if (clib_smp_swap (&dq->interrupt_pending, 0) ||
-	(node->state == VLIB_NODE_STATE_POLLING))
-      {
-	vui =
-	  pool_elt_at_index (vum->vhost_user_interfaces, dq->dev_instance);
-	n_rx_packets = vhost_user_if_input (vm, vum, vui, dq->queue_id, node,
-					    dq->mode);
-      }
-  }
+  vhost_packed_used_t *used =
+    vhost_user_main.cpus[vm->thread_index].packed_used;
+  u32 discarded_packets = 0;
 
-  return n_rx_packets;
-}
+  while (discarded_packets != discard_max &&
+	 vhost_user_packed_desc_available (txvq, txvq->last_avail_idx))
+    {
+      vring_packed_desc_t *desc = &txvq->packed_desc[txvq->last_avail_idx];
 
-/* *INDENT-OFF* */
-VLIB_REGISTER_NODE (vhost_user_input_node) = {
-  .function = vhost_user_input,
-  .type = VLIB_NODE_TYPE_INPUT,
-  .name = "vhost-user-input",
-  .sibling_of = "device-input",
+      vhost_user_packed_chain_used (txvq, txvq->packed_desc,
+				    txvq->last_avail_idx,
+				    desc->flags & VIRTQ_DESC_F_INDIRECT, 1,
+				    0, &used[discarded_packets]);
+      discarded_packets++;
+    }
 
-  /* Will be enabled if/when hardware is detected. */
-  .state = VLIB_NODE_STATE_DISABLED,
+  vhost_user_packed_used_flush (vui, txvq, used, discarded_packets);
+  return discarded_packets;
+}
 
-  .format_buffer = format_ethernet_header_with_length,
-  .format_trace = format_vhost_trace,
+static u32
+vhost_user_if_input_packed (vlib_main_t * vm,
+			    vhost_user_main_t * vum,
+			    vhost_user_intf_t * vui,
+			    u16 qid, vlib_node_runtime_t * node,
+			    vnet_hw_interface_rx_mode mode)
+{
+  vhost_user_vring_t *txvq = &vui->vrings[VHOST_VRING_IDX_TX (qid)];
+  u16 n_rx_packets = 0;
+  u32 n_rx_bytes = 0;
+  u16 n_left = VLIB_FRAME_SIZE;
+  u32 n_left_to_next, *to_next;
+  u32 next_index = VNET_DEVICE_INPUT_NEXT_ETHERNET_INPUT;
+  u32 n_trace = vlib_get_trace_count (vm, node);
+  u32 map_hint = txvq->map_hint;
+  u16 thread_index = vlib_get_thread_index ();
+  vhost_cpu_t *cpu = &vum->cpus[thread_index];
+  u16 copy_len = 0;
+  u32 n_used = 0;
 
-  .n_errors = VHOST_USER_INPUT_FUNC_N_ERROR,
-  .error_strings = vhost_user_input_func_error_strings,
-};
+  {
+    /* do we have pending interrupts ? */
+    vhost_user_vring_t *rxvq = &vui->vrings[VHOST_VRING_IDX_RX (qid)];
+    f64 now = vlib_time_now (vm);
 
-VLIB_NODE_FUNCTION_MULTIARCH (vhost_user_input_node, vhost_user_input)
-/* *INDENT-ON* */
+    if ((txvq->n_since_last_int) && (txvq->int_deadline < now))
+      vhost_user_send_call (vm, txvq);
 
+    if ((rxvq->n_since_last_int) && (rxvq->int_deadline < now))
+      vhost_user_send_call (vm, rxvq);
+  }
 
-void
-vhost_user_tx_trace (vhost_trace_t * t,
-		     vhost_user_intf_t * vui, u16 qid,
-		     vlib_buffer_t * b, vhost_user_vring_t * rxvq)
-{
-  vhost_user_main_t *vum = &vhost_user_main;
-  u32 last_avail_idx = rxvq->last_avail_idx;
-  u32 desc_current = rxvq->avail->ring[last_avail_idx & rxvq->qsz_mask];
-  vring_desc_t *hdr_desc = 0;
-  u32 hint = 0;
+  /* See vhost_user_if_input () */
+  if (PREDICT_FALSE (mode == VNET_HW_INTERFACE_RX_MODE_ADAPTIVE))
+    vhost_user_vring_set_notify
+      (vui, txvq,
+       (node->flags & VLIB_NODE_FLAG_SWITCH_FROM_POLLING_TO_INTERRUPT_MODE)
+       || !(node->flags &
+	    VLIB_NODE_FLAG_SWITCH_FROM_INTERRUPT_TO_POLLING_MODE));
 
-  memset (t, 0, sizeof (*t));
-  t->device_index = vui - vum->vhost_user_interfaces;
-  t->qid = qid;
+  /* nothing to do */
+  if (!vhost_user_packed_desc_available (txvq, txvq->last_avail_idx))
+    return 0;
 
-  hdr_desc = &rxvq->desc[desc_current];
-  if (rxvq->desc[desc_current].flags & VIRTQ_DESC_F_INDIRECT)
-    {
-      t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_INDIRECT;
-      /* Header is the first here */
-      hdr_desc = map_guest_mem (vui, rxvq->desc[desc_current].addr, &hint);
-    }
-  if (rxvq->desc[desc_current].flags & VIRTQ_DESC_F_NEXT)
+  if (PREDICT_FALSE (!vui->admin_up || !(txvq->enabled)))
     {
-      t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_SIMPLE_CHAINED;
+      vhost_user_rx_discard_packet_packed (vm, vui, txvq,
+					   VHOST_USER_DOWN_DISCARD_COUNT);
+      return 0;
     }
-  if (!(rxvq->desc[desc_current].flags & VIRTQ_DESC_F_NEXT) &&
-      !(rxvq->desc[desc_current].flags & VIRTQ_DESC_F_INDIRECT))
+
+  /* See vhost_user_if_input (), the number of packets is not known */
+  if (PREDICT_FALSE (cpu->rx_buffers_len < n_left + 1 ||
+		     cpu->rx_buffers_len < 40))
     {
-      t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_SINGLE_DESC;
-    }
+      u32 curr_len = cpu->rx_buffers_len;
+      cpu->rx_buffers_len +=
+	vlib_buffer_alloc_from_free_list (vm, cpu->rx_buffers + curr_len,
+					  VHOST_USER_RX_BUFFERS_N - curr_len,
+					  VLIB_BUFFER_DEFAULT_FREE_LIST_INDEX);
 
-  t->first_desc_len = hdr_desc ? hdr_desc->len : 0;
-}
+      if (PREDICT_FALSE (cpu->rx_buffers_len <
+			 VHOST_USER_RX_BUFFER_STARVATION))
+	{
+	  u32 flush = VHOST_USER_RX_BUFFER_STARVATION - cpu->rx_buffers_len;
+	  flush = vhost_user_rx_discard_packet_packed (vm, vui, txvq, flush);
 
-static_always_inline u32
-vhost_user_tx_copy (vhost_user_intf_t * vui, vhost_copy_t * cpy,
-		    u16 copy_len, u32 * map_hint)
-{
-  void *dst0, *dst1, *dst2, *dst3;
-  if (PREDICT_TRUE (copy_len >= 4))
+	  vlib_increment_simple_counter (vnet_main.
+					 interface_main.sw_if_counters +
+					 VNET_INTERFACE_COUNTER_DROP,
+					 vlib_get_thread_index (),
+					 vui->sw_if_index, flush);
+
+	  vlib_error_count (vm, vhost_user_input_node.index,
+			    VHOST_USER_INPUT_FUNC_ERROR_NO_BUFFER, flush);
+	}
+    }
+
+  while (n_left > 0)
     {
-      if (PREDICT_FALSE (!(dst2 = map_guest_mem (vui, cpy[0].dst, map_hint))))
-	return 1;
-      if (PREDICT_FALSE (!(dst3 = map_guest_mem (vui, cpy[1].dst, map_hint))))
-	return 1;
-      while (PREDICT_TRUE (copy_len >= 4))
+      vlib_get_next_frame (vm, node, next_index, to_next, n_left_to_next);
+
+      while (n_left > 0 && n_left_to_next > 0)
 	{
-	  dst0 = dst2;
-	  dst1 = dst3;
+	  vlib_buffer_t *b_head, *b_current;
+	  u32 bi_current;
+	  u16 desc_current, n_indirect = 0, n_descs = 1;
+	  u32 desc_data_offset;
+	  vring_packed_desc_t *desc_table = txvq->packed_desc;
 
-	  if (PREDICT_FALSE
-	      (!(dst2 = map_guest_mem (vui, cpy[2].dst, map_hint))))
-	    return 1;
-	  if (PREDICT_FALSE
-	      (!(dst3 = map_guest_mem (vui, cpy[3].dst, map_hint))))
-	    return 1;
+	  if (!vhost_user_packed_desc_available (txvq, txvq->last_avail_idx))
+	    {
+	      n_left = 0;
+	      break;
+	    }
 
-	  CLIB_PREFETCH ((void *) cpy[2].src, 64, LOAD);
-	  CLIB_PREFETCH ((void *) cpy[3].src, 64, LOAD);
+	  if (PREDICT_FALSE (cpu->rx_buffers_len <= 1))
+	    {
+	      /* Not enough rx_buffers */
+	      n_left = 0;
+	      break;
+	    }
 
-	  clib_memcpy (dst0, (void *) cpy[0].src, cpy[0].len);
-	  clib_memcpy (dst1, (void *) cpy[1].src, cpy[1].len);
+	  desc_current = txvq->last_avail_idx;
 
-	  vhost_user_log_dirty_pages_2 (vui, cpy[0].dst, cpy[0].len, 1);
-	  vhost_user_log_dirty_pages_2 (vui, cpy[1].dst, cpy[1].len, 1);
-	  copy_len -= 2;
-	  cpy += 2;
-	}
-    }
-  while (copy_len)
-    {
-      if (PREDICT_FALSE (!(dst0 = map_guest_mem (vui, cpy->dst, map_hint))))
-	return 1;
-      clib_memcpy (dst0, (void *) cpy->src, cpy->len);
-      vhost_user_log_dirty_pages_2 (vui, cpy->dst, cpy->len, 1);
-      copy_len -= 1;
-      cpy += 1;
-    }
-  return 0;
-}
+	  /* the descriptors of the next packets follow in the ring */
+	  CLIB_PREFETCH (&txvq->packed_desc[(desc_current + 4) &
+					    txvq->qsz_mask],
+			 CLIB_CACHE_LINE_BYTES, LOAD);
 
+	  cpu->rx_buffers_len--;
+	  bi_current = cpu->rx_buffers[cpu->rx_buffers_len];
+	  b_head = b_current = vlib_get_buffer (vm, bi_current);
+	  to_next[0] = bi_current;	//We do that now so we can forget about bi_current
+	  to_next++;
+	  n_left_to_next--;
 
-static uword
-vhost_user_tx (vlib_main_t * vm,
-	       vlib_node_runtime_t * node, vlib_frame_t * frame)
-{
-  u32 *buffers = vlib_frame_args (frame);
+	  vlib_prefetch_buffer_with_index
+	    (vm, cpu->rx_buffers[cpu->rx_buffers_len - 1], LOAD);
+
+	  /* The buffer should already be initialized */
+	  b_head->total_length_not_including_first_buffer = 0;
+	  b_head->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
+
+	  if (PREDICT_FALSE (n_trace))
+	    {
+	      vlib_trace_buffer (vm, node, next_index, b_head,
+				 /* follow_chain */ 0);
+	      vhost_trace_t *t0 =
+		vlib_add_trace (vm, node, b_head, sizeof (t0[0]));
+	      vhost_user_rx_trace (t0, vui, qid, b_head, txvq);
+	      n_trace--;
+	      vlib_set_trace_count (vm, node, n_trace);
+	    }
+
+	  if (desc_table[desc_current].flags & VIRTQ_DESC_F_INDIRECT)
+	    {
+	      n_indirect = desc_table[desc_current].len /
+		sizeof (vring_packed_desc_t);
+	      desc_table = map_guest_mem (vui, desc_table[desc_current].addr,
+					  &map_hint);
+	      desc_current = 0;
+	      if (PREDICT_FALSE (desc_table == 0 || n_indirect == 0))
+		{
+		  vlib_error_count (vm, node->node_index,
+				    VHOST_USER_INPUT_FUNC_ERROR_MMAP_FAIL, 1);
+		  /* at least one, to return the ring slot */
+		  n_indirect = 1;
+		  goto out;
+		}
+	    }
+
+	  /* VIRTIO_F_VERSION_1 is required, which implies ANY_LAYOUT */
+	  desc_data_offset = vui->virtio_net_hdr_sz;
+
+	  while (1)
+	    {
+	      /* Get more input if necessary. Or end of packet. */
+	      if (desc_data_offset >= desc_table[desc_current].len)
+		{
+		  if (n_indirect && desc_current + 1 < n_indirect)
+		    desc_current++;
+		  else if (!n_indirect &&
+			   (desc_table[desc_current].flags &
+			    VIRTQ_DESC_F_NEXT) && n_descs <= txvq->qsz_mask)
+		    {
+		      desc_current = (desc_current + 1) & txvq->qsz_mask;
+		      n_descs++;
+		    }
+		  else
+		    goto out;
+		  desc_data_offset = 0;
+		  continue;
+		}
+
+	      /* Get more output if necessary. Or end of packet. */
+	      if (PREDICT_FALSE
+		  (b_current->current_length == VLIB_BUFFER_DATA_SIZE))
+		{
+		  if (PREDICT_FALSE (cpu->rx_buffers_len == 0))
+		    {
+		      /* Cancel speculation, the ring was not touched */
+		      to_next--;
+		      n_left_to_next++;
+		      vhost_user_input_rewind_buffers (vm, cpu, b_head);
+		      n_left = 0;
+		      goto stop;
+		    }
+
+		  /* Get next output */
+		  cpu->rx_buffers_len--;
+		  u32 bi_next = cpu->rx_buffers[cpu->rx_buffers_len];
+		  b_current->next_buffer = bi_next;
+		  b_current->flags |= VLIB_BUFFER_NEXT_PRESENT;
+		  bi_current = bi_next;
+		  b_current = vlib_get_buffer (vm, bi_current);
+		}
+
+	      /* Prepare a copy order executed later for the data */
+	      vhost_copy_t *cpy = &cpu->copy[copy_len];
+	      copy_len++;
+	      u32 desc_data_l =
+		desc_table[desc_current].len - desc_data_offset;
+	      cpy->len = VLIB_BUFFER_DATA_SIZE - b_current->current_length;
+	      cpy->len = (cpy->len > desc_data_l) ? desc_data_l : cpy->len;
+	      cpy->dst = (uword) (vlib_buffer_get_current (b_current) +
+				  b_current->current_length);
+	      cpy->src = desc_table[desc_current].addr + desc_data_offset;
+
+	      desc_data_offset += cpy->len;
+
+	      b_current->current_length += cpy->len;
+	      b_head->total_length_not_including_first_buffer += cpy->len;
+	    }
+
+	out:
+	  n_rx_bytes += b_head->total_length_not_including_first_buffer;
+	  n_rx_packets++;
+
+	  b_head->total_length_not_including_first_buffer -=
+	    b_head->current_length;
+
+	  /* consume the descriptors and return them as used */
+	  vhost_user_packed_chain_used (txvq, desc_table, desc_current,
+					n_indirect, n_descs, 0,
+					&cpu->packed_used[n_used]);
+	  n_used++;
+
+	  VLIB_BUFFER_TRACE_TRAJECTORY_INIT (b_head);
+
+	  vnet_buffer (b_head)->sw_if_index[VLIB_RX] = vui->sw_if_index;
+	  vnet_buffer (b_head)->sw_if_index[VLIB_TX] = (u32) ~ 0;
+	  b_head->error = 0;
+
+	  {
+	    u32 next0 = VNET_DEVICE_INPUT_NEXT_ETHERNET_INPUT;
+
+	    /* redirect if feature path enabled */
+	    vnet_feature_start_device_input_x1 (vui->sw_if_index, &next0,
+						b_head);
+
+	    u32 bi = to_next[-1];	//Cannot use to_next[-1] in the macro
+	    vlib_validate_buffer_enqueue_x1 (vm, node, next_index,
+					     to_next, n_left_to_next,
+					     bi, next0);
+	  }
+
+	  n_left--;
+
+	  /* See vhost_user_if_input () */
+	  if (PREDICT_FALSE (copy_len >= VHOST_USER_RX_COPY_THRESHOLD))
+	    {
+	      if (PREDICT_FALSE
+		  (vhost_user_input_copy (vui, cpu->copy, copy_len,
+					  &map_hint)))
+		{
+		  vlib_error_count (vm, node->node_index,
+				    VHOST_USER_INPUT_FUNC_ERROR_MMAP_FAIL, 1);
+		}
+	      copy_len = 0;
+
+	      /* give buffers back to driver */
+	      vhost_user_packed_used_flush (vui, txvq, cpu->packed_used,
+					    n_used);
+	      n_used = 0;
+	    }
+	}
+    stop:
+      vlib_put_next_frame (vm, node, next_index, n_left_to_next);
+    }
+
+  /* Do the memory copies */
+  if (PREDICT_FALSE
+      (vhost_user_input_copy (vui, cpu->copy, copy_len, &map_hint)))
+    {
+      vlib_error_count (vm, node->node_index,
+			VHOST_USER_INPUT_FUNC_ERROR_MMAP_FAIL, 1);
+    }
+
+  /* give buffers back to driver */
+  vhost_user_packed_used_flush (vui, txvq, cpu->packed_used, n_used);
+
+  /* interrupt (call) handling */
+  if ((txvq->callfd_idx != ~0) &&
+      vhost_user_vring_want_interrupt (vui, txvq))
+    {
+      txvq->n_since_last_int += n_rx_packets;
+
+      if (txvq->n_since_last_int > vum->coalesce_frames)
+	vhost_user_send_call (vm, txvq);
+    }
+
+  txvq->map_hint = map_hint;
+
+  /* increase rx counters */
+  vlib_increment_combined_counter
+    (vnet_main.interface_main.combined_sw_if_counters
+     + VNET_INTERFACE_COUNTER_RX,
+     vlib_get_thread_index (), vui->sw_if_index, n_rx_packets, n_rx_bytes);
+
+  vnet_device_increment_rx_packets (thread_index, n_rx_packets);
+
+  return n_rx_packets;
+}
+
+static uword
+vhost_user_input (vlib_main_t * vm,
+		  vlib_node_runtime_t * node, vlib_frame_t * f)
+{
+  vhost_user_main_t *vum = &vhost_user_main;
+  uword n_rx_packets = 0;
+  vhost_user_intf_t *vui;
+  vnet_device_input_runtime_t *rt =
+    (vnet_device_input_runtime_t *) node->runtime_data;
+  vnet_device_and_queue_t *dq;
+
+  vec_foreach (dq, rt->devices_and_queues)
+  {
+    if (clib_smp_swap (&dq->interrupt_pending, 0) ||
+	(node->state == VLIB_NODE_STATE_POLLING))
+      {
+	uword n;
+	vui =
+	  pool_elt_at_index (vum->vhost_user_interfaces, dq->dev_instance);
+	if (vhost_user_is_packed_ring_supported (vui))
+	  n = vhost_user_if_input_packed (vm, vum, vui, dq->queue_id, node,
+					  dq->mode);
+	else
+	  n = vhost_user_if_input (vm, vum, vui, dq->queue_id, node,
+				   dq->mode);
+	dq->n_rx_vectors += n;
+	n_rx_packets += n;
+      }
+  }
+
+  return n_rx_packets;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (vhost_user_input_node) = {
+  .function = vhost_user_input,
+  .type = VLIB_NODE_TYPE_INPUT,
+  .name = "vhost-user-input",
+  .sibling_of = "device-input",
+
+  /* Will be enabled if/when hardware is detected. */
+  .state = VLIB_NODE_STATE_DISABLED,
+
+  .format_buffer = format_ethernet_header_with_length,
+  .format_trace = format_vhost_trace,
+
+  .n_errors = VHOST_USER_INPUT_FUNC_N_ERROR,
+  .error_strings = vhost_user_input_func_error_strings,
+};
+
+VLIB_NODE_FUNCTION_MULTIARCH (vhost_user_input_node, vhost_user_input)
+/* *INDENT-ON* */
+
+
+void
+vhost_user_tx_trace (vhost_trace_t * t,
+		     vhost_user_intf_t * vui, u16 qid,
+		     vlib_buffer_t * b, vhost_user_vring_t * rxvq)
+{
+  vhost_user_main_t *vum = &vhost_user_main;
+  u32 last_avail_idx = rxvq->last_avail_idx;
+  vring_desc_t *hdr_desc = 0;
+  u32 hint = 0;
+  u16 flags;
+
+  memset (t, 0, sizeof (*t));
+  t->device_index = vui - vum->vhost_user_interfaces;
+  t->qid = qid;
+
+  /* addr and len are at the same offsets in packed descriptors */
+  if (vhost_user_is_packed_ring_supported (vui))
+    {
+      hdr_desc = (vring_desc_t *) & rxvq->packed_desc[last_avail_idx];
+      flags = rxvq->packed_desc[last_avail_idx].flags;
+    }
+  else
+    {
+      hdr_desc =
+	&rxvq->desc[rxvq->avail->ring[last_avail_idx & rxvq->qsz_mask]];
+      flags = hdr_desc->flags;
+    }
+
+  if (flags & VIRTQ_DESC_F_INDIRECT)
+    {
+      t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_INDIRECT;
+      /* Header is the first here */
+      hdr_desc = map_guest_mem (vui, hdr_desc->addr, &hint);
+    }
+  if (flags & VIRTQ_DESC_F_NEXT)
+    {
+      t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_SIMPLE_CHAINED;
+    }
+  if (!(flags & VIRTQ_DESC_F_NEXT) && !(flags & VIRTQ_DESC_F_INDIRECT))
+    {
+      t->virtio_ring_flags |= 1 << VIRTIO_TRACE_F_SINGLE_DESC;
+    }
+
+  t->first_desc_len = hdr_desc ? hdr_desc->len : 0;
+}
+
+/*
+ * Copy of large frames to the guest with non-temporal stores: the data is
+ * read by the guest on another core, filling the cache of this one with
+ * it only evicts the packets still to be processed. The streamed part
+ * starts on a cache line boundary, so that the write-combining buffers
+ * are flushed as full lines. The stores are weakly ordered,
+ * vhost_user_tx_copy () fences them before the descriptors are given back.
+ */
+static_always_inline void
+vhost_user_memcpy_nt (void *dst, void *src, u32 len)
+{
+#ifdef __SSE2__
+  u8 *d = dst, *s = src;
+  u32 head = (-pointer_to_uword (d)) & (CLIB_CACHE_LINE_BYTES - 1);
+
+  if (len < head + 64)
+    {
+      clib_memcpy (d, s, len);
+      return;
+    }
+
+  clib_memcpy (d, s, head);
+  d += head;
+  s += head;
+  len -= head;
+
+  while (len >= 64)
+    {
+      __m128i x0 = _mm_loadu_si128 ((__m128i *) s + 0);
+      __m128i x1 = _mm_loadu_si128 ((__m128i *) s + 1);
+      __m128i x2 = _mm_loadu_si128 ((__m128i *) s + 2);
+      __m128i x3 = _mm_loadu_si128 ((__m128i *) s + 3);
+      _mm_stream_si128 ((__m128i *) d + 0, x0);
+      _mm_stream_si128 ((__m128i *) d + 1, x1);
+      _mm_stream_si128 ((__m128i *) d + 2, x2);
+      _mm_stream_si128 ((__m128i *) d + 3, x3);
+      d += 64;
+      s += 64;
+      len -= 64;
+    }
+
+  clib_memcpy (d, s, len);
+#else
+  clib_memcpy (dst, src, len);
+#endif
+}
+
+static_always_inline void
+vhost_user_tx_memcpy (void *dst, vhost_copy_t * cpy)
+{
+  if (PREDICT_FALSE (cpy->non_temporal))
+    vhost_user_memcpy_nt (dst, (void *) cpy->src, cpy->len);
+  else
+    clib_memcpy (dst, (void *) cpy->src, cpy->len);
+}
+
+static_always_inline u32
+vhost_user_tx_copy (vhost_user_intf_t * vui, vhost_copy_t * cpy,
+		    u16 copy_len, u32 * map_hint)
+{
+  void *dst0, *dst1, *dst2, *dst3;
+  u32 rv = 1;
+
+  if (PREDICT_TRUE (copy_len >= 4))
+    {
+      if (PREDICT_FALSE (!(dst2 = map_guest_mem (vui, cpy[0].dst, map_hint))))
+	goto done;
+      if (PREDICT_FALSE (!(dst3 = map_guest_mem (vui, cpy[1].dst, map_hint))))
+	goto done;
+      while (PREDICT_TRUE (copy_len >= 4))
+	{
+	  dst0 = dst2;
+	  dst1 = dst3;
+
+	  if (PREDICT_FALSE
+	      (!(dst2 = map_guest_mem (vui, cpy[2].dst, map_hint))))
+	    goto done;
+	  if (PREDICT_FALSE
+	      (!(dst3 = map_guest_mem (vui, cpy[3].dst, map_hint))))
+	    goto done;
+
+	  CLIB_PREFETCH ((void *) cpy[2].src, 64, LOAD);
+	  CLIB_PREFETCH ((void *) cpy[3].src, 64, LOAD);
+
+	  vhost_user_tx_memcpy (dst0, &cpy[0]);
+	  vhost_user_tx_memcpy (dst1, &cpy[1]);
+
+	  vhost_user_log_dirty_pages_2 (vui, cpy[0].dst, cpy[0].len, 1);
+	  vhost_user_log_dirty_pages_2 (vui, cpy[1].dst, cpy[1].len, 1);
+	  copy_len -= 2;
+	  cpy += 2;
+	}
+    }
+  while (copy_len)
+    {
+      if (PREDICT_FALSE (!(dst0 = map_guest_mem (vui, cpy->dst, map_hint))))
+	goto done;
+      vhost_user_tx_memcpy (dst0, cpy);
+      vhost_user_log_dirty_pages_2 (vui, cpy->dst, cpy->len, 1);
+      copy_len -= 1;
+      cpy += 1;
+    }
+  rv = 0;
+
+done:
+  /* complete the non-temporal stores before the descriptors are given back */
+  if (PREDICT_FALSE (vui->tx_large_frame_size != 0))
+    CLIB_MEMORY_STORE_BARRIER ();
+  return rv;
+}
+
+
+/*
+ * Returns the descriptor table of the chain at the head of the packed
+ * ring, and its first descriptor in desc_index.
+ */
+static_always_inline vring_packed_desc_t *
+vhost_user_tx_packed_chain (vhost_user_intf_t * vui,
+			    vhost_user_vring_t * rxvq, u16 * desc_index,
+			    u16 * n_indirect, u32 * map_hint, u8 * error)
+{
+  vring_packed_desc_t *desc_table = rxvq->packed_desc;
+  u16 head = rxvq->last_avail_idx;
+
+  *desc_index = head;
+  *n_indirect = 0;
+  if (PREDICT_FALSE (desc_table[head].flags & VIRTQ_DESC_F_INDIRECT))
+    {
+      *n_indirect = desc_table[head].len / sizeof (vring_packed_desc_t);
+      if (PREDICT_FALSE (*n_indirect == 0))
+	{
+	  *error = VHOST_USER_TX_FUNC_ERROR_INDIRECT_OVERFLOW;
+	  return 0;
+	}
+      if (PREDICT_FALSE (!(desc_table = map_guest_mem (vui,
+						       desc_table[head].addr,
+						       map_hint))))
+	{
+	  *error = VHOST_USER_TX_FUNC_ERROR_MMAP_FAIL;
+	  return 0;
+	}
+      *desc_index = 0;
+    }
+  return desc_table;
+}
+
+/*
+ * vhost_user_tx () for packed rings, called with the vring locked.
+ * Returns the number of packets left.
+ */
+static u32
+vhost_user_tx_packed (vlib_main_t * vm, vlib_node_runtime_t * node,
+		      vhost_user_intf_t * vui, u32 qid, u32 * buffers,
+		      u32 n_left, u8 * error)
+{
+  vhost_user_main_t *vum = &vhost_user_main;
+  vhost_user_vring_t *rxvq = &vui->vrings[qid];
+  u32 thread_index = vlib_get_thread_index ();
+  vhost_cpu_t *cpu = &vum->cpus[thread_index];
+  u32 n_packets = n_left;
+  u32 map_hint = rxvq->map_hint;
+  u8 retry = 8;
+  u16 copy_len;
+  u16 tx_headers_len;
+  u32 n_used;
+
+retry:
+  *error = VHOST_USER_TX_FUNC_ERROR_NONE;
+  tx_headers_len = 0;
+  copy_len = 0;
+  n_used = 0;
+  while (n_left > 0)
+    {
+      vlib_buffer_t *b0, *current_b0;
+      vring_packed_desc_t *desc_table;
+      u16 desc_index, n_indirect, n_descs;
+      u16 last_avail_idx, last_used_idx;
+      u8 avail_wrap_counter, used_wrap_counter;
+      u32 first_used;
+      uword buffer_map_addr;
+      u32 buffer_len, desc_len;
+      u16 bytes_left;
+      u8 non_temporal;
+      virtio_net_hdr_mrg_rxbuf_t *hdr;
+
+      if (PREDICT_TRUE (n_left > 1))
+	vlib_prefetch_buffer_with_index (vm, buffers[1], LOAD);
+
+      b0 = vlib_get_buffer (vm, buffers[0]);
+      non_temporal = vui->tx_large_frame_size &&
+	vlib_buffer_length_in_chain (vm, b0) >= vui->tx_large_frame_size;
+
+      if (PREDICT_FALSE (b0->flags & VLIB_BUFFER_IS_TRACED))
+	{
+	  cpu->current_trace =
+	    vlib_add_trace (vm, node, b0, sizeof (*cpu->current_trace));
+	  vhost_user_tx_trace (cpu->current_trace, vui, qid / 2, b0, rxvq);
+	}
+
+      if (PREDICT_FALSE (!vhost_user_packed_desc_available (rxvq,
+							    rxvq->last_avail_idx)))
+	{
+	  *error = VHOST_USER_TX_FUNC_ERROR_PKT_DROP_NOBUF;
+	  goto done;
+	}
+
+      /* to give the descriptors back if the packet does not fit */
+      last_avail_idx = rxvq->last_avail_idx;
+      last_used_idx = rxvq->last_used_idx;
+      avail_wrap_counter = rxvq->avail_wrap_counter;
+      used_wrap_counter = rxvq->used_wrap_counter;
+      first_used = n_used;
+
+      if (PREDICT_FALSE (!(desc_table =
+			   vhost_user_tx_packed_chain (vui, rxvq,
+						       &desc_index,
+						       &n_indirect,
+						       &map_hint, error))))
+	goto done;
+
+      /* the descriptors of the next packets follow in the ring */
+      CLIB_PREFETCH (&rxvq->packed_desc[(last_avail_idx + 4) &
+					rxvq->qsz_mask],
+		     CLIB_CACHE_LINE_BYTES, LOAD);
+
+      n_descs = 1;
+      desc_len = vui->virtio_net_hdr_sz;
+      buffer_map_addr = desc_table[desc_index].addr;
+      buffer_len = desc_table[desc_index].len;
+
+      {
+	// Get a header from the header array
+	hdr = &cpu->tx_headers[tx_headers_len];
+	tx_headers_len++;
+	hdr->hdr.flags = 0;
+	hdr->hdr.gso_type = 0;
+	hdr->num_buffers = 1;	//This is local, no need to check
+
+	// Prepare a copy order executed later for the header
+	vhost_copy_t *cpy = &cpu->copy[copy_len];
+	copy_len++;
+	cpy->len = vui->virtio_net_hdr_sz;
+	cpy->dst = buffer_map_addr;
+	cpy->src = (uword) hdr;
+	cpy->non_temporal = 0;
+      }
+
+      buffer_map_addr += vui->virtio_net_hdr_sz;
+      buffer_len -= vui->virtio_net_hdr_sz;
+      bytes_left = b0->current_length;
+      current_b0 = b0;
+      while (1)
+	{
+	  if (buffer_len == 0)
+	    {			//Get new output
+	      if (n_indirect && desc_index + 1 < n_indirect)
+		desc_index++;
+	      else if (!n_indirect &&
+		       (desc_table[desc_index].flags & VIRTQ_DESC_F_NEXT) &&
+		       n_descs <= rxvq->qsz_mask)
+		{
+		  desc_index = (desc_index + 1) & rxvq->qsz_mask;
+		  n_descs++;
+		}
+	      else if (vui->virtio_net_hdr_sz == 12)	//MRG is available
+		{
+		  //Move from available to used buffer
+		  vhost_user_packed_chain_used (rxvq, desc_table, desc_index,
+						n_indirect, n_descs, desc_len,
+						&cpu->packed_used[n_used]);
+		  n_used++;
+		  hdr->num_buffers++;
+		  desc_len = 0;
+
+		  if (PREDICT_FALSE
+		      (!vhost_user_packed_desc_available (rxvq,
+							  rxvq->last_avail_idx)
+		       || n_used == VHOST_USER_COPY_ARRAY_N))
+		    {
+		      *error = VHOST_USER_TX_FUNC_ERROR_PKT_DROP_NOBUF;
+		      goto rewind;
+		    }
+
+		  if (PREDICT_FALSE (!(desc_table =
+				       vhost_user_tx_packed_chain (vui, rxvq,
+								   &desc_index,
+								   &n_indirect,
+								   &map_hint,
+								   error))))
+		    goto rewind;
+		  n_descs = 1;
+		}
+	      else
+		{
+		  *error = VHOST_USER_TX_FUNC_ERROR_PKT_DROP_NOMRG;
+		  goto rewind;
+		}
+	      buffer_map_addr = desc_table[desc_index].addr;
+	      buffer_len = desc_table[desc_index].len;
+	      continue;
+	    }
+
+	  {
+	    vhost_copy_t *cpy = &cpu->copy[copy_len];
+	    copy_len++;
+	    cpy->len = bytes_left;
+	    cpy->len = (cpy->len > buffer_len) ? buffer_len : cpy->len;
+	    cpy->dst = buffer_map_addr;
+	    cpy->src = (uword) vlib_buffer_get_current (current_b0) +
+	      current_b0->current_length - bytes_left;
+	    cpy->non_temporal = non_temporal;
+
+	    bytes_left -= cpy->len;
+	    buffer_len -= cpy->len;
+	    buffer_map_addr += cpy->len;
+	    desc_len += cpy->len;
+	  }
+
+	  // Check if vlib buffer has more data. If not, get more or break.
+	  if (PREDICT_TRUE (!bytes_left))
+	    {
+	      if (PREDICT_FALSE
+		  (current_b0->flags & VLIB_BUFFER_NEXT_PRESENT))
+		{
+		  current_b0 = vlib_get_buffer (vm, current_b0->next_buffer);
+		  bytes_left = current_b0->current_length;
+		}
+	      else
+		{
+		  //End of packet
+		  break;
+		}
+	    }
+	}
+
+      //Move from available to used ring
+      vhost_user_packed_chain_used (rxvq, desc_table, desc_index,
+				    n_indirect, n_descs, desc_len,
+				    &cpu->packed_used[n_used]);
+      n_used++;
+
+      if (PREDICT_FALSE (b0->flags & VLIB_BUFFER_IS_TRACED))
+	cpu->current_trace->hdr = *hdr;
+
+      if (PREDICT_FALSE (non_temporal))
+	{
+	  rxvq->n_large_frames++;
+	  rxvq->n_large_frame_bytes += vlib_buffer_length_in_chain (vm, b0);
+	}
+
+      n_left--;			//At the end for error counting when 'goto done' is invoked
+
+      /* See vhost_user_tx () */
+      if (PREDICT_FALSE (copy_len >= VHOST_USER_TX_COPY_THRESHOLD ||
+			 n_used >= VHOST_USER_TX_COPY_THRESHOLD))
+	{
+	  if (PREDICT_FALSE
+	      (vhost_user_tx_copy (vui, cpu->copy, copy_len, &map_hint)))
+	    {
+	      vlib_error_count (vm, node->node_index,
+				VHOST_USER_TX_FUNC_ERROR_MMAP_FAIL, 1);
+	    }
+	  copy_len = 0;
+
+	  /* give buffers back to driver */
+	  vhost_user_packed_used_flush (vui, rxvq, cpu->packed_used, n_used);
+	  n_used = 0;
+	}
+      buffers++;
+      continue;
+
+    rewind:
+      /*
+       * Dequeue the descriptors used for this packet. The copies already
+       * queued for it are still done, into buffers the driver does not
+       * get back. Useless, but valid.
+       */
+      rxvq->last_avail_idx = last_avail_idx;
+      rxvq->last_used_idx = last_used_idx;
+      rxvq->avail_wrap_counter = avail_wrap_counter;
+      rxvq->used_wrap_counter = used_wrap_counter;
+      n_used = first_used;
+      goto done;
+    }
+
+done:
+  //Do the memory copies
+  if (PREDICT_FALSE
+      (vhost_user_tx_copy (vui, cpu->copy, copy_len, &map_hint)))
+    {
+      vlib_error_count (vm, node->node_index,
+			VHOST_USER_TX_FUNC_ERROR_MMAP_FAIL, 1);
+    }
+
+  vhost_user_packed_used_flush (vui, rxvq, cpu->packed_used, n_used);
+
+  /* See vhost_user_tx () */
+  if (n_left && (*error == VHOST_USER_TX_FUNC_ERROR_PKT_DROP_NOBUF) && retry)
+    {
+      retry--;
+      goto retry;
+    }
+
+  /* interrupt (call) handling */
+  if ((rxvq->callfd_idx != ~0) &&
+      vhost_user_vring_want_interrupt (vui, rxvq))
+    {
+      rxvq->n_since_last_int += n_packets - n_left;
+
+      if (rxvq->n_since_last_int > vum->coalesce_frames)
+	vhost_user_send_call (vm, rxvq);
+    }
+
+  rxvq->map_hint = map_hint;
+  return n_left;
+}
+
+static uword
+vhost_user_tx (vlib_main_t * vm,
+	       vlib_node_runtime_t * node, vlib_frame_t * frame)
+{
+  u32 *buffers = vlib_frame_args (frame);
   u32 n_left = frame->n_vectors;
   vhost_user_main_t *vum = &vhost_user_main;
   vnet_interface_output_runtime_t *rd = (void *) node->runtime_data;
@@ -1991,7 +2926,7 @@ vhost_user_tx (vlib_main_t * vm,
   vhost_user_vring_t *rxvq;
   u8 error;
   u32 thread_index = vlib_get_thread_index ();
-  u32 map_hint = 0;
+  u32 map_hint;
   u8 retry = 8;
   u16 copy_len;
   u16 tx_headers_len;
@@ -2015,6 +2950,15 @@ vhost_user_tx (vlib_main_t * vm,
   if (PREDICT_FALSE (vui->use_tx_spinlock))
     vhost_user_vring_lock (vui, qid);
 
+  if (vhost_user_is_packed_ring_supported (vui))
+    {
+      n_left = vhost_user_tx_packed (vm, node, vui, qid, buffers, n_left,
+				     &error);
+      goto done2;
+    }
+
+  map_hint = rxvq->map_hint;
+
 retry:
   error = VHOST_USER_TX_FUNC_ERROR_NONE;
   tx_headers_len = 0;
@@ -2027,11 +2971,14 @@ retry:
       uword buffer_map_addr;
       u32 buffer_len;
       u16 bytes_left;
+      u8 non_temporal;
 
       if (PREDICT_TRUE (n_left > 1))
 	vlib_prefetch_buffer_with_index (vm, buffers[1], LOAD);
 
       b0 = vlib_get_buffer (vm, buffers[0]);
+      non_temporal = vui->tx_large_frame_size &&
+	vlib_buffer_length_in_chain (vm, b0) >= vui->tx_large_frame_size;
 
       if (PREDICT_FALSE (b0->flags & VLIB_BUFFER_IS_TRACED))
 	{
@@ -2052,6 +2999,20 @@ retry:
       desc_head = desc_index =
 	rxvq->avail->ring[rxvq->last_avail_idx & rxvq->qsz_mask];
 
+      /*
+       * Prefetch the head descriptor of the next packet, and the used
+       * ring entries ahead once per cache line.
+       */
+      if (PREDICT_TRUE (n_left > 1))
+	CLIB_PREFETCH (&rxvq->desc[rxvq->avail->ring
+				   [(rxvq->last_avail_idx + 1) &
+				    rxvq->qsz_mask] & rxvq->qsz_mask],
+		       sizeof (vring_desc_t), LOAD);
+      if ((rxvq->last_used_idx & 7) == 0)
+	CLIB_PREFETCH (&rxvq->used->ring[(rxvq->last_used_idx + 8) &
+					 rxvq->qsz_mask],
+		       CLIB_CACHE_LINE_BYTES, STORE);
+
       /* Go deeper in case of indirect descriptor
        * I don't know of any driver providing indirect for RX. */
       if (PREDICT_FALSE (rxvq->desc[desc_head].flags & VIRTQ_DESC_F_INDIRECT))
@@ -2092,6 +3053,7 @@ retry:
 	cpy->len = vui->virtio_net_hdr_sz;
 	cpy->dst = buffer_map_addr;
 	cpy->src = (uword) hdr;
+	cpy->non_temporal = 0;
       }
 
       buffer_map_addr += vui->virtio_net_hdr_sz;
@@ -2181,13 +3143,12 @@ retry:
 	    cpy->dst = buffer_map_addr;
 	    cpy->src = (uword) vlib_buffer_get_current (current_b0) +
 	      current_b0->current_length - bytes_left;
+	    cpy->non_temporal = non_temporal;
 
 	    bytes_left -= cpy->len;
 	    buffer_len -= cpy->len;
 	    buffer_map_addr += cpy->len;
 	    desc_len += cpy->len;
-
-	    CLIB_PREFETCH (&rxvq->desc, CLIB_CACHE_LINE_BYTES, LOAD);
 	  }
 
 	  // Check if vlib buffer has more data. If not, get more or break.
@@ -2221,6 +3182,12 @@ retry:
 	    vum->cpus[thread_index].tx_headers[tx_headers_len - 1];
 	}
 
+      if (PREDICT_FALSE (non_temporal))
+	{
+	  rxvq->n_large_frames++;
+	  rxvq->n_large_frame_bytes += vlib_buffer_length_in_chain (vm, b0);
+	}
+
       n_left--;			//At the end for error counting when 'goto done' is invoked
 
       /*
@@ -2288,6 +3255,9 @@ done:
 	vhost_user_send_call (vm, rxvq);
     }
 
+  rxvq->map_hint = map_hint;
+
+done2:
   vhost_user_vring_unlock (vui, qid);
 
 done3:
@@ -2450,10 +3420,10 @@ vhost_user_interface_rx_mode_change (vnet_main_t * vnm, u32 hw_if_index,
 
   txvq->mode = mode;
   if (mode == VNET_HW_INTERFACE_RX_MODE_POLLING)
-    txvq->used->flags = VRING_USED_F_NO_NOTIFY;
+    vhost_user_vring_set_notify (vui, txvq, 0);
   else if ((mode == VNET_HW_INTERFACE_RX_MODE_ADAPTIVE) ||
 	   (mode == VNET_HW_INTERFACE_RX_MODE_INTERRUPT))
-    txvq->used->flags = 0;
+    vhost_user_vring_set_notify (vui, txvq, 1);
   else
     {
       clib_warning ("BUG: unhandled mode %d changed for if %d queue %d", mode,
@@ -2802,7 +3772,7 @@ vhost_user_vui_init (vnet_main_t * vnm,
 		     vhost_user_intf_t * vui,
 		     int server_sock_fd,
 		     const char *sock_filename,
-		     u64 feature_mask, u32 * sw_if_index)
+		     u64 feature_mask, u32 * sw_if_index, u8 enable_packed)
 {
   vnet_sw_interface_t *sw;
   int q;
@@ -2830,6 +3800,8 @@ vhost_user_vui_init (vnet_main_t * vnm,
   vui->sock_errno = 0;
   vui->is_up = 0;
   vui->feature_mask = feature_mask;
+  vui->enable_packed = enable_packed;
+  vui->tx_large_frame_size = 0;
   vui->clib_file_index = ~0;
   vui->log_base_addr = 0;
   vui->if_index = vui - vum->vhost_user_interfaces;
@@ -2863,7 +3835,8 @@ vhost_user_create_if (vnet_main_t * vnm, vlib_main_t * vm,
 		      u8 is_server,
 		      u32 * sw_if_index,
 		      u64 feature_mask,
-		      u8 renumber, u32 custom_dev_instance, u8 * hwaddr)
+		      u8 renumber, u32 custom_dev_instance, u8 * hwaddr,
+		      u8 enable_packed)
 {
   vhost_user_intf_t *vui = NULL;
   u32 sw_if_idx = ~0;
@@ -2901,7 +3874,7 @@ vhost_user_create_if (vnet_main_t * vnm, vlib_main_t * vm,
 
   vhost_user_create_ethernet (vnm, vm, vui, hwaddr);
   vhost_user_vui_init (vnm, vui, server_sock_fd, sock_filename,
-		       feature_mask, &sw_if_idx);
+		       feature_mask, &sw_if_idx, enable_packed);
 
   if (renumber)
     vnet_interface_name_renumber (sw_if_idx, custom_dev_instance);
@@ -2920,7 +3893,8 @@ vhost_user_modify_if (vnet_main_t * vnm, vlib_main_t * vm,
 		      const char *sock_filename,
 		      u8 is_server,
 		      u32 sw_if_index,
-		      u64 feature_mask, u8 renumber, u32 custom_dev_instance)
+		      u64 feature_mask, u8 renumber, u32 custom_dev_instance,
+		      u8 enable_packed)
 {
   vhost_user_main_t *vum = &vhost_user_main;
   vhost_user_intf_t *vui = NULL;
@@ -2955,7 +3929,7 @@ vhost_user_modify_if (vnet_main_t * vnm, vlib_main_t * vm,
 
   vhost_user_term_if (vui);
   vhost_user_vui_init (vnm, vui, server_sock_fd,
-		       sock_filename, feature_mask, &sw_if_idx);
+		       sock_filename, feature_mask, &sw_if_idx, enable_packed);
 
   if (renumber)
     vnet_interface_name_renumber (sw_if_idx, custom_dev_instance);
@@ -2966,6 +3940,35 @@ vhost_user_modify_if (vnet_main_t * vnm, vlib_main_t * vm,
   return rv;
 }
 
+/**
+ * @brief Frames of at least min_size bytes sent to the interface are
+ * copied with non-temporal stores, 0 to copy all frames the usual way.
+ */
+int
+vhost_user_set_large_frame_size (vnet_main_t * vnm, u32 sw_if_index,
+				 u32 min_size)
+{
+  vhost_user_main_t *vum = &vhost_user_main;
+  vnet_hw_interface_t *hwif;
+  vhost_user_intf_t *vui;
+  int q;
+
+  if (!(hwif = vnet_get_sup_hw_interface (vnm, sw_if_index)) ||
+      hwif->dev_class_index != vhost_user_dev_class.index)
+    return VNET_API_ERROR_INVALID_SW_IF_INDEX;
+
+  vui = pool_elt_at_index (vum->vhost_user_interfaces, hwif->dev_instance);
+  vui->tx_large_frame_size = min_size;
+
+  for (q = 0; q < VHOST_VRING_MAX_N; q++)
+    {
+      vui->vrings[q].n_large_frames = 0;
+      vui->vrings[q].n_large_frame_bytes = 0;
+    }
+
+  return 0;
+}
+
 clib_error_t *
 vhost_user_connect_command_fn (vlib_main_t * vm,
 			       unformat_input_t * input,
@@ -2980,6 +3983,7 @@ vhost_user_connect_command_fn (vlib_main_t * vm,
   u32 custom_dev_instance = ~0;
   u8 hwaddr[6];
   u8 *hw = NULL;
+  u8 enable_packed = 0;
   clib_error_t *error = NULL;
 
   /* Get a line of input. */
@@ -2994,6 +3998,8 @@ vhost_user_connect_command_fn (vlib_main_t * vm,
 	is_server = 1;
       else if (unformat (line_input, "feature-mask 0x%llx", &feature_mask))
 	;
+      else if (unformat (line_input, "packed"))
+	enable_packed = 1;
       else
 	if (unformat
 	    (line_input, "hwaddr %U", unformat_ethernet_address, hwaddr))
@@ -3015,7 +4021,8 @@ vhost_user_connect_command_fn (vlib_main_t * vm,
   int rv;
   if ((rv = vhost_user_create_if (vnm, vm, (char *) sock_filename,
 				  is_server, &sw_if_index, feature_mask,
-				  renumber, custom_dev_instance, hw)))
+				  renumber, custom_dev_instance, hw,
+				  enable_packed)))
     {
       error = clib_error_return (0, "vhost_user_create_if returned %d", rv);
       goto done;
@@ -3257,6 +4264,10 @@ show_vhost_user_command_fn (vlib_main_t * vm,
       vlib_cli_output (vm, " tx placement: %s\n",
 		       vui->use_tx_spinlock ? "spin-lock" : "lock-free");
 
+      if (vui->tx_large_frame_size)
+	vlib_cli_output (vm, " tx large frames: from %u bytes\n",
+			 vui->tx_large_frame_size);
+
       vec_foreach_index (ci, vui->per_cpu_tx_qid)
       {
 	vlib_cli_output (vm, "   thread %d on vring %d\n", ci,
@@ -3300,7 +4311,17 @@ show_vhost_user_command_fn (vlib_main_t * vm,
 			   vui->vrings[q].last_avail_idx,
 			   vui->vrings[q].last_used_idx);
 
-	  if (vui->vrings[q].avail && vui->vrings[q].used)
+	  if (vhost_user_is_packed_ring_supported (vui))
+	    {
+	      if (vui->vrings[q].avail_event && vui->vrings[q].used_event)
+		vlib_cli_output (vm,
+				 "  avail wrap %d used wrap %d driver event flags %x device event flags %x\n",
+				 vui->vrings[q].avail_wrap_counter,
+				 vui->vrings[q].used_wrap_counter,
+				 vui->vrings[q].avail_event->flags,
+				 vui->vrings[q].used_event->flags);
+	    }
+	  else if (vui->vrings[q].avail && vui->vrings[q].used)
 	    vlib_cli_output (vm,
 			     "  avail.flags %x avail.idx %d used.flags %x used.idx %d\n",
 			     vui->vrings[q].avail->flags,
@@ -3308,12 +4329,36 @@ show_vhost_user_command_fn (vlib_main_t * vm,
 			     vui->vrings[q].used->flags,
 			     vui->vrings[q].used->idx);
 
+	  if (vui->tx_large_frame_size && !(q & 1))
+	    vlib_cli_output (vm, "  large frames %llu bytes %llu\n",
+			     vui->vrings[q].n_large_frames,
+			     vui->vrings[q].n_large_frame_bytes);
+
 	  int kickfd = UNIX_GET_FD (vui->vrings[q].kickfd_idx);
 	  int callfd = UNIX_GET_FD (vui->vrings[q].callfd_idx);
 	  vlib_cli_output (vm, "  kickfd %d callfd %d errfd %d\n",
 			   kickfd, callfd, vui->vrings[q].errfd);
 
-	  if (show_descr)
+	  if (show_descr && vhost_user_is_packed_ring_supported (vui))
+	    {
+	      vlib_cli_output (vm, "\n  descriptor table (packed):\n");
+	      vlib_cli_output (vm,
+			       "   slot        addr         len  flags  id        user_addr\n");
+	      vlib_cli_output (vm,
+			       "  ===== ================== ===== ====== ===== ==================\n");
+	      for (j = 0; j < vui->vrings[q].qsz_mask + 1; j++)
+		{
+		  vring_packed_desc_t *d = &vui->vrings[q].packed_desc[j];
+		  u32 mem_hint = 0;
+		  vlib_cli_output (vm,
+				   "  %-5d 0x%016lx %-5d 0x%04x %-5d 0x%016lx\n",
+				   j, d->addr, d->len, d->flags, d->id,
+				   pointer_to_uword (map_guest_mem
+						     (vui, d->addr,
+						      &mem_hint)));
+		}
+	    }
+	  else if (show_descr)
 	    {
 	      vlib_cli_output (vm, "\n  descriptor table:\n");
 	      vlib_cli_output (vm,
@@ -3373,6 +4418,10 @@ done:
  *   - 0x010000000 (28) - VIRTIO_F_INDIRECT_DESC
  *   - 0x040000000 (30) - VHOST_USER_F_PROTOCOL_FEATURES
  *   - 0x100000000 (32) - VIRTIO_F_VERSION_1
+ *   - 0x400000000 (34) - VIRTIO_F_RING_PACKED, only with <b>packed</b>
+ *
+ * - <b>packed</b> - Optional flag to also offer the virtio 1.1 packed ring
+ * layout to the driver, which requires VIRTIO_F_VERSION_1.
  *
  * - <b>hwaddr <mac-addr></b> - Optional ethernet address, can be in either
  * X:X:X:X:X:X unix or X.X.X cisco format.
@@ -3401,7 +4450,8 @@ done:
 VLIB_CLI_COMMAND (vhost_user_connect_command, static) = {
     .path = "create vhost-user",
     .short_help = "create vhost-user socket <socket-filename> [server] "
-    "[feature-mask <hex>] [hwaddr <mac-addr>] [renumber <dev_instance>] ",
+    "[feature-mask <hex>] [hwaddr <mac-addr>] [renumber <dev_instance>] "
+    "[packed] ",
     .function = vhost_user_connect_command_fn,
 };
 /* *INDENT-ON* */
@@ -3424,6 +4474,75 @@ VLIB_CLI_COMMAND (vhost_user_delete_command, static) = {
     .short_help = "delete vhost-user {<interface> | sw_if_index <sw_idx>}",
     .function = vhost_user_delete_command_fn,
 };
+/* *INDENT-ON* */
+
+static clib_error_t *
+vhost_user_large_frames_command_fn (vlib_main_t * vm,
+				    unformat_input_t * input,
+				    vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 sw_if_index = ~0;
+  u32 min_size = VHOST_USER_LARGE_FRAME_SIZE;
+  clib_error_t *error = NULL;
+  int rv;
+
+  /* Get a line of input. */
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "%U", unformat_vnet_sw_interface, vnm,
+		    &sw_if_index))
+	;
+      else if (unformat (line_input, "min-size %u", &min_size))
+	;
+      else if (unformat (line_input, "disable"))
+	min_size = 0;
+      else
+	{
+	  error = clib_error_return (0, "unknown input `%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (sw_if_index == ~0)
+    {
+      error = clib_error_return (0, "interface required");
+      goto done;
+    }
+
+  if ((rv = vhost_user_set_large_frame_size (vnm, sw_if_index, min_size)))
+    error = clib_error_return (0, "Not a vhost interface");
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
+/*?
+ * Copy the frames of at least '<em>min-size</em>' bytes (2048 by default)
+ * sent to a vHost User interface with non-temporal stores. The data is
+ * then not kept in the cache of the worker, where it would evict the
+ * packets still to be processed, as it is read by the guest on another
+ * core. Smaller frames are copied the usual way. The number of frames and
+ * bytes copied this way by vring is shown by '<em>show vhost-user</em>'.
+ *
+ * @cliexpar
+ * @cliexcmd{set vhost-user large-frames VirtualEthernet0/0/0 min-size 4096}
+ * @cliexcmd{set vhost-user large-frames VirtualEthernet0/0/0 disable}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (vhost_user_large_frames_command, static) = {
+    .path = "set vhost-user large-frames",
+    .short_help = "set vhost-user large-frames <interface> "
+    "[min-size <bytes>] [disable]",
+    .function = vhost_user_large_frames_command_fn,
+};
 
 /*?
  * Display the attributes of a single vHost User interface (provide interface
@@ -26,6 +26,8 @@
 #define VHOST_USER_VRING_NOFD_MASK      0x100
 #define VIRTQ_DESC_F_NEXT               1
 #define VIRTQ_DESC_F_INDIRECT           4
+#define VIRTQ_DESC_F_AVAIL              (1 << 7)
+#define VIRTQ_DESC_F_USED               (1 << 15)
 #define VHOST_USER_REPLY_MASK       (0x1 << 2)
 
 #define VHOST_USER_PROTOCOL_F_MQ   0
@@ -45,6 +47,9 @@
 #define VRING_USED_F_NO_NOTIFY  1
 #define VRING_AVAIL_F_NO_INTERRUPT 1
 
+#define VRING_EVENT_F_ENABLE  0x0
+#define VRING_EVENT_F_DISABLE 0x1
+
 #define foreach_virtio_net_feature      \
  _ (VIRTIO_NET_F_MRG_RXBUF, 15)         \
  _ (VIRTIO_NET_F_CTRL_VQ, 17)           \
@@ -54,7 +59,8 @@
  _ (VIRTIO_F_ANY_LAYOUT, 27)            \
  _ (VIRTIO_F_INDIRECT_DESC, 28)         \
  _ (VHOST_USER_F_PROTOCOL_FEATURES, 30) \
- _ (VIRTIO_F_VERSION_1, 32)
+ _ (VIRTIO_F_VERSION_1, 32)            \
+ _ (VIRTIO_F_RING_PACKED, 34)
 
 
 typedef enum
@@ -67,13 +73,17 @@ typedef enum
 int vhost_user_create_if (vnet_main_t * vnm, vlib_main_t * vm,
 			  const char *sock_filename, u8 is_server,
 			  u32 * sw_if_index, u64 feature_mask,
-			  u8 renumber, u32 custom_dev_instance, u8 * hwaddr);
+			  u8 renumber, u32 custom_dev_instance, u8 * hwaddr,
+			  u8 enable_packed);
 int vhost_user_modify_if (vnet_main_t * vnm, vlib_main_t * vm,
 			  const char *sock_filename, u8 is_server,
 			  u32 sw_if_index, u64 feature_mask,
-			  u8 renumber, u32 custom_dev_instance);
+			  u8 renumber, u32 custom_dev_instance,
+			  u8 enable_packed);
 int vhost_user_delete_if (vnet_main_t * vnm, vlib_main_t * vm,
 			  u32 sw_if_index);
+int vhost_user_set_large_frame_size (vnet_main_t * vnm, u32 sw_if_index,
+				     u32 min_size);
 
 /* *INDENT-OFF* */
 typedef struct vhost_user_memory_region
@@ -159,6 +169,22 @@ typedef struct
     } ring[VHOST_VRING_MAX_SIZE];
 } __attribute ((packed)) vring_used_t;
 
+// vring_packed_desc descriptor of the virtio 1.1 packed ring
+typedef struct
+{
+  uint64_t addr;  // packet data buffer address
+  uint32_t len;   // packet data buffer size, or written length when used
+  uint16_t id;    // buffer id, returned in the used descriptor
+  uint16_t flags; // (see below), AVAIL/USED set from the wrap counters
+} __attribute ((packed)) vring_packed_desc_t;
+
+// event suppression structure of the packed ring driver and device areas
+typedef struct
+{
+  uint16_t off_wrap;
+  volatile uint16_t flags;
+} __attribute ((packed)) vring_desc_event_t;
+
 typedef struct
 {
   u8 flags;
@@ -196,19 +222,42 @@ typedef struct
   u16 last_avail_idx;
   u16 last_used_idx;
   u16 n_since_last_int;
-  vring_desc_t *desc;
-  vring_avail_t *avail;
-  vring_used_t *used;
+  union
+  {
+    vring_desc_t *desc;
+    vring_packed_desc_t *packed_desc;
+  };
+  union
+  {
+    vring_avail_t *avail;
+    vring_desc_event_t *avail_event;	/* packed ring driver area */
+  };
+  union
+  {
+    vring_used_t *used;
+    vring_desc_event_t *used_event;	/* packed ring device area */
+  };
   f64 int_deadline;
   u8 started;
   u8 enabled;
   u8 log_used;
+  /* packed ring: last_avail_idx and last_used_idx are ring positions */
+  u8 avail_wrap_counter;
+  u8 used_wrap_counter;
+  /* memory region of the last guest address translated for this vring */
+  u32 map_hint;
   //Put non-runtime in a different cache line
     CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
   int errfd;
   u32 callfd_idx;
   u32 kickfd_idx;
   u64 log_guest_addr;
+  /* packed ring: guest address of the descriptors, where used ones go */
+  u64 log_desc_guest_addr;
+
+  /* frames sent to the guest with non-temporal stores, and their bytes */
+  u64 n_large_frames;
+  u64 n_large_frame_bytes;
 
   /* The rx queue policy (interrupt/adaptive/polling) for this queue */
   u32 mode;
@@ -233,6 +282,10 @@ typedef struct
   u64 features;
   u64 feature_mask;
   u64 protocol_features;
+  u8 enable_packed;
+
+  /* size from which frames are copied with non-temporal stores, 0 if off */
+  u32 tx_large_frame_size;
 
   //Memory region information
   u32 nregions;
@@ -260,13 +313,26 @@ typedef struct
   u16 *rx_queues;
 } vhost_user_intf_t;
 
+#define vhost_user_is_packed_ring_supported(vui) \
+  ((vui)->features & (1ULL << FEAT_VIRTIO_F_RING_PACKED))
+
 typedef struct
 {
   uword dst;
   uword src;
   u32 len;
+  u8 non_temporal;
 } vhost_copy_t;
 
+/* packed ring used descriptor, made visible once the copies are done */
+typedef struct
+{
+  u32 len;
+  u16 id;
+  u16 idx;
+  u16 flags;
+} vhost_packed_used_t;
+
 typedef struct
 {
   u16 qid; /** The interface queue index (Not the virtio vring idx) */
@@ -287,6 +353,7 @@ typedef struct
 
   virtio_net_hdr_mrg_rxbuf_t tx_headers[VLIB_FRAME_SIZE];
   vhost_copy_t copy[VHOST_USER_COPY_ARRAY_N];
+  vhost_packed_used_t packed_used[VHOST_USER_COPY_ARRAY_N];
 
   /* This is here so it doesn't end-up
    * using stack or registers. */
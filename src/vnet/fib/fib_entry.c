@@ -1569,6 +1569,27 @@ fib_entry_pool_size (void)
     return (pool_elts(fib_entry_pool));
 }
 
+fib_node_index_t
+fib_entry_walk_range (fib_node_index_t start,
+                      u32 n_entries,
+                      fib_entry_walk_fn_t fn,
+                      void *ctx)
+{
+    fib_node_index_t fei;
+
+    for (fei = start; fei < pool_len(fib_entry_pool); fei++)
+    {
+        if (0 == n_entries--)
+            return (fei);
+        if (pool_is_free_index(fib_entry_pool, fei))
+            continue;
+        if (!fn(fei, ctx))
+            return (fei + 1);
+    }
+
+    return (FIB_NODE_INDEX_INVALID);
+}
+
 static clib_error_t *
 show_fib_entry_command (vlib_main_t * vm,
 			unformat_input_t * input,
@@ -550,4 +550,24 @@ extern fib_entry_t * fib_entry_get(fib_node_index_t fib_entry_index);
  */
 extern u32 fib_entry_pool_size(void);
 
+/**
+ * @brief Call back function when walking a range of FIB entries
+ */
+typedef int (*fib_entry_walk_fn_t)(fib_node_index_t fei,
+                                   void *ctx);
+
+/**
+ * @brief Walk the FIB entries of all tables, in the order of their
+ * indices, from start and for at most n_entries indices. The walk stops
+ * early when fn returns 0. Unlike a table walk, it can be resumed where
+ * it stopped after the FIB has changed.
+ *
+ * @return the index to resume the walk at, or FIB_NODE_INDEX_INVALID
+ * once all the entries have been walked.
+ */
+extern fib_node_index_t fib_entry_walk_range(fib_node_index_t start,
+                                             u32 n_entries,
+                                             fib_entry_walk_fn_t fn,
+                                             void *ctx);
+
 #endif
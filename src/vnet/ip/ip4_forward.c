@@ -473,7 +473,8 @@ static u8 *format_ip4_lookup_trace (u8 * s, va_list * args);
 VLIB_REGISTER_NODE (ip4_lookup_node) =
 {
 .function = ip4_lookup,.name = "ip4-lookup",.vector_size =
-    sizeof (u32),.format_trace = format_ip4_lookup_trace,.n_next_nodes =
+    sizeof (u32),.flags = VLIB_NODE_FLAG_STEALABLE,.format_trace =
+    format_ip4_lookup_trace,.n_next_nodes =
     IP_LOOKUP_N_NEXT,.next_nodes = IP4_LOOKUP_NEXT_NODES,};
 
 VLIB_NODE_FUNCTION_MULTIARCH (ip4_lookup_node, ip4_lookup);
@@ -2721,6 +2722,7 @@ VLIB_REGISTER_NODE (ip4_rewrite_node) = {
   .function = ip4_rewrite,
   .name = "ip4-rewrite",
   .vector_size = sizeof (u32),
+  .flags = VLIB_NODE_FLAG_STEALABLE,
 
   .format_trace = format_ip4_rewrite_trace,
 
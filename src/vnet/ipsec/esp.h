@@ -17,6 +17,7 @@
 
 #include <vnet/ip/ip.h>
 #include <vnet/ipsec/ipsec.h>
+#include <vnet/crypto/async.h>
 
 #include <openssl/hmac.h>
 #include <openssl/rand.h>
@@ -49,9 +50,22 @@ typedef CLIB_PACKED (struct {
 }) ip6_and_esp_header_t;
 /* *INDENT-ON* */
 
+/* *INDENT-OFF* */
+typedef CLIB_PACKED (struct {
+  u32 salt;
+  u8 iv[8];
+}) esp_gcm_nonce_t;
+/* *INDENT-ON* */
+
+#define ESP_GCM_ICV_SIZE	(16)
+
 typedef struct
 {
   const EVP_CIPHER *type;
+  u8 iv_size;
+  u8 block_size;
+  /* size of the ICV of the combined mode algorithms, 0 otherwise */
+  u8 icv_size;
 } esp_crypto_alg_t;
 
 typedef struct
@@ -71,6 +85,9 @@ typedef struct
   ipsec_crypto_alg_t last_encrypt_alg;
   ipsec_crypto_alg_t last_decrypt_alg;
   ipsec_integ_alg_t last_integ_alg;
+  /* SA whose key is loaded in the AEAD encrypt/decrypt context */
+  u32 last_encrypt_sa_index;
+  u32 last_decrypt_sa_index;
 } esp_main_per_thread_data_t;
 
 typedef struct
@@ -78,15 +95,111 @@ typedef struct
   esp_crypto_alg_t *esp_crypto_algs;
   esp_integ_alg_t *esp_integ_algs;
   esp_main_per_thread_data_t *per_thread_data;
+
+  /* async crypto handlers of the esp-encrypt/decrypt-async nodes */
+  u32 encrypt_async_handler;
+  u32 decrypt_async_handler;
 } esp_main_t;
 
 extern esp_main_t esp_main;
 
-#define ESP_WINDOW_SIZE		(64)
 #define ESP_SEQ_MAX 		(4294967295UL)
 
 u8 *format_esp_header (u8 * s, va_list * args);
 
+always_inline int
+esp_crypto_alg_is_aead (ipsec_crypto_alg_t alg)
+{
+  return (alg >= IPSEC_CRYPTO_ALG_AES_GCM_128 &&
+	  alg <= IPSEC_CRYPTO_ALG_AES_GCM_256);
+}
+
+/*
+ * Additional authenticated data of the combined mode algorithms,
+ * RFC 4106 section 5: SPI followed by the (extended) sequence number
+ */
+always_inline int
+esp_aead_aad (ipsec_sa_t * sa, u32 seq_hi, esp_header_t * esp, u8 * aad)
+{
+  u32 *p = (u32 *) aad;
+
+  p[0] = esp->spi;
+  if (PREDICT_TRUE (sa->use_esn))
+    {
+      p[1] = clib_host_to_net_u32 (seq_hi);
+      p[2] = esp->seq;
+      return 3 * sizeof (u32);
+    }
+  p[1] = esp->seq;
+  return 2 * sizeof (u32);
+}
+
+/* drop the key schedules of the SA cached by the ESP nodes */
+always_inline void
+esp_flush_sa_ctx (u32 sa_index)
+{
+  esp_main_t *em = &esp_main;
+  esp_main_per_thread_data_t *ptd;
+
+  vec_foreach (ptd, em->per_thread_data)
+  {
+    if (ptd->last_encrypt_sa_index == sa_index)
+      ptd->last_encrypt_sa_index = ~0;
+    if (ptd->last_decrypt_sa_index == sa_index)
+      ptd->last_decrypt_sa_index = ~0;
+  }
+}
+
+/*
+ * The anti-replay window is a ring bitmap of replay_window_size bits: the
+ * state of the sequence number seq is bit (seq % replay_window_size), so
+ * sliding the window only clears the bits of the sequence numbers skipped.
+ */
+always_inline int
+esp_replay_window_test (ipsec_sa_t * sa, u32 seq)
+{
+  u32 i = seq & (sa->replay_window_size - 1);
+
+  return (sa->replay_window[i / 64] >> (i % 64)) & 1;
+}
+
+always_inline void
+esp_replay_window_set (ipsec_sa_t * sa, u32 seq)
+{
+  u32 i = seq & (sa->replay_window_size - 1);
+
+  sa->replay_window[i / 64] |= 1ULL << (i % 64);
+}
+
+/* slide the window n sequence numbers past last_seq */
+always_inline void
+esp_replay_window_slide (ipsec_sa_t * sa, u64 n)
+{
+  u32 mask = sa->replay_window_size - 1;
+  u32 i = (sa->last_seq + 1) & mask;
+  u32 bit, k;
+
+  if (n >= sa->replay_window_size)
+    {
+      memset (sa->replay_window, 0, sa->replay_window_size / 8);
+      return;
+    }
+
+  /* clear whole words where possible */
+  while (n)
+    {
+      bit = i % 64;
+      k = clib_min (n, 64 - bit);
+      if (k == 64)
+	sa->replay_window[i / 64] = 0;
+      else
+	sa->replay_window[i / 64] &= ~(((1ULL << k) - 1) << bit);
+      n -= k;
+      i = (i + k) & mask;
+    }
+}
+
+/* returns 0 if the packet is to be accepted, 1 if replayed, 2 if too old */
 always_inline int
 esp_replay_check (ipsec_sa_t * sa, u32 seq)
 {
@@ -97,29 +210,38 @@ esp_replay_check (ipsec_sa_t * sa, u32 seq)
 
   diff = sa->last_seq - seq;
 
-  if (ESP_WINDOW_SIZE > diff)
-    return (sa->replay_window & (1ULL << diff)) ? 1 : 0;
-  else
-    return 1;
+  if (PREDICT_FALSE (diff >= sa->replay_window_size))
+    {
+      sa->replay_too_old++;
+      return 2;
+    }
+
+  if (esp_replay_window_test (sa, seq))
+    {
+      sa->replay_dups++;
+      return 1;
+    }
 
   return 0;
 }
 
+/*
+ * RFC 4303 appendix A2.2: infer the high order bits of the sequence
+ * number from the window position, then check the window.
+ */
 always_inline int
 esp_replay_check_esn (ipsec_sa_t * sa, u32 seq)
 {
   u32 tl = sa->last_seq;
   u32 th = sa->last_seq_hi;
-  u32 diff = tl - seq;
+  u32 w = sa->replay_window_size;
 
-  if (PREDICT_TRUE (tl >= (ESP_WINDOW_SIZE - 1)))
+  if (PREDICT_TRUE (tl >= (w - 1)))
     {
-      if (seq >= (tl - ESP_WINDOW_SIZE + 1))
+      if (seq >= (tl - w + 1))
 	{
 	  sa->seq_hi = th;
-	  if (seq <= tl)
-	    return (sa->replay_window & (1ULL << diff)) ? 1 : 0;
-	  else
+	  if (seq > tl)
 	    return 0;
 	}
       else
@@ -130,21 +252,30 @@ esp_replay_check_esn (ipsec_sa_t * sa, u32 seq)
     }
   else
     {
-      if (seq >= (tl - ESP_WINDOW_SIZE + 1))
+      if (seq >= (tl - w + 1))
 	{
+	  /* no sequence number precedes the first one */
+	  if (PREDICT_FALSE (th == 0))
+	    {
+	      sa->replay_too_old++;
+	      return 2;
+	    }
 	  sa->seq_hi = th - 1;
-	  return (sa->replay_window & (1ULL << diff)) ? 1 : 0;
 	}
       else
 	{
 	  sa->seq_hi = th;
-	  if (seq <= tl)
-	    return (sa->replay_window & (1ULL << diff)) ? 1 : 0;
-	  else
+	  if (seq > tl)
 	    return 0;
 	}
     }
 
+  if (esp_replay_window_test (sa, seq))
+    {
+      sa->replay_dups++;
+      return 1;
+    }
+
   return 0;
 }
 
@@ -152,59 +283,27 @@ esp_replay_check_esn (ipsec_sa_t * sa, u32 seq)
 always_inline void
 esp_replay_advance (ipsec_sa_t * sa, u32 seq)
 {
-  u32 pos;
-
   if (seq > sa->last_seq)
     {
-      pos = seq - sa->last_seq;
-      if (pos < ESP_WINDOW_SIZE)
-	sa->replay_window = ((sa->replay_window) << pos) | 1;
-      else
-	sa->replay_window = 1;
+      esp_replay_window_slide (sa, seq - sa->last_seq);
       sa->last_seq = seq;
     }
-  else
-    {
-      pos = sa->last_seq - seq;
-      sa->replay_window |= (1ULL << pos);
-    }
+  esp_replay_window_set (sa, seq);
 }
 
 always_inline void
 esp_replay_advance_esn (ipsec_sa_t * sa, u32 seq)
 {
-  int wrap = sa->seq_hi - sa->last_seq_hi;
-  u32 pos;
+  u64 s = ((u64) sa->seq_hi << 32) | seq;
+  u64 l = ((u64) sa->last_seq_hi << 32) | sa->last_seq;
 
-  if (wrap == 0 && seq > sa->last_seq)
+  if (s > l)
     {
-      pos = seq - sa->last_seq;
-      if (pos < ESP_WINDOW_SIZE)
-	sa->replay_window = ((sa->replay_window) << pos) | 1;
-      else
-	sa->replay_window = 1;
-      sa->last_seq = seq;
-    }
-  else if (wrap > 0)
-    {
-      pos = ~seq + sa->last_seq + 1;
-      if (pos < ESP_WINDOW_SIZE)
-	sa->replay_window = ((sa->replay_window) << pos) | 1;
-      else
-	sa->replay_window = 1;
+      esp_replay_window_slide (sa, s - l);
       sa->last_seq = seq;
       sa->last_seq_hi = sa->seq_hi;
     }
-  else if (wrap < 0)
-    {
-      pos = ~seq + sa->last_seq + 1;
-      sa->replay_window |= (1ULL << pos);
-    }
-  else
-    {
-      pos = sa->last_seq - seq;
-      sa->replay_window |= (1ULL << pos);
-    }
+  esp_replay_window_set (sa, seq);
 }
 
 always_inline int
@@ -231,6 +330,73 @@ esp_seq_advance (ipsec_sa_t * sa)
   return 0;
 }
 
+/* reserve the next block of sequence numbers of a spread SA */
+always_inline int
+esp_seq_reserve_block (ipsec_sa_t * sa, ipsec_sa_seq_block_t * sb)
+{
+  u32 i;
+
+  clib_spinlock_lock (&sa->seq_lock);
+  for (i = 0; i < IPSEC_SA_SEQ_BLOCK_SIZE; i++)
+    {
+      if (esp_seq_advance (sa))
+	break;
+      if (i == 0)
+	sb->next = ((u64) sa->seq_hi << 32) | sa->seq;
+    }
+  clib_spinlock_unlock (&sa->seq_lock);
+
+  sb->end = sb->next + i;
+  return (i == 0);
+}
+
+/*
+ * Sequence number of the next outbound packet of the SA on this thread.
+ * Returns 1 if the sequence number space is exhausted.
+ */
+always_inline int
+esp_seq_next (ipsec_sa_t * sa, u32 thread_index, u32 * seq, u32 * seq_hi)
+{
+  ipsec_sa_seq_block_t *sb;
+
+  if (PREDICT_TRUE (sa->affinity != IPSEC_SA_AFFINITY_SPREAD))
+    {
+      if (PREDICT_FALSE (esp_seq_advance (sa)))
+	return 1;
+      *seq = sa->seq;
+      *seq_hi = sa->seq_hi;
+      return 0;
+    }
+
+  sb = vec_elt_at_index (sa->seq_blocks, thread_index);
+  if (PREDICT_FALSE (sb->next == sb->end) && esp_seq_reserve_block (sa, sb))
+    return 1;
+
+  /* the non-ESN sequence numbers wrap within the low 32 bits */
+  *seq = (u32) sb->next;
+  *seq_hi = sb->next >> 32;
+  sb->next++;
+  return 0;
+}
+
+/* hand the frame off to the crypto workers, the packets of an SA to one */
+always_inline uword
+esp_crypto_async_submit (vlib_main_t * vm, u32 handler_index,
+			 vlib_frame_t * frame)
+{
+  u32 *from = vlib_frame_vector_args (frame);
+  u32 hashes[VLIB_FRAME_SIZE];
+  u32 i;
+
+  for (i = 0; i < frame->n_vectors; i++)
+    hashes[i] = vnet_buffer (vlib_get_buffer (vm, from[i]))->ipsec.sad_index;
+
+  vnet_crypto_async_submit (vm, handler_index, from, hashes,
+			    frame->n_vectors);
+
+  return frame->n_vectors;
+}
+
 always_inline void
 esp_init ()
 {
@@ -240,9 +406,38 @@ esp_init ()
   memset (em, 0, sizeof (em[0]));
 
   vec_validate (em->esp_crypto_algs, IPSEC_CRYPTO_N_ALG - 1);
-  em->esp_crypto_algs[IPSEC_CRYPTO_ALG_AES_CBC_128].type = EVP_aes_128_cbc ();
-  em->esp_crypto_algs[IPSEC_CRYPTO_ALG_AES_CBC_192].type = EVP_aes_192_cbc ();
-  em->esp_crypto_algs[IPSEC_CRYPTO_ALG_AES_CBC_256].type = EVP_aes_256_cbc ();
+  esp_crypto_alg_t *c;
+
+  c = &em->esp_crypto_algs[IPSEC_CRYPTO_ALG_AES_CBC_128];
+  c->type = EVP_aes_128_cbc ();
+  c->iv_size = c->block_size = 16;
+
+  c = &em->esp_crypto_algs[IPSEC_CRYPTO_ALG_AES_CBC_192];
+  c->type = EVP_aes_192_cbc ();
+  c->iv_size = c->block_size = 16;
+
+  c = &em->esp_crypto_algs[IPSEC_CRYPTO_ALG_AES_CBC_256];
+  c->type = EVP_aes_256_cbc ();
+  c->iv_size = c->block_size = 16;
+
+  /* RFC 4106: 8 octets of explicit IV, the payload aligned to 4 octets */
+  c = &em->esp_crypto_algs[IPSEC_CRYPTO_ALG_AES_GCM_128];
+  c->type = EVP_aes_128_gcm ();
+  c->iv_size = 8;
+  c->block_size = 4;
+  c->icv_size = ESP_GCM_ICV_SIZE;
+
+  c = &em->esp_crypto_algs[IPSEC_CRYPTO_ALG_AES_GCM_192];
+  c->type = EVP_aes_192_gcm ();
+  c->iv_size = 8;
+  c->block_size = 4;
+  c->icv_size = ESP_GCM_ICV_SIZE;
+
+  c = &em->esp_crypto_algs[IPSEC_CRYPTO_ALG_AES_GCM_256];
+  c->type = EVP_aes_256_gcm ();
+  c->iv_size = 8;
+  c->block_size = 4;
+  c->icv_size = ESP_GCM_ICV_SIZE;
 
   vec_validate (em->esp_integ_algs, IPSEC_INTEG_N_ALG - 1);
   esp_integ_alg_t *i;
@@ -267,15 +462,24 @@ esp_init ()
   i->md = EVP_sha512 ();
   i->trunc_size = 32;
 
+  em->encrypt_async_handler =
+    vnet_crypto_async_register_handler (vlib_get_main (),
+					esp_encrypt_async_node.index);
+  em->decrypt_async_handler =
+    vnet_crypto_async_register_handler (vlib_get_main (),
+					esp_decrypt_async_node.index);
+
   vec_validate_aligned (em->per_thread_data, tm->n_vlib_mains - 1,
 			CLIB_CACHE_LINE_BYTES);
   int thread_id;
 
-  for (thread_id = 0; thread_id < tm->n_vlib_mains - 1; thread_id++)
+  for (thread_id = 0; thread_id < tm->n_vlib_mains; thread_id++)
     {
       EVP_CIPHER_CTX_init (&(em->per_thread_data[thread_id].encrypt_ctx));
       EVP_CIPHER_CTX_init (&(em->per_thread_data[thread_id].decrypt_ctx));
       HMAC_CTX_init (&(em->per_thread_data[thread_id].hmac_ctx));
+      em->per_thread_data[thread_id].last_encrypt_sa_index = ~0;
+      em->per_thread_data[thread_id].last_decrypt_sa_index = ~0;
     }
 }
 
@@ -26,7 +26,8 @@
 _(DROP, "error-drop")                           \
 _(IP4_INPUT, "ip4-input")                       \
 _(IP6_INPUT, "ip6-input")                       \
-_(IPSEC_GRE_INPUT, "ipsec-gre-input")
+_(IPSEC_GRE_INPUT, "ipsec-gre-input")           \
+_(CRYPTO_ASYNC, "crypto-async-handoff")
 
 #define _(v, s) ESP_DECRYPT_NEXT_##v,
 typedef enum
@@ -43,7 +44,10 @@ typedef enum
  _(DECRYPTION_FAILED, "ESP decryption failed")      \
  _(INTEG_ERROR, "Integrity check failed")           \
  _(REPLAY, "SA replayed packet")                    \
- _(NOT_IP, "Not IP packet (dropped)")
+ _(REPLAY_TOO_OLD, "SA replay window exceeded")     \
+ _(NOT_IP, "Not IP packet (dropped)")               \
+ _(HANDOFF, "handed off to the SA owner thread")    \
+ _(HANDOFF_DROP, "SA owner thread congestion drop")
 
 
 typedef enum
@@ -108,9 +112,45 @@ esp_decrypt_aes_cbc (ipsec_crypto_alg_t alg,
   EVP_DecryptFinal_ex (ctx, out + out_len, &out_len);
 }
 
-static uword
-esp_decrypt_node_fn (vlib_main_t * vm,
-		     vlib_node_runtime_t * node, vlib_frame_t * from_frame)
+/* returns 1 if the ICV of the packet is valid */
+always_inline int
+esp_decrypt_aes_gcm (ipsec_crypto_alg_t alg, u32 sa_index, u8 * key,
+		     u8 * in, u8 * out, size_t in_len, u8 * nonce,
+		     u8 * aad, int aad_len, u8 * tag)
+{
+  esp_main_t *em = &esp_main;
+  u32 thread_index = vlib_get_thread_index ();
+  esp_main_per_thread_data_t *ptd = &em->per_thread_data[thread_index];
+  EVP_CIPHER_CTX *ctx = &ptd->decrypt_ctx;
+  int out_len;
+
+  ASSERT (alg < IPSEC_CRYPTO_N_ALG);
+
+  if (PREDICT_FALSE (ptd->last_decrypt_sa_index != sa_index ||
+		     ptd->last_decrypt_alg != alg))
+    {
+      EVP_DecryptInit_ex (ctx, em->esp_crypto_algs[alg].type, NULL, NULL,
+			  NULL);
+      EVP_CIPHER_CTX_ctrl (ctx, EVP_CTRL_GCM_SET_IVLEN,
+			   sizeof (esp_gcm_nonce_t), NULL);
+      EVP_DecryptInit_ex (ctx, NULL, NULL, key, NULL);
+      ptd->last_decrypt_alg = alg;
+      ptd->last_decrypt_sa_index = sa_index;
+    }
+
+  EVP_DecryptInit_ex (ctx, NULL, NULL, NULL, nonce);
+
+  EVP_DecryptUpdate (ctx, NULL, &out_len, aad, aad_len);
+  EVP_DecryptUpdate (ctx, out, &out_len, in, in_len);
+  EVP_CIPHER_CTX_ctrl (ctx, EVP_CTRL_GCM_SET_TAG, ESP_GCM_ICV_SIZE, tag);
+
+  return EVP_DecryptFinal_ex (ctx, out + out_len, &out_len) > 0;
+}
+
+always_inline uword
+esp_decrypt_inline (vlib_main_t * vm,
+		    vlib_node_runtime_t * node, vlib_frame_t * from_frame,
+		    int is_async)
 {
   u32 n_left_from, *from, next_index, *to_next;
   ipsec_main_t *im = &ipsec_main;
@@ -119,6 +159,32 @@ esp_decrypt_node_fn (vlib_main_t * vm,
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
   u32 thread_index = vlib_get_thread_index ();
+  u32 n_rx;
+
+  if (!is_async && vnet_crypto_async_is_offloaded (thread_index))
+    return esp_crypto_async_submit (vm, em->decrypt_async_handler,
+				    from_frame);
+
+  /* the crypto workers process all the packets of an SA already */
+  if (!is_async && PREDICT_FALSE (im->n_sa_owned))
+    {
+      ipsec_handoff_per_thread_data_t *hptd =
+	vec_elt_at_index (im->handoff_per_thread_data, thread_index);
+      u32 n_drops;
+
+      n_left_from = ipsec_sa_handoff (vm, im->esp_decrypt_fq_index,
+				      &hptd->decrypt, from, n_left_from,
+				      &n_drops);
+      vlib_node_increment_counter (vm, esp_decrypt_node.index,
+				   ESP_DECRYPT_ERROR_HANDOFF,
+				   from_frame->n_vectors - n_left_from -
+				   n_drops);
+      vlib_node_increment_counter (vm, esp_decrypt_node.index,
+				   ESP_DECRYPT_ERROR_HANDOFF_DROP, n_drops);
+      if (n_left_from == 0)
+	return from_frame->n_vectors;
+    }
+  n_rx = n_left_from;
 
   ipsec_alloc_empty_buffers (vm, im);
 
@@ -181,9 +247,11 @@ esp_decrypt_node_fn (vlib_main_t * vm,
 
 	      if (PREDICT_FALSE (rv))
 		{
-		  clib_warning ("anti-replay SPI %u seq %u", sa0->spi, seq);
 		  vlib_node_increment_counter (vm, esp_decrypt_node.index,
-					       ESP_DECRYPT_ERROR_REPLAY, 1);
+					       rv == 1 ?
+					       ESP_DECRYPT_ERROR_REPLAY :
+					       ESP_DECRYPT_ERROR_REPLAY_TOO_OLD,
+					       1);
 		  o_bi0 = i_bi0;
 		  to_next[0] = o_bi0;
 		  to_next += 1;
@@ -219,7 +287,9 @@ esp_decrypt_node_fn (vlib_main_t * vm,
 		}
 	    }
 
-	  if (PREDICT_TRUE (sa0->use_anti_replay))
+	  /* the ICV of the combined mode algorithms is checked below */
+	  if (PREDICT_TRUE (sa0->use_anti_replay &&
+			    !esp_crypto_alg_is_aead (sa0->crypto_alg)))
 	    {
 	      if (PREDICT_TRUE (sa0->use_esn))
 		esp_replay_advance_esn (sa0, seq);
@@ -241,17 +311,19 @@ esp_decrypt_node_fn (vlib_main_t * vm,
 	  /* add old buffer to the recycle list */
 	  vec_add1 (recycle, i_bi0);
 
-	  if (sa0->crypto_alg >= IPSEC_CRYPTO_ALG_AES_CBC_128 &&
-	      sa0->crypto_alg <= IPSEC_CRYPTO_ALG_AES_CBC_256)
+	  if ((sa0->crypto_alg >= IPSEC_CRYPTO_ALG_AES_CBC_128 &&
+	       sa0->crypto_alg <= IPSEC_CRYPTO_ALG_AES_CBC_256) ||
+	      esp_crypto_alg_is_aead (sa0->crypto_alg))
 	    {
-	      const int BLOCK_SIZE = 16;
-	      const int IV_SIZE = 16;
+	      esp_crypto_alg_t *alg = &em->esp_crypto_algs[sa0->crypto_alg];
+	      const int BLOCK_SIZE = alg->block_size;
+	      const int IV_SIZE = alg->iv_size;
 	      esp_footer_t *f0;
 	      u8 ip_hdr_size = 0;
 
 	      int blocks =
 		(i_b0->current_length - sizeof (esp_header_t) -
-		 IV_SIZE) / BLOCK_SIZE;
+		 IV_SIZE - alg->icv_size) / BLOCK_SIZE;
 
 	      o_b0->current_data = sizeof (ethernet_header_t);
 
@@ -293,13 +365,48 @@ esp_decrypt_node_fn (vlib_main_t * vm,
 		    }
 		}
 
-	      esp_decrypt_aes_cbc (sa0->crypto_alg,
-				   esp0->data + IV_SIZE,
-				   (u8 *) vlib_buffer_get_current (o_b0) +
-				   ip_hdr_size, BLOCK_SIZE * blocks,
-				   sa0->crypto_key, esp0->data);
+	      if (esp_crypto_alg_is_aead (sa0->crypto_alg))
+		{
+		  esp_gcm_nonce_t nonce;
+		  u8 aad[12];
+		  int aad_len, icv_ok;
+		  u8 *in = esp0->data + IV_SIZE;
+		  u8 *out = vlib_buffer_get_current (o_b0) + ip_hdr_size;
+
+		  nonce.salt = sa0->salt;
+		  clib_memcpy (nonce.iv, esp0->data, sizeof (nonce.iv));
+		  aad_len = esp_aead_aad (sa0, sa0->seq_hi, esp0, aad);
+
+		  icv_ok = esp_decrypt_aes_gcm (sa0->crypto_alg, sa_index0,
+						sa0->crypto_key, in, out,
+						BLOCK_SIZE * blocks,
+						(u8 *) & nonce, aad, aad_len,
+						in + BLOCK_SIZE * blocks);
+		  if (PREDICT_FALSE (!icv_ok))
+		    {
+		      vlib_node_increment_counter (vm, esp_decrypt_node.index,
+						   ESP_DECRYPT_ERROR_INTEG_ERROR,
+						   1);
+		      o_b0 = 0;
+		      goto trace;
+		    }
 
-	      o_b0->current_length = (blocks * 16) - 2 + ip_hdr_size;
+		  if (PREDICT_TRUE (sa0->use_anti_replay))
+		    {
+		      if (PREDICT_TRUE (sa0->use_esn))
+			esp_replay_advance_esn (sa0, seq);
+		      else
+			esp_replay_advance (sa0, seq);
+		    }
+		}
+	      else
+		esp_decrypt_aes_cbc (sa0->crypto_alg,
+				     esp0->data + IV_SIZE,
+				     (u8 *) vlib_buffer_get_current (o_b0) +
+				     ip_hdr_size, BLOCK_SIZE * blocks,
+				     sa0->crypto_key, esp0->data);
+
+	      o_b0->current_length = (blocks * BLOCK_SIZE) - 2 + ip_hdr_size;
 	      o_b0->flags = VLIB_BUFFER_TOTAL_LENGTH_VALID;
 	      f0 =
 		(esp_footer_t *) ((u8 *) vlib_buffer_get_current (o_b0) +
@@ -388,14 +495,22 @@ esp_decrypt_node_fn (vlib_main_t * vm,
 		}
 	    }
 
+	  /* return the packet to the worker it was submitted from */
+	  if (is_async)
+	    {
+	      vnet_crypto_async_set_next (em->decrypt_async_handler,
+					  vlib_get_buffer (vm, o_bi0), i_b0,
+					  next0);
+	      next0 = ESP_DECRYPT_NEXT_CRYPTO_ASYNC;
+	    }
+
 	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index, to_next,
 					   n_left_to_next, o_bi0, next0);
 	}
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
     }
   vlib_node_increment_counter (vm, esp_decrypt_node.index,
-			       ESP_DECRYPT_ERROR_RX_PKTS,
-			       from_frame->n_vectors);
+			       ESP_DECRYPT_ERROR_RX_PKTS, n_rx);
 
 free_buffers_and_exit:
   if (recycle)
@@ -404,6 +519,12 @@ free_buffers_and_exit:
   return from_frame->n_vectors;
 }
 
+static uword
+esp_decrypt_node_fn (vlib_main_t * vm,
+		     vlib_node_runtime_t * node, vlib_frame_t * from_frame)
+{
+  return esp_decrypt_inline (vm, node, from_frame, 0 /* is_async */ );
+}
 
 /* *INDENT-OFF* */
 VLIB_REGISTER_NODE (esp_decrypt_node) = {
@@ -426,6 +547,29 @@ VLIB_REGISTER_NODE (esp_decrypt_node) = {
 /* *INDENT-ON* */
 
 VLIB_NODE_FUNCTION_MULTIARCH (esp_decrypt_node, esp_decrypt_node_fn)
+
+/* runs on the crypto workers, see vnet/crypto/async.h */
+static uword
+esp_decrypt_async_node_fn (vlib_main_t * vm,
+			   vlib_node_runtime_t * node,
+			   vlib_frame_t * from_frame)
+{
+  return esp_decrypt_inline (vm, node, from_frame, 1 /* is_async */ );
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (esp_decrypt_async_node) = {
+  .function = esp_decrypt_async_node_fn,
+  .name = "esp-decrypt-async",
+  .vector_size = sizeof (u32),
+  .format_trace = format_esp_decrypt_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+  .sibling_of = "esp-decrypt",
+};
+/* *INDENT-ON* */
+
+VLIB_NODE_FUNCTION_MULTIARCH (esp_decrypt_async_node,
+			      esp_decrypt_async_node_fn)
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -28,7 +28,8 @@ esp_main_t esp_main;
 _(DROP, "error-drop")                              \
 _(IP4_LOOKUP, "ip4-lookup")                        \
 _(IP6_LOOKUP, "ip6-lookup")                        \
-_(INTERFACE_OUTPUT, "interface-output")
+_(INTERFACE_OUTPUT, "interface-output")            \
+_(CRYPTO_ASYNC, "crypto-async-handoff")
 
 #define _(v, s) ESP_ENCRYPT_NEXT_##v,
 typedef enum
@@ -42,7 +43,9 @@ typedef enum
  _(RX_PKTS, "ESP pkts received")                    \
  _(NO_BUFFER, "No buffer (packet dropped)")         \
  _(DECRYPTION_FAILED, "ESP encryption failed")      \
- _(SEQ_CYCLED, "sequence number cycled")
+ _(SEQ_CYCLED, "sequence number cycled")            \
+ _(HANDOFF, "handed off to the SA owner thread")    \
+ _(HANDOFF_DROP, "SA owner thread congestion drop")
 
 
 typedef enum
@@ -60,6 +63,7 @@ static char *esp_encrypt_error_strings[] = {
 };
 
 vlib_node_registration_t esp_encrypt_node;
+vlib_node_registration_t esp_encrypt_async_node;
 
 typedef struct
 {
@@ -112,16 +116,81 @@ esp_encrypt_aes_cbc (ipsec_crypto_alg_t alg,
   EVP_EncryptFinal_ex (ctx, out + out_len, &out_len);
 }
 
-static uword
-esp_encrypt_node_fn (vlib_main_t * vm,
-		     vlib_node_runtime_t * node, vlib_frame_t * from_frame)
+/*
+ * The key schedule of the SA is kept in the per-thread context, so
+ * consecutive packets of the same SA only load the nonce.
+ */
+always_inline void
+esp_encrypt_aes_gcm (ipsec_crypto_alg_t alg, u32 sa_index, u8 * key,
+		     u8 * in, u8 * out, size_t in_len, u8 * nonce,
+		     u8 * aad, int aad_len, u8 * tag)
+{
+  esp_main_t *em = &esp_main;
+  u32 thread_index = vlib_get_thread_index ();
+  esp_main_per_thread_data_t *ptd = &em->per_thread_data[thread_index];
+  EVP_CIPHER_CTX *ctx = &ptd->encrypt_ctx;
+  int out_len;
+
+  ASSERT (alg < IPSEC_CRYPTO_N_ALG);
+
+  if (PREDICT_FALSE (ptd->last_encrypt_sa_index != sa_index ||
+		     ptd->last_encrypt_alg != alg))
+    {
+      EVP_EncryptInit_ex (ctx, em->esp_crypto_algs[alg].type, NULL, NULL,
+			  NULL);
+      EVP_CIPHER_CTX_ctrl (ctx, EVP_CTRL_GCM_SET_IVLEN,
+			   sizeof (esp_gcm_nonce_t), NULL);
+      EVP_EncryptInit_ex (ctx, NULL, NULL, key, NULL);
+      ptd->last_encrypt_alg = alg;
+      ptd->last_encrypt_sa_index = sa_index;
+    }
+
+  EVP_EncryptInit_ex (ctx, NULL, NULL, NULL, nonce);
+
+  EVP_EncryptUpdate (ctx, NULL, &out_len, aad, aad_len);
+  EVP_EncryptUpdate (ctx, out, &out_len, in, in_len);
+  EVP_EncryptFinal_ex (ctx, out + out_len, &out_len);
+  EVP_CIPHER_CTX_ctrl (ctx, EVP_CTRL_GCM_GET_TAG, ESP_GCM_ICV_SIZE, tag);
+}
+
+always_inline uword
+esp_encrypt_inline (vlib_main_t * vm,
+		    vlib_node_runtime_t * node, vlib_frame_t * from_frame,
+		    int is_async)
 {
   u32 n_left_from, *from, *to_next = 0, next_index;
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
   ipsec_main_t *im = &ipsec_main;
+  esp_main_t *em = &esp_main;
   u32 *recycle = 0;
   u32 thread_index = vlib_get_thread_index ();
+  u32 n_rx;
+
+  if (!is_async && vnet_crypto_async_is_offloaded (thread_index))
+    return esp_crypto_async_submit (vm, em->encrypt_async_handler,
+				    from_frame);
+
+  /* the crypto workers process all the packets of an SA already */
+  if (!is_async && PREDICT_FALSE (im->n_sa_owned))
+    {
+      ipsec_handoff_per_thread_data_t *hptd =
+	vec_elt_at_index (im->handoff_per_thread_data, thread_index);
+      u32 n_drops;
+
+      n_left_from = ipsec_sa_handoff (vm, im->esp_encrypt_fq_index,
+				      &hptd->encrypt, from, n_left_from,
+				      &n_drops);
+      vlib_node_increment_counter (vm, esp_encrypt_node.index,
+				   ESP_ENCRYPT_ERROR_HANDOFF,
+				   from_frame->n_vectors - n_left_from -
+				   n_drops);
+      vlib_node_increment_counter (vm, esp_encrypt_node.index,
+				   ESP_ENCRYPT_ERROR_HANDOFF_DROP, n_drops);
+      if (n_left_from == 0)
+	return from_frame->n_vectors;
+    }
+  n_rx = n_left_from;
 
   ipsec_alloc_empty_buffers (vm, im);
 
@@ -149,6 +218,7 @@ esp_encrypt_node_fn (vlib_main_t * vm,
 	  vlib_buffer_t *i_b0, *o_b0 = 0;
 	  u32 sa_index0;
 	  ipsec_sa_t *sa0;
+	  u32 seq0 = 0, seq_hi0 = 0;
 	  ip4_and_esp_header_t *ih0, *oh0 = 0;
 	  ip6_and_esp_header_t *ih6_0, *oh6_0 = 0;
 	  uword last_empty_buffer;
@@ -171,7 +241,8 @@ esp_encrypt_node_fn (vlib_main_t * vm,
 	  sa_index0 = vnet_buffer (i_b0)->ipsec.sad_index;
 	  sa0 = pool_elt_at_index (im->sad, sa_index0);
 
-	  if (PREDICT_FALSE (esp_seq_advance (sa0)))
+	  if (PREDICT_FALSE (esp_seq_next (sa0, thread_index, &seq0,
+					   &seq_hi0)))
 	    {
 	      clib_warning ("sequence number counter has cycled SPI %u",
 			    sa0->spi);
@@ -227,7 +298,7 @@ esp_encrypt_node_fn (vlib_main_t * vm,
 	      oh6_0->ip6.dst_address.as_u64[1] =
 		ih6_0->ip6.dst_address.as_u64[1];
 	      oh6_0->esp.spi = clib_net_to_host_u32 (sa0->spi);
-	      oh6_0->esp.seq = clib_net_to_host_u32 (sa0->seq);
+	      oh6_0->esp.seq = clib_net_to_host_u32 (seq0);
 	      ip_proto = ih6_0->ip6.protocol;
 
 	      next0 = ESP_ENCRYPT_NEXT_IP6_LOOKUP;
@@ -249,7 +320,7 @@ esp_encrypt_node_fn (vlib_main_t * vm,
 	      oh0->ip4.src_address.as_u32 = ih0->ip4.src_address.as_u32;
 	      oh0->ip4.dst_address.as_u32 = ih0->ip4.dst_address.as_u32;
 	      oh0->esp.spi = clib_net_to_host_u32 (sa0->spi);
-	      oh0->esp.seq = clib_net_to_host_u32 (sa0->seq);
+	      oh0->esp.seq = clib_net_to_host_u32 (seq0);
 	      ip_proto = ih0->ip4.protocol;
 
 	      next0 = ESP_ENCRYPT_NEXT_IP4_LOOKUP;
@@ -300,9 +371,9 @@ esp_encrypt_node_fn (vlib_main_t * vm,
 
 	  if (PREDICT_TRUE (sa0->crypto_alg != IPSEC_CRYPTO_ALG_NONE))
 	    {
-
-	      const int BLOCK_SIZE = 16;
-	      const int IV_SIZE = 16;
+	      esp_crypto_alg_t *alg = &em->esp_crypto_algs[sa0->crypto_alg];
+	      const int BLOCK_SIZE = alg->block_size;
+	      const int IV_SIZE = alg->iv_size;
 	      int blocks = 1 + (i_b0->current_length + 1) / BLOCK_SIZE;
 
 	      /* pad packet in input buffer */
@@ -325,28 +396,53 @@ esp_encrypt_node_fn (vlib_main_t * vm,
 	      vnet_buffer (o_b0)->sw_if_index[VLIB_RX] =
 		vnet_buffer (i_b0)->sw_if_index[VLIB_RX];
 
-	      u8 iv[16];
-	      RAND_bytes (iv, sizeof (iv));
+	      if (esp_crypto_alg_is_aead (sa0->crypto_alg))
+		{
+		  esp_gcm_nonce_t nonce;
+		  u8 aad[12];
+		  int aad_len;
+		  u32 *iv = (u32 *) nonce.iv;
+
+		  /* the sequence number is unique per SA, use it as the IV */
+		  nonce.salt = sa0->salt;
+		  iv[0] = clib_host_to_net_u32 (seq_hi0);
+		  iv[1] = clib_host_to_net_u32 (seq0);
+		  clib_memcpy (o_esp0->data, nonce.iv, sizeof (nonce.iv));
+
+		  aad_len = esp_aead_aad (sa0, seq_hi0, o_esp0, aad);
+
+		  esp_encrypt_aes_gcm (sa0->crypto_alg, sa_index0,
+				       sa0->crypto_key,
+				       (u8 *) vlib_buffer_get_current (i_b0),
+				       o_esp0->data + IV_SIZE,
+				       BLOCK_SIZE * blocks, (u8 *) & nonce,
+				       aad, aad_len,
+				       vlib_buffer_get_current (o_b0) +
+				       o_b0->current_length);
+		  o_b0->current_length += alg->icv_size;
+		}
+	      else
+		{
+		  u8 iv[16];
+		  RAND_bytes (iv, sizeof (iv));
 
-	      clib_memcpy ((u8 *) vlib_buffer_get_current (o_b0) +
-			   ip_hdr_size + sizeof (esp_header_t), iv, 16);
+		  clib_memcpy (o_esp0->data, iv, 16);
 
-	      esp_encrypt_aes_cbc (sa0->crypto_alg,
-				   (u8 *) vlib_buffer_get_current (i_b0),
-				   (u8 *) vlib_buffer_get_current (o_b0) +
-				   ip_hdr_size + sizeof (esp_header_t) +
-				   IV_SIZE, BLOCK_SIZE * blocks,
-				   sa0->crypto_key, iv);
+		  esp_encrypt_aes_cbc (sa0->crypto_alg,
+				       (u8 *) vlib_buffer_get_current (i_b0),
+				       o_esp0->data + IV_SIZE,
+				       BLOCK_SIZE * blocks, sa0->crypto_key,
+				       iv);
+		}
 	    }
 
-	  o_b0->current_length += hmac_calc (sa0->integ_alg, sa0->integ_key,
-					     sa0->integ_key_len,
-					     (u8 *) o_esp0,
-					     o_b0->current_length -
-					     ip_hdr_size,
-					     vlib_buffer_get_current (o_b0) +
-					     o_b0->current_length,
-					     sa0->use_esn, sa0->seq_hi);
+	  /* the combined mode algorithms carry their own ICV */
+	  if (PREDICT_TRUE (!esp_crypto_alg_is_aead (sa0->crypto_alg)))
+	    o_b0->current_length +=
+	      hmac_calc (sa0->integ_alg, sa0->integ_key, sa0->integ_key_len,
+			 (u8 *) o_esp0, o_b0->current_length - ip_hdr_size,
+			 vlib_buffer_get_current (o_b0) +
+			 o_b0->current_length, sa0->use_esn, seq_hi0);
 
 
 	  if (PREDICT_FALSE (is_ipv6))
@@ -375,12 +471,21 @@ esp_encrypt_node_fn (vlib_main_t * vm,
 		  esp_encrypt_trace_t *tr =
 		    vlib_add_trace (vm, node, o_b0, sizeof (*tr));
 		  tr->spi = sa0->spi;
-		  tr->seq = sa0->seq - 1;
+		  tr->seq = seq0;
 		  tr->crypto_alg = sa0->crypto_alg;
 		  tr->integ_alg = sa0->integ_alg;
 		}
 	    }
 
+	  /* return the packet to the worker it was submitted from */
+	  if (is_async)
+	    {
+	      vnet_crypto_async_set_next (em->encrypt_async_handler,
+					  vlib_get_buffer (vm, o_bi0), i_b0,
+					  next0);
+	      next0 = ESP_ENCRYPT_NEXT_CRYPTO_ASYNC;
+	    }
+
 	  vlib_validate_buffer_enqueue_x1 (vm, node, next_index,
 					   to_next, n_left_to_next, o_bi0,
 					   next0);
@@ -388,8 +493,7 @@ esp_encrypt_node_fn (vlib_main_t * vm,
       vlib_put_next_frame (vm, node, next_index, n_left_to_next);
     }
   vlib_node_increment_counter (vm, esp_encrypt_node.index,
-			       ESP_ENCRYPT_ERROR_RX_PKTS,
-			       from_frame->n_vectors);
+			       ESP_ENCRYPT_ERROR_RX_PKTS, n_rx);
 
 free_buffers_and_exit:
   if (recycle)
@@ -398,6 +502,12 @@ free_buffers_and_exit:
   return from_frame->n_vectors;
 }
 
+static uword
+esp_encrypt_node_fn (vlib_main_t * vm,
+		     vlib_node_runtime_t * node, vlib_frame_t * from_frame)
+{
+  return esp_encrypt_inline (vm, node, from_frame, 0 /* is_async */ );
+}
 
 /* *INDENT-OFF* */
 VLIB_REGISTER_NODE (esp_encrypt_node) = {
@@ -420,6 +530,29 @@ VLIB_REGISTER_NODE (esp_encrypt_node) = {
 /* *INDENT-ON* */
 
 VLIB_NODE_FUNCTION_MULTIARCH (esp_encrypt_node, esp_encrypt_node_fn)
+
+/* runs on the crypto workers, see vnet/crypto/async.h */
+static uword
+esp_encrypt_async_node_fn (vlib_main_t * vm,
+			   vlib_node_runtime_t * node,
+			   vlib_frame_t * from_frame)
+{
+  return esp_encrypt_inline (vm, node, from_frame, 1 /* is_async */ );
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (esp_encrypt_async_node) = {
+  .function = esp_encrypt_async_node_fn,
+  .name = "esp-encrypt-async",
+  .vector_size = sizeof (u32),
+  .format_trace = format_esp_encrypt_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+  .sibling_of = "esp-encrypt",
+};
+/* *INDENT-ON* */
+
+VLIB_NODE_FUNCTION_MULTIARCH (esp_encrypt_async_node,
+			      esp_encrypt_async_node_fn)
 /*
  * fd.io coding-style-patch-verification: ON
  *
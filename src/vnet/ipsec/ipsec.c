@@ -37,6 +37,63 @@ ipsec_get_sa_index_by_sa_id (u32 sa_id)
   return p[0];
 }
 
+/* 0 selects the default size */
+int
+ipsec_replay_window_size_is_valid (u32 size)
+{
+  if (size == 0)
+    return 1;
+  return (is_pow2 (size) && size >= 64
+	  && size <= IPSEC_REPLAY_WINDOW_SIZE_MAX);
+}
+
+void
+ipsec_sa_replay_window_init (ipsec_sa_t * sa)
+{
+  if (sa->replay_window_size == 0)
+    sa->replay_window_size = IPSEC_REPLAY_WINDOW_SIZE_DEFAULT;
+
+  sa->replay_window = 0;
+  vec_validate_aligned (sa->replay_window, sa->replay_window_size / 64 - 1,
+			CLIB_CACHE_LINE_BYTES);
+  sa->replay_dups = sa->replay_too_old = 0;
+}
+
+/* free the runtime state of an SA being deleted */
+void
+ipsec_sa_runtime_free (ipsec_sa_t * sa)
+{
+  ipsec_main_t *im = &ipsec_main;
+
+  vec_free (sa->replay_window);
+
+  if (sa->affinity == IPSEC_SA_AFFINITY_AUTO ||
+      sa->affinity == IPSEC_SA_AFFINITY_WORKER)
+    im->n_sa_owned--;
+  if (sa->seq_blocks)
+    {
+      vec_free (sa->seq_blocks);
+      clib_spinlock_free (&sa->seq_lock);
+    }
+}
+
+/* bit i is set if last_seq - i was received */
+u64
+ipsec_sa_replay_window_last64 (ipsec_sa_t * sa)
+{
+  u32 mask = sa->replay_window_size - 1;
+  u64 w = 0;
+  u32 i, seq;
+
+  for (i = 0; i < 64; i++)
+    {
+      seq = (sa->last_seq - i) & mask;
+      if (sa->replay_window[seq / 64] & (1ULL << (seq % 64)))
+	w |= 1ULL << i;
+    }
+  return w;
+}
+
 int
 ipsec_set_interface_spd (vlib_main_t * vm, u32 sw_if_index, u32 spd_id,
 			 int is_add)
@@ -84,6 +141,78 @@ ipsec_set_interface_spd (vlib_main_t * vm, u32 sw_if_index, u32 spd_id,
   return 0;
 }
 
+static void
+ipsec_spd_flow_cache_init (ipsec_main_t * im)
+{
+  ipsec_spd_flow_cache_t *fc;
+
+  vec_foreach (fc, im->spd_flow_caches)
+  {
+    if (fc->entries)
+      continue;
+    vec_validate_aligned (fc->entries, IPSEC_SPD_FLOW_CACHE_N_ENTRIES - 1,
+			  CLIB_CACHE_LINE_BYTES);
+    /* an epoch of ~0 matches nothing */
+    memset (fc->entries, 0xff, vec_bytes (fc->entries));
+  }
+}
+
+/* invalidate the SPD lookup results cached by all the threads */
+static void
+ipsec_spd_flow_cache_invalidate (ipsec_main_t * im)
+{
+  CLIB_MEMORY_BARRIER ();
+  im->spd_epoch++;
+}
+
+static void
+ipsec_spd_free_inbound_spi_index (ipsec_spd_t * spd)
+{
+  u32 *indices;
+  u32 spi;
+
+  /* *INDENT-OFF* */
+  hash_foreach (spi, indices, spd->ipv4_inbound_protect_policy_indices_by_spi,
+  ({
+    vec_free (indices);
+  }));
+  /* *INDENT-ON* */
+  hash_free (spd->ipv4_inbound_protect_policy_indices_by_spi);
+}
+
+/*
+ * Index the ipv4 inbound protect policies by the SPI of their SA, so a
+ * lookup only walks the policies which can match the packet.
+ */
+static void
+ipsec_spd_build_inbound_spi_index (vlib_main_t * vm, ipsec_spd_t * spd)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_policy_t *p;
+  ipsec_sa_t *sa;
+  uword *indices_by_spi;
+  u32 *indices, *i;
+  uword *e;
+
+  indices_by_spi = hash_create (0, sizeof (uword));
+
+  /* the policy indices are sorted by priority already */
+  vec_foreach (i, spd->ipv4_inbound_protect_policy_indices)
+  {
+    p = pool_elt_at_index (spd->policies, *i);
+    sa = pool_elt_at_index (im->sad, p->sa_index);
+    e = hash_get (indices_by_spi, sa->spi);
+    indices = e ? (u32 *) e[0] : 0;
+    vec_add1 (indices, *i);
+    hash_set (indices_by_spi, sa->spi, indices);
+  }
+
+  vlib_worker_thread_barrier_sync (vm);
+  ipsec_spd_free_inbound_spi_index (spd);
+  spd->ipv4_inbound_protect_policy_indices_by_spi = indices_by_spi;
+  vlib_worker_thread_barrier_release (vm);
+}
+
 int
 ipsec_add_del_spd (vlib_main_t * vm, u32 spd_id, int is_add)
 {
@@ -116,10 +245,14 @@ ipsec_add_del_spd (vlib_main_t * vm, u32 spd_id, int is_add)
       vec_free (spd->ipv6_outbound_policies);
       vec_free (spd->ipv4_inbound_protect_policy_indices);
       vec_free (spd->ipv4_inbound_policy_discard_and_bypass_indices);
+      ipsec_spd_free_inbound_spi_index (spd);
       pool_put (im->spds, spd);
+      /* the SPD index may be reused */
+      ipsec_spd_flow_cache_invalidate (im);
     }
   else				/* create new SPD */
     {
+      ipsec_spd_flow_cache_init (im);
       pool_get (im->spds, spd);
       memset (spd, 0, sizeof (*spd));
       spd_index = spd - im->spds;
@@ -376,6 +509,12 @@ ipsec_add_del_policy (vlib_main_t * vm, ipsec_policy_t * policy, int is_add)
       /* *INDENT-ON* */
     }
 
+  if (!policy->is_outbound && !policy->is_ipv6 &&
+      policy->policy == IPSEC_POLICY_ACTION_PROTECT)
+    ipsec_spd_build_inbound_spi_index (vm, spd);
+
+  ipsec_spd_flow_cache_invalidate (im);
+
   return 0;
 }
 
@@ -442,12 +581,16 @@ ipsec_add_del_sa (vlib_main_t * vm, ipsec_sa_t * new_sa, int is_add)
 	  if (err)
 	    return VNET_API_ERROR_SYSCALL_ERROR_1;
 	}
+      ipsec_sa_runtime_free (sa);
       pool_put (im->sad, sa);
     }
   else				/* create new SA */
     {
+      if (!ipsec_replay_window_size_is_valid (new_sa->replay_window_size))
+	return VNET_API_ERROR_INVALID_VALUE;
       pool_get (im->sad, sa);
       clib_memcpy (sa, new_sa, sizeof (*sa));
+      ipsec_sa_replay_window_init (sa);
       sa_index = sa - im->sad;
       hash_set (im->sa_index_by_sa_id, sa->id, sa_index);
       if (im->cb.add_del_sa_sess_cb)
@@ -457,6 +600,7 @@ ipsec_add_del_sa (vlib_main_t * vm, ipsec_sa_t * new_sa, int is_add)
 	    return VNET_API_ERROR_SYSCALL_ERROR_1;
 	}
     }
+  ipsec_spd_flow_cache_invalidate (im);
   return 0;
 }
 
@@ -525,14 +669,46 @@ ipsec_rand_seed (void)
 static clib_error_t *
 ipsec_check_support (ipsec_sa_t * sa)
 {
-  if (sa->crypto_alg == IPSEC_CRYPTO_ALG_AES_GCM_128)
-    return clib_error_return (0, "unsupported aes-gcm-128 crypto-alg");
+  esp_main_t *em = &esp_main;
+
+  if (esp_crypto_alg_is_aead (sa->crypto_alg))
+    {
+      /* the key is followed by the 4 octets of salt, RFC 4106 section 8.1 */
+      if (sa->crypto_key_len !=
+	  EVP_CIPHER_key_length (em->esp_crypto_algs[sa->crypto_alg].type) +
+	  sizeof (sa->salt))
+	return clib_error_return (0, "invalid key length for %U crypto-alg",
+				  format_ipsec_crypto_alg, sa->crypto_alg);
+      if (sa->integ_alg != IPSEC_INTEG_ALG_NONE)
+	return clib_error_return (0, "unsupported integ-alg %U with %U",
+				  format_ipsec_integ_alg, sa->integ_alg,
+				  format_ipsec_crypto_alg, sa->crypto_alg);
+      return 0;
+    }
   if (sa->integ_alg == IPSEC_INTEG_ALG_NONE)
     return clib_error_return (0, "unsupported none integ-alg");
 
   return 0;
 }
 
+static clib_error_t *
+ipsec_add_del_sa_sess (u32 sa_index, u8 is_add)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_sa_t *sa = pool_elt_at_index (im->sad, sa_index);
+
+  /* also called when the keys of an SA are updated */
+  if (esp_crypto_alg_is_aead (sa->crypto_alg) &&
+      sa->crypto_key_len > sizeof (sa->salt))
+    clib_memcpy (&sa->salt,
+		 &sa->crypto_key[sa->crypto_key_len - sizeof (sa->salt)],
+		 sizeof (sa->salt));
+
+  esp_flush_sa_ctx (sa_index);
+
+  return 0;
+}
+
 static clib_error_t *
 ipsec_init (vlib_main_t * vm)
 {
@@ -554,6 +730,9 @@ ipsec_init (vlib_main_t * vm)
 
   vec_validate_aligned (im->empty_buffers, tm->n_vlib_mains - 1,
 			CLIB_CACHE_LINE_BYTES);
+  /* the tables are allocated along with the first SPD */
+  vec_validate_aligned (im->spd_flow_caches, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
 
   node = vlib_get_node_by_name (vm, (u8 *) "error-drop");
   ASSERT (node);
@@ -571,6 +750,7 @@ ipsec_init (vlib_main_t * vm)
   im->esp_decrypt_next_index = IPSEC_INPUT_NEXT_ESP_DECRYPT;
 
   im->cb.check_support_cb = ipsec_check_support;
+  im->cb.add_del_sa_sess_cb = ipsec_add_del_sa_sess;
 
   if ((error = vlib_call_init_function (vm, ipsec_cli_init)))
     return error;
@@ -578,6 +758,9 @@ ipsec_init (vlib_main_t * vm)
   if ((error = vlib_call_init_function (vm, ipsec_tunnel_if_init)))
     return error;
 
+  if ((error = vlib_call_init_function (vm, ipsec_handoff_init)))
+    return error;
+
   esp_init ();
 
   if ((error = ikev2_init (vm)))
@@ -17,9 +17,15 @@
 
 #include <vnet/ip/ip.h>
 #include <vnet/feature/feature.h>
+#include <vppinfra/xxhash.h>
+#include <vppinfra/lock.h>
 
 #define IPSEC_FLAG_IPSEC_GRE_TUNNEL (1 << 0)
 
+/* anti-replay window sizes, in packets */
+#define IPSEC_REPLAY_WINDOW_SIZE_DEFAULT (64)
+#define IPSEC_REPLAY_WINDOW_SIZE_MAX (4096)
+
 
 #define foreach_ipsec_output_next                \
 _(DROP, "error-drop")                            \
@@ -104,6 +110,39 @@ typedef enum
   IPSEC_PROTOCOL_ESP = 1
 } ipsec_protocol_t;
 
+/*
+ * Which thread processes the packets of an SA:
+ *  none   - the thread the packet arrives on
+ *  auto   - the first worker to process a packet of the SA owns it
+ *  worker - the given worker owns it
+ *  spread - any thread, each outbound packet gets its sequence number
+ *           from a block reserved by the thread
+ * The packets of an owned SA are handed off to the owner thread.
+ */
+#define foreach_ipsec_sa_affinity \
+  _(0, NONE, "none")              \
+  _(1, AUTO, "auto")              \
+  _(2, WORKER, "worker")          \
+  _(3, SPREAD, "spread")
+
+typedef enum
+{
+#define _(v,f,s) IPSEC_SA_AFFINITY_##f = v,
+  foreach_ipsec_sa_affinity
+#undef _
+} ipsec_sa_affinity_t;
+
+/* outbound sequence numbers reserved at once by a thread, spread SAs */
+#define IPSEC_SA_SEQ_BLOCK_SIZE (32)
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* next and end of the reserved block, ESN in the high bits */
+  u64 next;
+  u64 end;
+} ipsec_sa_seq_block_t;
+
 typedef struct
 {
   u32 id;
@@ -133,7 +172,20 @@ typedef struct
   u32 seq_hi;
   u32 last_seq;
   u32 last_seq_hi;
-  u64 replay_window;
+  /* anti-replay ring bitmap, see esp_replay_window_test () */
+  u64 *replay_window;
+  u32 replay_window_size;
+
+  /* packets dropped as replayed within the window, and left of it */
+  u64 replay_dups;
+  u64 replay_too_old;
+
+  /* thread affinity */
+  u8 affinity;
+  volatile u32 owner_thread_index;
+  /* per-thread sequence number blocks of a spread SA */
+  ipsec_sa_seq_block_t *seq_blocks;
+  clib_spinlock_t seq_lock;
 
   /*lifetime data */
   u64 total_data_size;
@@ -222,8 +274,66 @@ typedef struct
   u32 *ipv4_inbound_policy_discard_and_bypass_indices;
   u32 *ipv6_inbound_protect_policy_indices;
   u32 *ipv6_inbound_policy_discard_and_bypass_indices;
+  /* ipv4 inbound protect policy indices by SPI, in priority order */
+  uword *ipv4_inbound_protect_policy_indices_by_spi;
 } ipsec_spd_t;
 
+/*
+ * SPD flow cache.
+ *
+ * Each thread caches the result of the SPD lookups by flow, so a flow
+ * walks the policies only once.  The cached results are tagged with the
+ * SPD epoch, which is bumped by every SPD, policy and SA change, so the
+ * control plane invalidates all the caches at once without touching them.
+ * The cache is a fixed direct-mapped table: a new flow overwrites the
+ * entry in its slot, stale or not, so it never grows nor needs flushing.
+ */
+#define IPSEC_SPD_FLOW_CACHE_N_ENTRIES (1 << 16)
+
+typedef union
+{
+  struct
+  {
+    /* host byte order */
+    u32 laddr;
+    u32 raddr;
+    union
+    {
+      struct
+      {
+	u16 lport;
+	u16 rport;
+      };
+      /* inbound protect */
+      u32 spi;
+    };
+    u32 spd_index:23;
+    u32 is_inbound:1;
+    u32 protocol:8;
+  };
+  u64 as_u64[2];
+} ipsec_spd_flow_key_t;
+
+STATIC_ASSERT_SIZEOF (ipsec_spd_flow_key_t, 16);
+
+typedef struct
+{
+  u64 key[2];
+  /* SPD epoch << 32 | policy index */
+  u64 value;
+} ipsec_spd_flow_cache_entry_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  ipsec_spd_flow_cache_entry_t *entries;
+  /* counters */
+  u64 hits;
+  u64 misses;
+  /* current entries overwritten by another flow */
+  u64 evictions;
+} ipsec_spd_flow_cache_t;
+
 typedef struct
 {
   u32 spd_index;
@@ -241,6 +351,23 @@ typedef struct
   u32 hw_if_index;
 } ipsec_tunnel_if_t;
 
+typedef struct
+{
+  /* frame queue elements being filled, by owner thread */
+  vlib_frame_queue_elt_t **elt_by_thread;
+  vlib_frame_queue_t **congested_queue_by_thread;
+} ipsec_handoff_queue_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  ipsec_handoff_queue_t encrypt;
+  ipsec_handoff_queue_t decrypt;
+  /* packets handed off to the owner threads, and dropped on congestion */
+  u64 n_handed_off;
+  u64 n_congestion_drops;
+} ipsec_handoff_per_thread_data_t;
+
 typedef struct
 {
   clib_error_t *(*add_del_sa_sess_cb) (u32 sa_index, u8 is_add);
@@ -284,12 +411,27 @@ typedef struct
 
   /* callbacks */
   ipsec_main_callbacks_t cb;
+
+  /* SA owner handoff, see ipsec_handoff.c */
+  u32 n_sa_owned;
+  u32 esp_encrypt_fq_index;
+  u32 esp_decrypt_fq_index;
+  ipsec_handoff_per_thread_data_t *handoff_per_thread_data;
+  u32 first_worker_index;
+  u32 num_workers;
+
+  /* per-thread SPD flow caches */
+  ipsec_spd_flow_cache_t *spd_flow_caches;
+  /* bumped on every change invalidating the SPD lookup results */
+  volatile u32 spd_epoch;
 } ipsec_main_t;
 
 extern ipsec_main_t ipsec_main;
 
 extern vlib_node_registration_t esp_encrypt_node;
 extern vlib_node_registration_t esp_decrypt_node;
+extern vlib_node_registration_t esp_encrypt_async_node;
+extern vlib_node_registration_t esp_decrypt_async_node;
 extern vlib_node_registration_t ipsec_if_output_node;
 extern vlib_node_registration_t ipsec_if_input_node;
 
@@ -306,12 +448,22 @@ int ipsec_add_del_sa (vlib_main_t * vm, ipsec_sa_t * new_sa, int is_add);
 int ipsec_set_sa_key (vlib_main_t * vm, ipsec_sa_t * sa_update);
 
 u32 ipsec_get_sa_index_by_sa_id (u32 sa_id);
+int ipsec_replay_window_size_is_valid (u32 size);
+void ipsec_sa_replay_window_init (ipsec_sa_t * sa);
+void ipsec_sa_runtime_free (ipsec_sa_t * sa);
+int ipsec_sa_set_affinity (vlib_main_t * vm, u32 sa_id,
+			   ipsec_sa_affinity_t affinity, u32 worker);
+u32 ipsec_sa_handoff (vlib_main_t * vm, u32 fq_index,
+		      ipsec_handoff_queue_t * q, u32 * buffers, u32 n_buffers,
+		      u32 * n_congestion_drops);
+u64 ipsec_sa_replay_window_last64 (ipsec_sa_t * sa);
 u8 ipsec_is_sa_used (u32 sa_index);
 u8 *format_ipsec_if_output_trace (u8 * s, va_list * args);
 u8 *format_ipsec_policy_action (u8 * s, va_list * args);
 u8 *format_ipsec_crypto_alg (u8 * s, va_list * args);
 u8 *format_ipsec_integ_alg (u8 * s, va_list * args);
 u8 *format_ipsec_replay_window (u8 * s, va_list * args);
+u8 *format_ipsec_sa_affinity (u8 * s, va_list * args);
 uword unformat_ipsec_policy_action (unformat_input_t * input, va_list * args);
 uword unformat_ipsec_crypto_alg (unformat_input_t * input, va_list * args);
 uword unformat_ipsec_integ_alg (unformat_input_t * input, va_list * args);
@@ -354,6 +506,53 @@ ipsec_alloc_empty_buffers (vlib_main_t * vm, ipsec_main_t * im)
     }
 }
 
+/*
+ * Look a flow up in the SPD flow cache of the thread.  Returns 1 on a hit
+ * with the cached policy index, ~0 if no policy matched the flow.
+ */
+always_inline ipsec_spd_flow_cache_entry_t *
+ipsec_spd_flow_cache_entry (ipsec_spd_flow_cache_t * fc,
+			    ipsec_spd_flow_key_t * key)
+{
+  u64 h = clib_xxhash (key->as_u64[0] ^ key->as_u64[1]);
+  return fc->entries + (h & (IPSEC_SPD_FLOW_CACHE_N_ENTRIES - 1));
+}
+
+always_inline int
+ipsec_spd_flow_cache_lookup (ipsec_main_t * im, u32 thread_index,
+			     ipsec_spd_flow_key_t * key, u32 * policy_index)
+{
+  ipsec_spd_flow_cache_t *fc = vec_elt_at_index (im->spd_flow_caches,
+						 thread_index);
+  ipsec_spd_flow_cache_entry_t *e = ipsec_spd_flow_cache_entry (fc, key);
+
+  if (e->key[0] == key->as_u64[0] && e->key[1] == key->as_u64[1]
+      && (e->value >> 32) == im->spd_epoch)
+    {
+      fc->hits++;
+      *policy_index = (u32) e->value;
+      return 1;
+    }
+  fc->misses++;
+  return 0;
+}
+
+always_inline void
+ipsec_spd_flow_cache_add (ipsec_main_t * im, u32 thread_index,
+			  ipsec_spd_flow_key_t * key, u32 policy_index)
+{
+  ipsec_spd_flow_cache_t *fc = vec_elt_at_index (im->spd_flow_caches,
+						 thread_index);
+  ipsec_spd_flow_cache_entry_t *e = ipsec_spd_flow_cache_entry (fc, key);
+
+  if ((e->value >> 32) == im->spd_epoch)
+    fc->evictions++;
+
+  e->key[0] = key->as_u64[0];
+  e->key[1] = key->as_u64[1];
+  e->value = ((u64) im->spd_epoch << 32) | policy_index;
+}
+
 static_always_inline u32
 get_next_output_feature_node_index (vlib_buffer_t * b,
 				    vlib_node_runtime_t * nr)
@@ -238,6 +238,12 @@ static void vl_api_ipsec_sad_add_del_entry_t_handler
       clib_memcpy (&sa.tunnel_dst_addr.ip4.data, mp->tunnel_dst_address, 4);
     }
   sa.use_anti_replay = mp->use_anti_replay;
+  sa.replay_window_size = ntohl (mp->anti_replay_window_size);
+  if (!ipsec_replay_window_size_is_valid (sa.replay_window_size))
+    {
+      rv = VNET_API_ERROR_INVALID_VALUE;
+      goto out;
+    }
 
   ASSERT (im->cb.check_support_cb);
   clib_error_t *err = im->cb.check_support_cb (&sa);
@@ -460,7 +466,11 @@ send_ipsec_sa_details (ipsec_sa_t * sa, unix_shared_memory_queue_t * q,
       mp->last_seq_inbound |= (u64) (clib_host_to_net_u32 (sa->last_seq_hi));
     }
   if (sa->use_anti_replay)
-    mp->replay_window = clib_host_to_net_u64 (sa->replay_window);
+    mp->replay_window =
+      clib_host_to_net_u64 (ipsec_sa_replay_window_last64 (sa));
+  mp->replay_window_size = htonl (sa->replay_window_size);
+  mp->replay_dups = clib_host_to_net_u64 (sa->replay_dups);
+  mp->replay_too_old = clib_host_to_net_u64 (sa->replay_too_old);
   mp->total_data_size = clib_host_to_net_u64 (sa->total_data_size);
 
   vl_msg_api_send_shmem (q, (u8 *) & mp);
@@ -92,6 +92,22 @@ ipsec_sa_add_del_command_fn (vlib_main_t * vm,
 	is_add = 0;
       else if (unformat (line_input, "spi %u", &sa.spi))
 	;
+      else if (unformat (line_input, "esn"))
+	sa.use_esn = 1;
+      else if (unformat (line_input, "anti-replay-window %u",
+			 &sa.replay_window_size))
+	{
+	  sa.use_anti_replay = 1;
+	  if (!ipsec_replay_window_size_is_valid (sa.replay_window_size))
+	    {
+	      error = clib_error_return (0, "anti-replay window must be a "
+					 "power of 2 between 64 and %u",
+					 IPSEC_REPLAY_WINDOW_SIZE_MAX);
+	      goto done;
+	    }
+	}
+      else if (unformat (line_input, "anti-replay"))
+	sa.use_anti_replay = 1;
       else if (unformat (line_input, "esp"))
 	sa.protocol = IPSEC_PROTOCOL_ESP;
       else if (unformat (line_input, "ah"))
@@ -190,7 +206,7 @@ done:
 VLIB_CLI_COMMAND (ipsec_sa_add_del_command, static) = {
     .path = "ipsec sa",
     .short_help =
-    "ipsec sa [add|del]",
+    "ipsec sa [add|del] [esn] [anti-replay] [anti-replay-window <size>]",
     .function = ipsec_sa_add_del_command_fn,
 };
 /* *INDENT-ON* */
@@ -423,6 +439,86 @@ VLIB_CLI_COMMAND (set_ipsec_sa_key_command, static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+set_ipsec_sa_affinity_command_fn (vlib_main_t * vm,
+				  unformat_input_t * input,
+				  vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  u32 affinity = ~0;
+  u32 sa_id = ~0, worker = ~0;
+  clib_error_t *error = NULL;
+  int rv;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return 0;
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "worker %u", &worker))
+	affinity = IPSEC_SA_AFFINITY_WORKER;
+      else if (unformat (line_input, "auto"))
+	affinity = IPSEC_SA_AFFINITY_AUTO;
+      else if (unformat (line_input, "spread"))
+	affinity = IPSEC_SA_AFFINITY_SPREAD;
+      else if (unformat (line_input, "none"))
+	affinity = IPSEC_SA_AFFINITY_NONE;
+      else if (unformat (line_input, "%u", &sa_id))
+	;
+      else
+	{
+	  error = clib_error_return (0, "parse error: '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (sa_id == ~0 || affinity == ~0)
+    {
+      error = clib_error_return (0, "SA id and affinity required");
+      goto done;
+    }
+
+  rv = ipsec_sa_set_affinity (vm, sa_id, affinity, worker);
+  switch (rv)
+    {
+    case 0:
+      break;
+    case VNET_API_ERROR_NO_SUCH_ENTRY:
+      error = clib_error_return (0, "SA %u not found", sa_id);
+      break;
+    case VNET_API_ERROR_INVALID_WORKER:
+      error = clib_error_return (0, "invalid worker");
+      break;
+    default:
+      error = clib_error_return (0, "ipsec_sa_set_affinity returned %d", rv);
+    }
+
+done:
+  unformat_free (line_input);
+
+  return error;
+}
+
+/*?
+ * Select which thread processes the packets of an SA. The packets of an
+ * SA owned by a worker, either given or the first one to process it with
+ * 'auto', are handed off to it. The outbound packets of a 'spread' SA
+ * are processed by any thread, each reserving blocks of sequence
+ * numbers; the peer's anti-replay window must then cover the reordering.
+ *
+ * @cliexpar
+ * @cliexcmd{set ipsec sa affinity 10 worker 1}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_ipsec_sa_affinity_command, static) = {
+    .path = "set ipsec sa affinity",
+    .short_help =
+    "set ipsec sa affinity <id> [none|auto|spread|worker <n>]",
+    .function = set_ipsec_sa_affinity_command_fn,
+};
+/* *INDENT-ON* */
+
 static clib_error_t *
 show_ipsec_command_fn (vlib_main_t * vm,
 		       unformat_input_t * input, vlib_cli_command_t * cmd)
@@ -433,6 +529,7 @@ show_ipsec_command_fn (vlib_main_t * vm,
   ipsec_main_t *im = &ipsec_main;
   u32 *i;
   ipsec_tunnel_if_t *t;
+  ipsec_spd_flow_cache_t *fc;
   vnet_hw_interface_t *hi;
 
   /* *INDENT-OFF* */
@@ -459,6 +556,20 @@ show_ipsec_command_fn (vlib_main_t * vm,
                         format_ip4_address, &sa->tunnel_src_addr.ip4,
                         format_ip4_address, &sa->tunnel_dst_addr.ip4);
       }
+      if (sa->use_anti_replay) {
+        vlib_cli_output(vm, "  anti-replay window %u esn %u replayed %llu "
+                        "too-old %llu", sa->replay_window_size, sa->use_esn,
+                        sa->replay_dups, sa->replay_too_old);
+      }
+      if (sa->affinity != IPSEC_SA_AFFINITY_NONE) {
+        if (sa->owner_thread_index != ~0)
+          vlib_cli_output(vm, "  affinity %U thread %u",
+                          format_ipsec_sa_affinity, sa->affinity,
+                          sa->owner_thread_index);
+        else
+          vlib_cli_output(vm, "  affinity %U", format_ipsec_sa_affinity,
+                          sa->affinity);
+      }
     }
   }));
   /* *INDENT-ON* */
@@ -610,6 +721,29 @@ show_ipsec_command_fn (vlib_main_t * vm,
   }));
   /* *INDENT-ON* */
 
+  vlib_cli_output (vm, "spd flow cache epoch %u", im->spd_epoch);
+  vec_foreach (fc, im->spd_flow_caches)
+  {
+    if (!fc->entries)
+      continue;
+    vlib_cli_output (vm, "  thread %u hits %llu misses %llu evictions %llu",
+		     fc - im->spd_flow_caches, fc->hits, fc->misses,
+		     fc->evictions);
+  }
+
+  if (im->n_sa_owned)
+    {
+      ipsec_handoff_per_thread_data_t *hptd;
+
+      vlib_cli_output (vm, "sa owner handoff");
+      vec_foreach (hptd, im->handoff_per_thread_data)
+      {
+	vlib_cli_output (vm, "  thread %u handed-off %llu congestion-drops "
+			 "%llu", hptd - im->handoff_per_thread_data,
+			 hptd->n_handed_off, hptd->n_congestion_drops);
+      }
+    }
+
   vlib_cli_output (vm, "tunnel interfaces");
   /* *INDENT-OFF* */
   pool_foreach (t, im->tunnel_interfaces, ({
@@ -632,7 +766,11 @@ show_ipsec_command_fn (vlib_main_t * vm,
     vlib_cli_output(vm, "   last-seq %u last-seq-hi %u esn %u anti-replay %u window %U",
                     sa->last_seq, sa->last_seq_hi, sa->use_esn,
                     sa->use_anti_replay,
-                    format_ipsec_replay_window, sa->replay_window);
+                    format_ipsec_replay_window,
+                    ipsec_sa_replay_window_last64 (sa));
+    vlib_cli_output(vm, "   window-size %u replayed %llu too-old %llu",
+                    sa->replay_window_size, sa->replay_dups,
+                    sa->replay_too_old);
     vlib_cli_output(vm, "   remote-spi %u remote-ip %U", sa->spi,
                     format_ip4_address, &sa->tunnel_src_addr.ip4);
     vlib_cli_output(vm, "   remote-crypto %U %U",
@@ -662,6 +800,9 @@ clear_ipsec_counters_command_fn (vlib_main_t * vm,
   ipsec_main_t *im = &ipsec_main;
   ipsec_spd_t *spd;
   ipsec_policy_t *p;
+  ipsec_spd_flow_cache_t *fc;
+  ipsec_handoff_per_thread_data_t *hptd;
+  ipsec_sa_t *sa;
 
   /* *INDENT-OFF* */
   pool_foreach (spd, im->spds, ({
@@ -671,6 +812,22 @@ clear_ipsec_counters_command_fn (vlib_main_t * vm,
   }));
   /* *INDENT-ON* */
 
+  vec_foreach (fc, im->spd_flow_caches)
+  {
+    fc->hits = fc->misses = fc->evictions = 0;
+  }
+
+  vec_foreach (hptd, im->handoff_per_thread_data)
+  {
+    hptd->n_handed_off = hptd->n_congestion_drops = 0;
+  }
+
+  /* *INDENT-OFF* */
+  pool_foreach (sa, im->sad, ({
+    sa->replay_dups = sa->replay_too_old = 0;
+  }));
+  /* *INDENT-ON* */
+
   return 0;
 }
 
@@ -104,6 +104,24 @@ format_ipsec_integ_alg (u8 * s, va_list * args)
   return s;
 }
 
+u8 *
+format_ipsec_sa_affinity (u8 * s, va_list * args)
+{
+  u32 i = va_arg (*args, u32);
+  u8 *t = 0;
+
+  switch (i)
+    {
+#define _(v,f,str) case IPSEC_SA_AFFINITY_##f: t = (u8 *) str; break;
+      foreach_ipsec_sa_affinity
+#undef _
+    default:
+      s = format (s, "unknown");
+    }
+  s = format (s, "%s", t);
+  return s;
+}
+
 uword
 unformat_ipsec_integ_alg (unformat_input_t * input, va_list * args)
 {
@@ -0,0 +1,249 @@
+/*
+ * ipsec_handoff.c : IPSec SA thread affinity
+ *
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vnet/vnet.h>
+#include <vnet/api_errno.h>
+#include <vnet/ipsec/ipsec.h>
+
+/*
+ * The packets of an owned SA are processed by the owner thread only, so
+ * the SA state (sequence numbers, anti-replay window) is never shared.
+ * The ESP nodes hand the packets of the SAs owned by another thread off
+ * to the same node on the owner thread, through a frame queue.  As the
+ * frame queues are drained by the workers only, the SAs are owned by
+ * workers.
+ */
+
+#define IPSEC_HANDOFF_FRAME_QUEUE_NELTS 32
+
+/* thread which is to process the packets of sa on this thread */
+always_inline u32
+ipsec_sa_owner (ipsec_sa_t * sa, u32 thread_index)
+{
+  u32 owner = sa->owner_thread_index;
+
+  if (PREDICT_TRUE (sa->affinity == IPSEC_SA_AFFINITY_NONE ||
+		    sa->affinity == IPSEC_SA_AFFINITY_SPREAD))
+    return thread_index;
+
+  if (sa->affinity == IPSEC_SA_AFFINITY_AUTO && owner == ~0)
+    {
+      /* the main thread does not drain the frame queues, can't own */
+      if (thread_index == 0)
+	return thread_index;
+      owner = clib_smp_compare_and_swap (&sa->owner_thread_index,
+					 thread_index, ~0);
+      if (owner == ~0)
+	owner = thread_index;
+    }
+
+  return owner;
+}
+
+/*
+ * Hand the buffers of the SAs owned by other threads off to them.
+ * The buffers to process on this thread are moved to the front of
+ * buffers, returns their count.
+ */
+u32
+ipsec_sa_handoff (vlib_main_t * vm, u32 fq_index, ipsec_handoff_queue_t * q,
+		  u32 * buffers, u32 n_buffers, u32 * n_congestion_drops)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_handoff_per_thread_data_t *ptd;
+  u32 thread_index = vm->thread_index;
+  vlib_frame_queue_elt_t *hf;
+  vlib_frame_queue_t *fq0;
+  u32 *drop = 0;
+  u32 i, n_keep = 0, n_handed_off = 0;
+
+  ptd = vec_elt_at_index (im->handoff_per_thread_data, thread_index);
+
+  for (i = 0; i < n_buffers; i++)
+    {
+      vlib_buffer_t *b0 = vlib_get_buffer (vm, buffers[i]);
+      ipsec_sa_t *sa0 = pool_elt_at_index (im->sad,
+					   vnet_buffer (b0)->ipsec.sad_index);
+      u32 owner0 = ipsec_sa_owner (sa0, thread_index);
+
+      if (PREDICT_TRUE (owner0 == thread_index))
+	{
+	  buffers[n_keep++] = buffers[i];
+	  continue;
+	}
+
+      fq0 = is_vlib_frame_queue_congested (fq_index, owner0,
+					   IPSEC_HANDOFF_FRAME_QUEUE_NELTS
+					   - 2, q->congested_queue_by_thread);
+      if (PREDICT_FALSE (fq0 != 0))
+	{
+	  vec_add1 (drop, buffers[i]);
+	  continue;
+	}
+
+      hf = vlib_get_worker_handoff_queue_elt (fq_index, owner0,
+					      q->elt_by_thread);
+      hf->buffer_index[hf->n_vectors++] = buffers[i];
+      n_handed_off++;
+
+      if (hf->n_vectors == VLIB_FRAME_SIZE)
+	{
+	  vlib_put_frame_queue_elt (hf);
+	  q->elt_by_thread[owner0] = 0;
+	}
+    }
+
+  /* ship the partially filled elements */
+  for (i = 0; i < vec_len (q->elt_by_thread); i++)
+    {
+      if (q->elt_by_thread[i])
+	{
+	  vlib_put_frame_queue_elt (q->elt_by_thread[i]);
+	  q->elt_by_thread[i] = 0;
+	}
+      q->congested_queue_by_thread[i] = (vlib_frame_queue_t *) (~0);
+    }
+
+  ptd->n_handed_off += n_handed_off;
+  *n_congestion_drops = vec_len (drop);
+  if (PREDICT_FALSE (drop != 0))
+    {
+      ptd->n_congestion_drops += vec_len (drop);
+      vlib_buffer_free (vm, drop, vec_len (drop));
+      vec_free (drop);
+    }
+
+  return n_keep;
+}
+
+int
+ipsec_sa_set_affinity (vlib_main_t * vm, u32 sa_id,
+		       ipsec_sa_affinity_t affinity, u32 worker)
+{
+  ipsec_main_t *im = &ipsec_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  ipsec_sa_t *sa;
+  u32 sa_index;
+  int was_owned, is_owned;
+
+  sa_index = ipsec_get_sa_index_by_sa_id (sa_id);
+  if (sa_index == ~0)
+    return VNET_API_ERROR_NO_SUCH_ENTRY;
+
+  is_owned = (affinity == IPSEC_SA_AFFINITY_AUTO ||
+	      affinity == IPSEC_SA_AFFINITY_WORKER);
+
+  if (is_owned && im->num_workers == 0)
+    return VNET_API_ERROR_INVALID_WORKER;
+  if (affinity == IPSEC_SA_AFFINITY_WORKER && worker >= im->num_workers)
+    return VNET_API_ERROR_INVALID_WORKER;
+
+  sa = pool_elt_at_index (im->sad, sa_index);
+  was_owned = (sa->affinity == IPSEC_SA_AFFINITY_AUTO ||
+	       sa->affinity == IPSEC_SA_AFFINITY_WORKER);
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  /* the frame queues are drained by the workers, create them once */
+  if (is_owned && im->esp_encrypt_fq_index == ~0)
+    {
+      im->esp_encrypt_fq_index =
+	vlib_frame_queue_main_init (esp_encrypt_node.index,
+				    IPSEC_HANDOFF_FRAME_QUEUE_NELTS);
+      im->esp_decrypt_fq_index =
+	vlib_frame_queue_main_init (esp_decrypt_node.index,
+				    IPSEC_HANDOFF_FRAME_QUEUE_NELTS);
+    }
+
+  im->n_sa_owned += is_owned - was_owned;
+
+  /* the numbers left in the blocks are skipped, which the peer accepts */
+  if (affinity == IPSEC_SA_AFFINITY_SPREAD && !sa->seq_blocks)
+    {
+      vec_validate_aligned (sa->seq_blocks, tm->n_vlib_mains - 1,
+			    CLIB_CACHE_LINE_BYTES);
+      clib_spinlock_init (&sa->seq_lock);
+    }
+  else if (affinity != IPSEC_SA_AFFINITY_SPREAD && sa->seq_blocks)
+    {
+      vec_free (sa->seq_blocks);
+      clib_spinlock_free (&sa->seq_lock);
+    }
+
+  sa->owner_thread_index = (affinity == IPSEC_SA_AFFINITY_WORKER) ?
+    im->first_worker_index + worker : ~0;
+  sa->affinity = affinity;
+
+  vlib_worker_thread_barrier_release (vm);
+
+  return 0;
+}
+
+static clib_error_t *
+ipsec_handoff_init (vlib_main_t * vm)
+{
+  ipsec_main_t *im = &ipsec_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  ipsec_handoff_per_thread_data_t *ptd;
+  vlib_thread_registration_t *tr;
+  clib_error_t *error;
+  uword *p;
+
+  if ((error = vlib_call_init_function (vm, threads_init)))
+    return error;
+
+  /* Only the standard vnet worker threads are supported */
+  p = hash_get_mem (tm->thread_registrations_by_name, "workers");
+  if (p)
+    {
+      tr = (vlib_thread_registration_t *) p[0];
+      if (tr)
+	{
+	  im->num_workers = tr->count;
+	  im->first_worker_index = tr->first_index;
+	}
+    }
+
+  im->esp_encrypt_fq_index = ~0;
+  im->esp_decrypt_fq_index = ~0;
+
+  vec_validate_aligned (im->handoff_per_thread_data, tm->n_vlib_mains - 1,
+			CLIB_CACHE_LINE_BYTES);
+  vec_foreach (ptd, im->handoff_per_thread_data)
+  {
+    vec_validate (ptd->encrypt.elt_by_thread, tm->n_vlib_mains - 1);
+    vec_validate_init_empty (ptd->encrypt.congested_queue_by_thread,
+			     tm->n_vlib_mains - 1,
+			     (vlib_frame_queue_t *) (~0));
+    vec_validate (ptd->decrypt.elt_by_thread, tm->n_vlib_mains - 1);
+    vec_validate_init_empty (ptd->decrypt.congested_queue_by_thread,
+			     tm->n_vlib_mains - 1,
+			     (vlib_frame_queue_t *) (~0));
+  }
+
+  return 0;
+}
+
+VLIB_INIT_FUNCTION (ipsec_handoff_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
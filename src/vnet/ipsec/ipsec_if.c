@@ -173,6 +173,7 @@ ipsec_add_del_tunnel_if_internal (vnet_main_t * vnm,
 
       pool_get (im->sad, sa);
       memset (sa, 0, sizeof (*sa));
+      ipsec_sa_replay_window_init (sa);
       t->input_sa_index = sa - im->sad;
       sa->spi = args->remote_spi;
       sa->tunnel_src_addr.ip4.as_u32 = args->remote_ip.as_u32;
@@ -197,6 +198,7 @@ ipsec_add_del_tunnel_if_internal (vnet_main_t * vnm,
 
       pool_get (im->sad, sa);
       memset (sa, 0, sizeof (*sa));
+      ipsec_sa_replay_window_init (sa);
       t->output_sa_index = sa - im->sad;
       sa->spi = args->local_spi;
       sa->tunnel_src_addr.ip4.as_u32 = args->local_ip.as_u32;
@@ -270,11 +272,11 @@ ipsec_add_del_tunnel_if_internal (vnet_main_t * vnm,
 
       /* delete input and output SA */
       sa = pool_elt_at_index (im->sad, t->input_sa_index);
-
+      ipsec_sa_runtime_free (sa);
       pool_put (im->sad, sa);
 
       sa = pool_elt_at_index (im->sad, t->output_sa_index);
-
+      ipsec_sa_runtime_free (sa);
       pool_put (im->sad, sa);
 
       hash_unset (im->ipsec_if_pool_index_by_key, key);
@@ -472,6 +474,7 @@ ipsec_set_interface_sa (vnet_main_t * vnm, u32 hw_if_index, u32 sa_id,
 	return VNET_API_ERROR_SYSCALL_ERROR_1;
     }
 
+  ipsec_sa_runtime_free (old_sa);
   pool_put (im->sad, old_sa);
 
   return 0;
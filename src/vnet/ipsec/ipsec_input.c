@@ -79,16 +79,19 @@ ipsec_input_protect_policy_match (ipsec_spd_t * spd, u32 sa, u32 da, u32 spi)
   ipsec_main_t *im = &ipsec_main;
   ipsec_policy_t *p;
   ipsec_sa_t *s;
+  uword *e;
   u32 *i;
 
-  vec_foreach (i, spd->ipv4_inbound_protect_policy_indices)
+  /* only the policies with an SA of this SPI can match */
+  e = hash_get (spd->ipv4_inbound_protect_policy_indices_by_spi, spi);
+  if (!e)
+    return 0;
+
+  vec_foreach (i, (u32 *) e[0])
   {
     p = pool_elt_at_index (spd->policies, *i);
     s = pool_elt_at_index (im->sad, p->sa_index);
 
-    if (spi != s->spi)
-      continue;
-
     if (s->is_tunnel)
       {
 	if (da != clib_net_to_host_u32 (s->tunnel_dst_addr.ip4.as_u32))
@@ -117,6 +120,34 @@ ipsec_input_protect_policy_match (ipsec_spd_t * spd, u32 sa, u32 da, u32 spi)
   return 0;
 }
 
+always_inline ipsec_policy_t *
+ipsec_input_protect_policy_match_cached (ipsec_main_t * im, u32 thread_index,
+					 u32 spd_index, ipsec_spd_t * spd,
+					 u32 sa, u32 da, u32 spi)
+{
+  ipsec_spd_flow_key_t key;
+  ipsec_policy_t *p;
+  u32 policy_index;
+
+  key.as_u64[0] = key.as_u64[1] = 0;
+  key.laddr = da;
+  key.raddr = sa;
+  key.spi = spi;
+  key.spd_index = spd_index;
+  key.is_inbound = 1;
+  key.protocol = IP_PROTOCOL_IPSEC_ESP;
+
+  if (PREDICT_TRUE (ipsec_spd_flow_cache_lookup (im, thread_index, &key,
+						 &policy_index)))
+    return (policy_index == ~0) ? 0 :
+      pool_elt_at_index (spd->policies, policy_index);
+
+  p = ipsec_input_protect_policy_match (spd, sa, da, spi);
+  ipsec_spd_flow_cache_add (im, thread_index, &key,
+			    p ? p - spd->policies : ~0);
+  return p;
+}
+
 always_inline uword
 ip6_addr_match_range (ip6_address_t * a, ip6_address_t * la,
 		      ip6_address_t * ua)
@@ -176,6 +207,7 @@ ipsec_input_ip4_node_fn (vlib_main_t * vm,
 {
   u32 n_left_from, *from, next_index, *to_next;
   ipsec_main_t *im = &ipsec_main;
+  u32 thread_index = vlib_get_thread_index ();
 
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
@@ -226,15 +258,17 @@ ipsec_input_ip4_node_fn (vlib_main_t * vm,
 		 clib_net_to_host_u16 (ip0->length), spd0->id);
 #endif
 
-	      p0 = ipsec_input_protect_policy_match (spd0,
-						     clib_net_to_host_u32
-						     (ip0->src_address.
-						      as_u32),
-						     clib_net_to_host_u32
-						     (ip0->dst_address.
-						      as_u32),
-						     clib_net_to_host_u32
-						     (esp0->spi));
+	      p0 = ipsec_input_protect_policy_match_cached (im, thread_index,
+							    c0->spd_index,
+							    spd0,
+							    clib_net_to_host_u32
+							    (ip0->src_address.
+							     as_u32),
+							    clib_net_to_host_u32
+							    (ip0->dst_address.
+							     as_u32),
+							    clib_net_to_host_u32
+							    (esp0->spi));
 
 	      if (PREDICT_TRUE (p0 != 0))
 		{
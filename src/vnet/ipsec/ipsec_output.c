@@ -120,6 +120,41 @@ ipsec_output_policy_match (ipsec_spd_t * spd, u8 pr, u32 la, u32 ra, u16 lp,
   return 0;
 }
 
+always_inline ipsec_policy_t *
+ipsec_output_policy_match_cached (ipsec_main_t * im, u32 thread_index,
+				  u32 spd_index, ipsec_spd_t * spd, u8 pr,
+				  u32 la, u32 ra, u16 lp, u16 rp)
+{
+  ipsec_spd_flow_key_t key;
+  ipsec_policy_t *p;
+  u32 policy_index;
+
+  if (!spd)
+    return 0;
+
+  key.as_u64[0] = key.as_u64[1] = 0;
+  key.laddr = la;
+  key.raddr = ra;
+  /* the ports are only matched for TCP and UDP */
+  if (PREDICT_TRUE ((pr == IP_PROTOCOL_TCP) || (pr == IP_PROTOCOL_UDP)))
+    {
+      key.lport = lp;
+      key.rport = rp;
+    }
+  key.spd_index = spd_index;
+  key.protocol = pr;
+
+  if (PREDICT_TRUE (ipsec_spd_flow_cache_lookup (im, thread_index, &key,
+						 &policy_index)))
+    return (policy_index == ~0) ? 0 :
+      pool_elt_at_index (spd->policies, policy_index);
+
+  p = ipsec_output_policy_match (spd, pr, la, ra, lp, rp);
+  ipsec_spd_flow_cache_add (im, thread_index, &key,
+			    p ? p - spd->policies : ~0);
+  return p;
+}
+
 always_inline uword
 ip6_addr_match_range (ip6_address_t * a, ip6_address_t * la,
 		      ip6_address_t * ua)
@@ -186,6 +221,7 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   vlib_frame_t *f = 0;
   u32 spd_index0 = ~0;
   ipsec_spd_t *spd0 = 0;
+  u32 thread_index = vlib_get_thread_index ();
   u64 nc_protect = 0, nc_bypass = 0, nc_discard = 0, nc_nomatch = 0;
 
   from = vlib_frame_vector_args (from_frame);
@@ -255,15 +291,17 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 			sw_if_index0, spd_index0, spd0->id);
 #endif
 
-	  p0 = ipsec_output_policy_match (spd0, ip0->protocol,
-					  clib_net_to_host_u32
-					  (ip0->src_address.as_u32),
-					  clib_net_to_host_u32
-					  (ip0->dst_address.as_u32),
-					  clib_net_to_host_u16
-					  (udp0->src_port),
-					  clib_net_to_host_u16
-					  (udp0->dst_port));
+	  p0 = ipsec_output_policy_match_cached (im, thread_index,
+						 spd_index0, spd0,
+						 ip0->protocol,
+						 clib_net_to_host_u32
+						 (ip0->src_address.as_u32),
+						 clib_net_to_host_u32
+						 (ip0->dst_address.as_u32),
+						 clib_net_to_host_u16
+						 (udp0->src_port),
+						 clib_net_to_host_u16
+						 (udp0->dst_port));
 	}
 
       if (PREDICT_TRUE (p0 != NULL))
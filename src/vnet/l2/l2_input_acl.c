@@ -159,7 +159,7 @@ l2_inacl_node_fn (vlib_main_t * vm,
 	h0 = b0->data;
 
       vnet_buffer (b0)->l2_classify.hash =
-	vnet_classify_hash_packet (t0, (u8 *) h0);
+	vnet_classify_hash_packet_inline (t0, (u8 *) h0);
 
       vnet_classify_prefetch_bucket (t0, vnet_buffer (b0)->l2_classify.hash);
 
@@ -169,7 +169,7 @@ l2_inacl_node_fn (vlib_main_t * vm,
 	h1 = b1->data;
 
       vnet_buffer (b1)->l2_classify.hash =
-	vnet_classify_hash_packet (t1, (u8 *) h1);
+	vnet_classify_hash_packet_inline (t1, (u8 *) h1);
 
       vnet_classify_prefetch_bucket (t1, vnet_buffer (b1)->l2_classify.hash);
 
@@ -205,7 +205,7 @@ l2_inacl_node_fn (vlib_main_t * vm,
 	h0 = b0->data;
 
       vnet_buffer (b0)->l2_classify.hash =
-	vnet_classify_hash_packet (t0, (u8 *) h0);
+	vnet_classify_hash_packet_inline (t0, (u8 *) h0);
 
       vnet_buffer (b0)->l2_classify.table_index = table_index0;
       vnet_classify_prefetch_bucket (t0, vnet_buffer (b0)->l2_classify.hash);
@@ -287,7 +287,7 @@ l2_inacl_node_fn (vlib_main_t * vm,
 	      else
 		h0 = b0->data;
 
-	      e0 = vnet_classify_find_entry (t0, (u8 *) h0, hash0, now);
+	      e0 = vnet_classify_find_entry_inline (t0, (u8 *) h0, hash0, now);
 	      if (e0)
 		{
 		  vnet_buffer (b0)->l2_classify.opaque_index
@@ -333,8 +333,8 @@ l2_inacl_node_fn (vlib_main_t * vm,
 		      else
 			h0 = b0->data;
 
-		      hash0 = vnet_classify_hash_packet (t0, (u8 *) h0);
-		      e0 = vnet_classify_find_entry
+		      hash0 = vnet_classify_hash_packet_inline (t0, (u8 *) h0);
+		      e0 = vnet_classify_find_entry_inline
 			(t0, (u8 *) h0, hash0, now);
 		      if (e0)
 			{
@@ -0,0 +1,448 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <regex.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vppinfra/mem.h>
+#include <vppinfra/format.h>
+#include <vppinfra/time.h>
+
+#include "stat_client.h"
+
+/* seconds a reader waits for vpp to complete a change of the segment */
+#define STAT_SEGMENT_ACCESS_TIMEOUT 1.0
+
+typedef struct
+{
+  stat_segment_shared_header_t *shared_header;
+  u64 size;
+} stat_client_main_t;
+
+stat_client_main_t stat_client_main;
+
+typedef struct
+{
+  u64 epoch;
+} stat_segment_access_t;
+
+int
+stat_segment_connect (char *segment_name)
+{
+  stat_client_main_t *sm = &stat_client_main;
+  stat_segment_shared_header_t *sh;
+  u64 size;
+  int fd;
+
+  if (!clib_mem_get_heap ())
+    clib_mem_init (0, 64 << 20);
+
+  fd = shm_open (segment_name, O_RDONLY, 0);
+  if (fd < 0)
+    return -1;
+
+  sh = mmap (0, sizeof (*sh), PROT_READ, MAP_SHARED, fd, 0);
+  if (sh == MAP_FAILED)
+    {
+      close (fd);
+      return -1;
+    }
+  if (sh->version != STAT_SEGMENT_VERSION)
+    {
+      munmap (sh, sizeof (*sh));
+      close (fd);
+      return -1;
+    }
+  size = sh->size;
+  munmap (sh, sizeof (*sh));
+
+  sh = mmap (0, size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (sh == MAP_FAILED)
+    return -1;
+
+  sm->shared_header = sh;
+  sm->size = size;
+  return 0;
+}
+
+void
+stat_segment_disconnect (void)
+{
+  stat_client_main_t *sm = &stat_client_main;
+
+  if (sm->shared_header)
+    munmap (sm->shared_header, sm->size);
+  sm->shared_header = 0;
+}
+
+/*
+ * Wait for vpp to be done with the segment, note the epoch. -1 if vpp
+ * stays in the middle of a change, it may have died there.
+ */
+static int
+stat_segment_access_start (stat_segment_access_t * sa)
+{
+  stat_segment_shared_header_t *sh = stat_client_main.shared_header;
+  f64 deadline = 0;
+
+  while (1)
+    {
+      if (sh->in_progress)
+	{
+	  if (deadline == 0)
+	    deadline = unix_time_now () + STAT_SEGMENT_ACCESS_TIMEOUT;
+	  else if (unix_time_now () > deadline)
+	    return -1;
+	  continue;
+	}
+      sa->epoch = sh->epoch;
+      CLIB_MEMORY_BARRIER ();
+      if (!sh->in_progress)
+	return 0;
+    }
+}
+
+/* was what was read since stat_segment_access_start () consistent */
+static int
+stat_segment_access_end (stat_segment_access_t * sa)
+{
+  stat_segment_shared_header_t *sh = stat_client_main.shared_header;
+
+  CLIB_MEMORY_BARRIER ();
+  return (!sh->in_progress && sh->epoch == sa->epoch);
+}
+
+/* is v a vector of elt_bytes elements in the segment */
+static int
+stat_segment_vec_is_valid (void *v, uword elt_bytes)
+{
+  stat_segment_shared_header_t *sh = stat_client_main.shared_header;
+
+  if (!v)
+    return 1;
+  if (!stat_segment_pointer_is_valid (sh, _vec_find (v)))
+    return 0;
+  return stat_segment_pointer_is_valid (sh, (u8 *) v +
+					vec_len (v) * elt_bytes - 1);
+}
+
+static stat_segment_directory_entry_t *
+stat_segment_directory (void)
+{
+  stat_segment_shared_header_t *sh = stat_client_main.shared_header;
+  stat_segment_directory_entry_t *dir =
+    stat_segment_pointer (sh, sh->directory_offset);
+
+  return stat_segment_vec_is_valid (dir, sizeof (dir[0])) ? dir : 0;
+}
+
+u32 *
+stat_segment_ls (u8 ** patterns)
+{
+  stat_segment_directory_entry_t *dir;
+  stat_segment_access_t sa;
+  regex_t *regexes = 0, *r;
+  u32 *indices = 0;
+  u8 **pattern;
+  u32 i;
+
+  if (!stat_client_main.shared_header)
+    return 0;
+
+  vec_foreach (pattern, patterns)
+  {
+    u8 *p = format (0, "%v%c", *pattern, 0);
+    vec_add2 (regexes, r, 1);
+    if (regcomp (r, (char *) p, REG_EXTENDED | REG_NOSUB))
+      _vec_len (regexes)--;
+    vec_free (p);
+  }
+
+retry:
+  vec_reset_length (indices);
+  if (stat_segment_access_start (&sa))
+    {
+      vec_free (indices);
+      goto done;
+    }
+
+  dir = stat_segment_directory ();
+  for (i = 0; i < vec_len (dir); i++)
+    {
+      char name[STAT_SEGMENT_NAME_LEN];
+
+      strncpy (name, dir[i].name, sizeof (name) - 1);
+      name[sizeof (name) - 1] = 0;
+
+      if (!patterns)
+	{
+	  vec_add1 (indices, i);
+	  continue;
+	}
+      vec_foreach (r, regexes)
+      {
+	if (regexec (r, name, 0, 0, 0) == 0)
+	  {
+	    vec_add1 (indices, i);
+	    break;
+	  }
+      }
+    }
+
+  if (!stat_segment_access_end (&sa))
+    goto retry;
+
+done:
+  vec_foreach (r, regexes) regfree (r);
+  vec_free (regexes);
+
+  return indices;
+}
+
+static char *
+stat_segment_name_dup (char *name)
+{
+  u32 len = strnlen (name, STAT_SEGMENT_NAME_LEN - 1);
+  char *s = 0;
+
+  vec_validate (s, len);
+  clib_memcpy (s, name, len);
+  s[len] = 0;
+  return s;
+}
+
+char *
+stat_segment_index_to_name (u32 index)
+{
+  stat_segment_directory_entry_t *dir;
+  stat_segment_access_t sa;
+  char *name;
+
+  if (!stat_client_main.shared_header)
+    return 0;
+
+retry:
+  name = 0;
+  if (stat_segment_access_start (&sa))
+    return 0;
+  dir = stat_segment_directory ();
+  if (index < vec_len (dir))
+    name = stat_segment_name_dup (dir[index].name);
+  if (!stat_segment_access_end (&sa))
+    {
+      vec_free (name);
+      goto retry;
+    }
+
+  return name;
+}
+
+void
+stat_segment_vec_free (void *v)
+{
+  vec_free (v);
+}
+
+/* copy the per-thread counter vectors, 0 if inconsistent */
+static void **
+stat_segment_copy_counters (u64 offset, uword elt_bytes, int *ok)
+{
+  stat_segment_shared_header_t *sh = stat_client_main.shared_header;
+  void **counters = stat_segment_pointer (sh, offset);
+  void **res = 0;
+  u32 i;
+
+  if (!stat_segment_vec_is_valid (counters, sizeof (counters[0])))
+    goto inconsistent;
+  if (!vec_len (counters))
+    return 0;
+
+  vec_validate (res, vec_len (counters) - 1);
+  for (i = 0; i < vec_len (counters); i++)
+    {
+      void *v = stat_segment_rebase (sh, counters[i]);
+
+      if (!stat_segment_vec_is_valid (v, elt_bytes))
+	goto inconsistent;
+      if (!vec_len (v))
+	continue;
+      res[i] = _vec_resize (res[i], vec_len (v), vec_len (v) * elt_bytes,
+			    0, CLIB_CACHE_LINE_BYTES);
+      clib_memcpy (res[i], v, vec_len (v) * elt_bytes);
+    }
+  return res;
+
+inconsistent:
+  for (i = 0; i < vec_len (res); i++)
+    vec_free (res[i]);
+  vec_free (res);
+  *ok = 0;
+  return 0;
+}
+
+static int
+stat_segment_copy_entry (stat_segment_directory_entry_t * ep,
+			 stat_segment_data_t * d)
+{
+  stat_segment_shared_header_t *sh = stat_client_main.shared_header;
+  u64 **errors = stat_segment_pointer (sh, sh->error_offset);
+  int ok = 1;
+  u32 i;
+
+  d->type = ep->type;
+  d->name = stat_segment_name_dup (ep->name);
+
+  switch (ep->type)
+    {
+    case STAT_DIR_TYPE_SCALAR_VALUE:
+      d->scalar_value = ep->value;
+      break;
+
+    case STAT_DIR_TYPE_ERROR_INDEX:
+      d->error_value = 0;
+      if (!stat_segment_vec_is_valid (errors, sizeof (errors[0])))
+	return 0;
+      for (i = 0; i < vec_len (errors); i++)
+	{
+	  u64 *e = stat_segment_rebase (sh, errors[i]);
+
+	  if (!stat_segment_vec_is_valid (e, sizeof (u64)))
+	    return 0;
+	  if (ep->index < vec_len (e))
+	    d->error_value += e[ep->index];
+	}
+      break;
+
+    case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
+      d->simple_counter_vec = (counter_t **)
+	stat_segment_copy_counters (ep->offset, sizeof (counter_t), &ok);
+      break;
+
+    case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
+      d->combined_counter_vec = (vlib_counter_t **)
+	stat_segment_copy_counters (ep->offset, sizeof (vlib_counter_t),
+				    &ok);
+      break;
+
+    default:
+      break;
+    }
+
+  return ok;
+}
+
+stat_segment_data_t *
+stat_segment_dump (u32 * indices)
+{
+  stat_segment_directory_entry_t *dir;
+  stat_segment_data_t *res = 0, *d;
+  stat_segment_access_t sa;
+  u32 *index;
+
+  if (!stat_client_main.shared_header)
+    return 0;
+
+retry:
+  stat_segment_data_free (res);
+  res = 0;
+  if (stat_segment_access_start (&sa))
+    return 0;
+
+  dir = stat_segment_directory ();
+  vec_foreach (index, indices)
+  {
+    if (*index >= vec_len (dir))
+      continue;
+    vec_add2 (res, d, 1);
+    if (!stat_segment_copy_entry (&dir[*index], d))
+      goto retry;
+  }
+
+  if (!stat_segment_access_end (&sa))
+    goto retry;
+
+  return res;
+}
+
+void
+stat_segment_data_free (stat_segment_data_t * res)
+{
+  stat_segment_data_t *d;
+  u32 i;
+
+  vec_foreach (d, res)
+  {
+    switch (d->type)
+      {
+      case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
+	for (i = 0; i < vec_len (d->simple_counter_vec); i++)
+	  vec_free (d->simple_counter_vec[i]);
+	vec_free (d->simple_counter_vec);
+	break;
+      case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
+	for (i = 0; i < vec_len (d->combined_counter_vec); i++)
+	  vec_free (d->combined_counter_vec[i]);
+	vec_free (d->combined_counter_vec);
+	break;
+      default:
+	break;
+      }
+    vec_free (d->name);
+  }
+  vec_free (res);
+}
+
+f64
+stat_segment_heartbeat (void)
+{
+  stat_segment_directory_entry_t *dir;
+  stat_segment_access_t sa;
+  f64 heartbeat;
+  u32 i;
+
+  if (!stat_client_main.shared_header)
+    return 0;
+
+retry:
+  heartbeat = 0;
+  if (stat_segment_access_start (&sa))
+    return 0;
+
+  dir = stat_segment_directory ();
+  for (i = 0; i < vec_len (dir); i++)
+    if (dir[i].type == STAT_DIR_TYPE_SCALAR_VALUE &&
+	!strncmp (dir[i].name, "/sys/last_update", STAT_SEGMENT_NAME_LEN))
+      {
+	heartbeat = dir[i].value;
+	break;
+      }
+
+  if (!stat_segment_access_end (&sa))
+    goto retry;
+
+  return heartbeat;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
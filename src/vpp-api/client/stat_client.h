@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef included_stat_client_h
+#define included_stat_client_h
+
+#include <vppinfra/vec.h>
+#include <vppinfra/serialize.h>
+#include <vlib/counter.h>
+#include <vpp/stats/stat_segment.h>
+
+/*
+ * Reads the counters vpp publishes in the statistics segment, without
+ * talking to vpp.  A reader lists the directory entries it wants with
+ * stat_segment_ls(), once, then dumps their values as often as it
+ * likes.  The indices stay valid for the life of the segment.
+ */
+
+typedef struct
+{
+  char *name;
+  stat_directory_type_t type;
+  union
+  {
+    f64 scalar_value;
+    u64 error_value;
+    /* by thread, then by counter index */
+    counter_t **simple_counter_vec;
+    vlib_counter_t **combined_counter_vec;
+  };
+} stat_segment_data_t;
+
+/* map the segment, 0 or -1 */
+int stat_segment_connect (char *segment_name);
+void stat_segment_disconnect (void);
+
+/*
+ * The functions below return 0 when vpp does not complete a change of
+ * the segment within a second, as when it died in the middle of it.
+ */
+
+/* directory indices of the entries matching any of the regexes */
+u32 *stat_segment_ls (u8 ** patterns);
+/* name of an entry, to free with stat_segment_vec_free */
+char *stat_segment_index_to_name (u32 index);
+void stat_segment_vec_free (void *v);
+
+/* consistent copy of the entries, to free with stat_segment_data_free */
+stat_segment_data_t *stat_segment_dump (u32 * indices);
+void stat_segment_data_free (stat_segment_data_t * res);
+
+/* time of the last update by vpp, 0 if not known */
+f64 stat_segment_heartbeat (void);
+
+#endif /* included_stat_client_h */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
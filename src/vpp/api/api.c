@@ -131,6 +131,8 @@ _(INPUT_ACL_SET_INTERFACE, input_acl_set_interface)                     \
 _(DELETE_LOOPBACK, delete_loopback)                                     \
 _(BD_IP_MAC_ADD_DEL, bd_ip_mac_add_del)                                 \
 _(GET_NODE_GRAPH, get_node_graph)                                       \
+_(NODE_HISTOGRAM_ENABLE_DISABLE, node_histogram_enable_disable)         \
+_(NODE_HISTOGRAM_DUMP, node_histogram_dump)                             \
 _(IOAM_ENABLE, ioam_enable)                                             \
 _(IOAM_DISABLE, ioam_disable)                                           \
 _(GET_NEXT_INDEX, get_next_index)                                       \
@@ -1739,6 +1741,78 @@ vl_api_get_node_graph_t_handler (vl_api_get_node_graph_t * mp)
   /* *INDENT-ON* */
 }
 
+static void
+  vl_api_node_histogram_enable_disable_t_handler
+  (vl_api_node_histogram_enable_disable_t * mp)
+{
+  int rv = 0;
+  vl_api_node_histogram_enable_disable_reply_t *rmp;
+
+  vlib_node_histograms_enable_disable (vlib_get_main (), mp->enable != 0);
+
+  REPLY_MACRO (VL_API_NODE_HISTOGRAM_ENABLE_DISABLE_REPLY);
+}
+
+static void
+send_node_histogram_details (unix_shared_memory_queue_t * q, u32 context,
+			     u32 thread_index, vlib_node_t * n,
+			     vlib_node_histogram_t * h)
+{
+  vl_api_node_histogram_details_t *mp;
+  int i;
+
+  STATIC_ASSERT (ARRAY_LEN (mp->clocks_per_call) ==
+		 VLIB_NODE_HISTOGRAM_N_BUCKETS, "histogram size mismatch");
+
+  mp = vl_msg_api_alloc (sizeof (*mp));
+  memset (mp, 0, sizeof (*mp));
+  mp->_vl_msg_id = ntohs (VL_API_NODE_HISTOGRAM_DETAILS);
+  mp->context = context;
+  mp->thread_index = htonl (thread_index);
+  strncpy ((char *) mp->node_name, (char *) n->name,
+	   clib_min (vec_len (n->name), ARRAY_LEN (mp->node_name) - 1));
+
+  for (i = 0; i < VLIB_NODE_HISTOGRAM_N_BUCKETS; i++)
+    {
+      mp->clocks_per_call[i] = clib_host_to_net_u64 (h->clocks_per_call[i]);
+      mp->vectors_per_call[i] =
+	clib_host_to_net_u64 (h->vectors_per_call[i]);
+      mp->frame_residency[i] = clib_host_to_net_u64 (h->frame_residency[i]);
+    }
+
+  vl_msg_api_send_shmem (q, (u8 *) & mp);
+}
+
+static void
+vl_api_node_histogram_dump_t_handler (vl_api_node_histogram_dump_t * mp)
+{
+  unix_shared_memory_queue_t *q;
+  vlib_node_main_t *nm;
+  vlib_node_histogram_t *h;
+  u32 i, j, k;
+
+  q = vl_api_client_index_to_input_queue (mp->client_index);
+  if (!q)
+    return;
+
+  /* runs with the barrier held, the workers are not counting */
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    {
+      if (!vlib_mains[i])
+	continue;
+      nm = &vlib_mains[i]->node_main;
+      vec_foreach_index (j, nm->node_histograms)
+      {
+	h = vec_elt_at_index (nm->node_histograms, j);
+	for (k = 0; k < VLIB_NODE_HISTOGRAM_N_BUCKETS; k++)
+	  if (h->clocks_per_call[k] || h->frame_residency[k])
+	    break;
+	if (k < VLIB_NODE_HISTOGRAM_N_BUCKETS && j < vec_len (nm->nodes))
+	  send_node_histogram_details (q, mp->context, i, nm->nodes[j], h);
+      }
+    }
+}
+
 static void
 vl_api_ioam_enable_t_handler (vl_api_ioam_enable_t * mp)
 {
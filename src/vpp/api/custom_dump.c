@@ -1650,6 +1650,8 @@ static void *vl_api_create_vhost_user_if_t_print
     s = format (s, "server ");
   if (mp->renumber)
     s = format (s, "renumber %d ", ntohl (mp->custom_dev_instance));
+  if (mp->enable_packed)
+    s = format (s, "packed ");
   if (mp->tag[0])
     s = format (s, "tag %s", mp->tag);
 
@@ -1669,6 +1671,8 @@ static void *vl_api_modify_vhost_user_if_t_print
     s = format (s, "server ");
   if (mp->renumber)
     s = format (s, "renumber %d ", ntohl (mp->custom_dev_instance));
+  if (mp->enable_packed)
+    s = format (s, "packed ");
 
   FINISH;
 }
@@ -0,0 +1,222 @@
+/*
+ *------------------------------------------------------------------
+ * vpp_get_stats.c - read the vpp statistics segment
+ *
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <vppinfra/clib.h>
+#include <vppinfra/format.h>
+#include <vppinfra/time.h>
+#include <vpp-api/client/stat_client.h>
+
+static void
+print_data (stat_segment_data_t * d)
+{
+  u32 i, j;
+
+  switch (d->type)
+    {
+    case STAT_DIR_TYPE_SCALAR_VALUE:
+      fformat (stdout, "%.2f %s\n", d->scalar_value, d->name);
+      break;
+
+    case STAT_DIR_TYPE_ERROR_INDEX:
+      fformat (stdout, "%llu %s\n", d->error_value, d->name);
+      break;
+
+    case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
+      for (i = 0; i < vec_len (d->simple_counter_vec); i++)
+	for (j = 0; j < vec_len (d->simple_counter_vec[i]); j++)
+	  fformat (stdout, "[%d @ %d]: %llu packets %s\n", j, i,
+		   d->simple_counter_vec[i][j], d->name);
+      break;
+
+    case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
+      for (i = 0; i < vec_len (d->combined_counter_vec); i++)
+	for (j = 0; j < vec_len (d->combined_counter_vec[i]); j++)
+	  fformat (stdout, "[%d @ %d]: %llu packets, %llu bytes %s\n", j, i,
+		   d->combined_counter_vec[i][j].packets,
+		   d->combined_counter_vec[i][j].bytes, d->name);
+      break;
+
+    default:
+      break;
+    }
+}
+
+/* number of counter values, all threads */
+static uword
+count_values (stat_segment_data_t * res)
+{
+  stat_segment_data_t *d;
+  uword n = 0;
+  u32 i;
+
+  vec_foreach (d, res)
+  {
+    if (d->type == STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE)
+      for (i = 0; i < vec_len (d->simple_counter_vec); i++)
+	n += vec_len (d->simple_counter_vec[i]);
+    else if (d->type == STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED)
+      for (i = 0; i < vec_len (d->combined_counter_vec); i++)
+	n += vec_len (d->combined_counter_vec[i]);
+    else
+      n++;
+  }
+  return n;
+}
+
+/* poll the entries as fast as possible */
+static void
+bench (u32 * indices, u32 iterations)
+{
+  stat_segment_data_t *res;
+  clib_time_t clib_time;
+  f64 start, elapsed;
+  uword n_values = 0;
+  u32 i;
+
+  clib_time_init (&clib_time);
+  start = clib_time_now (&clib_time);
+
+  for (i = 0; i < iterations; i++)
+    {
+      res = stat_segment_dump (indices);
+      n_values = count_values (res);
+      stat_segment_data_free (res);
+    }
+
+  elapsed = clib_time_now (&clib_time) - start;
+  fformat (stdout, "%u polls of %u entries, %wu counter values: "
+	   "%.2f us per poll, %.2e values/s\n", iterations,
+	   vec_len (indices), n_values, elapsed * 1e6 / iterations,
+	   (f64) n_values * iterations / elapsed);
+}
+
+typedef enum
+{
+  STAT_CLIENT_CMD_UNKNOWN,
+  STAT_CLIENT_CMD_LS,
+  STAT_CLIENT_CMD_POLL,
+  STAT_CLIENT_CMD_DUMP,
+  STAT_CLIENT_CMD_BENCH,
+} stat_client_cmd_t;
+
+int
+main (int argc, char **argv)
+{
+  unformat_input_t _argv, *a = &_argv;
+  u8 *segment_name = (u8 *) STAT_SEGMENT_DEFAULT_NAME;
+  stat_client_cmd_t cmd = STAT_CLIENT_CMD_UNKNOWN;
+  stat_segment_data_t *res;
+  u8 *pattern, **patterns = 0;
+  u32 iterations = 10000, interval = 1;
+  u32 *indices, i;
+
+  clib_mem_init (0, 128 << 20);
+
+  unformat_init_command_line (a, argv);
+
+  while (unformat_check_input (a) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (a, "segment %s", &segment_name))
+	vec_add1 (segment_name, 0);
+      else if (unformat (a, "ls"))
+	cmd = STAT_CLIENT_CMD_LS;
+      else if (unformat (a, "dump"))
+	cmd = STAT_CLIENT_CMD_DUMP;
+      else if (unformat (a, "poll"))
+	cmd = STAT_CLIENT_CMD_POLL;
+      else if (unformat (a, "bench"))
+	cmd = STAT_CLIENT_CMD_BENCH;
+      else if (unformat (a, "iterations %u", &iterations))
+	;
+      else if (unformat (a, "interval %u", &interval))
+	;
+      else if (unformat (a, "%s", &pattern))
+	vec_add1 (patterns, pattern);
+      else
+	break;
+    }
+
+  if (cmd == STAT_CLIENT_CMD_UNKNOWN || !iterations)
+    {
+      fformat (stderr,
+	       "usage: vpp_get_stats [segment <name>] "
+	       "ls | dump | poll [interval <s>] | bench [iterations <n>] "
+	       "[<pattern> ...]\n");
+      exit (1);
+    }
+
+  if (stat_segment_connect ((char *) segment_name) < 0)
+    {
+      fformat (stderr, "can't map the statistics segment %s\n",
+	       segment_name);
+      exit (1);
+    }
+
+  indices = stat_segment_ls (patterns);
+
+  switch (cmd)
+    {
+    case STAT_CLIENT_CMD_LS:
+      for (i = 0; i < vec_len (indices); i++)
+	{
+	  char *name = stat_segment_index_to_name (indices[i]);
+	  fformat (stdout, "%s\n", name);
+	  stat_segment_vec_free (name);
+	}
+      break;
+
+    case STAT_CLIENT_CMD_DUMP:
+      res = stat_segment_dump (indices);
+      for (i = 0; i < vec_len (res); i++)
+	print_data (&res[i]);
+      stat_segment_data_free (res);
+      break;
+
+    case STAT_CLIENT_CMD_POLL:
+      while (1)
+	{
+	  res = stat_segment_dump (indices);
+	  for (i = 0; i < vec_len (res); i++)
+	    print_data (&res[i]);
+	  stat_segment_data_free (res);
+	  sleep (interval);
+	}
+      break;
+
+    case STAT_CLIENT_CMD_BENCH:
+      bench (indices, iterations);
+      break;
+
+    default:
+      break;
+    }
+
+  stat_segment_disconnect ();
+  exit (0);
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,601 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <vppinfra/mheap.h>
+#include <vpp/stats/stats.h>
+
+/* room always left on the segment heap, for the directory names etc */
+#define STAT_SEGMENT_HEAP_MARGIN (64 << 10)
+
+/*
+ * Directory entry of name, added if needed.
+ * Called with the segment locked and its heap pushed.
+ */
+static stat_segment_directory_entry_t *
+stat_segment_directory_entry (stats_main_t * sm, char *name,
+			      stat_directory_type_t type)
+{
+  stat_segment_shared_header_t *sh = sm->stat_segment;
+  stat_segment_directory_entry_t *ep;
+  void *oldheap;
+  uword *p;
+  u8 *key;
+
+  p = hash_get_mem (sm->stat_segment_directory_by_name, name);
+  if (p)
+    return vec_elt_at_index (sm->stat_segment_directory, p[0]);
+
+  vec_add2 (sm->stat_segment_directory, ep, 1);
+  sh->directory_offset =
+    stat_segment_offset (sh, sm->stat_segment_directory);
+  ep->type = type;
+  strncpy (ep->name, name, STAT_SEGMENT_NAME_LEN - 1);
+
+  /* the name hash is private to vpp */
+  oldheap = clib_mem_set_heap (sm->stat_segment_main_heap);
+  key = format (0, "%s%c", name, 0);
+  hash_set_mem (sm->stat_segment_directory_by_name, key,
+		ep - sm->stat_segment_directory);
+  clib_mem_set_heap (oldheap);
+
+  return ep;
+}
+
+/*
+ * Bytes which can surely still be allocated on the segment heap: the
+ * end of the heap never used yet. Free objects aren't counted.
+ */
+static uword
+stat_segment_heap_room (stats_main_t * sm)
+{
+  void *heap = sm->stat_segment_heap;
+
+  return mheap_max_size (heap) - vec_len (heap);
+}
+
+static void
+stat_segment_lock (stats_main_t * sm)
+{
+  clib_spinlock_lock (&sm->stat_segment_lock);
+  sm->stat_segment->in_progress = 1;
+  CLIB_MEMORY_BARRIER ();
+}
+
+void *
+vlib_stats_push_heap (uword n_bytes)
+{
+  stats_main_t *sm = &stats_main;
+  stat_segment_shared_header_t *sh = sm->stat_segment;
+
+  if (!sh || sm->stat_segment_full)
+    return 0;
+
+  clib_spinlock_lock (&sm->stat_segment_lock);
+
+  /*
+   * Running out of the segment heap is fatal. Short of room for the
+   * counters, the directory doubling and a margin, the segment is full
+   * for good: a vector moved off it never comes back.
+   */
+  if (stat_segment_heap_room (sm) < n_bytes + STAT_SEGMENT_HEAP_MARGIN +
+      2 * vec_bytes (sm->stat_segment_directory))
+    {
+      sm->stat_segment_full = 1;
+      clib_spinlock_unlock (&sm->stat_segment_lock);
+      clib_warning ("stats segment '%s' full, counters are no longer "
+		    "published (see statseg size)", sm->stat_segment_name);
+      return 0;
+    }
+
+  sh->in_progress = 1;
+  CLIB_MEMORY_BARRIER ();
+
+  return clib_mem_set_heap (sm->stat_segment_heap);
+}
+
+/* readers retry what they read since vlib_stats_push_heap () */
+static void
+stat_segment_release (stats_main_t * sm, void *oldheap)
+{
+  stat_segment_shared_header_t *sh = sm->stat_segment;
+
+  clib_mem_set_heap (oldheap);
+
+  CLIB_MEMORY_BARRIER ();
+  sh->epoch++;
+  CLIB_MEMORY_BARRIER ();
+  sh->in_progress = 0;
+
+  clib_spinlock_unlock (&sm->stat_segment_lock);
+}
+
+void
+vlib_stats_pop_heap (void *cm_arg, void *oldheap,
+		     vlib_stats_counter_type_t type)
+{
+  stats_main_t *sm = &stats_main;
+  stat_segment_directory_entry_t *ep;
+
+  if (type == VLIB_STATS_SIMPLE_COUNTER)
+    {
+      vlib_simple_counter_main_t *cm = cm_arg;
+      ep = stat_segment_directory_entry (sm, cm->stat_segment_name,
+					 STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE);
+      ep->offset = stat_segment_offset (sm->stat_segment, cm->counters);
+    }
+  else
+    {
+      vlib_combined_counter_main_t *cm = cm_arg;
+      ep = stat_segment_directory_entry (sm, cm->stat_segment_name,
+					 STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED);
+      ep->offset = stat_segment_offset (sm->stat_segment, cm->counters);
+    }
+
+  stat_segment_release (sm, oldheap);
+}
+
+void
+vlib_stats_pop_heap_error (u64 * counters, u32 thread_index, void *oldheap)
+{
+  stats_main_t *sm = &stats_main;
+  stat_segment_shared_header_t *sh = sm->stat_segment;
+
+  vec_validate (sm->stat_segment_error_vector, thread_index);
+  sm->stat_segment_error_vector[thread_index] = counters;
+  sh->error_offset = stat_segment_offset (sh, sm->stat_segment_error_vector);
+
+  stat_segment_release (sm, oldheap);
+}
+
+/* copy of a vector of the segment heap on the current heap */
+static void *
+stat_segment_vec_move (stats_main_t * sm, void *v, uword elt_bytes)
+{
+  void *oldheap, *nv = 0;
+
+  if (!v)
+    return 0;
+
+  nv = _vec_resize (nv, vec_len (v), vec_len (v) * elt_bytes, 0,
+		    CLIB_CACHE_LINE_BYTES);
+  clib_memcpy (nv, v, vec_len (v) * elt_bytes);
+
+  oldheap = clib_mem_set_heap (sm->stat_segment_heap);
+  vec_free (v);
+  clib_mem_set_heap (oldheap);
+
+  return nv;
+}
+
+void
+vlib_stats_unpublish (void *cm_arg, vlib_stats_counter_type_t type)
+{
+  stats_main_t *sm = &stats_main;
+  stat_segment_shared_header_t *sh = sm->stat_segment;
+  void ***countersp;
+  uword elt_bytes;
+  char *name;
+  uword *p;
+  u32 i;
+
+  if (type == VLIB_STATS_SIMPLE_COUNTER)
+    {
+      vlib_simple_counter_main_t *cm = cm_arg;
+      countersp = (void ***) &cm->counters;
+      elt_bytes = sizeof (counter_t);
+      name = cm->stat_segment_name;
+    }
+  else
+    {
+      vlib_combined_counter_main_t *cm = cm_arg;
+      countersp = (void ***) &cm->counters;
+      elt_bytes = sizeof (vlib_counter_t);
+      name = cm->stat_segment_name;
+    }
+
+  if (!sh || !stat_segment_pointer_is_valid (sh, *countersp))
+    return;
+
+  stat_segment_lock (sm);
+
+  /* readers see no threads */
+  p = hash_get_mem (sm->stat_segment_directory_by_name, name);
+  if (p)
+    sm->stat_segment_directory[p[0]].offset = 0;
+
+  for (i = 0; i < vec_len (*countersp); i++)
+    (*countersp)[i] = stat_segment_vec_move (sm, (*countersp)[i], elt_bytes);
+  *countersp = stat_segment_vec_move (sm, *countersp, sizeof (void *));
+
+  stat_segment_release (sm, clib_mem_get_heap ());
+}
+
+u64 *
+vlib_stats_unpublish_error (u64 * counters, u32 thread_index)
+{
+  stats_main_t *sm = &stats_main;
+  stat_segment_shared_header_t *sh = sm->stat_segment;
+
+  if (!sh || !stat_segment_pointer_is_valid (sh, counters))
+    return counters;
+
+  stat_segment_lock (sm);
+  if (thread_index < vec_len (sm->stat_segment_error_vector))
+    sm->stat_segment_error_vector[thread_index] = 0;
+  counters = stat_segment_vec_move (sm, counters, sizeof (u64));
+  stat_segment_release (sm, clib_mem_get_heap ());
+
+  return counters;
+}
+
+void
+vlib_stats_register_error_index (u8 * name, u32 index)
+{
+  stats_main_t *sm = &stats_main;
+  stat_segment_directory_entry_t *ep;
+  void *oldheap;
+
+  if (!(oldheap = vlib_stats_push_heap (0)))
+    return;
+
+  ep = stat_segment_directory_entry (sm, (char *) name,
+				     STAT_DIR_TYPE_ERROR_INDEX);
+  ep->index = index;
+  stat_segment_release (sm, oldheap);
+}
+
+static u32
+stat_segment_add_scalar (stats_main_t * sm, char *name)
+{
+  stat_segment_directory_entry_t *ep;
+  void *oldheap;
+
+  /* first entries, the segment can't be full yet */
+  oldheap = vlib_stats_push_heap (0);
+  ASSERT (oldheap);
+  ep = stat_segment_directory_entry (sm, name, STAT_DIR_TYPE_SCALAR_VALUE);
+  ep->value = 0;
+  stat_segment_release (sm, oldheap);
+
+  return ep - sm->stat_segment_directory;
+}
+
+static void
+stat_segment_set_scalar (stats_main_t * sm, u32 index, f64 value)
+{
+  /* the directory may be moved meanwhile */
+  clib_spinlock_lock (&sm->stat_segment_lock);
+  sm->stat_segment_directory[index].value = value;
+  clib_spinlock_unlock (&sm->stat_segment_lock);
+}
+
+/* called by the stats thread */
+void
+do_stat_segment_updates (stats_main_t * sm)
+{
+  f64 vector_rate = 0;
+  int i;
+
+  if (!sm->stat_segment)
+    return;
+
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    vector_rate += vlib_last_vectors_per_main_loop_as_f64 (vlib_mains[i]);
+  vector_rate /= vec_len (vlib_mains);
+
+  stat_segment_set_scalar (sm, sm->vector_rate_index, vector_rate);
+  stat_segment_set_scalar (sm, sm->last_update_index, unix_time_now ());
+}
+
+/*
+ * Create the segment file, locked. vpp holds the lock until it exits,
+ * however it exits: a segment file nobody has locked was left by a vpp
+ * which didn't run its exit functions, it is replaced.
+ */
+static clib_error_t *
+stat_segment_open (char *name, int *fdp)
+{
+  int i, fd = -1;
+
+  for (i = 0; i < 2; i++)
+    {
+      fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL,
+		     S_IRUSR | S_IWUSR | S_IRGRP);
+      if (fd >= 0)
+	{
+	  /* only another vpp replacing it as stale can hold it already */
+	  if (flock (fd, LOCK_EX | LOCK_NB) < 0)
+	    break;
+	  *fdp = fd;
+	  return 0;
+	}
+      if (errno != EEXIST)
+	return clib_error_return_unix (0, "create stats segment '%s'", name);
+
+      /* unlinked meanwhile, try again */
+      if ((fd = shm_open (name, O_RDWR, 0)) < 0)
+	continue;
+
+      /* never take over the segment of another running vpp */
+      if (flock (fd, LOCK_EX | LOCK_NB) < 0)
+	break;
+
+      clib_warning ("stats segment '%s' left by a vpp which exited "
+		    "uncleanly, replacing it", name);
+      shm_unlink (name);
+      close (fd);
+      fd = -1;
+    }
+
+  if (fd >= 0)
+    close (fd);
+  return clib_error_return (0, "stats segment '%s' in use by another vpp",
+			    name);
+}
+
+static clib_error_t *
+stat_segment_create (stats_main_t * sm)
+{
+  stat_segment_shared_header_t *sh;
+  uword page_size = clib_mem_get_page_size ();
+  char *name = (char *) sm->stat_segment_name;
+  clib_error_t *error;
+  u8 *base;
+  int fd = -1;
+
+  if ((error = stat_segment_open (name, &fd)))
+    return error;
+
+  if (sm->stat_segment_gid != ~0 && fchown (fd, -1, sm->stat_segment_gid))
+    clib_unix_warning ("stats segment chown");
+
+  if (ftruncate (fd, sm->stat_segment_size) < 0)
+    {
+      close (fd);
+      shm_unlink (name);
+      return clib_error_return_unix (0, "size stats segment '%s'", name);
+    }
+
+  base = mmap (0, sm->stat_segment_size, PROT_READ | PROT_WRITE,
+	       MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+    {
+      close (fd);
+      shm_unlink (name);
+      return clib_error_return_unix (0, "mmap stats segment '%s'", name);
+    }
+  sm->stat_segment_fd = fd;
+
+  sh = (stat_segment_shared_header_t *) base;
+  sh->base_va = pointer_to_uword (base);
+  sh->size = sm->stat_segment_size;
+
+  sm->stat_segment_heap =
+    mheap_alloc_with_flags (base + page_size,
+			    sm->stat_segment_size - page_size,
+			    MHEAP_FLAG_DISABLE_VM | MHEAP_FLAG_THREAD_SAFE);
+  sm->stat_segment_main_heap = clib_mem_get_heap ();
+  sm->stat_segment_directory_by_name = hash_create_string (0, sizeof (uword));
+  clib_spinlock_init (&sm->stat_segment_lock);
+  sm->stat_segment = sh;
+
+  sm->vector_rate_index = stat_segment_add_scalar (sm, "/sys/vector_rate");
+  sm->last_update_index = stat_segment_add_scalar (sm, "/sys/last_update");
+
+  /* readers wait for the version */
+  CLIB_MEMORY_BARRIER ();
+  sh->version = STAT_SEGMENT_VERSION;
+
+  return 0;
+}
+
+/*
+ * The segment is created before the init functions run, so that all
+ * the published counters get allocated on its heap.
+ */
+static clib_error_t *
+statseg_config (vlib_main_t * vm, unformat_input_t * input)
+{
+  stats_main_t *sm = &stats_main;
+  clib_error_t *error;
+  uword size = STAT_SEGMENT_DEFAULT_SIZE;
+  u32 gid = ~0;
+  u8 *name = 0;
+  int disable = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "name %s", &name))
+	;
+      else if (unformat (input, "size %U", unformat_memory_size, &size))
+	;
+      else if (unformat (input, "gid %U", unformat_unix_gid, &gid))
+	;
+      else if (unformat (input, "disable"))
+	disable = 1;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (disable)
+    {
+      vec_free (name);
+      return 0;
+    }
+
+  if (!name)
+    name = format (0, "%s", STAT_SEGMENT_DEFAULT_NAME);
+  if (name[0] != '/')
+    vec_insert_elts (name, (u8 *) "/", 1, 0);
+  vec_add1 (name, 0);
+
+  sm->stat_segment_name = name;
+  sm->stat_segment_size = size;
+  sm->stat_segment_gid = gid;
+
+  /* vpp runs without the segment if it can't be created */
+  if ((error = stat_segment_create (sm)))
+    clib_error_report (error);
+
+  return 0;
+}
+
+VLIB_EARLY_CONFIG_FUNCTION (statseg_config, "statseg");
+
+/* free the name for the next vpp, the mappings of the readers stay */
+static clib_error_t *
+stat_segment_exit (vlib_main_t * vm)
+{
+  stats_main_t *sm = &stats_main;
+
+  if (sm->stat_segment)
+    shm_unlink ((char *) sm->stat_segment_name);
+  return 0;
+}
+
+VLIB_MAIN_LOOP_EXIT_FUNCTION (stat_segment_exit);
+
+static u8 *
+format_stat_dir_type (u8 * s, va_list * args)
+{
+  stat_directory_type_t type = va_arg (*args, stat_directory_type_t);
+
+  switch (type)
+    {
+    case STAT_DIR_TYPE_SCALAR_VALUE:
+      return format (s, "scalar");
+    case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
+      return format (s, "simple counters");
+    case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
+      return format (s, "combined counters");
+    case STAT_DIR_TYPE_ERROR_INDEX:
+      return format (s, "error counter");
+    }
+  return format (s, "unknown %d", type);
+}
+
+static clib_error_t *
+show_stat_segment_command_fn (vlib_main_t * vm,
+			      unformat_input_t * input,
+			      vlib_cli_command_t * cmd)
+{
+  stats_main_t *sm = &stats_main;
+  stat_segment_shared_header_t *sh = sm->stat_segment;
+  stat_segment_directory_entry_t *ep, *show = 0;
+  u64 **error_vector;
+  clib_mem_usage_t usage;
+  int verbose = 0;
+  u32 i;
+
+  if (unformat (input, "verbose"))
+    verbose = 1;
+
+  if (!sh)
+    {
+      vlib_cli_output (vm, "The statistics segment is disabled");
+      return 0;
+    }
+
+  /* copy what is shown, the segment heap can't be used by format */
+  clib_spinlock_lock (&sm->stat_segment_lock);
+  show = vec_dup (sm->stat_segment_directory);
+  error_vector = vec_dup (sm->stat_segment_error_vector);
+  mheap_usage (sm->stat_segment_heap, &usage);
+  clib_spinlock_unlock (&sm->stat_segment_lock);
+
+  vlib_cli_output (vm, "%s: size %U, used %U, epoch %llu, %u entries%s",
+		   sm->stat_segment_name, format_memory_size, sh->size,
+		   format_memory_size, usage.bytes_used, sh->epoch,
+		   vec_len (show), sm->stat_segment_full ? ", full" : "");
+
+  vec_foreach (ep, show)
+  {
+    if (!verbose)
+      {
+	vlib_cli_output (vm, "  %-60s %U", ep->name, format_stat_dir_type,
+			 ep->type);
+	continue;
+      }
+
+    switch (ep->type)
+      {
+      case STAT_DIR_TYPE_SCALAR_VALUE:
+	vlib_cli_output (vm, "  %-60s %.2f", ep->name, ep->value);
+	break;
+
+      case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
+      case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
+	vlib_cli_output (vm, "  %-60s %U, %u threads", ep->name,
+			 format_stat_dir_type, ep->type,
+			 vec_len ((void **) stat_segment_pointer (sh,
+								  ep->offset)));
+	break;
+
+      case STAT_DIR_TYPE_ERROR_INDEX:
+	{
+	  u64 value = 0;
+
+	  for (i = 0; i < vec_len (error_vector); i++)
+	    if (error_vector[i] && ep->index < vec_len (error_vector[i]))
+	      value += error_vector[i][ep->index];
+	  vlib_cli_output (vm, "  %-60s %llu", ep->name, value);
+	}
+	break;
+      }
+  }
+
+  vec_free (show);
+  vec_free (error_vector);
+
+  return 0;
+}
+
+/*?
+ * Show the statistics segment, where vpp publishes counters which
+ * other processes read in place (see vpp_get_stats). With
+ * '<em>verbose</em>', show the values of the scalars and error counters.
+ *
+ * @cliexpar
+ * @cliexstart{show statistics segment}
+ * /vpp-stats: size 32m, used 1.21m, epoch 1043, 1214 entries
+ *   /sys/vector_rate                                             scalar
+ *   /sys/last_update                                             scalar
+ *   /if/drops                                                    simple counters
+ *   ...
+ * @cliexend
+ * The segment is configured in the '<em>statseg</em>' startup section:
+ * '<em>statseg { [name <shm-name>] [size <nn>[kmg]] [gid <group>]
+ * [disable] }</em>'. The members of the group can read the segment.
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_stat_segment_command, static) =
+{
+  .path = "show statistics segment",
+  .short_help = "show statistics segment [verbose]",
+  .function = show_stat_segment_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2017 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __included_stat_segment_h__
+#define __included_stat_segment_h__
+
+#include <vppinfra/types.h>
+
+/*
+ * Statistics segment
+ *
+ * The counters published in the statistics segment are allocated on
+ * its heap, and are read in place by the other processes, which map
+ * the segment read-only anywhere.  The segment starts with the shared
+ * header, the directory lists the published counters.  The header and
+ * the directory hold segment offsets.  The per-thread vectors of
+ * counters hold the addresses vpp uses, which readers rebase from
+ * base_va to their own mapping.
+ *
+ * The counters are written without locks, a counter value is always
+ * consistent.  A counter vector is moved when it grows though: vpp
+ * sets in_progress while it updates the directory or moves vectors, and
+ * increments the epoch when it is done.  A reader samples the epoch,
+ * waits for in_progress to be clear, reads, and starts over if the
+ * epoch changed or in_progress was set meanwhile.  The directory is
+ * only appended to, the index of an entry never changes.
+ */
+
+#define STAT_SEGMENT_VERSION 1
+#define STAT_SEGMENT_DEFAULT_NAME "/vpp-stats"
+#define STAT_SEGMENT_DEFAULT_SIZE (32 << 20)
+#define STAT_SEGMENT_NAME_LEN 128
+
+typedef enum
+{
+  /* value is an f64 */
+  STAT_DIR_TYPE_SCALAR_VALUE = 1,
+  /* data is a counter_t vector per thread */
+  STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE,
+  /* data is a vlib_counter_t vector per thread */
+  STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED,
+  /* index is the index in the error counter vectors */
+  STAT_DIR_TYPE_ERROR_INDEX,
+} stat_directory_type_t;
+
+typedef struct
+{
+  stat_directory_type_t type;
+  union
+  {
+    f64 value;
+    u64 index;
+    /* offset of the counter vector by thread */
+    u64 offset;
+  };
+  char name[STAT_SEGMENT_NAME_LEN];
+} stat_segment_directory_entry_t;
+
+typedef struct
+{
+  u64 version;
+  /* where vpp mapped the segment */
+  u64 base_va;
+  u64 size;
+
+  volatile u64 epoch;
+  volatile u64 in_progress;
+
+  /* offset of the directory vector */
+  u64 directory_offset;
+
+  /* offset of the error counter vector, by thread */
+  u64 error_offset;
+} stat_segment_shared_header_t;
+
+/* offsets from the start of the segment, 0 for a null pointer */
+#define stat_segment_offset(sh,p) \
+  ((p) ? (u64) ((u8 *) (p) - (u8 *) (sh)) : 0)
+#define stat_segment_pointer(sh,o) \
+  ((o) ? (void *) ((u8 *) (sh) + (o)) : 0)
+
+/* an address vpp stored in the segment, in the reader's mapping */
+#define stat_segment_rebase(sh,p) \
+  ((p) ? stat_segment_pointer (sh, pointer_to_uword (p) - (sh)->base_va) : 0)
+
+/*
+ * A pointer read from the segment while vpp changes it may be garbage,
+ * readers check that it points into the segment before following it.
+ */
+#define stat_segment_pointer_is_valid(sh,p) \
+  ((void *) (p) >= (void *) (sh) && \
+   (void *) (p) < (void *) ((u8 *) (sh) + (sh)->size))
+
+#endif /* __included_stat_segment_h__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
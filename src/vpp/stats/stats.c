@@ -1419,361 +1419,242 @@ do_ip6_nbr_counters (stats_main_t * sm)
   /* *INDENT-OFF* */
 }
 
-static void
-do_ip4_fib_counters (stats_main_t * sm)
-{
-  ip4_main_t *im4 = &ip4_main;
-  api_main_t *am = sm->api_main;
-  vl_shmem_hdr_t *shmem_hdr = am->shmem_hdr;
-  unix_shared_memory_queue_t *q = shmem_hdr->vl_input_queue;
-  ip4_route_t *r;
-  fib_table_t *fib;
-  ip4_fib_t *v4_fib;
-  do_ip46_fibs_t *do_fibs;
-  vl_api_vnet_ip4_fib_counters_t *mp = 0;
-  u32 items_this_message;
-  vl_api_ip4_fib_counter_t *ctrp = 0;
-  u32 start_at_fib_index = 0;
-  int i, j, k;
-
-  do_fibs = &sm->do_ip46_fibs;
-
-again:
-  vec_reset_length (do_fibs->fibs);
-  /* *INDENT-OFF* */
-  pool_foreach (fib, im4->fibs,
-                ({vec_add1(do_fibs->fibs,fib);}));
-
-  /* *INDENT-ON* */
+/*
+ * The FIB counters are exported incrementally: the FIB entries are
+ * walked in chunks of STATS_FIB_WALK_CHUNK indices, dropping the data
+ * structure lock between chunks, and only the routes whose counters
+ * changed since they were last exported are sent. The walk resumes
+ * where it stopped when the main thread wants the lock back.
+ */
+#define STATS_FIB_WALK_CHUNK 1024
 
-  for (j = 0; j < vec_len (do_fibs->fibs); j++)
+static int
+ip46_fib_stats_walk_cb (fib_node_index_t fei, void *arg)
+{
+  stats_main_t *sm = arg;
+  ip46_fib_counter_change_t *ch;
+  fib_entry_last_export_t *le;
+  const dpo_id_t *dpo_id;
+  fib_node_index_t i;
+  fib_prefix_t pfx;
+  vlib_counter_t c;
+
+  /* the entries skipped since the previous one were deleted */
+  for (i = sm->fib_walk_next_index;
+       i < fei && i < vec_len (sm->fib_entry_last_export); i++)
+    memset (&sm->fib_entry_last_export[i], 0, sizeof (*le));
+  sm->fib_walk_next_index = fei + 1;
+
+  fib_entry_get_prefix (fei, &pfx);
+
+  if ((pfx.fp_proto == FIB_PROTOCOL_IP4 &&
+       pool_elts (sm->stats_registrations[IDX_IP4_FIB_COUNTERS])) ||
+      (pfx.fp_proto == FIB_PROTOCOL_IP6 &&
+       pool_elts (sm->stats_registrations[IDX_IP6_FIB_COUNTERS])))
     {
-      fib = do_fibs->fibs[j];
-      /* We may have bailed out due to control-plane activity */
-      while ((fib - im4->fibs) < start_at_fib_index)
-	continue;
+      dpo_id = fib_entry_contribute_ip_forwarding (fei);
+      vlib_get_combined_counter (&load_balance_main.lbm_to_counters,
+				 dpo_id->dpoi_index, &c);
 
-      v4_fib = pool_elt_at_index (im4->v4_fibs, fib->ft_index);
-
-      if (mp == 0)
-	{
-	  items_this_message = IP4_FIB_COUNTER_BATCH_SIZE;
-	  mp = vl_msg_api_alloc_as_if_client
-	    (sizeof (*mp) +
-	     items_this_message * sizeof (vl_api_ip4_fib_counter_t));
-	  mp->_vl_msg_id = ntohs (VL_API_VNET_IP4_FIB_COUNTERS);
-	  mp->count = 0;
-	  mp->vrf_id = ntohl (fib->ft_table_id);
-	  ctrp = (vl_api_ip4_fib_counter_t *) mp->c;
-	}
-      else
+      /*
+       * Also compare the load-balance: the entry may have been deleted
+       * and its index reused by another route since the previous walk.
+       */
+      vec_validate (sm->fib_entry_last_export, fei);
+      le = &sm->fib_entry_last_export[fei];
+      if (le->lb_index != dpo_id->dpoi_index || c.packets != le->packets)
 	{
-	  /* happens if the last FIB was empty... */
-	  ASSERT (mp->count == 0);
-	  mp->vrf_id = ntohl (fib->ft_table_id);
+	  le->lb_index = dpo_id->dpoi_index;
+	  le->packets = c.packets;
+
+	  vec_add2 (sm->fib_counter_changes[pfx.fp_proto], ch, 1);
+	  ch->fib_entry_index = fei;
+	  ch->table_id =
+	    fib_table_get (fib_entry_get_fib_index (fei),
+			   pfx.fp_proto)->ft_table_id;
+	  ch->address = pfx.fp_addr;
+	  ch->address_length = pfx.fp_len;
+	  ch->counter = c;
 	}
+    }
 
-      dslock (sm, 0 /* release hint */ , 1 /* tag */ );
+  /* stop here if the main thread wants the lock */
+  return (!sm->data_structure_lock->release_hint);
+}
 
-      vec_reset_length (do_fibs->ip4routes);
-      vec_reset_length (do_fibs->results);
+static void
+do_ip46_fib_walk (stats_main_t * sm)
+{
+  fib_node_index_t start = 0;
+  int release_hint;
 
-      for (i = 0; i < ARRAY_LEN (v4_fib->fib_entry_by_dst_address); i++)
-	{
-	  uword *hash = v4_fib->fib_entry_by_dst_address[i];
-	  hash_pair_t *p;
-	  ip4_route_t x;
+  vec_reset_length (sm->fib_counter_changes[FIB_PROTOCOL_IP4]);
+  vec_reset_length (sm->fib_counter_changes[FIB_PROTOCOL_IP6]);
 
-	  vec_reset_length (do_fibs->pvec);
+  /* a client registered, send it every route */
+  if (sm->fib_counters_full_export)
+    {
+      sm->fib_counters_full_export = 0;
+      vec_reset_length (sm->fib_entry_last_export);
+    }
 
-	  x.address_length = i;
+  sm->fib_walk_next_index = 0;
+  do
+    {
+      dslock (sm, 0 /* release hint */ , 1 /* tag */ );
+      start = fib_entry_walk_range (start, STATS_FIB_WALK_CHUNK,
+				    ip46_fib_stats_walk_cb, sm);
+      release_hint = sm->data_structure_lock->release_hint;
+      dsunlock (sm);
 
-	  hash_foreach_pair (p, hash, (
-					{
-					vec_add1 (do_fibs->pvec, p);}
-			     ));
-	  for (k = 0; k < vec_len (do_fibs->pvec); k++)
-	    {
-	      p = do_fibs->pvec[k];
-	      x.address.data_u32 = p->key;
-	      x.index = p->value[0];
-
-	      vec_add1 (do_fibs->ip4routes, x);
-	      if (sm->data_structure_lock->release_hint)
-		{
-		  start_at_fib_index = fib - im4->fibs;
-		  dsunlock (sm);
-		  ip46_fib_stats_delay (sm, 0 /* sec */ ,
-					STATS_RELEASE_DELAY_NS);
-		  mp->count = 0;
-		  ctrp = (vl_api_ip4_fib_counter_t *) mp->c;
-		  goto again;
-		}
-	    }
-	}
+      if (release_hint)
+	ip46_fib_stats_delay (sm, 0 /* sec */ , STATS_RELEASE_DELAY_NS);
+    }
+  while (start != FIB_NODE_INDEX_INVALID);
 
-      vec_foreach (r, do_fibs->ip4routes)
-      {
-	vlib_counter_t c;
-	const dpo_id_t *dpo_id;
-	u32 index;
-
-	dpo_id = fib_entry_contribute_ip_forwarding (r->index);
-	index = (u32) dpo_id->dpoi_index;
-
-	vlib_get_combined_counter (&load_balance_main.lbm_to_counters,
-				   index, &c);
-	/*
-	 * If it has actually
-	 * seen at least one packet, send it.
-	 */
-	if (c.packets > 0)
-	  {
+  /* nor are the entries after the last one */
+  if (vec_len (sm->fib_entry_last_export) > sm->fib_walk_next_index)
+    _vec_len (sm->fib_entry_last_export) = sm->fib_walk_next_index;
+}
 
-	    /* already in net byte order */
-	    ctrp->address = r->address.as_u32;
-	    ctrp->address_length = r->address_length;
-	    ctrp->packets = clib_host_to_net_u64 (c.packets);
-	    ctrp->bytes = clib_host_to_net_u64 (c.bytes);
-	    mp->count++;
-	    ctrp++;
-
-	    if (mp->count == items_this_message)
-	      {
-		mp->count = htonl (items_this_message);
-		/*
-		 * If the main thread's input queue is stuffed,
-		 * drop the data structure lock (which the main thread
-		 * may want), and take a pause.
-		 */
-		unix_shared_memory_queue_lock (q);
-		if (unix_shared_memory_queue_is_full (q))
-		  {
-		    dsunlock (sm);
-		    vl_msg_api_send_shmem_nolock (q, (u8 *) & mp);
-		    unix_shared_memory_queue_unlock (q);
-		    mp = 0;
-		    ip46_fib_stats_delay (sm, 0 /* sec */ ,
-					  STATS_RELEASE_DELAY_NS);
-		    goto again;
-		  }
-		vl_msg_api_send_shmem_nolock (q, (u8 *) & mp);
-		unix_shared_memory_queue_unlock (q);
-
-		items_this_message = IP4_FIB_COUNTER_BATCH_SIZE;
-		mp = vl_msg_api_alloc_as_if_client
-		  (sizeof (*mp) +
-		   items_this_message * sizeof (vl_api_ip4_fib_counter_t));
-		mp->_vl_msg_id = ntohs (VL_API_VNET_IP4_FIB_COUNTERS);
-		mp->count = 0;
-		mp->vrf_id = ntohl (fib->ft_table_id);
-		ctrp = (vl_api_ip4_fib_counter_t *) mp->c;
-	      }
-	  }			/* for each (mp or single) adj */
-	if (sm->data_structure_lock->release_hint)
-	  {
-	    start_at_fib_index = fib - im4->fibs;
-	    dsunlock (sm);
-	    ip46_fib_stats_delay (sm, 0 /* sec */ , STATS_RELEASE_DELAY_NS);
-	    mp->count = 0;
-	    ctrp = (vl_api_ip4_fib_counter_t *) mp->c;
-	    goto again;
-	  }
-      }				/* vec_foreach (routes) */
+static int
+ip46_fib_counter_change_cmp (void *a1, void *a2)
+{
+  ip46_fib_counter_change_t *c1 = a1, *c2 = a2;
 
-      dsunlock (sm);
+  return ((i64) c1->table_id - (i64) c2->table_id);
+}
 
-      /* Flush any data from this fib */
-      if (mp->count)
-	{
-	  mp->count = htonl (mp->count);
-	  vl_msg_api_send_shmem (q, (u8 *) & mp);
-	  mp = 0;
-	}
+/*
+ * If the main thread's input queue is stuffed, don't wait for it: drop
+ * the message and forget having exported the routes from this one on,
+ * they are sent again after the next walk. Returns 0 then.
+ */
+static int
+ip46_fib_stats_send (stats_main_t * sm, unix_shared_memory_queue_t * q,
+		     void *mp, ip46_fib_counter_change_t * changes, u32 first)
+{
+  u32 i;
+
+  if (PREDICT_TRUE (!unix_shared_memory_queue_is_full (q)))
+    {
+      vl_msg_api_send_shmem (q, (u8 *) & mp);
+      return 1;
     }
 
-  /* If e.g. the last FIB had no reportable routes, free the buffer */
-  if (mp)
-    vl_msg_api_free (mp);
+  vl_msg_api_free (mp);
+  for (i = first; i < vec_len (changes); i++)
+    sm->fib_entry_last_export[changes[i].fib_entry_index].packets = ~0ULL;
+  return 0;
 }
 
-typedef struct
-{
-  u32 fib_index;
-  ip6_route_t **routep;
-  stats_main_t *sm;
-} add_routes_in_fib_arg_t;
-
 static void
-add_routes_in_fib (BVT (clib_bihash_kv) * kvp, void *arg)
+do_ip4_fib_counters (stats_main_t * sm)
 {
-  add_routes_in_fib_arg_t *ap = arg;
-  stats_main_t *sm = ap->sm;
+  api_main_t *am = sm->api_main;
+  vl_shmem_hdr_t *shmem_hdr = am->shmem_hdr;
+  unix_shared_memory_queue_t *q = shmem_hdr->vl_input_queue;
+  ip46_fib_counter_change_t *changes =
+    sm->fib_counter_changes[FIB_PROTOCOL_IP4];
+  ip46_fib_counter_change_t *ch;
+  vl_api_vnet_ip4_fib_counters_t *mp = 0;
+  vl_api_ip4_fib_counter_t *ctrp = 0;
+  u32 count = 0, first = 0;
+
+  vec_sort_with_function (changes, ip46_fib_counter_change_cmp);
 
-  if (sm->data_structure_lock->release_hint)
-    clib_longjmp (&sm->jmp_buf, 1);
+  vec_foreach (ch, changes)
+  {
+    /* one message per batch of routes of the same vrf */
+    if (mp && (count == IP4_FIB_COUNTER_BATCH_SIZE ||
+	       ntohl (mp->vrf_id) != ch->table_id))
+      {
+	mp->count = htonl (count);
+	if (!ip46_fib_stats_send (sm, q, mp, changes, first))
+	  return;
+	mp = 0;
+      }
+    if (mp == 0)
+      {
+	mp = vl_msg_api_alloc_as_if_client
+	  (sizeof (*mp) +
+	   IP4_FIB_COUNTER_BATCH_SIZE * sizeof (vl_api_ip4_fib_counter_t));
+	mp->_vl_msg_id = ntohs (VL_API_VNET_IP4_FIB_COUNTERS);
+	mp->vrf_id = ntohl (ch->table_id);
+	ctrp = (vl_api_ip4_fib_counter_t *) mp->c;
+	count = 0;
+	first = ch - changes;
+      }
+
+    /* already in net byte order */
+    ctrp->address = ch->address.ip4.as_u32;
+    ctrp->address_length = ch->address_length;
+    ctrp->packets = clib_host_to_net_u64 (ch->counter.packets);
+    ctrp->bytes = clib_host_to_net_u64 (ch->counter.bytes);
+    ctrp++;
+    count++;
+  }
 
-  if (kvp->key[2] >> 32 == ap->fib_index)
+  if (mp)
     {
-      ip6_address_t *addr;
-      ip6_route_t *r;
-      addr = (ip6_address_t *) kvp;
-      vec_add2 (*ap->routep, r, 1);
-      r->address = addr[0];
-      r->address_length = kvp->key[2] & 0xFF;
-      r->index = kvp->value;
+      mp->count = htonl (count);
+      ip46_fib_stats_send (sm, q, mp, changes, first);
     }
 }
 
 static void
 do_ip6_fib_counters (stats_main_t * sm)
 {
-  ip6_main_t *im6 = &ip6_main;
   api_main_t *am = sm->api_main;
   vl_shmem_hdr_t *shmem_hdr = am->shmem_hdr;
   unix_shared_memory_queue_t *q = shmem_hdr->vl_input_queue;
-  ip6_route_t *r;
-  fib_table_t *fib;
-  do_ip46_fibs_t *do_fibs;
+  ip46_fib_counter_change_t *changes =
+    sm->fib_counter_changes[FIB_PROTOCOL_IP6];
+  ip46_fib_counter_change_t *ch;
   vl_api_vnet_ip6_fib_counters_t *mp = 0;
-  u32 items_this_message;
   vl_api_ip6_fib_counter_t *ctrp = 0;
-  u32 start_at_fib_index = 0;
-  BVT (clib_bihash) * h = &im6->ip6_table[IP6_FIB_TABLE_FWDING].ip6_hash;
-  add_routes_in_fib_arg_t _a, *a = &_a;
-  int i;
-
-  do_fibs = &sm->do_ip46_fibs;
-again:
-  vec_reset_length (do_fibs->fibs);
-  /* *INDENT-OFF* */
-  pool_foreach (fib, im6->fibs,
-                ({vec_add1(do_fibs->fibs,fib);}));
-  /* *INDENT-ON* */
-
-
-  for (i = 0; i < vec_len (do_fibs->fibs); i++)
-    {
-      fib = do_fibs->fibs[i];
-      /* We may have bailed out due to control-plane activity */
-      while ((fib - im6->fibs) < start_at_fib_index)
-	continue;
-
-      if (mp == 0)
-	{
-	  items_this_message = IP6_FIB_COUNTER_BATCH_SIZE;
-	  mp = vl_msg_api_alloc_as_if_client
-	    (sizeof (*mp) +
-	     items_this_message * sizeof (vl_api_ip6_fib_counter_t));
-	  mp->_vl_msg_id = ntohs (VL_API_VNET_IP6_FIB_COUNTERS);
-	  mp->count = 0;
-	  mp->vrf_id = ntohl (fib->ft_table_id);
-	  ctrp = (vl_api_ip6_fib_counter_t *) mp->c;
-	}
-
-      dslock (sm, 0 /* release hint */ , 1 /* tag */ );
-
-      vec_reset_length (do_fibs->ip6routes);
-      vec_reset_length (do_fibs->results);
+  u32 count = 0, first = 0;
 
-      a->fib_index = fib - im6->fibs;
-      a->routep = &do_fibs->ip6routes;
-      a->sm = sm;
+  vec_sort_with_function (changes, ip46_fib_counter_change_cmp);
 
-      if (clib_setjmp (&sm->jmp_buf, 0) == 0)
-	{
-	  start_at_fib_index = fib - im6->fibs;
-	  BV (clib_bihash_foreach_key_value_pair) (h, add_routes_in_fib, a);
-	}
-      else
-	{
-	  dsunlock (sm);
-	  ip46_fib_stats_delay (sm, 0 /* sec */ ,
-				STATS_RELEASE_DELAY_NS);
-	  mp->count = 0;
-	  ctrp = (vl_api_ip6_fib_counter_t *) mp->c;
-	  goto again;
-	}
-
-      vec_foreach (r, do_fibs->ip6routes)
+  vec_foreach (ch, changes)
+  {
+    /* one message per batch of routes of the same vrf */
+    if (mp && (count == IP6_FIB_COUNTER_BATCH_SIZE ||
+	       ntohl (mp->vrf_id) != ch->table_id))
       {
-	vlib_counter_t c;
-
-	vlib_get_combined_counter (&load_balance_main.lbm_to_counters,
-				   r->index, &c);
-	/*
-	 * If it has actually
-	 * seen at least one packet, send it.
-	 */
-	if (c.packets > 0)
-	  {
-	    /* already in net byte order */
-	    ctrp->address[0] = r->address.as_u64[0];
-	    ctrp->address[1] = r->address.as_u64[1];
-	    ctrp->address_length = (u8) r->address_length;
-	    ctrp->packets = clib_host_to_net_u64 (c.packets);
-	    ctrp->bytes = clib_host_to_net_u64 (c.bytes);
-	    mp->count++;
-	    ctrp++;
-
-	    if (mp->count == items_this_message)
-	      {
-		mp->count = htonl (items_this_message);
-		/*
-		 * If the main thread's input queue is stuffed,
-		 * drop the data structure lock (which the main thread
-		 * may want), and take a pause.
-		 */
-		unix_shared_memory_queue_lock (q);
-		if (unix_shared_memory_queue_is_full (q))
-		  {
-		    dsunlock (sm);
-		    vl_msg_api_send_shmem_nolock (q, (u8 *) & mp);
-		    unix_shared_memory_queue_unlock (q);
-		    mp = 0;
-		    ip46_fib_stats_delay (sm, 0 /* sec */ ,
-					  STATS_RELEASE_DELAY_NS);
-		    goto again;
-		  }
-		vl_msg_api_send_shmem_nolock (q, (u8 *) & mp);
-		unix_shared_memory_queue_unlock (q);
-
-		items_this_message = IP6_FIB_COUNTER_BATCH_SIZE;
-		mp = vl_msg_api_alloc_as_if_client
-		  (sizeof (*mp) +
-		   items_this_message * sizeof (vl_api_ip6_fib_counter_t));
-		mp->_vl_msg_id = ntohs (VL_API_VNET_IP6_FIB_COUNTERS);
-		mp->count = 0;
-		mp->vrf_id = ntohl (fib->ft_table_id);
-		ctrp = (vl_api_ip6_fib_counter_t *) mp->c;
-	      }
-	  }
-
-	if (sm->data_structure_lock->release_hint)
-	  {
-	    start_at_fib_index = fib - im6->fibs;
-	    dsunlock (sm);
-	    ip46_fib_stats_delay (sm, 0 /* sec */ , STATS_RELEASE_DELAY_NS);
-	    mp->count = 0;
-	    ctrp = (vl_api_ip6_fib_counter_t *) mp->c;
-	    goto again;
-	  }
-      }				/* vec_foreach (routes) */
-
-      dsunlock (sm);
+	mp->count = htonl (count);
+	if (!ip46_fib_stats_send (sm, q, mp, changes, first))
+	  return;
+	mp = 0;
+      }
+    if (mp == 0)
+      {
+	mp = vl_msg_api_alloc_as_if_client
+	  (sizeof (*mp) +
+	   IP6_FIB_COUNTER_BATCH_SIZE * sizeof (vl_api_ip6_fib_counter_t));
+	mp->_vl_msg_id = ntohs (VL_API_VNET_IP6_FIB_COUNTERS);
+	mp->vrf_id = ntohl (ch->table_id);
+	ctrp = (vl_api_ip6_fib_counter_t *) mp->c;
+	count = 0;
+	first = ch - changes;
+      }
 
-      /* Flush any data from this fib */
-      if (mp->count)
-	{
-	  mp->count = htonl (mp->count);
-	  vl_msg_api_send_shmem (q, (u8 *) & mp);
-	  mp = 0;
-	}
-    }
+    /* already in net byte order */
+    ctrp->address[0] = ch->address.ip6.as_u64[0];
+    ctrp->address[1] = ch->address.ip6.as_u64[1];
+    ctrp->address_length = (u8) ch->address_length;
+    ctrp->packets = clib_host_to_net_u64 (ch->counter.packets);
+    ctrp->bytes = clib_host_to_net_u64 (ch->counter.bytes);
+    ctrp++;
+    count++;
+  }
 
-  /* If e.g. the last FIB had no reportable routes, free the buffer */
   if (mp)
-    vl_msg_api_free (mp);
+    {
+      mp->count = htonl (count);
+      ip46_fib_stats_send (sm, q, mp, changes, first);
+    }
 }
 
 static void
@@ -1801,6 +1682,8 @@ stats_thread_fn (void *arg)
       /* 10 second poll interval */
       ip46_fib_stats_delay (sm, 10 /* secs */ , 0 /* nsec */ );
 
+      do_stat_segment_updates (sm);
+
       if (!(sm->enable_poller))
 	{
 	  continue;
@@ -1813,11 +1696,13 @@ stats_thread_fn (void *arg)
 	  (sm->stats_registrations[IDX_PER_INTERFACE_SIMPLE_COUNTERS]))
 	do_simple_per_interface_counters (sm);
 
-      if (pool_elts (sm->stats_registrations[IDX_IP4_FIB_COUNTERS]))
-	do_ip4_fib_counters (sm);
-
-      if (pool_elts (sm->stats_registrations[IDX_IP6_FIB_COUNTERS]))
-	do_ip6_fib_counters (sm);
+      if (pool_elts (sm->stats_registrations[IDX_IP4_FIB_COUNTERS]) ||
+	  pool_elts (sm->stats_registrations[IDX_IP6_FIB_COUNTERS]))
+	{
+	  do_ip46_fib_walk (sm);
+	  do_ip4_fib_counters (sm);
+	  do_ip6_fib_counters (sm);
+	}
 
       if (pool_elts (sm->stats_registrations[IDX_IP4_NBR_COUNTERS]))
 	do_ip4_nbr_counters (sm);
@@ -2186,6 +2071,9 @@ vl_api_want_ip4_fib_stats_t_handler (vl_api_want_ip4_fib_stats_t * mp)
 
   handle_client_registration (&rp, IDX_IP4_FIB_COUNTERS, fib,
 			      mp->enable_disable);
+  /* a new client wants every route, not only the changed ones */
+  if (mp->enable_disable)
+    sm->fib_counters_full_export = 1;
 
 reply:
   q = vl_api_client_index_to_input_queue (mp->client_index);
@@ -2222,6 +2110,9 @@ vl_api_want_ip6_fib_stats_t_handler (vl_api_want_ip6_fib_stats_t * mp)
 
   handle_client_registration (&rp, IDX_IP6_FIB_COUNTERS, fib,
 			      mp->enable_disable);
+  /* a new client wants every route, not only the changed ones */
+  if (mp->enable_disable)
+    sm->fib_counters_full_export = 1;
 
 reply:
   q = vl_api_client_index_to_input_queue (mp->client_index);
@@ -26,6 +26,8 @@
 #include <vlibmemory/api.h>
 #include <vlibmemory/unix_shared_memory_queue.h>
 #include <vlibapi/api_helper_macros.h>
+#include <vppinfra/lock.h>
+#include <vpp/stats/stat_segment.h>
 
 typedef struct
 {
@@ -40,14 +42,6 @@ typedef struct
  * @brief stats request registration indexes
  *
  */
-/* from .../vnet/vnet/ip/lookup.c. Yuck */
-typedef CLIB_PACKED (struct
-		     {
-		     ip4_address_t address;
-u32 address_length: 6;
-u32 index:	     26;
-		     }) ip4_route_t;
-
 /* see interface.api */
 typedef struct
 {
@@ -63,6 +57,16 @@ typedef struct
   u64 rx_mpls;
 } vnet_simple_counter_t;
 
+/*
+ * FIB entry counters as last exported. They are those of the entry's
+ * load-balance, which changes when the entry's forwarding does.
+ */
+typedef struct
+{
+  u32 lb_index;
+  u64 packets;
+} fib_entry_last_export_t;
+
 typedef struct
 {
   u32 sw_if_index;
@@ -72,22 +76,15 @@ typedef struct
   u64 tx_bytes;			/**< byte counter  */
 } vnet_combined_counter_t;
 
+/* route whose counters changed since they were last exported */
 typedef struct
 {
-  ip6_address_t address;
+  fib_node_index_t fib_entry_index;
+  u32 table_id;
   u32 address_length;
-  u32 index;
-} ip6_route_t;
-
-
-typedef struct
-{
-  ip4_route_t *ip4routes;
-  ip6_route_t *ip6routes;
-  fib_table_t **fibs;
-  hash_pair_t **pvec;
-  uword *results;
-} do_ip46_fibs_t;
+  ip46_address_t address;
+  vlib_counter_t counter;
+} ip46_fib_counter_change_t;
 
 typedef struct
 {
@@ -164,11 +161,14 @@ typedef struct
   /* control-plane data structure lock */
   data_structure_lock_t *data_structure_lock;
 
-  /* bail out of FIB walk if set */
-  clib_longjmp_t jmp_buf;
-
-  /* Vectors for Distribution funcs: do_ip4_fibs and do_ip6_fibs. */
-  do_ip46_fibs_t do_ip46_fibs;
+  /*
+   * FIB counters export: counters of each FIB entry as last exported,
+   * and the routes to export by fib protocol (ip4, ip6).
+   */
+  fib_entry_last_export_t *fib_entry_last_export;
+  fib_node_index_t fib_walk_next_index;
+  ip46_fib_counter_change_t *fib_counter_changes[2];
+  volatile u32 fib_counters_full_export;
 
   /*
      Working vector vars so as to not thrash memory allocator.
@@ -177,6 +177,25 @@ typedef struct
   vpe_client_stats_registration_t **regs_tmp;
   vpe_client_registration_t **clients_tmp;
 
+  /* statistics segment, see stat_segment.h */
+  stat_segment_shared_header_t *stat_segment;
+  void *stat_segment_heap;
+  void *stat_segment_main_heap;
+  u8 *stat_segment_name;
+  uword stat_segment_size;
+  u32 stat_segment_gid;
+  /* no more counters published once set */
+  u8 stat_segment_full;
+  /* kept open, vpp holds its lock as long as it runs */
+  int stat_segment_fd;
+  clib_spinlock_t stat_segment_lock;
+  uword *stat_segment_directory_by_name;
+  /* published as offsets in the shared header */
+  stat_segment_directory_entry_t *stat_segment_directory;
+  u64 **stat_segment_error_vector;
+  u32 vector_rate_index;
+  u32 last_update_index;
+
   /* convenience */
   vlib_main_t *vlib_main;
   vnet_main_t *vnet_main;
@@ -188,6 +207,7 @@ extern stats_main_t stats_main;
 
 void dslock (stats_main_t * sm, int release_hint, int tag);
 void dsunlock (stats_main_t * sm);
+void do_stat_segment_updates (stats_main_t * sm);
 
 #endif /* __included_stats_h__ */
 
@@ -329,11 +329,45 @@ static inline int BV (clib_bihash_search_inline)
   return -1;
 }
 
-static inline int BV (clib_bihash_search_inline_2)
+/*
+ * Prefetch the bucket for a precomputed hash. Together with
+ * clib_bihash_prefetch_data() and clib_bihash_search_inline_2_with_hash()
+ * this lets the caller compute the hashes for a batch of keys upfront,
+ * and overlap the memory accesses of the subsequent lookups.
+ */
+static inline void BV (clib_bihash_prefetch_bucket)
+  (BVT (clib_bihash) * h, u64 hash)
+{
+  u32 bucket_index = hash & (h->nbuckets - 1);
+
+  CLIB_PREFETCH (&h->buckets[bucket_index], CLIB_CACHE_LINE_BYTES, LOAD);
+}
+
+/* Prefetch the key/value page, the bucket should have been prefetched */
+static inline void BV (clib_bihash_prefetch_data)
+  (BVT (clib_bihash) * h, u64 hash)
+{
+  u32 bucket_index;
+  BVT (clib_bihash_value) * v;
+  BVT (clib_bihash_bucket) * b;
+
+  bucket_index = hash & (h->nbuckets - 1);
+  b = &h->buckets[bucket_index];
+
+  if (PREDICT_FALSE (b->offset == 0))
+    return;
+
+  hash >>= h->log2_nbuckets;
+  v = BV (clib_bihash_get_value) (h, b->offset);
+  v += (b->linear_search == 0) ? hash & ((1 << b->log2_pages) - 1) : 0;
+
+  CLIB_PREFETCH (v, CLIB_CACHE_LINE_BYTES, LOAD);
+}
+
+static inline int BV (clib_bihash_search_inline_2_with_hash)
   (BVT (clib_bihash) * h,
-   BVT (clib_bihash_kv) * search_key, BVT (clib_bihash_kv) * valuep)
+   u64 hash, BVT (clib_bihash_kv) * search_key, BVT (clib_bihash_kv) * valuep)
 {
-  u64 hash;
   u32 bucket_index;
   BVT (clib_bihash_value) * v;
   BVT (clib_bihash_bucket) * b;
@@ -344,8 +378,6 @@ static inline int BV (clib_bihash_search_inline_2)
 
   ASSERT (valuep);
 
-  hash = BV (clib_bihash_hash) (search_key);
-
   bucket_index = hash & (h->nbuckets - 1);
   b = &h->buckets[bucket_index];
 
@@ -406,6 +438,18 @@ static inline int BV (clib_bihash_search_inline_2)
   return -1;
 }
 
+static inline int BV (clib_bihash_search_inline_2)
+  (BVT (clib_bihash) * h,
+   BVT (clib_bihash_kv) * search_key, BVT (clib_bihash_kv) * valuep)
+{
+  u64 hash;
+
+  hash = BV (clib_bihash_hash) (search_key);
+
+  return BV (clib_bihash_search_inline_2_with_hash) (h, hash, search_key,
+						      valuep);
+}
+
 #endif /* __included_bihash_template_h__ */
 
 /** @endcond */
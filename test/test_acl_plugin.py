@@ -1156,6 +1156,50 @@ class TestACLplugin(VppTestCase):
 
         self.logger.info("ACLP_TEST_FINISH_0023")
 
+    def test_0024_acl_replace_applied(self):
+        """ replace an ACL in place while it is applied
+        """
+        self.logger.info("ACLP_TEST_START_0024")
+
+        rules = []
+        rules.append(self.create_rule(self.IPV4, self.PERMIT,
+                     self.PORTS_ALL, self.proto[self.IP][self.UDP]))
+        rules.append(self.create_rule(self.IPV4, self.PERMIT,
+                     self.PORTS_ALL, self.proto[self.IP][self.TCP]))
+        reply = self.vapi.acl_add_replace(acl_index=4294967295, r=rules,
+                                          tag="permit udp;permit tcp")
+        acl_index = reply.acl_index
+        for i in self.pg_interfaces:
+            self.vapi.acl_interface_set_acl_list(sw_if_index=i.sw_if_index,
+                                                 n_input=1,
+                                                 acls=[acl_index])
+
+        # Traffic should pass
+        self.run_verify_test(self.IP, self.IPV4,
+                             self.proto[self.IP][self.UDP])
+
+        # Change the first rule and add one more in the applied ACL
+        rules = []
+        rules.append(self.create_rule(self.IPV4, self.DENY,
+                     self.PORTS_ALL, self.proto[self.IP][self.UDP]))
+        rules.append(self.create_rule(self.IPV4, self.PERMIT,
+                     self.PORTS_ALL, self.proto[self.IP][self.TCP]))
+        rules.append(self.create_rule(self.IPV4, self.PERMIT,
+                                      self.PORTS_ALL, 0))
+        reply = self.vapi.acl_add_replace(acl_index=acl_index, r=rules,
+                                          tag="deny udp;permit all")
+        self.assertEqual(reply.acl_index, acl_index)
+        self.logger.info("ACL update took %d usec" % reply.update_usec)
+
+        # UDP traffic should not pass anymore, TCP still should
+        self.run_verify_negat_test(self.IP, self.IPV4,
+                                   self.proto[self.IP][self.UDP])
+        self.reset_packet_infos()
+        self.run_verify_test(self.IP, self.IPV4,
+                             self.proto[self.IP][self.TCP])
+
+        self.logger.info("ACLP_TEST_FINISH_0024")
+
     def test_0108_tcp_permit_v4(self):
         """ permit TCPv4 + non-match range
         """
@@ -15,6 +15,8 @@ from util import ppp
   - IP4 to GRE6 encap
   - IP6 to GRE4 encap
   - IP6 to GRE6 encap
+  - IP4 and IP6 L2 direct server return
+  - IP4 L3 direct server return
 
  As stated in comments below, GRE has issues with IPv6.
  All test cases involving IPv6 are executed, but
@@ -44,6 +46,10 @@ class TestLB(VppTestCase):
                 i.disable_ipv6_ra()
                 i.resolve_arp()
                 i.resolve_ndp()
+            # Directly connected ASs for L2DSR
+            cls.pg1.generate_remote_hosts(len(cls.ass))
+            cls.pg1.configure_ipv4_neighbors()
+            cls.pg1.configure_ipv6_neighbors()
             dst4 = socket.inet_pton(socket.AF_INET, "10.0.0.0")
             dst6 = socket.inet_pton(socket.AF_INET6, "2002::")
             cls.vapi.ip_add_del_route(dst4, 24, cls.pg1.remote_ip4n)
@@ -138,6 +144,46 @@ class TestLB(VppTestCase):
                 self.logger.error(ppp("Unexpected or invalid packet:", p))
                 raise
 
+        self.checkLoad(load)
+
+    def checkDSRCapture(self, isv4, dscp=None):
+        """ Check packets sent without encap, with L2DSR if dscp is None,
+        L3DSR otherwise """
+        self.pg0.assert_nothing_captured()
+        out = self.pg1.get_capture(len(self.packets))
+
+        IPver = IP if isv4 else IPv6
+        load = [0] * len(self.ass)
+        self.info = None
+        for p in out:
+            try:
+                ip = p[IPver]
+                payload_info = self.payload_to_info(str(p[Raw]))
+                self.info = self.packet_infos[payload_info.index]
+                self.assertEqual(payload_info.src, self.pg0.sw_if_index)
+                sent = self.info.data[IPver]
+                self.assertEqual(ip.src, sent.src)
+                self.assertEqual(str(ip[UDP]), str(sent[UDP]))
+                if dscp is None:
+                    # Only the MAC address says which AS it is sent to
+                    host = self.pg1.host_by_mac(p[Ether].dst)
+                    asid = self.pg1.remote_hosts.index(host)
+                    self.assertEqual(ip.dst, sent.dst)
+                else:
+                    asid = int(ip.dst.split(".")[3])
+                    self.assertEqual(ip.dst, "10.0.0.%u" % asid)
+                    self.assertEqual(ip.tos, dscp << 2)
+                    chksum = ip.chksum
+                    del ip.chksum
+                    self.assertEqual(IP(str(ip)).chksum, chksum)
+                load[asid] += 1
+            except:
+                self.logger.error(ppp("Unexpected or invalid packet:", p))
+                raise
+
+        self.checkLoad(load)
+
+    def checkLoad(self, load):
         # This is just to roughly check that the balancing algorithm
         # is not completly biased.
         for asid in self.ass:
@@ -164,6 +210,32 @@ class TestLB(VppTestCase):
             self.vapi.cli("lb vip 90.0.0.0/8 encap gre4 del")
             self.vapi.cli("test lb flowtable flush")
 
+    def test_lb_ip4_gre4_flush(self):
+        """ Load Balancer IP4 GRE4 after a flowtable flush """
+        try:
+            self.vapi.cli("lb vip 90.0.0.0/8 encap gre4")
+            for asid in self.ass:
+                self.vapi.cli("lb as 90.0.0.0/8 10.0.0.%u" % (asid))
+
+            self.pg0.add_stream(self.generatePackets(self.pg0, isv4=True))
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            self.checkCapture(gre4=True, isv4=True)
+
+            # The VIP is kept, its traffic goes to emptied flow tables
+            self.vapi.cli("test lb flowtable flush")
+
+            self.pg0.add_stream(self.generatePackets(self.pg0, isv4=True))
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+            self.checkCapture(gre4=True, isv4=True)
+
+        finally:
+            for asid in self.ass:
+                self.vapi.cli("lb as 90.0.0.0/8 10.0.0.%u del" % (asid))
+            self.vapi.cli("lb vip 90.0.0.0/8 encap gre4 del")
+            self.vapi.cli("test lb flowtable flush")
+
     def test_lb_ip6_gre4(self):
         """ Load Balancer IP6 GRE4 """
 
@@ -218,3 +290,65 @@ class TestLB(VppTestCase):
                 self.vapi.cli("lb as 2001::/16 2002::%u del" % (asid))
             self.vapi.cli("lb vip 2001::/16 encap gre6 del")
             self.vapi.cli("test lb flowtable flush")
+
+    def test_lb_ip4_l2dsr(self):
+        """ Load Balancer IP4 L2DSR """
+        try:
+            self.vapi.cli("lb vip 90.0.0.0/8 encap l2dsr")
+            for asid in self.ass:
+                self.vapi.cli("lb as 90.0.0.0/8 %s" %
+                              self.pg1.remote_hosts[asid].ip4)
+
+            self.pg0.add_stream(self.generatePackets(self.pg0, isv4=True))
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+
+            self.checkDSRCapture(isv4=True)
+        finally:
+            for asid in self.ass:
+                self.vapi.cli("lb as 90.0.0.0/8 %s del" %
+                              self.pg1.remote_hosts[asid].ip4)
+            self.vapi.cli("lb vip 90.0.0.0/8 encap l2dsr del")
+            self.vapi.cli("test lb flowtable flush")
+
+    def test_lb_ip6_l2dsr(self):
+        """ Load Balancer IP6 L2DSR """
+        try:
+            self.vapi.cli("lb vip 2001::/16 encap l2dsr")
+            for asid in self.ass:
+                self.vapi.cli("lb as 2001::/16 %s" %
+                              self.pg1.remote_hosts[asid].ip6)
+
+            self.pg0.add_stream(self.generatePackets(self.pg0, isv4=False))
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+
+            self.checkDSRCapture(isv4=False)
+        finally:
+            for asid in self.ass:
+                self.vapi.cli("lb as 2001::/16 %s del" %
+                              self.pg1.remote_hosts[asid].ip6)
+            self.vapi.cli("lb vip 2001::/16 encap l2dsr del")
+            self.vapi.cli("test lb flowtable flush")
+
+    def test_lb_ip4_l3dsr(self):
+        """ Load Balancer IP4 L3DSR """
+        try:
+            self.vapi.cli("lb vip 90.0.0.0/8 encap l3dsr dscp 7")
+            for asid in self.ass:
+                self.vapi.cli("lb as 90.0.0.0/8 10.0.0.%u" % (asid))
+
+            self.pg0.add_stream(self.generatePackets(self.pg0, isv4=True))
+            self.pg_enable_capture(self.pg_interfaces)
+            self.pg_start()
+
+            self.checkDSRCapture(isv4=True, dscp=7)
+
+            out = self.vapi.cli("show lb vips verbose")
+            self.assertIn("sent to application servers: %u packets" %
+                          len(self.packets), out)
+        finally:
+            for asid in self.ass:
+                self.vapi.cli("lb as 90.0.0.0/8 10.0.0.%u del" % (asid))
+            self.vapi.cli("lb vip 90.0.0.0/8 encap l3dsr del")
+            self.vapi.cli("test lb flowtable flush")